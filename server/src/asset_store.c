@@ -0,0 +1,228 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#include <dirent.h>
+#include <glib.h>
+#include <inttypes.h>
+#include <onion/mime.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "asset_store.h"
+#include "server.h"
+#include "communication_utils.h"
+
+// Length of a quoted 64-bit hexadecimal ETag, including the terminating 0
+#define ASSET_STORE_ETAG_LEN	19
+
+typedef struct {
+	char *content;
+	size_t content_len;
+	// NULL if compression does not pay off
+	char *content_gzip;
+	size_t content_gzip_len;
+	const char *content_type;
+	// The gzip variant has its own ETag with a "-gzip" suffix
+	char etag[ASSET_STORE_ETAG_LEN];
+	char etag_gzip[ASSET_STORE_ETAG_LEN + 5];
+} t_asset;
+
+// Path relative to the asset directory -> t_asset. Only modified by load and free,
+// which happen before and after the server listens, so it is read without locking.
+static GHashTable *assets = NULL;
+static size_t assets_size_total = 0;
+
+static void free_asset(void *pointer) {
+	t_asset *asset = pointer;
+	free(asset->content);
+	free(asset->content_gzip);
+	free(asset);
+}
+
+static void compute_etag(const char *content, size_t content_len, 
+                         char etag[ASSET_STORE_ETAG_LEN]) {
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < content_len; i++) {
+		hash ^= (unsigned char) content[i];
+		hash *= 1099511628211ULL;
+	}
+	snprintf(etag, ASSET_STORE_ETAG_LEN, "\"%016" PRIx64 "\"", hash);
+}
+
+static bool read_file(const char *filepath, size_t size, char **content) {
+	FILE *file = fopen(filepath, "rb");
+	if (file == NULL) {
+		return false;
+	}
+	*content = malloc(size > 0 ? size : 1);
+	const bool success = *content != NULL && fread(*content, 1, size, file) == size;
+	fclose(file);
+	if (!success) {
+		free(*content);
+		*content = NULL;
+	}
+	return success;
+}
+
+// Compresses the asset content in gzip format, keeps the result if it is small enough
+static void compress_asset(t_asset *asset) {
+	z_stream stream = {0};
+	// 15 window bits + 16 for a gzip header
+	if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, 
+	                 Z_DEFAULT_STRATEGY) != Z_OK) {
+		return;
+	}
+	const uLong bound = deflateBound(&stream, asset->content_len);
+	char *compressed = malloc(bound);
+	if (compressed == NULL) {
+		deflateEnd(&stream);
+		return;
+	}
+	stream.next_in = (Bytef *) asset->content;
+	stream.avail_in = asset->content_len;
+	stream.next_out = (Bytef *) compressed;
+	stream.avail_out = bound;
+	const int result = deflate(&stream, Z_FINISH);
+	const size_t compressed_len = stream.total_out;
+	deflateEnd(&stream);
+	
+	if (result == Z_STREAM_END 
+	    && compressed_len * 100 <= asset->content_len * ASSET_STORE_GZIP_RATIO_MAX) {
+		asset->content_gzip = compressed;
+		asset->content_gzip_len = compressed_len;
+	} else {
+		free(compressed);
+	}
+}
+
+static bool load_asset(const char *filepath, const char *path, size_t size) {
+	t_asset *asset = calloc(1, sizeof(t_asset));
+	if (asset == NULL || !read_file(filepath, size, &asset->content)) {
+		free(asset);
+		syslog_server(LOG_ERR, "Asset store - could not read %s", filepath);
+		return false;
+	}
+	asset->content_len = size;
+	asset->content_type = onion_mime_get(path);
+	compute_etag(asset->content, asset->content_len, asset->etag);
+	snprintf(asset->etag_gzip, sizeof(asset->etag_gzip), "%.17s-gzip\"", asset->etag);
+	compress_asset(asset);
+	g_hash_table_insert(assets, strdup(path), asset);
+	assets_size_total += asset->content_len + asset->content_gzip_len;
+	return true;
+}
+
+static bool load_directory(const char *directory, const char *path_prefix) {
+	DIR *dir_handle = opendir(directory);
+	if (dir_handle == NULL) {
+		syslog_server(LOG_ERR, "Asset store - directory %s could not be opened", directory);
+		return false;
+	}
+	struct dirent *dir_entry = NULL;
+	while ((dir_entry = readdir(dir_handle)) != NULL) {
+		if (dir_entry->d_name[0] == '.') {
+			continue;
+		}
+		GString *filepath = g_string_new(directory);
+		g_string_append_printf(filepath, "/%s", dir_entry->d_name);
+		GString *path = g_string_new(path_prefix);
+		g_string_append_printf(path, "/%s", dir_entry->d_name);
+		
+		struct stat st;
+		if (stat(filepath->str, &st) == 0) {
+			if (S_ISDIR(st.st_mode)) {
+				load_directory(filepath->str, path->str);
+			} else if (S_ISREG(st.st_mode) && st.st_size <= ASSET_STORE_FILE_SIZE_MAX) {
+				load_asset(filepath->str, path->str, (size_t) st.st_size);
+			}
+		}
+		g_string_free(filepath, true);
+		g_string_free(path, true);
+	}
+	closedir(dir_handle);
+	return true;
+}
+
+bool asset_store_load(const char *directory) {
+	asset_store_free();
+	assets = g_hash_table_new_full(g_str_hash, g_str_equal, free, free_asset);
+	assets_size_total = 0;
+	const bool success = load_directory(directory, "");
+	syslog_server(LOG_NOTICE, "Asset store - loaded %u assets (%zu bytes) from %s",
+	              g_hash_table_size(assets), assets_size_total, directory);
+	return success;
+}
+
+static bool header_contains(onion_request *req, const char *header, const char *value) {
+	const char *header_value = onion_request_get_header(req, header);
+	return header_value != NULL && strstr(header_value, value) != NULL;
+}
+
+bool asset_store_serve(const char *path, onion_request *req, onion_response *res) {
+	if (assets == NULL || path == NULL) {
+		return false;
+	}
+	const t_asset *asset = g_hash_table_lookup(assets, path);
+	if (asset == NULL) {
+		return false;
+	}
+	const bool gzip = asset->content_gzip != NULL 
+	                  && header_contains(req, "Accept-Encoding", "gzip");
+	const char *etag = gzip ? asset->etag_gzip : asset->etag;
+	onion_response_set_header(res, "ETag", etag);
+	if (asset->content_gzip != NULL) {
+		onion_response_set_header(res, "Vary", "Accept-Encoding");
+	}
+	if (header_contains(req, "If-None-Match", etag)) {
+		set_response_code(res, HTTP_NOT_MODIFIED);
+		onion_response_set_length(res, 0);
+		return true;
+	}
+	onion_response_set_header(res, "Content-Type", asset->content_type);
+	if (gzip) {
+		onion_response_set_header(res, "Content-Encoding", "gzip");
+		onion_response_set_length(res, asset->content_gzip_len);
+		onion_response_write(res, asset->content_gzip, asset->content_gzip_len);
+	} else {
+		onion_response_set_length(res, asset->content_len);
+		onion_response_write(res, asset->content, asset->content_len);
+	}
+	return true;
+}
+
+void asset_store_free(void) {
+	if (assets != NULL) {
+		g_hash_table_destroy(assets);
+		assets = NULL;
+	}
+}
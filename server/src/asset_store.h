@@ -0,0 +1,69 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#ifndef ASSET_STORE_H
+#define ASSET_STORE_H
+
+#include <onion/onion.h>
+#include <stdbool.h>
+
+// Assets larger than this are not preloaded, but served from the file system
+#define ASSET_STORE_FILE_SIZE_MAX	(4 * 1024 * 1024)
+// Gzip variants are only kept if they are at most this percentage of the original size
+#define ASSET_STORE_GZIP_RATIO_MAX	90
+
+/**
+ * Loads all files in the asset directory (recursively) into memory, along with their
+ * content type, ETag, and a gzip variant where compression pays off. 
+ * Shall be called once before the server starts listening.
+ * 
+ * @param directory asset directory
+ * @return true if the directory could be read, false otherwise
+ */
+bool asset_store_load(const char *directory);
+
+/**
+ * Serves a preloaded asset from memory. Answers with 304 Not Modified if the If-None-Match 
+ * header of the request matches the ETag, and sends the gzip variant if the client
+ * accepts it.
+ * 
+ * @param path path of the asset relative to the asset directory, starting with '/'
+ * @param req request
+ * @param res response to send over
+ * @return true if the asset is preloaded and was served, 
+ * false if it is not preloaded (nothing is sent in this case)
+ */
+bool asset_store_serve(const char *path, onion_request *req, onion_response *res);
+
+/**
+ * Frees all preloaded assets.
+ */
+void asset_store_free(void);
+
+#endif  // ASSET_STORE_H
@@ -367,6 +367,7 @@ class Driver {
 	trainAvailabilityInterval = null;
 	updatePossibleDestinationsInterval = null;
 	destinationReachedInterval = null;
+	destinationReachedStream = null;
 
 
 	constructor(trackOutput, trainEngine, trainId) {
@@ -384,6 +385,7 @@ class Driver {
 		this.trainAvailabilityInterval = null;
 		this.updatePossibleDestinationsInterval = null;
 		this.destinationReachedInterval = null;
+		this.destinationReachedStream = null;
 
 		drivingTimer = new Timer();
 	}
@@ -414,6 +416,10 @@ class Driver {
 	clearDestinationReachedInterval() {
 		console.log("clearDestinationReachedInterval");
 		clearInterval(this.destinationReachedInterval);
+		if (this.destinationReachedStream !== null) {
+			this.destinationReachedStream.close();
+			this.destinationReachedStream = null;
+		}
 	}
 
 	// Request for the train's current block
@@ -631,9 +637,66 @@ class Driver {
 	}
 
 
+	// Show the destination reached button once the train occupies the destination segment
+	checkDestinationReached(segmentIDs) {
+		const segments = segmentIDs.map(s => s.replace(/(a|b)$/, ''));
+
+		///NOTE: Adjusted this to enable DestinationReached, when the train
+		//       occupies the expected destination main segment (this.routeDetails['segment'])
+		//       AND the train occupies 3 segments or less.
+		//       Previously, DestinationReached would only be enabled if the train
+		//       *exclusively* occupied the destination main segment. This was problematic
+		//       for routes with a short main segment on the block at end of the route.
+		//       Drivers were getting a warning for stopping, even though they were already
+		//       close to the destination signal.
+		///TODO: Test if this can be simplified by `&& this.routeDetails['segment'] in segments`
+		if (segments.length <= 3) {
+			for (let index in segments) {
+				if (segments[index] === this.routeDetails['segment']) {
+					this.clearDestinationReachedInterval();
+					this.isDestinationReached = true;
+					$('#endGameButton').show();
+					$(window).unbind('beforeunload', pageRefreshWarning);
+					return;
+				}
+			}
+		}
+	}
+
+	// Monitor the train's current segments via the server's state stream,
+	// and fall back to polling if the stream is not available
+	enableDestinationReachedPromise() {
+		if (typeof EventSource === 'undefined') {
+			this.enableDestinationReachedPolling();
+			return;
+		}
+		let streamIsOpen = false;
+		this.destinationReachedStream = new EventSource(serverAddress + '/monitor/state-stream');
+		const onStateObjects = (event) => {
+			streamIsOpen = true;
+			const stateObjects = JSON.parse(event.data);
+			for (const stateObject of stateObjects) {
+				if (stateObject.type === 'train' && stateObject.id === this.trainId
+					&& stateObject.on_track && !this.isDestinationReached) {
+					this.checkDestinationReached(stateObject.occupied_segments);
+				}
+			}
+		};
+		this.destinationReachedStream.addEventListener('snapshot', onStateObjects);
+		this.destinationReachedStream.addEventListener('delta', onStateObjects);
+		this.destinationReachedStream.onerror = () => {
+			if (!streamIsOpen && this.destinationReachedStream !== null) {
+				console.warn("/monitor/state-stream not available, polling instead");
+				this.destinationReachedStream.close();
+				this.destinationReachedStream = null;
+				this.enableDestinationReachedPolling();
+			}
+		};
+	}
+
 	// Request for the train's current segment and then determine
 	// whether to show the destination reached button
-	enableDestinationReachedPromise() {
+	enableDestinationReachedPolling() {
 		const destinationReachedTimeout = 100;
 		this.destinationReachedInterval = setInterval(() => {
 			return $.ajax({
@@ -648,29 +711,7 @@ class Driver {
 						return;
 					}
 
-					const segmentIDs = responseJson.occupied_segments;
-					const segments = segmentIDs.map(s => s.replace(/(a|b)$/, ''));
-
-					///NOTE: Adjusted this to enable DestinationReached, when the train
-					//       occupies the expected destination main segment (this.routeDetails['segment'])
-					//       AND the train occupies 3 segments or less.
-					//       Previously, DestinationReached would only be enabled if the train
-					//       *exclusively* occupied the destination main segment. This was problematic
-					//       for routes with a short main segment on the block at end of the route.
-					//       Drivers were getting a warning for stopping, even though they were already
-					//       close to the destination signal.
-					///TODO: Test if this can be simplified by `&& this.routeDetails['segment'] in segments`
-					if (segments.length <= 3) {
-						for (let index in segments) {
-							if (segments[index] === this.routeDetails['segment']) {
-								this.clearDestinationReachedInterval();
-								this.isDestinationReached = true;
-								$('#endGameButton').show();
-								$(window).unbind('beforeunload', pageRefreshWarning);
-								return;
-							}
-						}
-					}
+					this.checkDestinationReached(responseJson.occupied_segments);
 					/* OLD VERSION - SEE NOTE ABOVE
 					for (let index in segments) {
 						if (segments[index] != this.routeDetails['segment']) {
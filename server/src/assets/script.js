@@ -95,8 +95,15 @@ function updateTrainIsForwards() {
 	});
 }
 
+function showTrainGrabbedState(trainId, isGrabbed) {
+	if (isGrabbed) {
+		$(`#releaseTrainButton_${trainId}`).show();
+	} else {
+		$(`#releaseTrainButton_${trainId}`).hide();
+	}
+}
+
 function updateTrainGrabbedState() {
-	// Called from client.html
 	return $.ajax({
 		type: 'GET',
 		url: '/monitor/trains',
@@ -105,13 +112,7 @@ function updateTrainGrabbedState() {
 		success: function (responseText) {
 			const responseJson = JSON.parse(responseText);
 			responseJson['trains'].forEach((train) => {
-				const trainId = train.id;
-				const isGrabbed = train.grabbed;
-				if (isGrabbed) {
-					$(`#releaseTrainButton_${trainId}`).show();
-				} else {
-					$(`#releaseTrainButton_${trainId}`).hide();
-				}
+				showTrainGrabbedState(train.id, train.grabbed);
 			});
 		}
 	});
@@ -232,25 +233,80 @@ function updateGrantedRoutes(htmlElement) {
 		dataType: 'text',
 		success: function (responseText) {
 			const responseJson = JSON.parse(responseText);
-			htmlElement.empty();
-			if (!responseJson['granted-routes'] || responseJson['granted-routes'].length === 0) {
-				htmlElement.html('<li>No granted routes</li>');
-				return;
-			}
-			responseJson['granted-routes'].forEach((route) => {
-				const routeId = route['id'];
-				const trainId = route.train;
-				const routeText = `route ${routeId} granted to ${trainId}`;
-				const releaseButton = `<button class="grantedRoute btn smallerLineHeight btn-outline-primary" value=${routeId}>Release</button>`;
-				htmlElement.append(`<li>${routeText} ${releaseButton}</li>`);
-			});
-			$('.grantedRoute').click(function (event) {
-				adminReleaseRoute(event.currentTarget.value);
-			});
+			showGrantedRoutes(htmlElement, responseJson['granted-routes']);
 		}
 	});
 }
 
+function showGrantedRoutes(htmlElement, grantedRoutes) {
+	htmlElement.empty();
+	if (!grantedRoutes || grantedRoutes.length === 0) {
+		htmlElement.html('<li>No granted routes</li>');
+		return;
+	}
+	grantedRoutes.forEach((route) => {
+		const routeId = route['id'];
+		const trainId = route.train;
+		const routeText = `route ${routeId} granted to ${trainId}`;
+		const releaseButton = `<button class="grantedRoute btn smallerLineHeight btn-outline-primary" value=${routeId}>Release</button>`;
+		htmlElement.append(`<li>${routeText} ${releaseButton}</li>`);
+	});
+	$('.grantedRoute').click(function (event) {
+		adminReleaseRoute(event.currentTarget.value);
+	});
+}
+
+// Follows the grabbed trains and the granted routes via the server's state stream, 
+// and falls back to polling if the browser does not support server-sent events.
+// Called from client.html
+function enableStateUpdates(grantedRoutesElement) {
+	const updateTimeout = 2000;
+	if (typeof EventSource === 'undefined') {
+		setInterval(() => {
+			updateTrainGrabbedState();
+			updateGrantedRoutes(grantedRoutesElement);
+		}, updateTimeout);
+		return;
+	}
+	// Route id -> id of the train that the route is granted to
+	const grantedRoutes = new Map();
+	const onStateObjects = (stateObjects, isSnapshot) => {
+		if (isSnapshot) {
+			grantedRoutes.clear();
+		}
+		let routesChanged = isSnapshot;
+		for (const stateObject of stateObjects) {
+			if (stateObject.type === 'train') {
+				showTrainGrabbedState(stateObject.id, !stateObject.removed && stateObject.grabbed);
+			} else if (stateObject.type === 'route') {
+				if (stateObject.removed || stateObject.granted_to_train === '') {
+					grantedRoutes.delete(stateObject.id);
+				} else {
+					grantedRoutes.set(stateObject.id, stateObject.granted_to_train);
+				}
+				routesChanged = true;
+			}
+		}
+		if (routesChanged) {
+			showGrantedRoutes(grantedRoutesElement, 
+				Array.from(grantedRoutes, ([routeId, trainId]) => ({ id: routeId, train: trainId })));
+		}
+	};
+	const connect = () => {
+		const stateStream = new EventSource('/monitor/state-stream');
+		stateStream.addEventListener('snapshot', (event) => onStateObjects(JSON.parse(event.data), true));
+		stateStream.addEventListener('delta', (event) => onStateObjects(JSON.parse(event.data), false));
+		stateStream.onerror = () => {
+			// The browser reconnects by itself unless the server refused the stream, 
+			// e.g., because it is not running
+			if (stateStream.readyState === EventSource.CLOSED) {
+				setTimeout(connect, updateTimeout);
+			}
+		};
+	};
+	connect();
+}
+
 // Connectivity 
 
 function pingServer () {
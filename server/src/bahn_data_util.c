@@ -26,6 +26,7 @@
  */
 
 #include <bidib/bidib.h>
+#include <limits.h>
 #include <string.h>
 
 #include "server.h"
@@ -34,6 +35,8 @@
 #include "parsers/config_data_intern.h"
 #include "bahn_data_util.h"
 #include "handler_driver.h"
+#include "request_metrics.h"
+#include "memory_footprint.h"
 
 typedef enum {
     TYPE_MODULE_NAME,
@@ -65,12 +68,15 @@ bool bahn_data_util_initialise_config(const char *config_dir) {
     if (!parse_config_data(config_dir, &config_data)) {
         return false;
     }
+    memory_footprint_set(MEMORY_SUBSYSTEM_CONFIG_TABLES, 
+                         config_data_memory_footprint(&config_data));
 
     return true;
 }
 
 void bahn_data_util_free_config() {
     free_config_data(config_data);
+    memory_footprint_set(MEMORY_SUBSYSTEM_CONFIG_TABLES, 0);
     free_interlocking_table();
 }
 
@@ -90,10 +96,15 @@ void bahn_data_util_init_cached_track_state() {
         return;
     }
     cached_allocated_str_array = g_array_sized_new(FALSE, FALSE, sizeof(char *), 16);
+    memory_footprint_add(MEMORY_SUBSYSTEM_TRACK_STATE_CACHE, 
+                         memory_footprint_of_array(cached_allocated_str_array, 16, false));
 }
 
 void bahn_data_util_free_cached_track_state() {
     if (cached_allocated_str_array != NULL) {
+        memory_footprint_subtract(MEMORY_SUBSYSTEM_TRACK_STATE_CACHE, 
+                                  memory_footprint_of_string_array(cached_allocated_str_array, 
+                                                                   16, false));
         for (int i = 0; i < cached_allocated_str_array->len; ++i) {
             free(g_array_index(cached_allocated_str_array, char *, i));
         }
@@ -104,7 +115,14 @@ void bahn_data_util_free_cached_track_state() {
 
 static void add_cache_str(char *state) {
     if (cached_allocated_str_array != NULL) {
+        // Accounts for the growth of the array too, so that freeing the cache 
+        // subtracts what was added
+        const size_t array_bytes = 
+                memory_footprint_of_array(cached_allocated_str_array, 16, false);
         g_array_append_val(cached_allocated_str_array, state);
+        memory_footprint_add(MEMORY_SUBSYSTEM_TRACK_STATE_CACHE, 
+                             memory_footprint_of_array(cached_allocated_str_array, 16, false) 
+                             - array_bytes + memory_footprint_of_string(state));
     } else {
         syslog_server(LOG_ERR, "bahn data util add cache str - cache is NULL!");
     }
@@ -539,6 +557,11 @@ int config_get_array_string_value(const char *type, const char *id, const char *
 }
 
 int config_get_array_int_value(const char *type, const char *id, const char *prop_name, int data[]) {
+    return config_get_bounded_array_int_value(type, id, prop_name, data, INT_MAX);
+}
+
+int config_get_bounded_array_int_value(const char *type, const char *id, const char *prop_name, 
+                                       int data[], int data_len_max) {
     if (type == NULL || id == NULL || prop_name == NULL) {
         syslog_server(LOG_ERR, "Get array int value: invalid (NULL) parameters");
         return 0;
@@ -559,7 +582,7 @@ int config_get_array_int_value(const char *type, const char *id, const char *pro
         }
 
         if (arr != NULL) {
-            for (int i = 0; i < arr->len; ++i) {
+            for (int i = 0; i < arr->len && i < data_len_max; ++i) {
                 data[i] = g_array_index(arr, int, i);
             }
             result = arr->len;
@@ -993,7 +1016,7 @@ bool train_state_set_speed(const char *train_id, int speed) {
     bool result = false;
     if (g_hash_table_contains(config_data.table_trains, train_id)) {
         const int grab_id = train_get_grab_id(train_id);
-        pthread_mutex_lock(&grabbed_trains_mutex);
+        request_metrics_mutex_lock(&grabbed_trains_mutex);
         result = bidib_set_train_speed(train_id, speed, grabbed_trains[grab_id].track_output) == 0;
         pthread_mutex_unlock(&grabbed_trains_mutex);
         bidib_flush();
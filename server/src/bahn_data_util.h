@@ -89,6 +89,14 @@ int config_get_array_string_value(const char *type, const char *id, const char *
 
 int config_get_array_int_value(const char *type, const char *id, const char *prop_name, int data[]);
 
+/**
+ * Like config_get_array_int_value, but writes at most data_len_max values into data.
+ * 
+ * @return int length of the array, which may exceed data_len_max
+ */
+int config_get_bounded_array_int_value(const char *type, const char *id, const char *prop_name, 
+                                       int data[], int data_len_max);
+
 int config_get_array_float_value(const char *type, const char *id, const char *prop_name, float data[]);
 
 int config_get_array_bool_value(const char *type, const char *id, const char *prop_name, bool data[]);
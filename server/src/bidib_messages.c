@@ -0,0 +1,268 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#include <bidib/bidib.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bidib_messages.h"
+#include "server.h"
+#include "state_stream.h"
+#include "command_journal.h"
+
+typedef struct {
+	unsigned long long sequence;
+	bool is_error;
+	// Length of the whole message, including the length byte
+	unsigned int length;
+	uint8_t bytes[BIDIB_MESSAGES_BYTES_MAX];
+} t_recorded_message;
+
+static const char *message_class_names[BIDIB_MESSAGE_CLASS_COUNT] = {
+	"system", "feedback", "booster", "accessory", "light-control", "command-station", "other"
+};
+
+static pthread_mutex_t consumer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t consumer_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t consumer_thread;
+static bool consumer_started = false;
+static bool consumer_stopping = false;
+
+// The history is written by the consumer thread and read by bidib_messages_render
+static pthread_mutex_t history_mutex = PTHREAD_MUTEX_INITIALIZER;
+static t_recorded_message history[BIDIB_MESSAGES_HISTORY_LEN];
+static unsigned long long message_count = 0;
+static unsigned long long error_count = 0;
+static unsigned long long class_counts[BIDIB_MESSAGE_CLASS_COUNT];
+
+// Classes by the upper bits of the uplink message type, see the BiDiB protocol specification
+static e_bidib_message_class message_class_of(uint8_t type) {
+	if (type >= 0x80 && type < 0xa0) {
+		return BIDIB_MESSAGE_SYSTEM;
+	} else if (type >= 0xa0 && type < 0xb0) {
+		return BIDIB_MESSAGE_FEEDBACK;
+	} else if (type >= 0xb0 && type < 0xb8) {
+		return BIDIB_MESSAGE_BOOSTER;
+	} else if (type >= 0xb8 && type < 0xc0) {
+		return BIDIB_MESSAGE_ACCESSORY;
+	} else if (type >= 0xc0 && type < 0xc8) {
+		return BIDIB_MESSAGE_LIGHT_CONTROL;
+	} else if (type >= 0xe0 && type < 0xf0) {
+		return BIDIB_MESSAGE_COMMAND_STATION;
+	}
+	return BIDIB_MESSAGE_OTHER;
+}
+
+bool bidib_messages_decode(const uint8_t *message, t_bidib_message_event *event) {
+	if (message == NULL || event == NULL) {
+		return false;
+	}
+	const unsigned int length = message[0];
+	unsigned int i = 1;
+	memset(event->address, 0, sizeof(event->address));
+	for (unsigned int level = 0; i <= length && message[i] != 0x00; level++, i++) {
+		if (level >= sizeof(event->address)) {
+			return false;
+		}
+		event->address[level] = message[i];
+	}
+	// Skip the address terminator, then the number and the type have to follow
+	i++;
+	if (i + 1 > length) {
+		return false;
+	}
+	event->number = message[i];
+	event->type = message[i + 1];
+	event->message_class = message_class_of(event->type);
+	event->data = &message[i + 2];
+	event->data_len = length - (i + 1);
+	return true;
+}
+
+static void append_hex(GString *dest, const uint8_t *bytes, unsigned int length) {
+	static const char digits[] = "0123456789abcdef";
+	for (unsigned int i = 0; i < length; i++) {
+		const char hex[] = { ' ', '0', 'x', digits[bytes[i] >> 4], digits[bytes[i] & 0x0f] };
+		// No leading space for the first byte
+		g_string_append_len(dest, i == 0 ? hex + 1 : hex, i == 0 ? 4 : 5);
+	}
+}
+
+static void record_message(const uint8_t *message, bool is_error) {
+	pthread_mutex_lock(&history_mutex);
+	t_recorded_message *recorded = &history[message_count % BIDIB_MESSAGES_HISTORY_LEN];
+	recorded->sequence = message_count;
+	recorded->is_error = is_error;
+	recorded->length = message[0] + 1;
+	memcpy(recorded->bytes, message, 
+	       recorded->length < BIDIB_MESSAGES_BYTES_MAX ? recorded->length : BIDIB_MESSAGES_BYTES_MAX);
+	message_count++;
+	pthread_mutex_unlock(&history_mutex);
+}
+
+// Drains both message queues; returns the number of messages read, and sets state_changed 
+// if a message reports a change of the track state
+static unsigned int drain_messages(bool *state_changed) {
+	unsigned int count = 0;
+	uint8_t *message;
+	while ((message = bidib_read_message()) != NULL) {
+		t_bidib_message_event event;
+		e_bidib_message_class message_class = BIDIB_MESSAGE_OTHER;
+		if (bidib_messages_decode(message, &event)) {
+			message_class = event.message_class;
+			syslog_server(LOG_DEBUG, 
+			              "BiDiB message - %s type: 0x%02x address: %u.%u.%u.%u number: %u", 
+			              message_class_names[message_class], event.type, 
+			              event.address[0], event.address[1], event.address[2], 
+			              event.address[3], event.number);
+		}
+		const bool is_state_change = message_class == BIDIB_MESSAGE_FEEDBACK 
+		                             || message_class == BIDIB_MESSAGE_ACCESSORY 
+		                             || message_class == BIDIB_MESSAGE_LIGHT_CONTROL 
+		                             || message_class == BIDIB_MESSAGE_COMMAND_STATION;
+		if (is_state_change) {
+			command_journal_record_bidib(message);
+		}
+		*state_changed = *state_changed || is_state_change;
+		record_message(message, false);
+		pthread_mutex_lock(&history_mutex);
+		class_counts[message_class]++;
+		pthread_mutex_unlock(&history_mutex);
+		free(message);
+		count++;
+	}
+	while ((message = bidib_read_error_message()) != NULL) {
+		// Error messages are rare, so they are logged in full
+		GString *hex = g_string_sized_new(5 * (message[0] + 1));
+		append_hex(hex, message, message[0] + 1);
+		syslog_server(LOG_ERR, "SWTbahn error message queue: %s", hex->str);
+		g_string_free(hex, true);
+		record_message(message, true);
+		pthread_mutex_lock(&history_mutex);
+		error_count++;
+		pthread_mutex_unlock(&history_mutex);
+		free(message);
+		count++;
+	}
+	return count;
+}
+
+// libbidib does not signal when it enqueues a message, so the queues are drained
+// in short intervals while messages arrive, backing off while none arrive
+static void *consume_bidib_messages(void *_) {
+	unsigned int wait_us = BIDIB_MESSAGES_BUSY_WAIT_US;
+	pthread_mutex_lock(&consumer_mutex);
+	while (!consumer_stopping) {
+		pthread_mutex_unlock(&consumer_mutex);
+		bool state_changed = false;
+		if (drain_messages(&state_changed) > 0) {
+			wait_us = BIDIB_MESSAGES_BUSY_WAIT_US;
+		} else if (wait_us < BIDIB_MESSAGES_IDLE_WAIT_US) {
+			wait_us = wait_us * 2 < BIDIB_MESSAGES_IDLE_WAIT_US 
+			          ? wait_us * 2 : BIDIB_MESSAGES_IDLE_WAIT_US;
+		}
+		if (state_changed) {
+			state_stream_notify_change();
+		}
+		
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += (long) wait_us * 1000L;
+		deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+		deadline.tv_nsec %= 1000000000L;
+		pthread_mutex_lock(&consumer_mutex);
+		if (!consumer_stopping) {
+			pthread_cond_timedwait(&consumer_cond, &consumer_mutex, &deadline);
+		}
+	}
+	pthread_mutex_unlock(&consumer_mutex);
+	return NULL;
+}
+
+void bidib_messages_start(void) {
+	pthread_mutex_lock(&consumer_mutex);
+	consumer_stopping = false;
+	consumer_started = 
+			pthread_create(&consumer_thread, NULL, consume_bidib_messages, NULL) == 0;
+	pthread_mutex_unlock(&consumer_mutex);
+	if (!consumer_started) {
+		syslog_server(LOG_ERR, "BiDiB messages start - unable to create consumer thread");
+	}
+}
+
+void bidib_messages_stop(void) {
+	pthread_mutex_lock(&consumer_mutex);
+	const bool started = consumer_started;
+	consumer_stopping = true;
+	consumer_started = false;
+	pthread_cond_broadcast(&consumer_cond);
+	pthread_mutex_unlock(&consumer_mutex);
+	if (started) {
+		pthread_join(consumer_thread, NULL);
+	}
+}
+
+GString *bidib_messages_render(void) {
+	pthread_mutex_lock(&history_mutex);
+	GString *rendered = g_string_sized_new(128 + BIDIB_MESSAGES_HISTORY_LEN * 96);
+	g_string_append_printf(rendered, "BiDiB messages: %llu received, %llu errors\n", 
+	                       message_count - error_count, error_count);
+	for (unsigned int i = 0; i < BIDIB_MESSAGE_CLASS_COUNT; i++) {
+		g_string_append_printf(rendered, "* %s: %llu\n", message_class_names[i], class_counts[i]);
+	}
+	g_string_append(rendered, "\n");
+	
+	const unsigned long long first = message_count > BIDIB_MESSAGES_HISTORY_LEN 
+	                                 ? message_count - BIDIB_MESSAGES_HISTORY_LEN : 0;
+	for (unsigned long long sequence = first; sequence < message_count; sequence++) {
+		const t_recorded_message *recorded = &history[sequence % BIDIB_MESSAGES_HISTORY_LEN];
+		t_bidib_message_event event;
+		if (recorded->is_error) {
+			g_string_append_printf(rendered, "#%llu error: ", recorded->sequence);
+		} else if (recorded->length <= BIDIB_MESSAGES_BYTES_MAX 
+		           && bidib_messages_decode(recorded->bytes, &event)) {
+			g_string_append_printf(rendered, "#%llu %s type: 0x%02x address: %u.%u.%u.%u: ", 
+			                       recorded->sequence, message_class_names[event.message_class], 
+			                       event.type, event.address[0], event.address[1], 
+			                       event.address[2], event.address[3]);
+		} else {
+			g_string_append_printf(rendered, "#%llu: ", recorded->sequence);
+		}
+		append_hex(rendered, recorded->bytes, recorded->length < BIDIB_MESSAGES_BYTES_MAX 
+		                                      ? recorded->length : BIDIB_MESSAGES_BYTES_MAX);
+		if (recorded->length > BIDIB_MESSAGES_BYTES_MAX) {
+			g_string_append(rendered, " ...");
+		}
+		g_string_append_c(rendered, '\n');
+	}
+	pthread_mutex_unlock(&history_mutex);
+	return rendered;
+}
@@ -0,0 +1,96 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#ifndef BIDIB_MESSAGES_H
+#define BIDIB_MESSAGES_H
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Number of recent messages kept in binary form for on-demand rendering
+#define BIDIB_MESSAGES_HISTORY_LEN		256
+// Bytes kept per message, longer messages are truncated in the history
+#define BIDIB_MESSAGES_BYTES_MAX		48
+// Wait between drains while messages are arriving
+#define BIDIB_MESSAGES_BUSY_WAIT_US		2000
+// Longest wait between drains while no messages arrive
+#define BIDIB_MESSAGES_IDLE_WAIT_US		250000
+
+// Classes of BiDiB uplink messages, decoded from the message type
+typedef enum {
+	BIDIB_MESSAGE_SYSTEM,
+	BIDIB_MESSAGE_FEEDBACK,
+	BIDIB_MESSAGE_BOOSTER,
+	BIDIB_MESSAGE_ACCESSORY,
+	BIDIB_MESSAGE_LIGHT_CONTROL,
+	BIDIB_MESSAGE_COMMAND_STATION,
+	BIDIB_MESSAGE_OTHER,
+	BIDIB_MESSAGE_CLASS_COUNT
+} e_bidib_message_class;
+
+typedef struct {
+	e_bidib_message_class message_class;
+	// Node address, up to four levels, terminated by 0
+	uint8_t address[4];
+	uint8_t number;
+	uint8_t type;
+	// Data after the type, points into the message
+	const uint8_t *data;
+	unsigned int data_len;
+} t_bidib_message_event;
+
+/**
+ * Decodes a message as returned by bidib_read_message (the first byte is the length 
+ * of the rest): address stack, sequence number, type, and data.
+ * 
+ * @param message message to decode
+ * @param event (out) decoded message, its data points into message
+ * @return true if the message is well-formed
+ */
+bool bidib_messages_decode(const uint8_t *message, t_bidib_message_event *event);
+
+/**
+ * Starts the consumer thread that drains the BiDiB message queues, records the messages,
+ * and notifies the state stream of feedback, accessory and train changes.
+ */
+void bidib_messages_start(void);
+
+/**
+ * Stops the consumer thread and waits for it to return.
+ */
+void bidib_messages_stop(void);
+
+/**
+ * @return GString* with the recorded recent messages, one per line with their class, 
+ * type and address, and the message rendered as hex
+ */
+GString *bidib_messages_render(void);
+
+#endif  // BIDIB_MESSAGES_H
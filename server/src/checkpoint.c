@@ -0,0 +1,667 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+#include "server.h"
+#include "handler_controller.h"
+#include "handler_driver.h"
+#include "handler_upload.h"
+#include "param_verification.h"
+
+#define CHECKPOINT_FORMAT		"swtbahn-checkpoint\t1"
+#define CHECKPOINT_FILE			"state"
+#define CHECKPOINT_MODELS_DIR	"models"
+
+typedef struct {
+	// Upload that loaded the plugin, its model is restored to output_dir/filename
+	t_upload_request request;
+	// SHA-256 of the model, which is stored under this name in the models directory
+	gchar *hash;
+} t_checkpoint_plugin;
+
+typedef struct {
+	gchar *train;
+	gchar *engine;
+} t_checkpoint_grab;
+
+// Protects the recorded state; no other lock is acquired while it is held
+static pthread_mutex_t checkpoint_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Signalled when the recorded state changes or recording stops
+static pthread_cond_t checkpoint_changed = PTHREAD_COND_INITIALIZER;
+static pthread_t writer;
+static bool writer_running = false;
+static bool recording = false;
+// Whether the recorded state differs from the written checkpoint
+static bool dirty = false;
+
+static char checkpoint_dir[PATH_MAX] = "";
+static unsigned int batch_ms = CHECKPOINT_BATCH_MS_DEFAULT;
+// Whether a shutdown deletes the checkpoint instead of writing it
+static bool discard_at_shutdown = false;
+
+static t_checkpoint_grab grabs[TRAIN_ENGINE_INSTANCE_COUNT_MAX];
+// Route id -> id of the train the route is granted to
+static GHashTable *grants = NULL;
+static GPtrArray *plugins = NULL;
+static gchar *interlocker = NULL;
+
+
+static unsigned int env_setting(const char *name, unsigned int default_value, 
+                                unsigned int max_value) {
+	const char *value = getenv(name);
+	if (value == NULL) {
+		return default_value;
+	}
+	char *end = NULL;
+	const unsigned long number = strtoul(value, &end, 10);
+	if (end == value || *end != '\0' || number > max_value) {
+		syslog_server(LOG_WARNING, "Checkpoint - invalid %s (%s), using %u", 
+		              name, value, default_value);
+		return default_value;
+	}
+	return (unsigned int) number;
+}
+
+// Shall only be called with checkpoint_mutex acquired
+static void mark_changed(void) {
+	dirty = true;
+	pthread_cond_signal(&checkpoint_changed);
+}
+
+static void free_plugin(gpointer data) {
+	t_checkpoint_plugin *plugin = data;
+	g_free(plugin->hash);
+	g_free(plugin);
+}
+
+// Shall only be called with checkpoint_mutex acquired
+static void clear_recorded_state(void) {
+	for (int i = 0; i < TRAIN_ENGINE_INSTANCE_COUNT_MAX; i++) {
+		g_free(grabs[i].train);
+		g_free(grabs[i].engine);
+		grabs[i].train = NULL;
+		grabs[i].engine = NULL;
+	}
+	if (grants != NULL) {
+		g_hash_table_destroy(grants);
+		grants = NULL;
+	}
+	if (plugins != NULL) {
+		g_ptr_array_free(plugins, true);
+		plugins = NULL;
+	}
+	g_free(interlocker);
+	interlocker = NULL;
+	dirty = false;
+}
+
+// Returns the index of the recorded plugin, or -1; 
+// shall only be called with checkpoint_mutex acquired
+static int find_plugin(e_upload_kind kind, const char *libname) {
+	for (unsigned int i = 0; i < plugins->len; i++) {
+		const t_checkpoint_plugin *plugin = g_ptr_array_index(plugins, i);
+		if (plugin->request.kind == kind && strcmp(plugin->request.libname, libname) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+
+// --- Durable files ---
+
+// Makes the creation or renaming of files in the directory durable
+static void sync_dir(const char dir[]) {
+	const int fd = open(dir, O_RDONLY | O_DIRECTORY);
+	if (fd >= 0) {
+		fsync(fd);
+		close(fd);
+	}
+}
+
+// Writes the data to a temporary file, syncs it, and renames it to path, such that path 
+// has either its previous or its new content, even if the server or the system crashes
+static bool write_file_atomically(const char dir[], const char path[], 
+                                  const char *data, size_t len) {
+	char temp_path[PATH_MAX + NAME_MAX + 16];
+	snprintf(temp_path, sizeof(temp_path), "%s.XXXXXX", path);
+	const int fd = g_mkstemp(temp_path);
+	if (fd < 0) {
+		return false;
+	}
+	bool success = fchmod(fd, 0644) == 0;
+	size_t written = 0;
+	while (success && written < len) {
+		const ssize_t written_now = write(fd, data + written, len - written);
+		if (written_now < 0 && errno == EINTR) {
+			continue;
+		}
+		success = written_now > 0;
+		written += success ? (size_t) written_now : 0;
+	}
+	success = success && fsync(fd) == 0;
+	success = (close(fd) == 0) && success;
+	if (!success || rename(temp_path, path) != 0) {
+		remove(temp_path);
+		return false;
+	}
+	sync_dir(dir);
+	return true;
+}
+
+static void models_dir_path(char path[], size_t size) {
+	snprintf(path, size, "%s/%s", checkpoint_dir, CHECKPOINT_MODELS_DIR);
+}
+
+
+// --- Writing ---
+
+// Fields are separated by tabs and records by newlines, which names hardly contain
+static bool is_valid_field(const char *value) {
+	return value != NULL && strpbrk(value, "\t\n") == NULL;
+}
+
+// Shall only be called with checkpoint_mutex acquired
+static GString *serialise_checkpoint(void) {
+	GString *text = g_string_sized_new(512);
+	g_string_append_printf(text, "%s\nsession\t%ld\n", CHECKPOINT_FORMAT, (long) session_id);
+	// In the order in which the state is restored, e.g., grabs need their engines
+	for (unsigned int i = 0; plugins != NULL && i < plugins->len; i++) {
+		const t_checkpoint_plugin *plugin = g_ptr_array_index(plugins, i);
+		g_string_append_printf(text, "plugin\t%s\t%s\t%s\t%s\t%s\n", 
+		                       plugin->request.kind == UPLOAD_ENGINE ? "engine" : "interlocker",
+		                       plugin->request.output_dir, plugin->request.filename, 
+		                       plugin->request.libname, plugin->hash);
+	}
+	g_string_append_printf(text, "interlocker\t%s\n", interlocker != NULL ? interlocker : "");
+	for (int i = 0; i < TRAIN_ENGINE_INSTANCE_COUNT_MAX; i++) {
+		if (grabs[i].train != NULL) {
+			g_string_append_printf(text, "grab\t%d\t%s\t%s\n", 
+			                       i, grabs[i].train, grabs[i].engine);
+		}
+	}
+	if (grants != NULL) {
+		GHashTableIter iter;
+		gpointer route_id, train;
+		g_hash_table_iter_init(&iter, grants);
+		while (g_hash_table_iter_next(&iter, &route_id, &train)) {
+			g_string_append_printf(text, "grant\t%s\t%s\n", 
+			                       (const char *) route_id, (const char *) train);
+		}
+	}
+	g_string_append(text, "end\n");
+	return text;
+}
+
+// Writes the recorded state if it has changed; 
+// shall only be called with checkpoint_mutex acquired, which is released while writing
+static void flush_checkpoint(void) {
+	if (!dirty) {
+		return;
+	}
+	GString *text = serialise_checkpoint();
+	dirty = false;
+	pthread_mutex_unlock(&checkpoint_mutex);
+	
+	char path[PATH_MAX + NAME_MAX];
+	snprintf(path, sizeof(path), "%s/%s", checkpoint_dir, CHECKPOINT_FILE);
+	if (!write_file_atomically(checkpoint_dir, path, text->str, text->len)) {
+		syslog_server(LOG_ERR, "Checkpoint - %s could not be written", path);
+	}
+	g_string_free(text, true);
+	pthread_mutex_lock(&checkpoint_mutex);
+}
+
+static void *checkpoint_writer(void *_) {
+	pthread_mutex_lock(&checkpoint_mutex);
+	while (true) {
+		while (recording && !dirty) {
+			pthread_cond_wait(&checkpoint_changed, &checkpoint_mutex);
+		}
+		if (!dirty) {
+			break;
+		}
+		// Collect the changes of a burst (e.g., a route grant and the grab before it), 
+		// so that they are written and synced once
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += batch_ms / 1000;
+		deadline.tv_nsec += (long) (batch_ms % 1000) * 1000000;
+		if (deadline.tv_nsec >= 1000000000) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+		while (recording 
+		       && pthread_cond_timedwait(&checkpoint_changed, &checkpoint_mutex, 
+		                                 &deadline) != ETIMEDOUT) {
+			;
+		}
+		flush_checkpoint();
+	}
+	pthread_mutex_unlock(&checkpoint_mutex);
+	return NULL;
+}
+
+
+// --- Restoring ---
+
+static void restore_plugin(gchar **fields) {
+	if (g_strv_length(fields) != 6 || strlen(fields[2]) >= PATH_MAX 
+	    || strlen(fields[3]) >= NAME_MAX || strlen(fields[4]) >= NAME_MAX) {
+		syslog_server(LOG_WARNING, "Checkpoint restore - invalid plugin record - skipped");
+		return;
+	}
+	t_upload_request request = {
+		.kind = strcmp(fields[1], "engine") == 0 ? UPLOAD_ENGINE : UPLOAD_INTERLOCKER,
+		// The model was verified when it was uploaded
+		.skip_verification = true
+	};
+	snprintf(request.output_dir, sizeof(request.output_dir), "%s", fields[2]);
+	snprintf(request.filename, sizeof(request.filename), "%s", fields[3]);
+	snprintf(request.libname, sizeof(request.libname), "%s", fields[4]);
+	snprintf(request.model_path, sizeof(request.model_path), "%s/%s", 
+	         request.output_dir, request.filename);
+	char *extension = strrchr(request.model_path, '.');
+	if (extension != NULL) {
+		*extension = '\0';
+	}
+	const char *hash = fields[5];
+	
+	char models_dir[PATH_MAX + 8];
+	models_dir_path(models_dir, sizeof(models_dir));
+	char stored_model[PATH_MAX + NAME_MAX + 16];
+	snprintf(stored_model, sizeof(stored_model), "%s/%s", models_dir, hash);
+	gchar *contents = NULL;
+	gsize len = 0;
+	gchar *stored_hash = NULL;
+	if (g_file_get_contents(stored_model, &contents, &len, NULL)) {
+		stored_hash = g_compute_checksum_for_data(G_CHECKSUM_SHA256, 
+		                                          (const guchar *) contents, len);
+	}
+	if (stored_hash == NULL || strcmp(stored_hash, hash) != 0) {
+		g_free(contents);
+		g_free(stored_hash);
+		syslog_server(LOG_WARNING, 
+		              "Checkpoint restore - plugin: %s - stored model is missing or "
+		              "corrupted - skipped", 
+		              request.libname);
+		return;
+	}
+	g_free(stored_hash);
+	
+	char model_file[PATH_MAX + NAME_MAX + 8];
+	snprintf(model_file, sizeof(model_file), "%s/%s", request.output_dir, request.filename);
+	const bool copied = g_file_set_contents(model_file, contents, len, NULL);
+	g_free(contents);
+	const unsigned int upload_id = copied ? upload_pipeline_submit(&request) : 0;
+	if (upload_id == 0) {
+		if (request.kind == UPLOAD_ENGINE) {
+			remove_engine_files(request.libname);
+		} else {
+			remove_interlocker_files(request.libname);
+		}
+		syslog_server(LOG_WARNING, 
+		              "Checkpoint restore - plugin: %s - could not be queued - skipped", 
+		              request.libname);
+		return;
+	}
+	
+	t_upload_status status;
+	const bool is_known = upload_pipeline_get_status(upload_id, true, &status);
+	if (is_known && status.message != NULL) {
+		g_string_free(status.message, true);
+	}
+	if (!is_known || status.state != UPLOAD_SUCCEEDED) {
+		syslog_server(LOG_WARNING, 
+		              "Checkpoint restore - plugin: %s - could not be loaded - skipped", 
+		              request.libname);
+	}
+}
+
+static void restore_record(gchar **fields) {
+	const guint field_count = g_strv_length(fields);
+	if (strcmp(fields[0], "session") == 0 && field_count == 2) {
+		session_id = (time_t) strtoll(fields[1], NULL, 10);
+	} else if (strcmp(fields[0], "plugin") == 0) {
+		restore_plugin(fields);
+	} else if (strcmp(fields[0], "interlocker") == 0 && field_count == 2) {
+		if (!restore_selected_interlocker(fields[1][0] != '\0' ? fields[1] : NULL)) {
+			syslog_server(LOG_WARNING, 
+			              "Checkpoint restore - interlocker: %s - could not be selected", 
+			              fields[1]);
+		}
+	} else if (strcmp(fields[0], "grab") == 0 && field_count == 4) {
+		if (!params_check_is_number(fields[1]) 
+		    || !restore_grabbed_train(atoi(fields[1]), fields[2], fields[3])) {
+			syslog_server(LOG_WARNING, 
+			              "Checkpoint restore - grab-id: %s train: %s - "
+			              "train could not be grabbed", 
+			              fields[1], fields[2]);
+		}
+	} else if (strcmp(fields[0], "grant") == 0 && field_count == 3) {
+		if (!restore_granted_route(fields[1], fields[2])) {
+			syslog_server(LOG_WARNING, 
+			              "Checkpoint restore - route: %s train: %s - "
+			              "route could not be granted", 
+			              fields[1], fields[2]);
+		}
+	} else {
+		syslog_server(LOG_WARNING, "Checkpoint restore - unknown record %s - skipped", fields[0]);
+	}
+}
+
+// Replays the checkpoint through the same functions as the requests, whose records 
+// rebuild the recorded state from what could actually be restored
+static void restore_checkpoint(void) {
+	char path[PATH_MAX + NAME_MAX];
+	snprintf(path, sizeof(path), "%s/%s", checkpoint_dir, CHECKPOINT_FILE);
+	gchar *text = NULL;
+	if (!g_file_get_contents(path, &text, NULL, NULL)) {
+		syslog_server(LOG_INFO, "Checkpoint restore - no checkpoint in %s", checkpoint_dir);
+		return;
+	}
+	gchar **lines = g_strsplit(text, "\n", -1);
+	g_free(text);
+	const guint line_count = g_strv_length(lines);
+	// A checkpoint is only written completely, so a missing end means it is not ours
+	if (line_count < 3 || strcmp(lines[0], CHECKPOINT_FORMAT) != 0 
+	    || strcmp(lines[line_count - 2], "end") != 0) {
+		g_strfreev(lines);
+		syslog_server(LOG_ERR, "Checkpoint restore - %s is not a valid checkpoint - ignored", path);
+		return;
+	}
+	
+	syslog_server(LOG_NOTICE, "Checkpoint restore - start");
+	for (guint i = 1; i < line_count - 2; i++) {
+		gchar **fields = g_strsplit(lines[i], "\t", -1);
+		if (fields[0] != NULL) {
+			restore_record(fields);
+		}
+		g_strfreev(fields);
+	}
+	g_strfreev(lines);
+	syslog_server(LOG_NOTICE, "Checkpoint restore - finish");
+}
+
+// Removes the stored models that the recorded plugins do not refer to
+static void remove_unreferenced_models(void) {
+	char models_dir[PATH_MAX + 8];
+	models_dir_path(models_dir, sizeof(models_dir));
+	DIR *dir_handle = opendir(models_dir);
+	if (dir_handle == NULL) {
+		return;
+	}
+	struct dirent *dir_entry = NULL;
+	while ((dir_entry = readdir(dir_handle)) != NULL) {
+		if (strcmp(dir_entry->d_name, ".") == 0 || strcmp(dir_entry->d_name, "..") == 0) {
+			continue;
+		}
+		bool is_referenced = false;
+		pthread_mutex_lock(&checkpoint_mutex);
+		for (unsigned int i = 0; i < plugins->len && !is_referenced; i++) {
+			const t_checkpoint_plugin *plugin = g_ptr_array_index(plugins, i);
+			is_referenced = strcmp(plugin->hash, dir_entry->d_name) == 0;
+		}
+		pthread_mutex_unlock(&checkpoint_mutex);
+		if (!is_referenced) {
+			char filepath[PATH_MAX + NAME_MAX + 16];
+			snprintf(filepath, sizeof(filepath), "%s/%s", models_dir, dir_entry->d_name);
+			remove(filepath);
+		}
+	}
+	closedir(dir_handle);
+}
+
+
+// --- Recording ---
+
+void checkpoint_start(void) {
+	const char *dir = getenv("SWTBAHN_CHECKPOINT_DIR");
+	snprintf(checkpoint_dir, sizeof(checkpoint_dir), "%s", dir != NULL ? dir : "");
+	if (checkpoint_dir[0] == '\0') {
+		syslog_server(LOG_INFO, "Checkpoint start - disabled, SWTBAHN_CHECKPOINT_DIR is not set");
+		return;
+	}
+	batch_ms = env_setting("SWTBAHN_CHECKPOINT_BATCH_MS", CHECKPOINT_BATCH_MS_DEFAULT, 
+	                       CHECKPOINT_BATCH_MS_MAX);
+	discard_at_shutdown = env_setting("SWTBAHN_CHECKPOINT_DISCARD_AT_SHUTDOWN", 0, 1) == 1;
+	char models_dir[PATH_MAX + 8];
+	models_dir_path(models_dir, sizeof(models_dir));
+	if (g_mkdir_with_parents(models_dir, 0755) != 0) {
+		syslog_server(LOG_ERR, "Checkpoint start - directory %s could not be created", models_dir);
+		checkpoint_dir[0] = '\0';
+		return;
+	}
+	
+	char *selected_interlocker = get_selected_interlocker_name();
+	pthread_mutex_lock(&checkpoint_mutex);
+	clear_recorded_state();
+	grants = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	plugins = g_ptr_array_new_with_free_func(free_plugin);
+	interlocker = g_strdup(selected_interlocker);
+	recording = true;
+	pthread_mutex_unlock(&checkpoint_mutex);
+	free(selected_interlocker);
+	
+	restore_checkpoint();
+	
+	// The checkpoint now only refers to what has been restored
+	pthread_mutex_lock(&checkpoint_mutex);
+	dirty = true;
+	flush_checkpoint();
+	pthread_mutex_unlock(&checkpoint_mutex);
+	remove_unreferenced_models();
+	
+	writer_running = pthread_create(&writer, NULL, checkpoint_writer, NULL) == 0;
+	if (!writer_running) {
+		syslog_server(LOG_ERR, "Checkpoint start - writer could not be created, %s", 
+		              discard_at_shutdown ? "changes are not written" 
+		                                  : "changes are only written at shutdown");
+	}
+	syslog_server(LOG_NOTICE, "Checkpoint start - recording to %s every %u ms", 
+	              checkpoint_dir, batch_ms);
+}
+
+void checkpoint_stop(void) {
+	pthread_mutex_lock(&checkpoint_mutex);
+	const bool was_recording = recording;
+	recording = false;
+	if (discard_at_shutdown) {
+		// Pending changes are not written, the checkpoint is deleted anyway
+		dirty = false;
+	}
+	pthread_cond_broadcast(&checkpoint_changed);
+	pthread_mutex_unlock(&checkpoint_mutex);
+	if (writer_running) {
+		// The writer writes pending changes before it returns
+		pthread_join(writer, NULL);
+		writer_running = false;
+	}
+	
+	pthread_mutex_lock(&checkpoint_mutex);
+	if (was_recording) {
+		flush_checkpoint();
+	}
+	clear_recorded_state();
+	pthread_mutex_unlock(&checkpoint_mutex);
+	if (was_recording && discard_at_shutdown) {
+		// The stored models are removed by the next start, as nothing refers to them
+		char path[PATH_MAX + NAME_MAX];
+		snprintf(path, sizeof(path), "%s/%s", checkpoint_dir, CHECKPOINT_FILE);
+		if (remove(path) != 0 && errno != ENOENT) {
+			syslog_server(LOG_ERR, "Checkpoint stop - %s could not be deleted", path);
+		}
+		sync_dir(checkpoint_dir);
+		syslog_server(LOG_NOTICE, "Checkpoint stop - checkpoint deleted at shutdown");
+	}
+}
+
+void checkpoint_set_grab(int grab_id, const char *train, const char *engine) {
+	if (grab_id < 0 || grab_id >= TRAIN_ENGINE_INSTANCE_COUNT_MAX 
+	    || !is_valid_field(train) || !is_valid_field(engine)) {
+		return;
+	}
+	pthread_mutex_lock(&checkpoint_mutex);
+	if (recording) {
+		g_free(grabs[grab_id].train);
+		g_free(grabs[grab_id].engine);
+		grabs[grab_id].train = g_strdup(train);
+		grabs[grab_id].engine = g_strdup(engine);
+		mark_changed();
+	}
+	pthread_mutex_unlock(&checkpoint_mutex);
+}
+
+void checkpoint_clear_grab(int grab_id) {
+	if (grab_id < 0 || grab_id >= TRAIN_ENGINE_INSTANCE_COUNT_MAX) {
+		return;
+	}
+	pthread_mutex_lock(&checkpoint_mutex);
+	if (recording && grabs[grab_id].train != NULL) {
+		g_free(grabs[grab_id].train);
+		g_free(grabs[grab_id].engine);
+		grabs[grab_id].train = NULL;
+		grabs[grab_id].engine = NULL;
+		mark_changed();
+	}
+	pthread_mutex_unlock(&checkpoint_mutex);
+}
+
+void checkpoint_set_grant(const char *route_id, const char *train) {
+	if (!is_valid_field(route_id) || !is_valid_field(train)) {
+		return;
+	}
+	pthread_mutex_lock(&checkpoint_mutex);
+	if (recording) {
+		g_hash_table_replace(grants, g_strdup(route_id), g_strdup(train));
+		mark_changed();
+	}
+	pthread_mutex_unlock(&checkpoint_mutex);
+}
+
+void checkpoint_clear_grant(const char *route_id) {
+	if (route_id == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&checkpoint_mutex);
+	if (recording && g_hash_table_remove(grants, route_id)) {
+		mark_changed();
+	}
+	pthread_mutex_unlock(&checkpoint_mutex);
+}
+
+void checkpoint_set_plugin(const t_upload_request *request) {
+	pthread_mutex_lock(&checkpoint_mutex);
+	const bool is_recording = recording;
+	pthread_mutex_unlock(&checkpoint_mutex);
+	if (!is_recording || !is_valid_field(request->output_dir) 
+	    || !is_valid_field(request->filename) || !is_valid_field(request->libname)) {
+		return;
+	}
+	
+	char model_file[PATH_MAX + NAME_MAX + 8];
+	snprintf(model_file, sizeof(model_file), "%s/%s", request->output_dir, request->filename);
+	gchar *contents = NULL;
+	gsize len = 0;
+	if (!g_file_get_contents(model_file, &contents, &len, NULL)) {
+		syslog_server(LOG_WARNING, "Checkpoint - model %s could not be read", model_file);
+		return;
+	}
+	gchar *hash = g_compute_checksum_for_data(G_CHECKSUM_SHA256, (const guchar *) contents, len);
+	char models_dir[PATH_MAX + 8];
+	models_dir_path(models_dir, sizeof(models_dir));
+	char stored_model[PATH_MAX + NAME_MAX + 16];
+	snprintf(stored_model, sizeof(stored_model), "%s/%s", models_dir, hash);
+	// The model has to be stored before the checkpoint refers to it
+	const bool is_stored = g_file_test(stored_model, G_FILE_TEST_EXISTS) 
+	                       || write_file_atomically(models_dir, stored_model, contents, len);
+	g_free(contents);
+	if (!is_stored) {
+		g_free(hash);
+		syslog_server(LOG_ERR, "Checkpoint - model %s could not be stored", model_file);
+		return;
+	}
+	
+	t_checkpoint_plugin *plugin = g_new0(t_checkpoint_plugin, 1);
+	plugin->request = *request;
+	plugin->request.skip_verification = false;
+	plugin->hash = hash;
+	pthread_mutex_lock(&checkpoint_mutex);
+	if (recording) {
+		const int index = find_plugin(request->kind, request->libname);
+		if (index >= 0) {
+			g_ptr_array_remove_index(plugins, index);
+		}
+		g_ptr_array_add(plugins, plugin);
+		mark_changed();
+	} else {
+		free_plugin(plugin);
+	}
+	pthread_mutex_unlock(&checkpoint_mutex);
+}
+
+void checkpoint_clear_plugin(e_upload_kind kind, const char *libname) {
+	if (libname == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&checkpoint_mutex);
+	const int index = recording ? find_plugin(kind, libname) : -1;
+	if (index >= 0) {
+		g_ptr_array_remove_index(plugins, index);
+		mark_changed();
+	}
+	pthread_mutex_unlock(&checkpoint_mutex);
+}
+
+void checkpoint_set_interlocker(const char *name) {
+	if (name != NULL && !is_valid_field(name)) {
+		return;
+	}
+	pthread_mutex_lock(&checkpoint_mutex);
+	if (recording) {
+		g_free(interlocker);
+		interlocker = g_strdup(name);
+		mark_changed();
+	}
+	pthread_mutex_unlock(&checkpoint_mutex);
+}
@@ -0,0 +1,121 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdbool.h>
+
+#include "upload_pipeline.h"
+
+// Time in which changes are collected before the checkpoint is written, 
+// unless set by SWTBAHN_CHECKPOINT_BATCH_MS
+#define CHECKPOINT_BATCH_MS_DEFAULT		200
+#define CHECKPOINT_BATCH_MS_MAX			60000
+
+/**
+ * Restores the operational state of the last checkpoint, i.e., the session-id, the 
+ * loaded engines and interlockers (recompiled from their stored models without 
+ * verification), the selected interlocker, the grabbed trains with their grab-ids, 
+ * and the granted routes. Then starts recording the state and writes 
+ * the checkpoint whenever the state has changed. Items that cannot be restored are 
+ * skipped and are no longer part of the checkpoint.
+ * Does nothing unless SWTBAHN_CHECKPOINT_DIR sets the directory of the checkpoint and its 
+ * models, as restored plugins are not verified again.
+ * Shall only be called once the default interlocker has been loaded and the upload 
+ * pipeline has been started, but before requests are served.
+ */
+void checkpoint_start(void);
+
+/**
+ * Writes pending changes and stops recording the state, such that the state released 
+ * by the shutdown is restored by the next start. If SWTBAHN_CHECKPOINT_DISCARD_AT_SHUTDOWN 
+ * is 1, deletes the checkpoint instead, such that only the state of a server that did not 
+ * shut down, e.g., after a crash, is restored.
+ * Shall be called before the trains, routes and interlockers are released.
+ */
+void checkpoint_stop(void);
+
+/**
+ * Records that a train has been grabbed.
+ * 
+ * @param grab_id grab-id of the train
+ * @param train id of the train
+ * @param engine name of the train engine
+ */
+void checkpoint_set_grab(int grab_id, const char *train, const char *engine);
+
+/**
+ * Records that a train has been released.
+ * 
+ * @param grab_id grab-id the train had
+ */
+void checkpoint_clear_grab(int grab_id);
+
+/**
+ * Records that a route has been granted to a train.
+ * 
+ * @param route_id id of the route
+ * @param train id of the train
+ */
+void checkpoint_set_grant(const char *route_id, const char *train);
+
+/**
+ * Records that a route has been released.
+ * 
+ * @param route_id id of the route
+ */
+void checkpoint_clear_grant(const char *route_id);
+
+/**
+ * Records that an engine or interlocker has been loaded, and stores a copy of its 
+ * model under its SHA-256, unless an identical model is stored already.
+ * Shall not be called with any lock acquired, because the model is read and written.
+ * 
+ * @param request upload whose library has been loaded
+ */
+void checkpoint_set_plugin(const t_upload_request *request);
+
+/**
+ * Records that an engine or interlocker has been removed.
+ * 
+ * @param kind whether an engine or interlocker has been removed
+ * @param libname name of the library, e.g., "libengine"
+ */
+void checkpoint_clear_plugin(e_upload_kind kind, const char *libname);
+
+/**
+ * Records the selected interlocker.
+ * 
+ * @param name name of the interlocker, or NULL if no interlocker is selected
+ */
+void checkpoint_set_interlocker(const char *name);
+
+#endif  // CHECKPOINT_H
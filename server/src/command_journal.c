@@ -0,0 +1,452 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+
+#include <onion/dict.h>
+#include <onion/request.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "command_journal.h"
+#include "server.h"
+#include "request_metrics.h"
+
+typedef onion_connection_status (*t_handler)(void *, onion_request *, onion_response *);
+
+typedef struct {
+	void *handler;
+	void *handler_data;
+	// Whether the request is journaled only after it has been answered
+	bool record_after_handling;
+} t_journal_handler;
+
+// Only appended to before the server listens, so they are read without locking
+static t_journal_handler journal_handlers[COMMAND_JOURNAL_HANDLER_COUNT_MAX];
+static unsigned int journal_handler_count = 0;
+
+// Protects the ring; held only to copy a record in or out
+static pthread_mutex_t ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Signalled when the ring is half full or journaling stops
+static pthread_cond_t ring_filled = PTHREAD_COND_INITIALIZER;
+static uint8_t *ring = NULL;
+static size_t ring_size = 0;
+// The records in [ring_head, ring_head + ring_len) wait to be written
+static size_t ring_head = 0;
+static size_t ring_len = 0;
+static bool journaling = false;
+static unsigned long long record_count = 0;
+static unsigned long long dropped_count = 0;
+
+static pthread_t writer;
+static bool writer_running = false;
+static int journal_fd = -1;
+static unsigned int flush_ms = COMMAND_JOURNAL_FLUSH_MS_DEFAULT;
+
+static atomic_uint next_sequence = 1;
+// Sequence of the request handled by this thread, 0 if none
+static _Thread_local uint32_t current_sequence = 0;
+// Reused for the records of the requests handled by this thread
+static _Thread_local GByteArray *request_buffer = NULL;
+
+
+static unsigned int env_setting(const char *name, unsigned int default_value, 
+                                unsigned int max_value) {
+	const char *value = getenv(name);
+	if (value == NULL) {
+		return default_value;
+	}
+	char *end = NULL;
+	const unsigned long number = strtoul(value, &end, 10);
+	if (end == value || *end != '\0' || number == 0 || number > max_value) {
+		syslog_server(LOG_WARNING, "Command journal - invalid %s (%s), using %u", 
+		              name, value, default_value);
+		return default_value;
+	}
+	return (unsigned int) number;
+}
+
+static uint64_t now_ns(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+// Shall only be called with ring_mutex acquired and enough free space in the ring
+static void ring_put(const void *data, size_t len) {
+	size_t tail = (ring_head + ring_len) % ring_size;
+	const size_t first_len = len < ring_size - tail ? len : ring_size - tail;
+	memcpy(ring + tail, data, first_len);
+	memcpy(ring, (const uint8_t *) data + first_len, len - first_len);
+	ring_len += len;
+}
+
+// Copies a record into the ring; the record is dropped instead of waiting if the ring is full
+static void append_record(e_journal_record_type type, const void *payload, size_t payload_len) {
+	t_journal_record_header header = {
+		.payload_len = (uint32_t) payload_len,
+		.type = (uint16_t) type
+	};
+	pthread_mutex_lock(&ring_mutex);
+	if (!journaling) {
+		pthread_mutex_unlock(&ring_mutex);
+		return;
+	}
+	if (ring_len + sizeof(header) + payload_len > ring_size) {
+		dropped_count++;
+		pthread_mutex_unlock(&ring_mutex);
+		return;
+	}
+	// Taken while the ring is locked, so that the timestamps of the records are ordered
+	header.timestamp_ns = now_ns();
+	ring_put(&header, sizeof(header));
+	ring_put(payload, payload_len);
+	record_count++;
+	if (ring_len > ring_size / 2) {
+		pthread_cond_signal(&ring_filled);
+	}
+	pthread_mutex_unlock(&ring_mutex);
+}
+
+static bool write_all(const uint8_t *data, size_t len) {
+	while (len > 0) {
+		const ssize_t written = write(journal_fd, data, len);
+		if (written < 0 && errno == EINTR) {
+			continue;
+		} else if (written <= 0) {
+			return false;
+		}
+		data += written;
+		len -= (size_t) written;
+	}
+	return true;
+}
+
+// Writes the ring to the file when it is half full, or at least every flush_ms; 
+// records are only appended to the free part of the ring, so it is written unlocked
+static void *journal_writer(void *_) {
+	bool write_failed = false;
+	bool stopping = false;
+	while (!stopping) {
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += flush_ms / 1000;
+		deadline.tv_nsec += (long) (flush_ms % 1000) * 1000000L;
+		deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+		deadline.tv_nsec %= 1000000000L;
+		
+		pthread_mutex_lock(&ring_mutex);
+		while (journaling && ring_len <= ring_size / 2 
+		       && pthread_cond_timedwait(&ring_filled, &ring_mutex, &deadline) != ETIMEDOUT) {
+			;
+		}
+		stopping = !journaling;
+		const size_t head = ring_head;
+		const size_t len = ring_len;
+		pthread_mutex_unlock(&ring_mutex);
+		
+		const size_t first_len = len < ring_size - head ? len : ring_size - head;
+		const bool success = write_all(ring + head, first_len) 
+		                     && write_all(ring, len - first_len);
+		if (!success && !write_failed) {
+			syslog_server(LOG_ERR, "Command journal - unable to write to the journal file");
+		}
+		write_failed = !success;
+		
+		pthread_mutex_lock(&ring_mutex);
+		ring_head = (head + len) % ring_size;
+		ring_len -= len;
+		pthread_mutex_unlock(&ring_mutex);
+	}
+	fdatasync(journal_fd);
+	return NULL;
+}
+
+void command_journal_start(void) {
+	const char *path = getenv("SWTBAHN_JOURNAL");
+	if (path == NULL || path[0] == '\0') {
+		return;
+	}
+	journal_fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+	struct stat journal_stat;
+	if (journal_fd < 0 || fstat(journal_fd, &journal_stat) != 0) {
+		syslog_server(LOG_ERR, "Command journal - unable to open %s", path);
+		if (journal_fd >= 0) {
+			close(journal_fd);
+			journal_fd = -1;
+		}
+		return;
+	}
+	if (journal_stat.st_size == 0) {
+		write_all((const uint8_t *) COMMAND_JOURNAL_MAGIC, strlen(COMMAND_JOURNAL_MAGIC));
+	}
+	
+	ring_size = (size_t) env_setting("SWTBAHN_JOURNAL_RING_KB", COMMAND_JOURNAL_RING_KB_DEFAULT, 
+	                                 COMMAND_JOURNAL_RING_KB_MAX) * 1024;
+	flush_ms = env_setting("SWTBAHN_JOURNAL_FLUSH_MS", COMMAND_JOURNAL_FLUSH_MS_DEFAULT, 
+	                       COMMAND_JOURNAL_FLUSH_MS_MAX);
+	ring = malloc(ring_size);
+	if (ring == NULL) {
+		syslog_server(LOG_ERR, "Command journal - unable to allocate the ring");
+		close(journal_fd);
+		journal_fd = -1;
+		return;
+	}
+	ring_head = 0;
+	ring_len = 0;
+	journaling = true;
+	writer_running = pthread_create(&writer, NULL, journal_writer, NULL) == 0;
+	if (!writer_running) {
+		journaling = false;
+		free(ring);
+		ring = NULL;
+		close(journal_fd);
+		journal_fd = -1;
+		syslog_server(LOG_ERR, "Command journal - unable to create the writer thread");
+		return;
+	}
+	
+	struct timespec wall_clock;
+	clock_gettime(CLOCK_REALTIME, &wall_clock);
+	const int64_t wall_clock_ns = (int64_t) wall_clock.tv_sec * 1000000000LL + wall_clock.tv_nsec;
+	append_record(JOURNAL_RECORD_START, &wall_clock_ns, sizeof(wall_clock_ns));
+	syslog_server(LOG_NOTICE, "Command journal - appending to %s", path);
+}
+
+void command_journal_stop(void) {
+	pthread_mutex_lock(&ring_mutex);
+	journaling = false;
+	pthread_cond_broadcast(&ring_filled);
+	pthread_mutex_unlock(&ring_mutex);
+	if (!writer_running) {
+		return;
+	}
+	pthread_join(writer, NULL);
+	writer_running = false;
+	close(journal_fd);
+	journal_fd = -1;
+	free(ring);
+	ring = NULL;
+}
+
+void *command_journal_wrap(void *handler, void *handler_data, bool record_after_handling) {
+	if (journal_handler_count >= COMMAND_JOURNAL_HANDLER_COUNT_MAX) {
+		return NULL;
+	}
+	t_journal_handler *journal_handler = &journal_handlers[journal_handler_count++];
+	journal_handler->handler = handler;
+	journal_handler->handler_data = handler_data;
+	journal_handler->record_after_handling = record_after_handling;
+	return journal_handler;
+}
+
+static void append_uint(GByteArray *buffer, uint64_t value, size_t len) {
+	// Host byte order, as the fixed-size fields of the header
+	uint8_t bytes[sizeof(value)];
+	if (len == sizeof(uint8_t)) {
+		bytes[0] = (uint8_t) value;
+	} else if (len == sizeof(uint16_t)) {
+		const uint16_t value16 = (uint16_t) value;
+		memcpy(bytes, &value16, len);
+	} else if (len == sizeof(uint32_t)) {
+		const uint32_t value32 = (uint32_t) value;
+		memcpy(bytes, &value32, len);
+	} else {
+		memcpy(bytes, &value, len);
+	}
+	g_byte_array_append(buffer, bytes, len);
+}
+
+typedef struct {
+	GByteArray *buffer;
+	uint16_t count;
+	uint8_t kind;
+} t_param_context;
+
+static void append_param(t_param_context *context, const char *key, const uint8_t *value, 
+                         size_t value_len) {
+	const size_t key_len = strnlen(key, UINT16_MAX);
+	append_uint(context->buffer, context->kind, sizeof(uint8_t));
+	append_uint(context->buffer, key_len, sizeof(uint16_t));
+	append_uint(context->buffer, value_len, sizeof(uint32_t));
+	g_byte_array_append(context->buffer, (const guint8 *) key, key_len);
+	g_byte_array_append(context->buffer, value, value_len);
+	context->count++;
+}
+
+static void append_form_field(void *data, const char *key, const void *value, int flags) {
+	const char *value_str = value != NULL ? value : "";
+	append_param(data, key, (const uint8_t *) value_str, strlen(value_str));
+}
+
+// The value of an uploaded file is the path of its temporary copy
+static void append_file(void *data, const char *key, const void *value, int flags) {
+	gchar *contents = NULL;
+	gsize len = 0;
+	struct stat file_stat;
+	if (value != NULL && stat(value, &file_stat) == 0 
+	    && file_stat.st_size <= COMMAND_JOURNAL_FILE_SIZE_MAX) {
+		g_file_get_contents(value, &contents, &len, NULL);
+	}
+	append_param(data, key, (const uint8_t *) (contents != NULL ? contents : ""), len);
+	g_free(contents);
+}
+
+static void record_request(uint32_t sequence, onion_request *req) {
+	if (request_buffer == NULL) {
+		request_buffer = g_byte_array_sized_new(512);
+	}
+	GByteArray *buffer = request_buffer;
+	g_byte_array_set_size(buffer, 0);
+	const char *path = onion_request_get_fullpath(req);
+	const size_t path_len = path != NULL ? strnlen(path, UINT16_MAX) : 0;
+	append_uint(buffer, sequence, sizeof(uint32_t));
+	append_uint(buffer, path_len, sizeof(uint16_t));
+	// The parameter count is filled in once the parameters are appended
+	append_uint(buffer, 0, sizeof(uint16_t));
+	g_byte_array_append(buffer, (const guint8 *) path, path_len);
+	
+	t_param_context context = { .buffer = buffer, .count = 0, .kind = 0 };
+	const onion_dict *form_fields = onion_request_get_post_dict(req);
+	if (form_fields != NULL) {
+		onion_dict_preorder(form_fields, append_form_field, &context);
+	}
+	const onion_dict *files = onion_request_get_file_dict(req);
+	if (files != NULL) {
+		context.kind = 1;
+		onion_dict_preorder(files, append_file, &context);
+	}
+	memcpy(buffer->data + sizeof(uint32_t) + sizeof(uint16_t), &context.count, sizeof(uint16_t));
+	append_record(JOURNAL_RECORD_REQUEST, buffer->data, buffer->len);
+}
+
+static void record_response(uint32_t sequence, uint64_t duration_ns) {
+	struct {
+		uint32_t sequence;
+		uint16_t status_code;
+		uint16_t unused;
+		uint64_t duration_ns;
+	} response = {
+		.sequence = sequence,
+		.status_code = (uint16_t) request_metrics_response_code(),
+		.duration_ns = duration_ns
+	};
+	append_record(JOURNAL_RECORD_RESPONSE, &response, sizeof(response));
+}
+
+// Calls the handler before anything is journaled, such that, e.g., an emergency stop 
+// does not wait for the ring; the request is then recorded together with its response
+static onion_connection_status handle_then_record(t_journal_handler *journal_handler, 
+                                                  onion_request *req, onion_response *res) {
+	const uint64_t start_ns = now_ns();
+	const onion_connection_status status = 
+			((t_handler) journal_handler->handler)(journal_handler->handler_data, req, res);
+	const uint64_t duration_ns = now_ns() - start_ns;
+	
+	pthread_mutex_lock(&ring_mutex);
+	const bool is_journaling = journaling;
+	pthread_mutex_unlock(&ring_mutex);
+	if (is_journaling && (onion_request_get_flags(req) & OR_METHODS) == OR_POST) {
+		const uint32_t sequence = atomic_fetch_add(&next_sequence, 1);
+		record_request(sequence, req);
+		record_response(sequence, duration_ns);
+	}
+	return status;
+}
+
+onion_connection_status command_journal_handler(void *data, onion_request *req, 
+                                                onion_response *res) {
+	t_journal_handler *journal_handler = data;
+	if (journal_handler->record_after_handling) {
+		return handle_then_record(journal_handler, req, res);
+	}
+	pthread_mutex_lock(&ring_mutex);
+	const bool is_journaling = journaling;
+	pthread_mutex_unlock(&ring_mutex);
+	if (!is_journaling || (onion_request_get_flags(req) & OR_METHODS) != OR_POST) {
+		return ((t_handler) journal_handler->handler)(journal_handler->handler_data, req, res);
+	}
+	
+	const uint32_t sequence = atomic_fetch_add(&next_sequence, 1);
+	record_request(sequence, req);
+	const uint64_t start_ns = now_ns();
+	current_sequence = sequence;
+	const onion_connection_status status = 
+			((t_handler) journal_handler->handler)(journal_handler->handler_data, req, res);
+	current_sequence = 0;
+	record_response(sequence, now_ns() - start_ns);
+	return status;
+}
+
+void command_journal_record_bidib(const uint8_t *message) {
+	append_record(JOURNAL_RECORD_BIDIB, message, (size_t) message[0] + 1);
+}
+
+void command_journal_record_assigned_id(const char *name, long long id) {
+	if (current_sequence == 0 || name == NULL) {
+		return;
+	}
+	uint8_t payload[sizeof(uint32_t) + sizeof(int64_t) + sizeof(uint16_t) + 64];
+	const uint16_t name_len = (uint16_t) strnlen(name, 64);
+	const int64_t id64 = id;
+	memcpy(payload, &current_sequence, sizeof(uint32_t));
+	memcpy(payload + sizeof(uint32_t), &id64, sizeof(int64_t));
+	memcpy(payload + sizeof(uint32_t) + sizeof(int64_t), &name_len, sizeof(uint16_t));
+	memcpy(payload + sizeof(uint32_t) + sizeof(int64_t) + sizeof(uint16_t), name, name_len);
+	append_record(JOURNAL_RECORD_ASSIGNED_ID, payload, 
+	              sizeof(uint32_t) + sizeof(int64_t) + sizeof(uint16_t) + name_len);
+}
+
+void command_journal_append_prometheus(GString *dest) {
+	pthread_mutex_lock(&ring_mutex);
+	const unsigned long long records = record_count;
+	const unsigned long long dropped = dropped_count;
+	const size_t pending = ring_len;
+	pthread_mutex_unlock(&ring_mutex);
+	
+	g_string_append_printf(dest, 
+	                       "# HELP swtbahn_journal_records_total Records added to the journal.\n"
+	                       "# TYPE swtbahn_journal_records_total counter\n"
+	                       "swtbahn_journal_records_total %llu\n"
+	                       "# HELP swtbahn_journal_dropped_records_total Records dropped "
+	                       "because the ring was full.\n"
+	                       "# TYPE swtbahn_journal_dropped_records_total counter\n"
+	                       "swtbahn_journal_dropped_records_total %llu\n"
+	                       "# HELP swtbahn_journal_pending_bytes Bytes waiting to be written.\n"
+	                       "# TYPE swtbahn_journal_pending_bytes gauge\n"
+	                       "swtbahn_journal_pending_bytes %zu\n", 
+	                       records, dropped, pending);
+}
@@ -0,0 +1,142 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+
+#ifndef COMMAND_JOURNAL_H
+#define COMMAND_JOURNAL_H
+
+#include <glib.h>
+#include <onion/onion.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Size of the ring in which records wait to be written, unless set by SWTBAHN_JOURNAL_RING_KB
+#define COMMAND_JOURNAL_RING_KB_DEFAULT		1024
+#define COMMAND_JOURNAL_RING_KB_MAX			(256 * 1024)
+// Longest time a record waits in the ring, unless set by SWTBAHN_JOURNAL_FLUSH_MS
+#define COMMAND_JOURNAL_FLUSH_MS_DEFAULT	250
+#define COMMAND_JOURNAL_FLUSH_MS_MAX		60000
+// Uploaded files up to this size are journaled with their content
+#define COMMAND_JOURNAL_FILE_SIZE_MAX		(256 * 1024)
+// Maximum number of journaled handlers
+#define COMMAND_JOURNAL_HANDLER_COUNT_MAX	64
+
+// Written at the start of a new journal file
+#define COMMAND_JOURNAL_MAGIC				"SWTBJRN1"
+
+/*
+ * A journal file starts with COMMAND_JOURNAL_MAGIC and is followed by records, 
+ * each with a t_journal_record_header and the payload of its type. 
+ * Numbers are in host byte order (little-endian on the Raspberry Pi and x86), 
+ * strings are not terminated.
+ */
+typedef enum {
+	// A server process started to append: i64 wall-clock time in ns since the epoch
+	JOURNAL_RECORD_START = 1,
+	// A request arrived: u32 sequence, u16 path length, u16 parameter count, path, 
+	// and per parameter: u8 kind (0 form field, 1 file content), u16 key length, 
+	// u32 value length, key, value
+	JOURNAL_RECORD_REQUEST = 2,
+	// A request was answered: u32 sequence, u16 status code, u16 unused, u64 duration in ns
+	JOURNAL_RECORD_RESPONSE = 3,
+	// A BiDiB message that reports a change of the track state: the message as read 
+	// from libbidib, whose first byte is the length of the rest
+	JOURNAL_RECORD_BIDIB = 4,
+	// The server assigned an id while answering a request, e.g., a grab-id: 
+	// u32 sequence of the request, i64 id, u16 name length, name
+	JOURNAL_RECORD_ASSIGNED_ID = 5
+} e_journal_record_type;
+
+typedef struct {
+	// CLOCK_MONOTONIC, which does not jump with the wall-clock time
+	uint64_t timestamp_ns;
+	uint32_t payload_len;
+	uint16_t type;
+	uint16_t unused;
+} t_journal_record_header;
+
+/**
+ * Starts appending to the journal file given by the environment variable SWTBAHN_JOURNAL, 
+ * if it is set, and the writer thread that flushes the ring to the file.
+ * Shall be called before the server starts listening.
+ */
+void command_journal_start(void);
+
+/**
+ * Stops journaling, and writes the remaining records.
+ */
+void command_journal_stop(void);
+
+/**
+ * Wraps a handler such that its POST requests are journaled when they arrive 
+ * and when they have been answered.
+ * Shall only be called before the server starts listening.
+ * 
+ * @param handler onion handler function
+ * @param handler_data data passed to the handler function as first argument
+ * @param record_after_handling whether the request is only journaled once it has been 
+ * answered, such that the handler does not wait for the journal (e.g., an emergency stop); 
+ * the request record then has the time of the response
+ * @return data to register together with command_journal_handler, 
+ * or NULL if too many handlers were wrapped
+ */
+void *command_journal_wrap(void *handler, void *handler_data, bool record_after_handling);
+
+/**
+ * Onion handler that journals the request given by data (see command_journal_wrap), 
+ * and then calls the wrapped handler.
+ */
+onion_connection_status command_journal_handler(void *data, onion_request *req, 
+                                                onion_response *res);
+
+/**
+ * Journals a BiDiB message. Does not block; the message is dropped if the ring is full.
+ * 
+ * @param message message as returned by bidib_read_message
+ */
+void command_journal_record_bidib(const uint8_t *message);
+
+/**
+ * Journals an id that the server assigned while answering the request of the calling 
+ * thread, so that a replay can map the ids of the journal to the ids it gets assigned.
+ * 
+ * @param name name of the id as in the requests, e.g., "grab-id"
+ * @param id the assigned id
+ */
+void command_journal_record_assigned_id(const char *name, long long id);
+
+/**
+ * Appends the number of journaled and dropped records to a string in the 
+ * Prometheus text exposition format.
+ * 
+ * @param dest string to append to
+ */
+void command_journal_append_prometheus(GString *dest);
+
+#endif  // COMMAND_JOURNAL_H
@@ -28,9 +28,17 @@
 #include "communication_utils.h"
 
 #include "server.h" // for logging
+#include "response_encoding.h"
+#include "request_metrics.h"
+#include "json_response_builder.h"
 
 #include <onion/response.h>
 
+void set_response_code(onion_response *res, int status_code) {
+	onion_response_set_code(res, status_code);
+	request_metrics_record_code(status_code);
+}
+
 bool send_common_feedback(onion_response *res, int status_code, const char* message) {
 	return send_single_str_field_feedback(res, status_code, "msg", message);
 }
@@ -39,10 +47,14 @@ bool send_common_feedback_miss_param_helper(onion_response *res, int status_code
 	if (res == NULL) {
 		return false;
 	}
-	onion_response_set_code(res, status_code);
 	if (param_name != NULL && strlen(param_name) > 0) {
-		return onion_response_printf(res, "{\"msg\":\"missing parameter %s\"}", param_name) >= 0;
+		GString *message = g_string_new("missing parameter ");
+		g_string_append(message, param_name);
+		const bool ret = send_single_str_field_feedback(res, status_code, "msg", message->str);
+		g_string_free(message, true);
+		return ret;
 	} else {
+		set_response_code(res, status_code);
 		return true;
 	}
 }
@@ -72,11 +84,22 @@ bool send_some_gstring_and_free(onion_response *res, int status_code, GString *g
 		}
 		return false;
 	}
-	onion_response_set_code(res, status_code);
+	set_response_code(res, status_code);
 	if (gstr == NULL) {
 		return true;
 	}
-	bool ret = onion_response_printf(res, "%s", gstr->str) >= 0;
+	if (response_encoding_current() == RESPONSE_ENCODING_CBOR) {
+		GString *cbor = response_encoding_json_to_cbor(gstr->str, gstr->len);
+		if (cbor != NULL) {
+			g_string_free(gstr, true);
+			gstr = cbor;
+			onion_response_set_header(res, "Content-Type", RESPONSE_ENCODING_CBOR_MEDIA_TYPE);
+		} else {
+			syslog_server(LOG_WARNING, "Send gstring - reply is not valid json, sending it as is");
+		}
+	}
+	// Written as is, the length is known, so no need to go through a format string
+	bool ret = onion_response_write(res, gstr->str, gstr->len) >= 0;
 	g_string_free(gstr, true);
 	gstr = NULL;
 	return ret;
@@ -87,11 +110,15 @@ bool send_single_str_field_feedback(onion_response *res, int status_code, const
 	if (res == NULL) {
 		return false;
 	}
-	onion_response_set_code(res, status_code);
 	if (field_name != NULL && strlen(field_name) > 0 
 		&& field_value != NULL && strlen(field_value) > 0) {
-		return onion_response_printf(res, "{\"%s\":\"%s\"}", field_name, field_value) >= 0;
+		GString *feedback = g_string_sized_new(32 + strlen(field_value));
+		append_start_of_obj(feedback, false);
+		append_field_str_value(feedback, field_name, field_value, false);
+		append_end_of_obj(feedback, false);
+		return send_some_gstring_and_free(res, status_code, feedback);
 	} else {
+		set_response_code(res, status_code);
 		return true;
 	}
 }
@@ -100,11 +127,11 @@ bool send_some_cstring(onion_response *res, int status_code, const char *cstr) {
 	if (res == NULL) {
 		return false;
 	}
-	onion_response_set_code(res, status_code);
+	set_response_code(res, status_code);
 	if (cstr == NULL) {
 		return true;
 	} else {
-		return onion_response_printf(res, "%s", cstr) >= 0;
+		return onion_response_write0(res, cstr) >= 0;
 	}
 }
 
@@ -112,11 +139,11 @@ onion_connection_status handle_req_run_or_method_fail(onion_response *res, bool
                                                       const char *caller_logname) {
 	if (is_running) {
 		syslog_server(LOG_WARNING, "Request: %s - wrong request type", caller_logname);
-		onion_response_set_code(res, HTTP_METHOD_NOT_ALLOWED);
+		set_response_code(res, HTTP_METHOD_NOT_ALLOWED);
 		return OCS_NOT_IMPLEMENTED;
 	} else {
 		syslog_server(LOG_ERR, "Request: %s - system not running", caller_logname);
-		onion_response_set_code(res, HTTP_SERVICE_UNAVAILABLE);
+		set_response_code(res, HTTP_SERVICE_UNAVAILABLE);
 		return OCS_PROCESSED;
 	}
 }
@@ -32,7 +32,8 @@
 #include <stdbool.h>
 #include <onion/types.h>
 
-// The onion library we use has no define for the 409 code. Add it here.
+// The onion library we use has no define for the 202 and 409 codes. Add them here.
+#define CUSTOM_HTTP_CODE_ACCEPTED 202
 #define CUSTOM_HTTP_CODE_CONFLICT 409
 
 /**
@@ -47,6 +48,16 @@
  */
 bool send_common_feedback(onion_response *res, int status_code, const char* message);
 
+/**
+ * @brief Sets the http status code of the response, and records it for the request metrics
+ * (onion does not offer a way to read the code back). Use this instead of 
+ * onion_response_set_code.
+ * 
+ * @param res the response whose code to set. Shall not be NULL.
+ * @param status_code http status code to set
+ */
+void set_response_code(onion_response *res, int status_code);
+
 /**
  * @brief Constructs the common-feedback json with field prefilled for a missing parameter msg, 
  * and sends it via the response res. 
@@ -75,7 +86,8 @@ bool handle_param_miss_check(onion_response *res, const char *request_log_name,
 
 /**
  * @brief Sends the content of gstr via the response res. Then free's the GString,
- * i.e., this is a transfer of ownership.
+ * i.e., this is a transfer of ownership. If the client accepts CBOR 
+ * (see response_encoding_handler), the json in gstr is sent encoded as CBOR.
  * 
  * @param res the response over which to send. Shall not be NULL.
  * @param status_code http status code to set for the response to be sent
@@ -0,0 +1,242 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#include <dirent.h>
+#include <glib.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <utime.h>
+
+#include "compile_cache.h"
+#include "server.h"
+
+static pthread_mutex_t compile_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Signalled whenever a compilation has finished and its key is no longer in flight
+static pthread_cond_t compile_cache_compiled = PTHREAD_COND_INITIALIZER;
+// Keys of the models being compiled, so that identical uploads do not compile twice at once
+static GHashTable *compile_cache_in_flight = NULL;
+
+// Compiler identities of TRAIN_ENGINE and INTERLOCKER, computed by compile_cache_init
+static char compiler_identities[2][2048];
+
+// Computes the key of a model as the SHA-256 of its file name, content and the compiler 
+// identity; returns NULL if the model cannot be read, otherwise a string to free with g_free
+static gchar *compile_cache_key(dynlib_type type, const char model_path[]) {
+	FILE *model = fopen(model_path, "rb");
+	if (model == NULL) {
+		return NULL;
+	}
+	GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA256);
+	char model_path_copy[PATH_MAX + NAME_MAX];
+	snprintf(model_path_copy, sizeof(model_path_copy), "%s", model_path);
+	const char *filename = basename(model_path_copy);
+	g_checksum_update(checksum, (const guchar *) filename, strlen(filename) + 1);
+	
+	unsigned char buffer[8192];
+	size_t read_len;
+	while ((read_len = fread(buffer, 1, sizeof(buffer), model)) > 0) {
+		g_checksum_update(checksum, buffer, read_len);
+	}
+	const bool read_error = ferror(model);
+	fclose(model);
+	
+	const char *identity = compiler_identities[type == TRAIN_ENGINE ? 0 : 1];
+	g_checksum_update(checksum, (const guchar *) identity, strlen(identity));
+	
+	gchar *key = read_error ? NULL : g_strdup(g_checksum_get_string(checksum));
+	g_checksum_free(checksum);
+	return key;
+}
+
+// Copies a file, writing to a temporary file first so that dest is never partially written
+static bool copy_file(const char src[], const char dest[]) {
+	char temp[PATH_MAX + NAME_MAX + 8];
+	snprintf(temp, sizeof(temp), "%s.tmp", dest);
+	FILE *in = fopen(src, "rb");
+	if (in == NULL) {
+		return false;
+	}
+	FILE *out = fopen(temp, "wb");
+	if (out == NULL) {
+		fclose(in);
+		return false;
+	}
+	bool success = true;
+	unsigned char buffer[65536];
+	size_t read_len;
+	while ((read_len = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+		if (fwrite(buffer, 1, read_len, out) != read_len) {
+			success = false;
+			break;
+		}
+	}
+	success = success && !ferror(in);
+	fclose(in);
+	success = (fclose(out) == 0) && success;
+	if (!success || rename(temp, dest) != 0) {
+		remove(temp);
+		return false;
+	}
+	chmod(dest, 0755);
+	return true;
+}
+
+typedef struct {
+	char path[PATH_MAX + NAME_MAX];
+	time_t last_used;
+	off_t size;
+} t_cache_entry;
+
+static gint compare_last_used(gconstpointer a, gconstpointer b) {
+	const t_cache_entry *entry_a = a;
+	const t_cache_entry *entry_b = b;
+	return (entry_a->last_used > entry_b->last_used) - (entry_a->last_used < entry_b->last_used);
+}
+
+// Removes the least recently used libraries until the cache is within its limits
+static void evict(void) {
+	DIR *dir_handle = opendir(COMPILE_CACHE_DIR);
+	if (dir_handle == NULL) {
+		return;
+	}
+	GArray *entries = g_array_new(false, false, sizeof(t_cache_entry));
+	unsigned long long total_size = 0;
+	struct dirent *dir_entry = NULL;
+	while ((dir_entry = readdir(dir_handle)) != NULL) {
+		if (!g_str_has_suffix(dir_entry->d_name, ".so")) {
+			continue;
+		}
+		t_cache_entry entry;
+		snprintf(entry.path, sizeof(entry.path), "%s/%s", COMPILE_CACHE_DIR, dir_entry->d_name);
+		struct stat entry_stat;
+		if (stat(entry.path, &entry_stat) == 0) {
+			// The modification time is updated on every hit
+			entry.last_used = entry_stat.st_mtime;
+			entry.size = entry_stat.st_size;
+			total_size += entry.size;
+			g_array_append_val(entries, entry);
+		}
+	}
+	closedir(dir_handle);
+	
+	g_array_sort(entries, compare_last_used);
+	unsigned int count = entries->len;
+	for (unsigned int i = 0; i < entries->len; i++) {
+		if (count <= COMPILE_CACHE_ENTRY_COUNT_MAX && total_size <= COMPILE_CACHE_SIZE_MAX) {
+			break;
+		}
+		const t_cache_entry *entry = &g_array_index(entries, t_cache_entry, i);
+		if (remove(entry->path) == 0) {
+			syslog_server(LOG_INFO, "Compile cache - evicted %s", entry->path);
+			count--;
+			total_size -= entry->size;
+		}
+	}
+	g_array_free(entries, true);
+}
+
+void compile_cache_init(void) {
+	pthread_mutex_lock(&compile_cache_mutex);
+	dynlib_compiler_identity(TRAIN_ENGINE, compiler_identities[0], sizeof(compiler_identities[0]));
+	dynlib_compiler_identity(INTERLOCKER, compiler_identities[1], sizeof(compiler_identities[1]));
+	if (compile_cache_in_flight == NULL) {
+		compile_cache_in_flight = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	}
+	pthread_mutex_unlock(&compile_cache_mutex);
+}
+
+dynlib_status compile_cache_compile(dynlib_type type, const char filepath[], 
+                                    const char output_dir[]) {
+	char filepath_copy[PATH_MAX + NAME_MAX];
+	snprintf(filepath_copy, sizeof(filepath_copy), "%s", filepath);
+	const char *filename = basename(filepath_copy);
+	
+	char model_path[PATH_MAX + NAME_MAX];
+	char library_path[PATH_MAX + NAME_MAX];
+	if (type == TRAIN_ENGINE) {
+		snprintf(model_path, sizeof(model_path), "%s.sctx", filepath);
+		snprintf(library_path, sizeof(library_path), "%s/lib%s.so", output_dir, filename);
+	} else {
+		snprintf(model_path, sizeof(model_path), "%s.bahn", filepath);
+		snprintf(library_path, sizeof(library_path), 
+		         "%s/libinterlocker_%s.so", output_dir, filename);
+	}
+	
+	gchar *key = compile_cache_key(type, model_path);
+	if (key == NULL) {
+		syslog_server(LOG_WARNING, "Compile cache - cannot read %s, compiling uncached", model_path);
+		return type == TRAIN_ENGINE ? dynlib_compile_scchart(filepath, output_dir) 
+		                            : dynlib_compile_bahndsl(filepath, output_dir);
+	}
+	char cached_path[PATH_MAX + NAME_MAX];
+	snprintf(cached_path, sizeof(cached_path), "%s/%s.so", COMPILE_CACHE_DIR, key);
+	
+	pthread_mutex_lock(&compile_cache_mutex);
+	while (true) {
+		if (copy_file(cached_path, library_path)) {
+			// Marks the library as recently used for the eviction
+			utime(cached_path, NULL);
+			pthread_mutex_unlock(&compile_cache_mutex);
+			g_free(key);
+			syslog_server(LOG_NOTICE, "Compile cache - %s loaded from %s", filename, cached_path);
+			return DYNLIB_COMPILE_SUCCESS;
+		}
+		if (!g_hash_table_contains(compile_cache_in_flight, key)) {
+			break;
+		}
+		// An identical upload is being compiled, whose library is copied once it is cached
+		pthread_cond_wait(&compile_cache_compiled, &compile_cache_mutex);
+	}
+	g_hash_table_add(compile_cache_in_flight, key);
+	pthread_mutex_unlock(&compile_cache_mutex);
+	
+	const dynlib_status status = type == TRAIN_ENGINE 
+	                             ? dynlib_compile_scchart(filepath, output_dir) 
+	                             : dynlib_compile_bahndsl(filepath, output_dir);
+	
+	pthread_mutex_lock(&compile_cache_mutex);
+	if (status == DYNLIB_COMPILE_SUCCESS) {
+		mkdir(COMPILE_CACHE_DIR, 0755);
+		if (copy_file(library_path, cached_path)) {
+			syslog_server(LOG_INFO, "Compile cache - %s added as %s", filename, cached_path);
+			evict();
+		} else {
+			// E.g., a .dylib instead of a .so, which is not cached
+			syslog_server(LOG_WARNING, "Compile cache - %s could not be added", filename);
+		}
+	}
+	// A waiting upload compiles the model itself if this compilation failed
+	g_hash_table_remove(compile_cache_in_flight, key);
+	pthread_cond_broadcast(&compile_cache_compiled);
+	pthread_mutex_unlock(&compile_cache_mutex);
+	return status;
+}
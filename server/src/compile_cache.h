@@ -0,0 +1,67 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#ifndef COMPILE_CACHE_H
+#define COMPILE_CACHE_H
+
+#include "dynlib.h"
+
+// Directory of the cached libraries, kept across restarts (unlike the engine and 
+// interlocker directories)
+#define COMPILE_CACHE_DIR			"compile-cache"
+// Maximum number of cached libraries
+#define COMPILE_CACHE_ENTRY_COUNT_MAX	64
+// Maximum total size of the cached libraries
+#define COMPILE_CACHE_SIZE_MAX		(256 * 1024 * 1024)
+
+/**
+ * Computes the identities of the compilers and flags, which are part of the cache keys, 
+ * once instead of for every compilation. Shall be called at startup before 
+ * compile_cache_compile.
+ */
+void compile_cache_init(void);
+
+/**
+ * Compiles a model into a shared library like dynlib_compile_scchart (type TRAIN_ENGINE) 
+ * or dynlib_compile_bahndsl (type INTERLOCKER), unless a library compiled from the same 
+ * model file name and content with the same compilers and flags is cached. 
+ * A cached library is copied into the output directory instead of compiling, 
+ * and a newly compiled library is added to the cache. If the cache exceeds its limits, 
+ * the least recently used libraries are evicted. An upload of a model that is already 
+ * being compiled waits for that compilation and copies its library.
+ * 
+ * @param type TRAIN_ENGINE or INTERLOCKER
+ * @param filepath path of the model without extension (.sctx or .bahn)
+ * @param output_dir directory of the compiled library
+ * @return DYNLIB_COMPILE_SUCCESS, or the error of the compilation
+ */
+dynlib_status compile_cache_compile(dynlib_type type, const char filepath[], 
+                                    const char output_dir[]);
+
+#endif  // COMPILE_CACHE_H
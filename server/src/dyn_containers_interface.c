@@ -30,6 +30,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <stdatomic.h>
 #include <glib.h>
 #include <bidib/bidib.h>
 
@@ -37,6 +38,8 @@
 #include "handler_admin.h"
 #include "server.h"
 #include "handler_driver.h"
+#include "request_metrics.h"
+#include "memory_footprint.h"
 
 
 
@@ -54,6 +57,17 @@ static const key_t shm_key = 1234;
 
 long long dyn_containers_actuate_reaction_counter = 0;
 
+// Mailbox holding the latest requested speed of each train engine instance. 
+// Written without locking by the request handlers and consumed once per LET tick 
+// when the containers copy their inputs. Layout: [pending:1][forwards:1][speed:8]
+#define SPEED_MAILBOX_PENDING  (1u << 9)
+#define SPEED_MAILBOX_FORWARDS (1u << 8)
+#define SPEED_MAILBOX_SPEED    0xFFu
+
+static atomic_uint speed_mailbox[TRAIN_ENGINE_INSTANCE_COUNT_MAX];
+static atomic_ullong speed_mailbox_posted[TRAIN_ENGINE_INSTANCE_COUNT_MAX];
+static atomic_ullong speed_mailbox_superseded[TRAIN_ENGINE_INSTANCE_COUNT_MAX];
+
 
 static void dyn_containers_reset_interface(t_dyn_containers_interface *dyn_containers_interface) {
 	if (dyn_containers_interface == NULL) {
@@ -76,6 +90,7 @@ static void dyn_containers_reset_interface(t_dyn_containers_interface *dyn_conta
 		};
 	}
 	for (int i = 0; i < TRAIN_ENGINE_INSTANCE_COUNT_MAX; i++) {
+		atomic_store(&speed_mailbox[i], 0);
 		dyn_containers_interface->train_engine_instances_io[i] = 
 		(struct t_train_engine_instance_io) {
 			.input_grab = false,
@@ -169,8 +184,8 @@ static void *dyn_containers_actuate(void *_) {
 	}
 	
 	do {
-		pthread_mutex_lock(&grabbed_trains_mutex);
-		pthread_mutex_lock(&dyn_containers_mutex);
+		request_metrics_mutex_lock(&grabbed_trains_mutex);
+		request_metrics_mutex_lock(&dyn_containers_mutex);
 		
 		for (int i = 0; i < TRAIN_ENGINE_INSTANCE_COUNT_MAX; i++) {
 			dyn_actuate_specific_engine(i);
@@ -192,6 +207,12 @@ static void *dyn_containers_actuate(void *_) {
 
 int dyn_containers_start(void) {
 	dyn_containers_shm_create(&shm_config, shm_permissions, shm_key, &dyn_containers_interface);
+	if (dyn_containers_interface != NULL) {
+		// The segment occupies whole pages
+		const size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+		memory_footprint_set(MEMORY_SUBSYSTEM_DYN_CONTAINERS, 
+		                     (shm_config.size + page_size - 1) / page_size * page_size);
+	}
 	dyn_containers_reset_interface(dyn_containers_interface);
 	pthread_create(&dyn_containers_thread, NULL, forec_dyn_containers, NULL);
 	pthread_create(&dyn_containers_actuate_thread, NULL, dyn_containers_actuate, NULL);
@@ -204,6 +225,7 @@ void dyn_containers_stop(void) {
 	
 	dyn_containers_shm_detach(&dyn_containers_interface);
 	dyn_containers_shm_delete(&shm_config);
+	memory_footprint_set(MEMORY_SUBSYSTEM_DYN_CONTAINERS, 0);
 	syslog_server(LOG_NOTICE, "Closed dynamic library containers");
 }
 
@@ -307,7 +329,7 @@ void dyn_containers_set_engine(int engine_slot, const char filepath[]) {
 	while (!tr_eng_io->output_in_use) {
 		usleep(let_period_us);
 	}
-	pthread_mutex_lock(&dyn_containers_mutex);
+	request_metrics_mutex_lock(&dyn_containers_mutex);
 	tr_eng_io->input_load = false;
 	syslog_server(LOG_NOTICE, 
 	              "Train engine %s has been dynamically loaded into engine slot %d", 
@@ -341,7 +363,7 @@ bool dyn_containers_free_engine(int engine_slot) {
 	while (tr_eng_io->output_in_use) {
 		usleep(let_period_us);
 	}
-	pthread_mutex_lock(&dyn_containers_mutex);
+	request_metrics_mutex_lock(&dyn_containers_mutex);
 	tr_eng_io->input_unload = false;
 	syslog_server(LOG_NOTICE, "Unloaded train engine at slot %d", engine_slot);
 	return true;
@@ -352,7 +374,7 @@ GArray *dyn_containers_get_train_engines_arr(void) {
 		return NULL;
 	}
 	GArray *train_engine_names = g_array_new(FALSE, FALSE, sizeof(char *));
-	pthread_mutex_lock(&dyn_containers_mutex);
+	request_metrics_mutex_lock(&dyn_containers_mutex);
 	for (int i = 0; i < TRAIN_ENGINE_COUNT_MAX; ++i) {
 		const struct t_train_engine_io *tr_eng_io = &dyn_containers_interface->train_engines_io[i];
 		if (!tr_eng_io->output_in_use) {
@@ -378,7 +400,7 @@ int dyn_containers_set_train_engine_instance(t_train_data *grabbed_train,
 		return 1;
 	}
 	
-	pthread_mutex_lock(&dyn_containers_mutex);
+	request_metrics_mutex_lock(&dyn_containers_mutex);
 	int train_engine_type = -1;
 	for (int i = 0; i < TRAIN_ENGINE_COUNT_MAX; i++) {
 		struct t_train_engine_io *train_engine_io = &dyn_containers_interface->train_engines_io[i];
@@ -402,13 +424,14 @@ int dyn_containers_set_train_engine_instance(t_train_data *grabbed_train,
 			tr_eng_instance_io->input_train_engine_type = train_engine_type;
 			tr_eng_instance_io->input_requested_speed = 0;
 			tr_eng_instance_io->input_requested_forwards = true;
+			atomic_store(&speed_mailbox[i], 0);
 			pthread_mutex_unlock(&dyn_containers_mutex);
 			
 			do {
 				usleep(let_period_us);
 			} while (!tr_eng_instance_io->output_in_use);
 			
-			pthread_mutex_lock(&dyn_containers_mutex);
+			request_metrics_mutex_lock(&dyn_containers_mutex);
 			tr_eng_instance_io->input_grab = false;
 			pthread_mutex_unlock(&dyn_containers_mutex);
 			
@@ -431,7 +454,7 @@ void dyn_containers_free_train_engine_instance(int dyn_containers_engine_instanc
 	struct t_train_engine_instance_io *tr_eng_instance_io = 
 		&dyn_containers_interface->train_engine_instances_io[dyn_containers_engine_instance];
 	
-	pthread_mutex_lock(&dyn_containers_mutex);
+	request_metrics_mutex_lock(&dyn_containers_mutex);
 	tr_eng_instance_io->input_release = true;
 	pthread_mutex_unlock(&dyn_containers_mutex);
 	
@@ -439,7 +462,7 @@ void dyn_containers_free_train_engine_instance(int dyn_containers_engine_instanc
 		usleep(let_period_us);
 	} while (tr_eng_instance_io->output_in_use);
 	
-	pthread_mutex_lock(&dyn_containers_mutex);
+	request_metrics_mutex_lock(&dyn_containers_mutex);
 	tr_eng_instance_io->input_release = false;
 	pthread_mutex_unlock(&dyn_containers_mutex);
 	
@@ -455,12 +478,72 @@ void dyn_containers_set_train_engine_instance_inputs(int dyn_containers_engine_i
 	struct t_train_engine_instance_io *tr_eng_instance_io = 
 			&dyn_containers_interface->train_engine_instances_io[dyn_containers_engine_instance];
 	
-	pthread_mutex_lock(&dyn_containers_mutex);
+	request_metrics_mutex_lock(&dyn_containers_mutex);
+	// Discard an older request still waiting in the mailbox, otherwise it 
+	// would overwrite these inputs at the start of the next tick
+	atomic_store(&speed_mailbox[dyn_containers_engine_instance], 0);
 	tr_eng_instance_io->input_requested_speed = requested_speed;
 	tr_eng_instance_io->input_requested_forwards = requested_forwards;
 	pthread_mutex_unlock(&dyn_containers_mutex);
 }
 
+bool dyn_containers_post_train_engine_instance_speed(int dyn_containers_engine_instance, 
+                                                     int requested_speed, 
+                                                     bool requested_forwards) {
+	if (dyn_containers_engine_instance < 0 
+	        || dyn_containers_engine_instance >= TRAIN_ENGINE_INSTANCE_COUNT_MAX) {
+		return false;
+	}
+	const unsigned int request = SPEED_MAILBOX_PENDING 
+	                             | (requested_forwards ? SPEED_MAILBOX_FORWARDS : 0)
+	                             | ((unsigned int) requested_speed & SPEED_MAILBOX_SPEED);
+	const unsigned int previous = 
+			atomic_exchange(&speed_mailbox[dyn_containers_engine_instance], request);
+	atomic_fetch_add(&speed_mailbox_posted[dyn_containers_engine_instance], 1);
+	
+	// The previous request has not been consumed by a tick yet, so it is overwritten
+	const bool superseded = (previous & SPEED_MAILBOX_PENDING) != 0;
+	if (superseded) {
+		atomic_fetch_add(&speed_mailbox_superseded[dyn_containers_engine_instance], 1);
+	}
+	return superseded;
+}
+
+// Shall only be called while the dyn_containers_mutex is locked
+void dyn_containers_consume_train_engine_instance_speeds(void) {
+	if (dyn_containers_interface == NULL) {
+		return;
+	}
+	for (int i = 0; i < TRAIN_ENGINE_INSTANCE_COUNT_MAX; i++) {
+		// Cheap check first to avoid a read-modify-write on idle mailboxes
+		if ((atomic_load_explicit(&speed_mailbox[i], memory_order_relaxed) 
+		        & SPEED_MAILBOX_PENDING) == 0) {
+			continue;
+		}
+		const unsigned int request = atomic_exchange(&speed_mailbox[i], 0);
+		if ((request & SPEED_MAILBOX_PENDING) != 0) {
+			struct t_train_engine_instance_io *tr_eng_instance_io = 
+					&dyn_containers_interface->train_engine_instances_io[i];
+			tr_eng_instance_io->input_requested_speed = request & SPEED_MAILBOX_SPEED;
+			tr_eng_instance_io->input_requested_forwards = 
+					(request & SPEED_MAILBOX_FORWARDS) != 0;
+		}
+	}
+}
+
+void dyn_containers_get_speed_mailbox_stats(int dyn_containers_engine_instance, 
+                                            unsigned long long *posted, 
+                                            unsigned long long *superseded) {
+	if (dyn_containers_engine_instance < 0 
+	        || dyn_containers_engine_instance >= TRAIN_ENGINE_INSTANCE_COUNT_MAX) {
+		*posted = 0;
+		*superseded = 0;
+		return;
+	}
+	*posted = atomic_load(&speed_mailbox_posted[dyn_containers_engine_instance]);
+	*superseded = atomic_load(&speed_mailbox_superseded[dyn_containers_engine_instance]);
+}
+
 // Finds the first available slot for a interlocker
 // Shall only be called while the dyn_containers_mutex is locked
 int dyn_containers_get_free_interlocker_slot(void) {
@@ -509,7 +592,7 @@ void dyn_containers_set_interlocker(int interlocker_slot, const char filepath[])
 	while (!interlocker_io->output_in_use) {
 		usleep(let_period_us);
 	}
-	pthread_mutex_lock(&dyn_containers_mutex);
+	request_metrics_mutex_lock(&dyn_containers_mutex);
 	interlocker_io->input_load = false;
 	syslog_server(LOG_NOTICE,
 	              "Interlocker %s has been dynamically loaded into interlocker slot %d",
@@ -545,7 +628,7 @@ bool dyn_containers_free_interlocker(int interlocker_slot) {
 	while (interlocker_io->output_in_use) {
 		usleep(let_period_us);
 	}
-	pthread_mutex_lock(&dyn_containers_mutex);
+	request_metrics_mutex_lock(&dyn_containers_mutex);
 	interlocker_io->input_unload = false;
 	syslog_server(LOG_NOTICE, "Unloaded interlocker at slot %d", interlocker_slot);
 	return true;
@@ -556,7 +639,7 @@ GArray *dyn_containers_get_interlockers_arr(void) {
 		return NULL;
 	}
 	GArray *interlocker_names = g_array_new(FALSE, FALSE, sizeof(char *));
-	pthread_mutex_lock(&dyn_containers_mutex);
+	request_metrics_mutex_lock(&dyn_containers_mutex);
 	for (int i = 0; i < INTERLOCKER_COUNT_MAX; ++i) {
 		const struct t_interlocker_io *interlocker_io =
 				&dyn_containers_interface->interlockers_io[i];
@@ -603,7 +686,7 @@ int dyn_containers_set_interlocker_instance(t_interlocker_data *interlocker_inst
 		return 1;
 	}
 	
-	pthread_mutex_lock(&dyn_containers_mutex);
+	request_metrics_mutex_lock(&dyn_containers_mutex);
 	int interlocker_type = -1;
 	for (int i = 0; i < INTERLOCKER_COUNT_MAX; i++) {
 		struct t_interlocker_io *interlocker_io = &dyn_containers_interface->interlockers_io[i];
@@ -632,7 +715,7 @@ int dyn_containers_set_interlocker_instance(t_interlocker_data *interlocker_inst
 				usleep(let_period_us);
 			} while (!interlocker_instance_io->output_in_use);
 			
-			pthread_mutex_lock(&dyn_containers_mutex);
+			request_metrics_mutex_lock(&dyn_containers_mutex);
 			interlocker_instance_io->input_grab = false;
 			pthread_mutex_unlock(&dyn_containers_mutex);
 			
@@ -661,7 +744,7 @@ void dyn_containers_free_interlocker_instance(t_interlocker_data *interlocker_in
 	struct t_interlocker_instance_io *interlocker_instance_io = 
 			&dyn_containers_interface->interlocker_instances_io[inst_index];
 	
-	pthread_mutex_lock(&dyn_containers_mutex);
+	request_metrics_mutex_lock(&dyn_containers_mutex);
 	interlocker_instance_io->input_release = true;
 	pthread_mutex_unlock(&dyn_containers_mutex);
 	
@@ -669,7 +752,7 @@ void dyn_containers_free_interlocker_instance(t_interlocker_data *interlocker_in
 		usleep(let_period_us);
 	} while (interlocker_instance_io->output_in_use);
 	
-	pthread_mutex_lock(&dyn_containers_mutex);
+	request_metrics_mutex_lock(&dyn_containers_mutex);
 	interlocker_instance_io->input_release = false;
 	pthread_mutex_unlock(&dyn_containers_mutex);
 	
@@ -691,7 +774,7 @@ void dyn_containers_set_interlocker_instance_reset(t_interlocker_data *interlock
 	struct t_interlocker_instance_io *interlocker_instance_io = 
 			&dyn_containers_interface->interlocker_instances_io[inst_index];
 	
-	pthread_mutex_lock(&dyn_containers_mutex);
+	request_metrics_mutex_lock(&dyn_containers_mutex);
 	interlocker_instance_io->input_reset = reset;
 	pthread_mutex_unlock(&dyn_containers_mutex);
 }
@@ -714,7 +797,7 @@ void dyn_containers_set_interlocker_instance_inputs(t_interlocker_data *interloc
 	struct t_interlocker_instance_io *interlocker_instance_io = 
 			&dyn_containers_interface->interlocker_instances_io[inst_index];
 	
-	pthread_mutex_lock(&dyn_containers_mutex);
+	request_metrics_mutex_lock(&dyn_containers_mutex);
 	interlocker_instance_io->input_reset = true;
 	strncpy(interlocker_instance_io->input_src_signal_id, src_signal_id, NAME_MAX);
 	strncpy(interlocker_instance_io->input_dst_signal_id, dst_signal_id, NAME_MAX);
@@ -734,7 +817,7 @@ void dyn_containers_get_interlocker_instance_outputs(t_interlocker_data *interlo
 	struct t_interlocker_instance_io *interlocker_instance_io = 
 		&dyn_containers_interface->interlocker_instances_io[inst_index];
 	
-	pthread_mutex_lock(&dyn_containers_mutex);
+	request_metrics_mutex_lock(&dyn_containers_mutex);
 	interlocker_instance_io_copy->output_in_use = interlocker_instance_io->output_in_use;
 	interlocker_instance_io_copy->output_has_reset = interlocker_instance_io->output_has_reset;
 	interlocker_instance_io_copy->output_interlocker_type = interlocker_instance_io->output_interlocker_type;
@@ -159,6 +159,22 @@ void dyn_containers_set_train_engine_instance_inputs(int dyn_containers_engine_i
                                                      int requested_speed, 
                                                      bool requested_forwards);
 
+// Posts the latest requested speed of a train engine instance without taking any lock.
+// Only the most recent request per LET tick reaches the train engine; returns true 
+// if an earlier request that had not been consumed yet was superseded.
+bool dyn_containers_post_train_engine_instance_speed(int dyn_containers_engine_instance, 
+                                                     int requested_speed, 
+                                                     bool requested_forwards);
+
+// Copies pending posted speeds into the train engine instance inputs
+// Can only be called while the dyn_containers_mutex is locked
+void dyn_containers_consume_train_engine_instance_speeds(void);
+
+// Gets the number of posted and superseded speed requests of a train engine instance
+void dyn_containers_get_speed_mailbox_stats(int dyn_containers_engine_instance, 
+                                            unsigned long long *posted, 
+                                            unsigned long long *superseded);
+
 
 // Finds the first available slot for a interlocker
 // Can only be called while the dyn_containers_mutex is locked
@@ -30,6 +30,7 @@
 #include <dlfcn.h>
 #include <string.h>
 #include <libgen.h>
+#include <sys/stat.h>
 
 #include "dynlib.h"
 #include "server.h"
@@ -54,6 +55,43 @@ dynlib_status dynlib_load_interlocker_funcs(dynlib_data *library);
 dynlib_status dynlib_load_drive_route_funcs(dynlib_data *library);
 
 
+// Appends the modification time and size of a tool to dest, so that updating it changes the identity
+static void append_tool_identity(char dest[], size_t dest_len, const char env_name[], 
+                                 const char relative_path[]) {
+	const char *dir = getenv(env_name);
+	char path[PATH_MAX + NAME_MAX];
+	snprintf(path, sizeof(path), "%s/%s", dir != NULL ? dir : "", relative_path);
+	struct stat tool_stat;
+	const size_t len = strlen(dest);
+	if (stat(path, &tool_stat) == 0) {
+		snprintf(dest + len, dest_len - len, "%s %lld %lld\n", path, 
+		         (long long) tool_stat.st_mtime, (long long) tool_stat.st_size);
+	} else {
+		snprintf(dest + len, dest_len - len, "%s missing\n", path);
+	}
+}
+
+// Describes the compilers and flags used for a library type
+void dynlib_compiler_identity(dynlib_type type, char dest[], size_t dest_len) {
+	if (type == TRAIN_ENGINE) {
+		snprintf(dest, dest_len, "%s\n%s\n", sccharts_compiler_c_command, c_compiler_command);
+		append_tool_identity(dest, dest_len, "KIELER_PATH", "kico.jar");
+		
+		// The C compiler is found via PATH, so its version identifies it
+		FILE *version_pipe = popen("clang --version 2>/dev/null", "r");
+		if (version_pipe != NULL) {
+			const size_t len = strlen(dest);
+			if (fgets(dest + len, dest_len - len, version_pipe) == NULL) {
+				dest[len] = '\0';
+			}
+			pclose(version_pipe);
+		}
+	} else {
+		snprintf(dest, dest_len, "%s\n%s\n", bahndsl_compiler_command, bahndsl_move_command);
+		append_tool_identity(dest, dest_len, "BAHNC_PATH", "bahnc");
+	}
+}
+
 // Compiles a given SCCharts model into a shared library
 dynlib_status dynlib_compile_scchart(const char filepath[], const char output_dir[]) {
 	// Get the filename
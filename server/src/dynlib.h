@@ -29,6 +29,7 @@
 #define DYNLIB_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <limits.h>
 
 #include "tick_data.h"
@@ -89,6 +90,9 @@ typedef struct {
 
 dynlib_status dynlib_compile_scchart(const char filepath[], const char output_dir[]);
 dynlib_status dynlib_compile_bahndsl(const char filepath[], const char output_dir[]);
+// Describes the compilers, their versions and flags for a library type, 
+// e.g., to key a cache of compiled libraries
+void dynlib_compiler_identity(dynlib_type type, char dest[], size_t dest_len);
 
 dynlib_status dynlib_load(dynlib_data *library, const char filepath[], dynlib_type type);
 bool dynlib_is_loaded(dynlib_data *library);
@@ -0,0 +1,427 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fleet_scheduler.h"
+#include "server.h"
+#include "handler_controller.h"
+#include "interlocking.h"
+#include "route_planner.h"
+#include "request_metrics.h"
+
+typedef struct {
+	t_fleet_timetable_entry entry;
+	t_fleet_train_stats stats;
+	pthread_t thread;
+	bool thread_started;
+	// Route that the train waits to be granted, NULL if it does not wait
+	const t_interlocking_route *waiting_route;
+	// Since when the train waits to be granted a route towards its next destination
+	unsigned long long waiting_since_ms;
+} t_fleet_train;
+
+// Mutex to lock when starting the scheduler or joining its threads
+static pthread_mutex_t fleet_scheduler_lifecycle_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Mutex to lock when accessing the statistics and waiting routes of the trains
+static pthread_mutex_t fleet_scheduler_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static t_fleet_train fleet_trains[FLEET_SCHEDULER_TRAIN_COUNT_MAX];
+static unsigned int fleet_train_count = 0;
+
+static atomic_bool fleet_stop_requested = false;
+static atomic_int fleet_active_count = 0;
+static atomic_ullong fleet_start_ms = 0;
+static atomic_ullong fleet_stop_ms = 0;
+
+static unsigned long long fleet_now_ms(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long long) now.tv_sec * 1000ULL + (unsigned long long) now.tv_nsec / 1000000ULL;
+}
+
+static bool fleet_may_continue(void) {
+	return running && !atomic_load(&fleet_stop_requested);
+}
+
+int fleet_scheduler_parse_timetable(const char *timetable, 
+                                    t_fleet_timetable_entry entries[FLEET_SCHEDULER_TRAIN_COUNT_MAX]) {
+	if (timetable == NULL || entries == NULL) {
+		syslog_server(LOG_ERR, "Fleet scheduler parse timetable - invalid (NULL) parameters");
+		return -1;
+	}
+	char *text = strdup(timetable);
+	if (text == NULL) {
+		syslog_server(LOG_ERR, "Fleet scheduler parse timetable - unable to allocate memory");
+		return -1;
+	}
+	
+	int entry_count = 0;
+	bool valid = true;
+	char *line_save = NULL;
+	for (char *line = strtok_r(text, "\n", &line_save); line != NULL && valid; 
+	     line = strtok_r(NULL, "\n", &line_save)) {
+		char *token_save = NULL;
+		const char *train_id = strtok_r(line, " \t\r", &token_save);
+		if (train_id == NULL || train_id[0] == '#') {
+			continue;
+		}
+		const char *priority_str = strtok_r(NULL, " \t\r", &token_save);
+		char *end = NULL;
+		const long priority = priority_str == NULL ? 0 : strtol(priority_str, &end, 10);
+		if (entry_count >= FLEET_SCHEDULER_TRAIN_COUNT_MAX 
+		    || strlen(train_id) >= FLEET_SCHEDULER_ID_LEN_MAX
+		    || priority_str == NULL || *end != '\0') {
+			valid = false;
+			break;
+		}
+		for (int i = 0; i < entry_count; i++) {
+			if (strcmp(entries[i].train_id, train_id) == 0) {
+				valid = false;
+			}
+		}
+		
+		t_fleet_timetable_entry *entry = &entries[entry_count];
+		memset(entry, 0, sizeof(t_fleet_timetable_entry));
+		strcpy(entry->train_id, train_id);
+		entry->priority = (int) priority;
+		
+		for (char *stop = strtok_r(NULL, " \t\r", &token_save); stop != NULL && valid; 
+		     stop = strtok_r(NULL, " \t\r", &token_save)) {
+			long dwell_s = 0;
+			char *dwell_str = strchr(stop, ':');
+			if (dwell_str != NULL) {
+				*dwell_str = '\0';
+				dwell_str++;
+				dwell_s = strtol(dwell_str, &end, 10);
+				valid = (*dwell_str != '\0' && *end == '\0' && dwell_s >= 0);
+			}
+			if (entry->stop_count >= FLEET_SCHEDULER_STOP_COUNT_MAX 
+			    || strlen(stop) == 0 || strlen(stop) >= FLEET_SCHEDULER_ID_LEN_MAX) {
+				valid = false;
+			}
+			if (valid) {
+				strcpy(entry->stops[entry->stop_count].destination, stop);
+				entry->stops[entry->stop_count].dwell_s = (unsigned int) dwell_s;
+				entry->stop_count++;
+			}
+		}
+		valid = valid && entry->stop_count > 0;
+		entry_count++;
+	}
+	free(text);
+	
+	if (!valid) {
+		syslog_server(LOG_ERR, "Fleet scheduler parse timetable - invalid timetable");
+		return -1;
+	}
+	return entry_count;
+}
+
+static bool routes_conflict(const t_interlocking_route *route, const t_interlocking_route *other) {
+	if (route == other) {
+		return true;
+	}
+	for (unsigned int i = 0; i < route->conflicts->len; i++) {
+		if (strcmp(g_array_index(route->conflicts, char *, i), other->id) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Whether another train takes precedence over the train with the given index, because it 
+// waits for a conflicting route and has a higher priority, or has waited longer.
+static bool other_train_takes_precedence(unsigned int index, const t_interlocking_route *route) {
+	bool precedence = false;
+	pthread_mutex_lock(&fleet_scheduler_mutex);
+	const t_fleet_train *train = &fleet_trains[index];
+	for (unsigned int i = 0; i < fleet_train_count && !precedence; i++) {
+		const t_fleet_train *other = &fleet_trains[i];
+		if (i == index || other->waiting_route == NULL 
+		    || !routes_conflict(route, other->waiting_route)) {
+			continue;
+		}
+		precedence = other->entry.priority > train->entry.priority
+		             || (other->entry.priority == train->entry.priority 
+		                 && other->waiting_since_ms < train->waiting_since_ms);
+	}
+	pthread_mutex_unlock(&fleet_scheduler_mutex);
+	return precedence;
+}
+
+// Tries to get the route granted until it is granted or the replan timeout has passed.
+static bool wait_for_route_grant(unsigned int index, const char *route_id) {
+	t_fleet_train *train = &fleet_trains[index];
+	const char *train_id = train->entry.train_id;
+	const t_interlocking_route *route = get_route(route_id);
+	if (route == NULL) {
+		return false;
+	}
+	
+	const unsigned long long wait_start_ms = fleet_now_ms();
+	pthread_mutex_lock(&fleet_scheduler_mutex);
+	train->waiting_route = route;
+	if (train->waiting_since_ms == 0) {
+		train->waiting_since_ms = wait_start_ms;
+	}
+	pthread_mutex_unlock(&fleet_scheduler_mutex);
+	
+	bool granted = false;
+	while (fleet_may_continue() 
+	       && fleet_now_ms() - wait_start_ms < FLEET_SCHEDULER_REPLAN_TIMEOUT_MS) {
+		const bool yields = other_train_takes_precedence(index, route);
+		if (!yields) {
+			const char *result = grant_route_id(train_id, route_id);
+			if (strcmp(result, "granted") == 0) {
+				granted = true;
+				break;
+			} else if (strcmp(result, "not_known") == 0 || strcmp(result, "internal_error") == 0) {
+				break;
+			}
+		}
+		pthread_mutex_lock(&fleet_scheduler_mutex);
+		if (yields) {
+			train->stats.precedence_yields++;
+		} else {
+			train->stats.grant_refusals++;
+		}
+		pthread_mutex_unlock(&fleet_scheduler_mutex);
+		usleep(FLEET_SCHEDULER_GRANT_RETRY_US);
+	}
+	
+	const unsigned long long now_ms = fleet_now_ms();
+	pthread_mutex_lock(&fleet_scheduler_mutex);
+	train->stats.wait_ms_total += now_ms - wait_start_ms;
+	if (granted) {
+		const unsigned long long waited_ms = now_ms - train->waiting_since_ms;
+		if (waited_ms > train->stats.wait_ms_max) {
+			train->stats.wait_ms_max = waited_ms;
+		}
+		train->waiting_since_ms = 0;
+	}
+	train->waiting_route = NULL;
+	pthread_mutex_unlock(&fleet_scheduler_mutex);
+	return granted;
+}
+
+// Drives the train route by route until it has reached the destination. 
+// The next route is planned from the current block of the train each time, preferring 
+// routes that are available at the moment.
+static bool drive_to_destination(unsigned int index, int grab_id, const char *destination) {
+	t_fleet_train *train = &fleet_trains[index];
+	const char *train_id = train->entry.train_id;
+	while (fleet_may_continue()) {
+		const char *block_id = train_get_block_id(train_id);
+		GArray *plan = NULL;
+		if (block_id != NULL) {
+			request_metrics_mutex_lock(&interlocker_mutex);
+			plan = route_planner_plan(block_id, destination, 
+			                          route_is_available_for_train, (void *) train_id, NULL);
+			if (plan == NULL) {
+				plan = route_planner_plan(block_id, destination, NULL, NULL, NULL);
+			}
+			pthread_mutex_unlock(&interlocker_mutex);
+		}
+		if (plan == NULL) {
+			pthread_mutex_lock(&fleet_scheduler_mutex);
+			train->stats.plan_failures++;
+			pthread_mutex_unlock(&fleet_scheduler_mutex);
+			syslog_server(LOG_WARNING, 
+			              "Fleet scheduler - train: %s from: %s to: %s - no plan exists",
+			              train_id, block_id == NULL ? "unknown block" : block_id, destination);
+			return false;
+		} else if (plan->len == 0) {
+			g_array_free(plan, true);
+			return true;
+		}
+		// Route IDs are owned by the interlocking table
+		const char *route_id = g_array_index(plan, char *, 0);
+		g_array_free(plan, true);
+		
+		if (!wait_for_route_grant(index, route_id)) {
+			continue;
+		}
+		const unsigned long long drive_start_ms = fleet_now_ms();
+		const bool driven = drive_route(grab_id, train_id, route_id, true);
+		pthread_mutex_lock(&fleet_scheduler_mutex);
+		train->stats.drive_ms_total += fleet_now_ms() - drive_start_ms;
+		if (driven) {
+			train->stats.routes_driven++;
+		}
+		pthread_mutex_unlock(&fleet_scheduler_mutex);
+		if (!driven) {
+			release_route(route_id);
+			return false;
+		}
+	}
+	return false;
+}
+
+static void *fleet_train_run(void *arg) {
+	const unsigned int index = (unsigned int) (uintptr_t) arg;
+	t_fleet_train *train = &fleet_trains[index];
+	const char *train_id = train->entry.train_id;
+	
+	const int grab_id = grab_train(train_id, FLEET_SCHEDULER_TRAIN_ENGINE);
+	if (grab_id < 0) {
+		syslog_server(LOG_ERR, "Fleet scheduler - train: %s - unable to grab train", train_id);
+	} else {
+		syslog_server(LOG_NOTICE, "Fleet scheduler - train: %s - starts", train_id);
+	}
+	
+	unsigned int stop_index = 0;
+	while (grab_id >= 0 && fleet_may_continue()) {
+		const t_fleet_timetable_stop *stop = &train->entry.stops[stop_index];
+		if (drive_to_destination(index, grab_id, stop->destination)) {
+			pthread_mutex_lock(&fleet_scheduler_mutex);
+			train->stats.stops_reached++;
+			pthread_mutex_unlock(&fleet_scheduler_mutex);
+			syslog_server(LOG_NOTICE, 
+			              "Fleet scheduler - train: %s - reached: %s, dwelling for %u s",
+			              train_id, stop->destination, stop->dwell_s);
+			for (unsigned int i = 0; i < stop->dwell_s * 10 && fleet_may_continue(); i++) {
+				usleep(100000);
+			}
+			stop_index = (stop_index + 1) % train->entry.stop_count;
+		} else if (fleet_may_continue()) {
+			// Try again later, e.g., once the train that blocks the way has moved on
+			usleep(FLEET_SCHEDULER_GRANT_RETRY_US * 4);
+		}
+	}
+	
+	if (grab_id >= 0 && train_get_grab_id(train_id) == grab_id) {
+		release_train(grab_id);
+	}
+	syslog_server(LOG_NOTICE, "Fleet scheduler - train: %s - stops", train_id);
+	pthread_mutex_lock(&fleet_scheduler_mutex);
+	train->stats.active = false;
+	pthread_mutex_unlock(&fleet_scheduler_mutex);
+	if (atomic_fetch_sub(&fleet_active_count, 1) == 1) {
+		atomic_store(&fleet_stop_ms, fleet_now_ms());
+	}
+	return NULL;
+}
+
+// Shall only be called with fleet_scheduler_lifecycle_mutex locked.
+static void fleet_scheduler_join_threads(void) {
+	for (unsigned int i = 0; i < fleet_train_count; i++) {
+		if (fleet_trains[i].thread_started) {
+			pthread_join(fleet_trains[i].thread, NULL);
+			fleet_trains[i].thread_started = false;
+		}
+	}
+}
+
+int fleet_scheduler_start(const char *timetable) {
+	t_fleet_timetable_entry entries[FLEET_SCHEDULER_TRAIN_COUNT_MAX];
+	const int entry_count = fleet_scheduler_parse_timetable(timetable, entries);
+	if (entry_count <= 0) {
+		return -1;
+	}
+	
+	pthread_mutex_lock(&fleet_scheduler_lifecycle_mutex);
+	if (atomic_load(&fleet_active_count) > 0) {
+		pthread_mutex_unlock(&fleet_scheduler_lifecycle_mutex);
+		return -2;
+	}
+	fleet_scheduler_join_threads();
+	
+	pthread_mutex_lock(&fleet_scheduler_mutex);
+	memset(fleet_trains, 0, sizeof(fleet_trains));
+	for (int i = 0; i < entry_count; i++) {
+		fleet_trains[i].entry = entries[i];
+		strcpy(fleet_trains[i].stats.train_id, entries[i].train_id);
+		fleet_trains[i].stats.priority = entries[i].priority;
+		fleet_trains[i].stats.active = true;
+	}
+	fleet_train_count = entry_count;
+	pthread_mutex_unlock(&fleet_scheduler_mutex);
+	
+	atomic_store(&fleet_stop_requested, false);
+	atomic_store(&fleet_active_count, entry_count);
+	atomic_store(&fleet_start_ms, fleet_now_ms());
+	atomic_store(&fleet_stop_ms, 0);
+	for (int i = 0; i < entry_count; i++) {
+		if (pthread_create(&fleet_trains[i].thread, NULL, 
+		                   fleet_train_run, (void *) (uintptr_t) i) == 0) {
+			fleet_trains[i].thread_started = true;
+		} else {
+			syslog_server(LOG_ERR, 
+			              "Fleet scheduler start - train: %s - unable to create thread",
+			              entries[i].train_id);
+			pthread_mutex_lock(&fleet_scheduler_mutex);
+			fleet_trains[i].stats.active = false;
+			pthread_mutex_unlock(&fleet_scheduler_mutex);
+			atomic_fetch_sub(&fleet_active_count, 1);
+		}
+	}
+	pthread_mutex_unlock(&fleet_scheduler_lifecycle_mutex);
+	syslog_server(LOG_NOTICE, "Fleet scheduler start - %d trains", entry_count);
+	return 0;
+}
+
+void fleet_scheduler_request_stop(void) {
+	atomic_store(&fleet_stop_requested, true);
+}
+
+void fleet_scheduler_join(void) {
+	pthread_mutex_lock(&fleet_scheduler_lifecycle_mutex);
+	fleet_scheduler_join_threads();
+	pthread_mutex_unlock(&fleet_scheduler_lifecycle_mutex);
+}
+
+bool fleet_scheduler_is_active(void) {
+	return atomic_load(&fleet_active_count) > 0;
+}
+
+unsigned int fleet_scheduler_get_stats(t_fleet_train_stats stats[FLEET_SCHEDULER_TRAIN_COUNT_MAX],
+                                       unsigned long long *elapsed_ms) {
+	pthread_mutex_lock(&fleet_scheduler_mutex);
+	const unsigned int train_count = fleet_train_count;
+	for (unsigned int i = 0; i < train_count; i++) {
+		stats[i] = fleet_trains[i].stats;
+	}
+	pthread_mutex_unlock(&fleet_scheduler_mutex);
+	
+	const unsigned long long start_ms = atomic_load(&fleet_start_ms);
+	const unsigned long long stop_ms = atomic_load(&fleet_stop_ms);
+	if (start_ms == 0) {
+		*elapsed_ms = 0;
+	} else {
+		*elapsed_ms = (stop_ms != 0 ? stop_ms : fleet_now_ms()) - start_ms;
+	}
+	return train_count;
+}
@@ -0,0 +1,126 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#ifndef FLEET_SCHEDULER_H
+#define FLEET_SCHEDULER_H
+
+#include <stdbool.h>
+
+#include "handler_driver.h"
+
+// Every scheduled train has to be grabbed
+#define FLEET_SCHEDULER_TRAIN_COUNT_MAX		TRAIN_ENGINE_INSTANCE_COUNT_MAX
+#define FLEET_SCHEDULER_STOP_COUNT_MAX		16
+#define FLEET_SCHEDULER_ID_LEN_MAX			64
+
+#define FLEET_SCHEDULER_TRAIN_ENGINE		"libtrain_engine_default (unremovable)"
+
+// Time between two attempts to get a route granted
+#define FLEET_SCHEDULER_GRANT_RETRY_US		250000
+// Time after which a waiting train plans again, e.g., to use an alternative route
+#define FLEET_SCHEDULER_REPLAN_TIMEOUT_MS	5000
+
+typedef struct {
+	char destination[FLEET_SCHEDULER_ID_LEN_MAX];
+	unsigned int dwell_s;
+} t_fleet_timetable_stop;
+
+typedef struct {
+	char train_id[FLEET_SCHEDULER_ID_LEN_MAX];
+	int priority;
+	unsigned int stop_count;
+	t_fleet_timetable_stop stops[FLEET_SCHEDULER_STOP_COUNT_MAX];
+} t_fleet_timetable_entry;
+
+typedef struct {
+	char train_id[FLEET_SCHEDULER_ID_LEN_MAX];
+	int priority;
+	bool active;
+	unsigned long long stops_reached;
+	unsigned long long routes_driven;
+	// Times the interlocker refused to grant a route
+	unsigned long long grant_refusals;
+	// Times the train did not request a route because another train took precedence
+	unsigned long long precedence_yields;
+	unsigned long long plan_failures;
+	unsigned long long wait_ms_total;
+	unsigned long long wait_ms_max;
+	unsigned long long drive_ms_total;
+} t_fleet_train_stats;
+
+/**
+ * Parses a timetable. Each line of the timetable lists one train: 
+ * `<train> <priority> <destination>[:<dwell-s>] ...`, where a destination is a signal 
+ * or block. Empty lines and lines starting with `#` are ignored.
+ * A higher priority wins when two trains wait for conflicting routes.
+ * 
+ * @param timetable text of the timetable
+ * @param entries (out) the parsed entries
+ * @return int number of entries, or -1 if the timetable is invalid
+ */
+int fleet_scheduler_parse_timetable(const char *timetable, 
+                                    t_fleet_timetable_entry entries[FLEET_SCHEDULER_TRAIN_COUNT_MAX]);
+
+/**
+ * Starts driving all trains of the timetable concurrently. Each train is grabbed and
+ * then drives to the destinations of its timetable entry in turn, dwelling at each 
+ * destination, and starts over after the last destination until the scheduler is stopped.
+ * 
+ * @param timetable text of the timetable, see fleet_scheduler_parse_timetable
+ * @return int 0 if started, -1 if the timetable is invalid, -2 if the scheduler is still active
+ */
+int fleet_scheduler_start(const char *timetable);
+
+/**
+ * Requests all scheduled trains to stop. Each train stops once it has reached the 
+ * end of the route it is driving, and is then released. Does not block.
+ */
+void fleet_scheduler_request_stop(void);
+
+/**
+ * Waits until all scheduled trains have stopped.
+ */
+void fleet_scheduler_join(void);
+
+/**
+ * @return true if at least one scheduled train has not stopped yet, otherwise false
+ */
+bool fleet_scheduler_is_active(void);
+
+/**
+ * Gets the statistics of the trains of the current (or last) timetable.
+ * 
+ * @param stats (out) the statistics per train
+ * @param elapsed_ms (out) time since the scheduler was started, or until it stopped
+ * @return unsigned int number of trains
+ */
+unsigned int fleet_scheduler_get_stats(t_fleet_train_stats stats[FLEET_SCHEDULER_TRAIN_COUNT_MAX],
+                                       unsigned long long *elapsed_ms);
+
+#endif  // FLEET_SCHEDULER_H
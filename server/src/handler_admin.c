@@ -29,6 +29,7 @@
 #include <bidib/bidib.h>
 #include <pthread.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "handler_admin.h"
@@ -41,11 +42,17 @@
 #include "bahn_data_util.h"
 #include "websocket_uploader/engine_uploader.h"
 #include "communication_utils.h"
+#include "fleet_scheduler.h"
+#include "state_stream.h"
+#include "bidib_messages.h"
+#include "upload_pipeline.h"
+#include "response_cache.h"
+#include "request_metrics.h"
+#include "railway_simulation.h"
+#include "checkpoint.h"
 
 // Mutex to lock when performing startup or shutdown
 static pthread_mutex_t start_stop_mutex = PTHREAD_MUTEX_INITIALIZER;
-// Thread that polls bidib messages periodically
-static pthread_t poll_bidib_messages_thread;
 typedef onion_connection_status o_con_status;
 
 typedef enum {
@@ -58,62 +65,27 @@ typedef enum {
 } e_startup_result_code;
 
 /**
- * @brief Constructs a hex-string from a bidib message into `dest`.
- * 
- * @param message bidib msg string, first byte shall indicate length
- * @param dest (in-out), filled with resulting hex string; caller responsible for ensuring 
- * that this string is long enough to hold the hex string
- */
-static void build_message_hex_string(unsigned char *message, char *dest) {
-	for (unsigned int i = 0; i <= message[0]; i++) {
-		if (i != 0) {
-			dest += sprintf(dest, " ");
-		}
-		dest += sprintf(dest, "0x%02x", message[i]);
-	}
-}
-
-/**
- * @brief While the system is running, polls bidib messages and logs them.
- * 
- * @param _ unused
- * @return void* 
- */
-static void *poll_bidib_messages(void *_) {
-	while (running) {
-		unsigned char *message;
-		while ((message = bidib_read_message()) != NULL) {
-			// message[0] holds length of msg; +1 for null-term(?), 
-			// and max. 5 chars per byte will be needed in hex representation
-			char hex_string[(message[0] + 1) * 5];
-			build_message_hex_string(message, hex_string);
-			syslog_server(LOG_NOTICE, "SWTbahn message queue: %s", hex_string);
-			free(message);
-		}
-		while ((message = bidib_read_error_message()) != NULL) {
-			char hex_string[(message[0] + 1) * 5];
-			build_message_hex_string(message, hex_string);
-			syslog_server(LOG_ERR, "SWTbahn error message queue: %s", hex_string);
-			free(message);
-		}
-		usleep(250000);	// 0.25 seconds
-	}
-	
-	pthread_exit(NULL);
-}
-
-/**
- * @brief Starts the server/system. I.e., establishes BiDiB connection, 
+ * @brief Starts the server/system. I.e., establishes BiDiB connection (or starts the 
+ * simulated railway if the serial device is RAILWAY_SIMULATION_DEVICE), 
  * clears temporary directories, loads the config, starts the dynamic containers
- * along with the default interlocker, and launches the thread that polls
- * bidib messages.
+ * along with the default interlocker, launches the upload workers, restores the last 
+ * checkpoint, and launches the thread that consumes bidib messages.
  * Shall only be called with start_stop_mutex acquired.
  * 
  * @return true if startup succeeded, otherwise returns false
  */
 static e_startup_result_code startup_server(void) {
-	const int err_serial = bidib_start_serial(serial_device, config_directory, 0);
+	int err_serial = 0;
+	if (strcmp(serial_device, RAILWAY_SIMULATION_DEVICE) == 0) {
+		// Load testing without a physical railway
+		err_serial = !railway_simulation_start(config_directory)
+		             || bidib_start_pointer(railway_simulation_read, railway_simulation_write, 
+		                                    config_directory, 0);
+	} else {
+		err_serial = bidib_start_serial(serial_device, config_directory, 0);
+	}
 	if (err_serial) {
+		railway_simulation_stop();
 		syslog_server(LOG_ERR, "Startup server - Could not start BiDiB serial connection");
 		return ERR_BIDIB_START_FAIL;
 	}
@@ -131,6 +103,8 @@ static e_startup_result_code startup_server(void) {
 		return ERR_CONFIG_LOAD_FAIL;
 	}
 
+	emergency_stop_table_initialise();
+	
 	const int err_dyn_containers = dyn_containers_start();
 	if (err_dyn_containers) {
 		syslog_server(LOG_ERR, "Startup server - Could not start shared library containers");
@@ -143,35 +117,53 @@ static e_startup_result_code startup_server(void) {
 		return ERR_LOAD_DEFAULT_INTERLOCKER_FAIL;
 	}
 	
+	upload_pipeline_start();
+	// Before requests are served, so that the restored grab-ids are not taken
+	checkpoint_start();
 	running = true;
-	pthread_create(&poll_bidib_messages_thread, NULL, poll_bidib_messages, NULL);
+	bidib_messages_start();
+	state_stream_start();
 	return STARTUP_SUCCESS;
 }
 
 /**
- * @brief Stops the server/system. I.e., releases all grabbed trains, releases all interlockers,
- * stops the dynamic containers, frees the loaded config memory, joins with the thread
- * polling bidib messages, and stops bidib.
+ * @brief Stops the server/system. I.e., stops the checkpoint and the fleet scheduler, 
+ * releases all grabbed trains and interlockers, stops the state stream, the upload pipeline 
+ * and the dynamic containers, frees the loaded config memory and cached responses, 
+ * and stops the BiDiB message consumer, bidib and the simulated railway.
  * 
  * Shall only be called with start_stop_mutex acquired.
  */
 void shutdown_server(void) {
+	// The state released below is restored by the next startup
+	checkpoint_stop();
 	session_id = 0;
 	syslog_server(LOG_NOTICE, "Shutdown server");
+	fleet_scheduler_request_stop();
 	release_all_grabbed_trains();
 	syslog_server(LOG_INFO, "Shutdown server - Released all grabbed trains");
 	release_all_interlockers();
 	syslog_server(LOG_INFO, "Shutdown server - Released all interlockers");
 	running = false;
+	// Scheduled trains stop driving once the server no longer runs
+	fleet_scheduler_join();
+	syslog_server(LOG_INFO, "Shutdown server - Stopped fleet scheduler");
+	state_stream_stop();
+	syslog_server(LOG_INFO, "Shutdown server - Stopped state stream");
+	upload_pipeline_stop();
+	syslog_server(LOG_INFO, "Shutdown server - Stopped upload pipeline");
 	dyn_containers_stop();
 	syslog_server(LOG_INFO, "Shutdown server - Stopped dyn containers");
 	bahn_data_util_free_config();
 	syslog_server(LOG_INFO, "Shutdown server - Released interlocking config and table data");
-	pthread_join(poll_bidib_messages_thread, NULL);
+	response_cache_invalidate(RESPONSE_CACHE_SCOPE_CONFIG);
+	response_cache_free();
+	bidib_messages_stop();
 	syslog_server(LOG_NOTICE, 
-	              "Shutdown server - BiDiB message poll thread joined, "
+	              "Shutdown server - BiDiB message consumer stopped, "
 	              "now stopping BiDiB and closing log");
 	bidib_stop();
+	railway_simulation_stop();
 }
 
 o_con_status handler_startup(void *_, onion_request *req, onion_response *res) {
@@ -189,7 +181,7 @@ o_con_status handler_startup(void *_, onion_request *req, onion_response *res) {
 		switch (startup_code) {
 			case STARTUP_SUCCESS:
 				reason_str = "";
-				onion_response_set_code(res, HTTP_OK);
+				set_response_code(res, HTTP_OK);
 				syslog_server(LOG_NOTICE, 
 				              "Request: Startup server - session-id: %ld - finish", 
 				              session_id);
@@ -232,7 +224,7 @@ o_con_status handler_startup(void *_, onion_request *req, onion_response *res) {
 			send_common_feedback(res, CUSTOM_HTTP_CODE_CONFLICT, "server already running");
 		} else {
 			syslog_server(LOG_WARNING, "Request: Startup server - wrong request type");
-			onion_response_set_code(res, HTTP_METHOD_NOT_ALLOWED);
+			set_response_code(res, HTTP_METHOD_NOT_ALLOWED);
 			ret = OCS_NOT_IMPLEMENTED;
 		}
 		pthread_mutex_unlock(&start_stop_mutex);
@@ -247,7 +239,7 @@ o_con_status handler_shutdown(void *_, onion_request *req, onion_response *res)
 		syslog_server(LOG_NOTICE, "Request: Shutdown server - start");
 		shutdown_server();
 		pthread_mutex_unlock(&start_stop_mutex);
-		onion_response_set_code(res, HTTP_OK);
+		set_response_code(res, HTTP_OK);
 		// Can't log "finished" here since bidib closes the syslog when stopping
 		return OCS_PROCESSED;
 	} else {
@@ -276,7 +268,7 @@ o_con_status handler_set_track_output(void *_, onion_request *req, onion_respons
 			syslog_server(LOG_NOTICE, "Request: Set track output - state: 0x%02x - start", state);
 			bidib_set_track_output_state_all(state);
 			bidib_flush();
-			onion_response_set_code(res, HTTP_OK);
+			set_response_code(res, HTTP_OK);
 			syslog_server(LOG_NOTICE, "Request: Set track output - state: 0x%02x - finish", state);
 		}
 		return OCS_PROCESSED;
@@ -299,7 +291,7 @@ o_con_status handler_set_verification_option(void *_, onion_request *req, onion_
 			              data_verification_option);
 		} else {
 			verification_enabled = strcasecmp("true", data_verification_option) == 0;
-			onion_response_set_code(res, HTTP_OK);
+			set_response_code(res, HTTP_OK);
 			syslog_server(LOG_NOTICE, 
 			              "Request: Set verification option - new state: %s - done", 
 			              verification_enabled ? "enabled" : "disabled");
@@ -319,7 +311,9 @@ o_con_status handler_set_verification_url(void *_, onion_request *req, onion_res
 			;
 		} else {
 			set_verifier_url(data_verification_url);
-			onion_response_set_code(res, HTTP_OK);
+			// Cached now rather than at exit, so that it survives a crash
+			cache_verifier_url();
+			set_response_code(res, HTTP_OK);
 			syslog_server(LOG_NOTICE, 
 			              "Request: Set verification URL - new URL: %s - done", 
 			              data_verification_url);
@@ -330,6 +324,48 @@ o_con_status handler_set_verification_url(void *_, onion_request *req, onion_res
 	}
 }
 
+static const char *log_level_names[] = {
+	"emerg", "alert", "crit", "err", "warning", "notice", "info", "debug"
+};
+
+// Returns the syslog priority named by log_level_name, or -1 if there is none
+static int log_level_from_name(const char *log_level_name) {
+	for (int i = LOG_EMERG; i <= LOG_DEBUG; i++) {
+		if (strcasecmp(log_level_names[i], log_level_name) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+o_con_status handler_set_log_level(void *_, onion_request *req, onion_response *res) {
+	build_response_header(res);
+	if ((onion_request_get_flags(req) & OR_METHODS) == OR_POST) {
+		const char *data_log_level = onion_request_get_post(req, "log-level");
+		const int log_level = data_log_level != NULL ? log_level_from_name(data_log_level) : -1;
+		if (handle_param_miss_check(res, "Set log level", "log-level", data_log_level)) {
+			;
+		} else if (log_level < 0) {
+			send_common_feedback(res, HTTP_BAD_REQUEST, "invalid log-level");
+			syslog_server(LOG_ERR, "Request: Set log level - invalid log-level (%s)", 
+			              data_log_level);
+		} else {
+			syslog_server_level = log_level;
+			set_response_code(res, HTTP_OK);
+			syslog_server(LOG_NOTICE, "Request: Set log level - new level: %s - done", 
+			              log_level_names[log_level]);
+			if (log_level > SYSLOG_SERVER_LEVEL_MAX) {
+				syslog_server(LOG_WARNING, 
+				              "Request: Set log level - levels above %s are compiled out", 
+				              log_level_names[SYSLOG_SERVER_LEVEL_MAX]);
+			}
+		}
+		return OCS_PROCESSED;
+	} else {
+		return handle_req_run_or_method_fail(res, running, "Set log level");
+	}
+}
+
 o_con_status handler_admin_release_train(void *_, onion_request *req, onion_response *res) {
 	build_response_header(res);
 	if (running && ((onion_request_get_flags(req) & OR_METHODS) == OR_POST)) {
@@ -348,7 +384,7 @@ o_con_status handler_admin_release_train(void *_, onion_request *req, onion_resp
 		syslog_server(LOG_NOTICE, "Request: Admin release train - train: %s - start", data_train);
 		
 		// Ensure that the train has stopped moving
-		pthread_mutex_lock(&grabbed_trains_mutex);
+		request_metrics_mutex_lock(&grabbed_trains_mutex);
 		const int engine_instance = grabbed_trains[grab_id].dyn_containers_engine_instance;
 		dyn_containers_set_train_engine_instance_inputs(engine_instance, 0, true);
 		pthread_mutex_unlock(&grabbed_trains_mutex);
@@ -367,7 +403,7 @@ o_con_status handler_admin_release_train(void *_, onion_request *req, onion_resp
 		//  easily avoid such a race condition being possible - have to release the mutex whilst
 		//  waiting for the train to stop; thus someone else could do smth with it in the meantime)
 		release_train(grab_id);
-		onion_response_set_code(res, HTTP_OK);
+		set_response_code(res, HTTP_OK);
 		syslog_server(LOG_NOTICE, 
 		              "Request: Admin release train - train: %s - finish",
 		              data_train);
@@ -415,7 +451,7 @@ o_con_status handler_admin_set_dcc_train_speed(void *_, onion_request *req, onio
 			              data_train, speed);
 		} else {
 			bidib_flush();
-			onion_response_set_code(res, HTTP_OK);
+			set_response_code(res, HTTP_OK);
 			syslog_server(LOG_NOTICE, 
 			              "Request: Admin set dcc train speed - train: %s speed: %d - finish", 
 			              data_train, speed);
@@ -425,3 +461,43 @@ o_con_status handler_admin_set_dcc_train_speed(void *_, onion_request *req, onio
 		return handle_req_run_or_method_fail(res, running, "Admin set dcc train speed");
 	}
 }
+
+o_con_status handler_start_scheduler(void *_, onion_request *req, onion_response *res) {
+	build_response_header(res);
+	if (running && ((onion_request_get_flags(req) & OR_METHODS) == OR_POST)) {
+		const char *data_timetable = onion_request_get_post(req, "timetable");
+		if (handle_param_miss_check(res, "Start scheduler", "timetable", data_timetable)) {
+			return OCS_PROCESSED;
+		}
+		
+		syslog_server(LOG_NOTICE, "Request: Start scheduler - start");
+		const int result = fleet_scheduler_start(data_timetable);
+		if (result == 0) {
+			set_response_code(res, HTTP_OK);
+			syslog_server(LOG_NOTICE, "Request: Start scheduler - finish");
+		} else if (result == -1) {
+			send_common_feedback(res, HTTP_BAD_REQUEST, "invalid timetable");
+			syslog_server(LOG_ERR, "Request: Start scheduler - invalid timetable - abort");
+		} else {
+			send_common_feedback(res, CUSTOM_HTTP_CODE_CONFLICT, 
+			                     "scheduler is still active, stop it first");
+			syslog_server(LOG_ERR, "Request: Start scheduler - scheduler still active - abort");
+		}
+		return OCS_PROCESSED;
+	} else {
+		return handle_req_run_or_method_fail(res, running, "Start scheduler");
+	}
+}
+
+o_con_status handler_stop_scheduler(void *_, onion_request *req, onion_response *res) {
+	build_response_header(res);
+	if (running && ((onion_request_get_flags(req) & OR_METHODS) == OR_POST)) {
+		// Trains stop once they have reached the end of their current route
+		fleet_scheduler_request_stop();
+		set_response_code(res, HTTP_OK);
+		syslog_server(LOG_NOTICE, "Request: Stop scheduler - stop requested");
+		return OCS_PROCESSED;
+	} else {
+		return handle_req_run_or_method_fail(res, running, "Stop scheduler");
+	}
+}
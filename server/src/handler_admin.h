@@ -44,9 +44,15 @@ o_con_status handler_set_verification_option(void *_, onion_request *req, onion_
 
 o_con_status handler_set_verification_url(void *_, onion_request *req, onion_response *res);
 
+o_con_status handler_set_log_level(void *_, onion_request *req, onion_response *res);
+
 o_con_status handler_admin_release_train(void *_, onion_request *req, onion_response *res);
 
 o_con_status handler_admin_set_dcc_train_speed(void *_, onion_request *req, onion_response *res);
 
+o_con_status handler_start_scheduler(void *_, onion_request *req, onion_response *res);
+
+o_con_status handler_stop_scheduler(void *_, onion_request *req, onion_response *res);
+
 
 #endif  // HANDLER_ADMIN_H
\ No newline at end of file
@@ -30,6 +30,7 @@
 #include <bidib/bidib.h>
 #include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -42,6 +43,8 @@
 #include "check_route_sectional/check_route_sectional_direct.h"
 #include "json_response_builder.h"
 #include "communication_utils.h"
+#include "request_metrics.h"
+#include "checkpoint.h"
 
 pthread_mutex_t interlocker_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -91,6 +94,7 @@ static int set_interlocker(const char *interlocker_name) {
 				selected_interlocker_name = g_string_new(interlocker_name);
 				selected_interlocker_instance = i;
 				interlocker_instances[selected_interlocker_instance].is_valid = true;
+				checkpoint_set_interlocker(interlocker_name);
 				return selected_interlocker_instance;
 			}
 		}
@@ -122,6 +126,7 @@ static int unset_interlocker(const char *interlocker_name) {
 		g_string_free(selected_interlocker_name, true);
 		selected_interlocker_name = NULL;
 		selected_interlocker_instance = -1;
+		checkpoint_set_interlocker(NULL);
 	}
 	return selected_interlocker_instance;
 }
@@ -130,15 +135,39 @@ bool load_default_interlocker_instance() {
 	while (!dyn_containers_is_running()) {
 		usleep(let_period_us);
 	}
-	pthread_mutex_lock(&interlocker_mutex);
+	request_metrics_mutex_lock(&interlocker_mutex);
 	const int result = set_interlocker("libinterlocker_default (unremovable)");
 	pthread_mutex_unlock(&interlocker_mutex);
 	// return true if loading failed, otherwise false
 	return (result == -1);
 }
 
+char *get_selected_interlocker_name(void) {
+	request_metrics_mutex_lock(&interlocker_mutex);
+	char *name = selected_interlocker_name != NULL ? strdup(selected_interlocker_name->str) : NULL;
+	pthread_mutex_unlock(&interlocker_mutex);
+	return name;
+}
+
+bool restore_selected_interlocker(const char *interlocker_name) {
+	request_metrics_mutex_lock(&interlocker_mutex);
+	if (selected_interlocker_name != NULL 
+	    && (interlocker_name == NULL 
+	        || strcmp(selected_interlocker_name->str, interlocker_name) != 0)) {
+		char *previous_name = strdup(selected_interlocker_name->str);
+		unset_interlocker(previous_name);
+		free(previous_name);
+	}
+	bool success = selected_interlocker_instance == -1;
+	if (interlocker_name != NULL && selected_interlocker_instance == -1) {
+		success = set_interlocker(interlocker_name) != -1;
+	}
+	pthread_mutex_unlock(&interlocker_mutex);
+	return success;
+}
+
 void release_all_interlockers(void) {
-	pthread_mutex_lock(&interlocker_mutex);
+	request_metrics_mutex_lock(&interlocker_mutex);
 	if (selected_interlocker_name != NULL) {
 		g_string_free(selected_interlocker_name, true);
 		selected_interlocker_name = NULL;
@@ -194,6 +223,17 @@ bool get_route_has_granted_conflicts(const char *route_id) {
 	return false;
 }
 
+bool route_is_available_for_train(const t_interlocking_route *route, void *context) {
+	const char *train_id = (const char *) context;
+	if (route == NULL || train_id == NULL) {
+		return false;
+	}
+	if (route->train != NULL && strcmp(route->train, train_id) != 0) {
+		return false;
+	}
+	return !get_route_has_granted_conflicts(route->id);
+}
+
 GArray *get_granted_route_conflicts(const char *route_id, bool include_conflict_train_info) {
 	if (route_id == NULL) {
 		return NULL;
@@ -286,7 +326,7 @@ GString *grant_route(const char *train_id, const char *source_id, const char *de
 		return g_string_new("not_grantable");
 	}
 	
-	pthread_mutex_lock(&interlocker_mutex);
+	request_metrics_mutex_lock(&interlocker_mutex);
 	if (selected_interlocker_instance == -1) {
 		pthread_mutex_unlock(&interlocker_mutex);
 		syslog_server(LOG_ERR, 
@@ -325,6 +365,7 @@ GString *grant_route(const char *train_id, const char *source_id, const char *de
 	pthread_mutex_unlock(&interlocker_mutex);
 	
 	if (g_route_id_copy->str != NULL && params_check_is_number(g_route_id_copy->str)) {
+		checkpoint_set_grant(g_route_id_copy->str, train_id);
 		syslog_server(LOG_NOTICE, 
 		              "Grant route - train: %s from: %s to: %s - route %s has been granted", 
 		              train_id, source_id, destination_id, g_route_id_copy->str);
@@ -353,7 +394,7 @@ const char *grant_route_id(const char *train_id, const char *route_id) {
 		syslog_server(LOG_ERR, "Grant route id - invalid (NULL) parameters");
 		return "not_grantable";
 	}
-	pthread_mutex_lock(&interlocker_mutex);
+	request_metrics_mutex_lock(&interlocker_mutex);
 	// Check whether the route can be granted
 	t_interlocking_route *route = get_route(route_id);
 	if (route == NULL) {
@@ -420,6 +461,7 @@ const char *grant_route_id(const char *train_id, const char *route_id) {
 	///       Benefit: Detect hardware failures, thus preventing a potential short circuit later.
 	///       Drawback: Latency increases.
 	
+	checkpoint_set_grant(route_id, train_id);
 	pthread_mutex_unlock(&interlocker_mutex);
 	
 	syslog_server(LOG_NOTICE, 
@@ -428,6 +470,47 @@ const char *grant_route_id(const char *train_id, const char *route_id) {
 	return "granted";
 }
 
+bool restore_granted_route(const char *route_id, const char *train_id) {
+	if (route_id == NULL || train_id == NULL) {
+		syslog_server(LOG_ERR, "Restore granted route - invalid (NULL) parameters");
+		return false;
+	}
+	request_metrics_mutex_lock(&interlocker_mutex);
+	t_interlocking_route *route = get_route(route_id);
+	if (route == NULL || route->train != NULL || get_route_has_granted_conflicts(route_id)) {
+		pthread_mutex_unlock(&interlocker_mutex);
+		syslog_server(LOG_ERR, 
+		              "Restore granted route - route: %s train: %s - unknown, "
+		              "already granted, or conflicting routes are granted", 
+		              route_id, train_id);
+		return false;
+	}
+	route->train = strdup(train_id);
+	if (route->train == NULL) {
+		pthread_mutex_unlock(&interlocker_mutex);
+		syslog_server(LOG_ERR, 
+		              "Restore granted route - route: %s train: %s - "
+		              "unable to allocate memory for route->train",
+		              route_id, train_id);
+		return false;
+	}
+	
+	// The points are set again in case they were moved while the server was down, 
+	// but the signals stay at stop because the train may already be on the route
+	for (unsigned int i = 0; i < route->points->len; i++) {
+		const t_interlocking_point point = g_array_index(route->points, t_interlocking_point, i);
+		bidib_switch_point(point.id, (point.position == NORMAL) ? "normal" : "reverse");
+		bidib_flush();
+	}
+	checkpoint_set_grant(route_id, train_id);
+	pthread_mutex_unlock(&interlocker_mutex);
+	
+	syslog_server(LOG_NOTICE, 
+	              "Restore granted route - route: %s train: %s - route granted", 
+	              route_id, train_id);
+	return true;
+}
+
 ///TODO: This should not unconditionally set all route signals to stop, because that would
 //       prevent sectional route release from working correctly
 bool release_route(const char *route_id) {
@@ -435,7 +518,7 @@ bool release_route(const char *route_id) {
 		syslog_server(LOG_ERR, "Release route - invalid (NULL) route_id");
 		return false;
 	}
-	pthread_mutex_lock(&interlocker_mutex);
+	request_metrics_mutex_lock(&interlocker_mutex);
 	t_interlocking_route *route = get_route(route_id);
 	bool ret = false;
 	if (route != NULL && route->train != NULL) {
@@ -459,6 +542,7 @@ bool release_route(const char *route_id) {
 		
 		free(route->train);
 		route->train = NULL;
+		checkpoint_clear_grant(route_id);
 		syslog_server(LOG_NOTICE, "Release route - route: %s - released", route_id);
 		ret = true;
 	} else if (route == NULL) {
@@ -641,10 +725,140 @@ o_con_status handler_set_peripheral(void *_, onion_request *req, onion_response
 	}
 }
 
+typedef enum {
+	ACCESSORY_POINT,
+	ACCESSORY_SIGNAL,
+	ACCESSORY_PERIPHERAL
+} e_accessory_kind;
+
+typedef struct {
+	e_accessory_kind kind;
+	const char *id;
+	const char *state;
+} t_accessory_command;
+
+static const char *accessory_kind_names[] = { "point", "signal", "peripheral" };
+
+// Parses one command per line, each of the form "<point|signal|peripheral> <id> <state>". 
+// Empty lines and lines starting with # are skipped. The ids and states point into text.
+// Returns the number of commands, or -1 if the text is invalid.
+static int parse_accessory_commands(char *text, 
+                                    t_accessory_command commands[ACCESSORY_BATCH_COUNT_MAX]) {
+	int command_count = 0;
+	char *line_save = NULL;
+	for (char *line = strtok_r(text, "\n", &line_save); line != NULL; 
+	     line = strtok_r(NULL, "\n", &line_save)) {
+		char *token_save = NULL;
+		const char *kind = strtok_r(line, " \t\r", &token_save);
+		if (kind == NULL || kind[0] == '#') {
+			continue;
+		}
+		const char *id = strtok_r(NULL, " \t\r", &token_save);
+		const char *state = strtok_r(NULL, " \t\r", &token_save);
+		if (id == NULL || state == NULL || strtok_r(NULL, " \t\r", &token_save) != NULL 
+		    || command_count >= ACCESSORY_BATCH_COUNT_MAX) {
+			return -1;
+		}
+		t_accessory_command *command = &commands[command_count];
+		if (strcmp(kind, "point") == 0) {
+			command->kind = ACCESSORY_POINT;
+		} else if (strcmp(kind, "signal") == 0) {
+			command->kind = ACCESSORY_SIGNAL;
+		} else if (strcmp(kind, "peripheral") == 0) {
+			command->kind = ACCESSORY_PERIPHERAL;
+		} else {
+			return -1;
+		}
+		command->id = id;
+		command->state = state;
+		command_count++;
+	}
+	return command_count;
+}
+
+// Queues the command in libbidib without flushing, returns an error message or NULL if queued
+static const char *queue_accessory_command(const t_accessory_command *command) {
+	switch (command->kind) {
+		case ACCESSORY_POINT:
+			if (!is_type_point(command->id)) {
+				return "unknown point";
+			}
+			return bidib_switch_point(command->id, command->state) ? "invalid state" : NULL;
+		case ACCESSORY_SIGNAL:
+			if (!is_type_signal(command->id)) {
+				return "unknown signal";
+			}
+			return bidib_set_signal(command->id, command->state) ? "invalid state" : NULL;
+		case ACCESSORY_PERIPHERAL:
+			return bidib_set_peripheral(command->id, command->state) 
+			       ? "unknown peripheral or invalid state" : NULL;
+		default:
+			return "unknown accessory kind";
+	}
+}
+
+o_con_status handler_set_accessories(void *_, onion_request *req, onion_response *res) {
+	build_response_header(res);
+	if (running && ((onion_request_get_flags(req) & OR_METHODS) == OR_POST)) {
+		const char *data_accessories = onion_request_get_post(req, "accessories");
+		if (handle_param_miss_check(res, "Set accessories", "accessories", data_accessories)) {
+			return OCS_PROCESSED;
+		}
+		
+		char *text = strdup(data_accessories);
+		t_accessory_command commands[ACCESSORY_BATCH_COUNT_MAX];
+		const int command_count = text != NULL ? parse_accessory_commands(text, commands) : -1;
+		if (command_count < 0) {
+			free(text);
+			send_common_feedback(res, HTTP_BAD_REQUEST, "invalid accessories");
+			syslog_server(LOG_ERR, "Request: Set accessories - invalid accessories");
+			return OCS_PROCESSED;
+		}
+		
+		syslog_server(LOG_NOTICE, "Request: Set accessories - %d commands - start", command_count);
+		GString *g_results = g_string_sized_new(64 + 96 * command_count);
+		append_start_of_obj(g_results, false);
+		append_field_start_of_list(g_results, "results");
+		int queued_count = 0;
+		for (int i = 0; i < command_count; i++) {
+			const char *error = queue_accessory_command(&commands[i]);
+			append_start_of_obj(g_results, true);
+			append_field_str_value(g_results, "kind", accessory_kind_names[commands[i].kind], true);
+			append_field_str_value(g_results, "id", commands[i].id, true);
+			append_field_str_value(g_results, "state", commands[i].state, true);
+			if (error == NULL) {
+				append_field_bool_value(g_results, "ok", true, false);
+				queued_count++;
+			} else {
+				append_field_bool_value(g_results, "ok", false, true);
+				append_field_str_value(g_results, "msg", error, false);
+				syslog_server(LOG_ERR, "Request: Set accessories - %s: %s state: %s - %s", 
+				              accessory_kind_names[commands[i].kind], commands[i].id, 
+				              commands[i].state, error);
+			}
+			append_end_of_obj(g_results, i + 1 < command_count);
+		}
+		append_end_of_list(g_results, false, command_count > 0);
+		append_end_of_obj(g_results, false);
+		free(text);
+		
+		// All queued commands are sent at once
+		if (queued_count > 0) {
+			bidib_flush();
+		}
+		send_some_gstring_and_free(res, HTTP_OK, g_results);
+		syslog_server(LOG_NOTICE, "Request: Set accessories - %d of %d commands set - finish", 
+		              queued_count, command_count);
+		return OCS_PROCESSED;
+	} else {
+		return handle_req_run_or_method_fail(res, running, "Set accessories");
+	}
+}
+
 o_con_status handler_get_interlocker(void *_, onion_request *req, onion_response *res) {
 	build_response_header(res);
 	if (running && ((onion_request_get_flags(req) & OR_METHODS) == OR_GET)) {
-		pthread_mutex_lock(&interlocker_mutex);
+		request_metrics_mutex_lock(&interlocker_mutex);
 		if (selected_interlocker_instance != -1 && selected_interlocker_name != NULL) {
 			GString *g_resstr = g_string_new("{\"interlocker\": \"");
 			g_string_append_printf(g_resstr, "%s\"}", 
@@ -675,7 +889,7 @@ o_con_status handler_set_interlocker(void *_, onion_request *req, onion_response
 		syslog_server(LOG_NOTICE, 
 		              "Request: Set interlocker - interlocker: %s - start",
 		              data_interlocker);
-		pthread_mutex_lock(&interlocker_mutex);
+		request_metrics_mutex_lock(&interlocker_mutex);
 		if (selected_interlocker_instance != -1) {
 			pthread_mutex_unlock(&interlocker_mutex);
 			send_common_feedback(res, CUSTOM_HTTP_CODE_CONFLICT, 
@@ -717,7 +931,7 @@ o_con_status handler_unset_interlocker(void *_, onion_request *req, onion_respon
 		syslog_server(LOG_NOTICE, 
 		              "Request: Unset interlocker - interlocker: %s - start",
 		              data_interlocker);
-		pthread_mutex_lock(&interlocker_mutex);
+		request_metrics_mutex_lock(&interlocker_mutex);
 		if (selected_interlocker_instance == -1) {
 			pthread_mutex_unlock(&interlocker_mutex);
 			send_common_feedback(res, CUSTOM_HTTP_CODE_CONFLICT, 
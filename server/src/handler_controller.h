@@ -32,10 +32,14 @@
 #include <onion/onion.h>
 #include <glib.h>
 
+#include "interlocking.h"
+
 typedef onion_connection_status o_con_status;
 
 #define INTERLOCKER_COUNT_MAX           4
 #define INTERLOCKER_INSTANCE_COUNT_MAX  4
+// Maximum number of commands in one controller/set-accessories request
+#define ACCESSORY_BATCH_COUNT_MAX       256
 
 extern pthread_mutex_t interlocker_mutex;
 
@@ -48,6 +52,23 @@ typedef struct {
 
 void release_all_interlockers(void);
 
+/**
+ * @brief Gets the name of the selected interlocker.
+ * Caller must free the returned string.
+ * 
+ * @return char* name of the selected interlocker, or NULL if none is selected
+ */
+char *get_selected_interlocker_name(void);
+
+/**
+ * @brief Selects an interlocker, e.g., when restoring a checkpoint. Unsets the selected 
+ * interlocker first if it is another one.
+ * 
+ * @param interlocker_name name of the interlocker to select, or NULL to select none
+ * @return true if the interlocker is selected, otherwise false
+ */
+bool restore_selected_interlocker(const char *interlocker_name);
+
 /**
  * Loads the default interlocker
  * @return false if successful, otherwise true
@@ -65,6 +86,18 @@ bool load_default_interlocker_instance();
  */
 bool get_route_has_granted_conflicts(const char *route_id);
 
+/**
+ * Checks whether a route could currently be granted to a train, i.e., the route is not 
+ * granted to another train and has no conflicts with granted routes. 
+ * Can be used as a route filter of the route planner, with the train id as the context.
+ * Shall only be called with interlocker_mutex locked.
+ * 
+ * @param route route to check
+ * @param context id of the train (const char *)
+ * @return true if the route is available for the train, otherwise false
+ */
+bool route_is_available_for_train(const t_interlocking_route *route, void *context);
+
 /**
  * Finds conflicting routes that have been granted.
  * Shall only be called with interlocker_mutex locked.
@@ -133,6 +166,18 @@ const char *grant_route_id(const char *train_id,
   */ 
 bool release_route(const char *route_id);
 
+/**
+ * @brief Grants a route to a train again, e.g., when restoring a checkpoint. Unlike 
+ * grant_route_id, the route does not need to be clear, and only its points are set; 
+ * its signals stay at stop.
+ * 
+ * @param route_id id of the route
+ * @param train_id id of the train
+ * @return true if the route is granted to the train, false if the route is unknown or 
+ * already granted, or conflicting routes are granted
+ */
+bool restore_granted_route(const char *route_id, const char *train_id);
+
 /**
  * Requests the reverser state to be updated and waits
  * for the update to complete. The waiting is bounded by 
@@ -150,6 +195,8 @@ o_con_status handler_set_signal(void *_, onion_request *req, onion_response *res
 
 o_con_status handler_set_peripheral(void *_, onion_request *req, onion_response *res);
 
+o_con_status handler_set_accessories(void *_, onion_request *req, onion_response *res);
+
 o_con_status handler_get_interlocker(void *_, onion_request *req, onion_response *res);
 
 o_con_status handler_set_interlocker(void *_, onion_request *req, onion_response *res);
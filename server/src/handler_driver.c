@@ -28,6 +28,7 @@
 
 #include <bidib/bidib.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -44,11 +45,14 @@
 #include "bahn_data_util.h"
 #include "json_response_builder.h"
 #include "communication_utils.h"
+#include "route_speed_profile.h"
+#include "route_planner.h"
+#include "request_metrics.h"
+#include "checkpoint.h"
+#include "command_journal.h"
 
 pthread_mutex_t grabbed_trains_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-static unsigned int DRIVING_SPEED_SLOW = 40;
-static unsigned int DRIVING_SPEED_STOPPING = 25;
 static unsigned int next_grab_id = 0;
 
 
@@ -86,6 +90,41 @@ typedef struct {
 	e_route_pos_error_code err_code;
 } t_train_index_on_route_query;
 
+// State of a train following the speed profile of a route in automatic driving mode
+typedef struct {
+	const t_route_speed_profile *profile;
+	int grab_id;
+	int engine_instance;
+	bool requested_forwards;
+	int speed_commanded;
+} t_route_speed_follower;
+
+// Train ids of the platform, resolved once at startup so that an emergency stop 
+// never has to wait for the grabbed_trains_mutex or query the config.
+typedef struct {
+	char id[EMERGENCY_STOP_ID_LEN_MAX];
+} t_emergency_stop_train;
+
+// Track output of a grabbed train, written while holding the grabbed_trains_mutex and 
+// read without locking. The sequence counter is odd while the value is being written.
+typedef struct {
+	atomic_uint seq;
+	char value[32];
+} t_emergency_stop_track_output;
+
+static t_emergency_stop_train emergency_stop_trains[EMERGENCY_STOP_TRAIN_COUNT_MAX];
+static atomic_int emergency_stop_train_count = 0;
+
+// Index into emergency_stop_trains of the train grabbed with a grab-id, or -1
+static atomic_int emergency_stop_grabbed[TRAIN_ENGINE_INSTANCE_COUNT_MAX];
+static atomic_int emergency_stop_engine_instances[TRAIN_ENGINE_INSTANCE_COUNT_MAX];
+static t_emergency_stop_track_output emergency_stop_track_outputs[TRAIN_ENGINE_INSTANCE_COUNT_MAX];
+
+static atomic_ullong emergency_stop_count = 0;
+static atomic_ullong emergency_stop_latency_last_ns = 0;
+static atomic_ullong emergency_stop_latency_max_ns = 0;
+static atomic_ullong emergency_stop_latency_total_ns = 0;
+
 static void increment_next_grab_id(void) {
 	if (next_grab_id == TRAIN_ENGINE_INSTANCE_COUNT_MAX - 1) {
 		next_grab_id = 0;
@@ -100,7 +139,7 @@ int train_get_grab_id(const char *train) {
 		return -1;
 	}
 	int grab_id = -1;
-	pthread_mutex_lock(&grabbed_trains_mutex);
+	request_metrics_mutex_lock(&grabbed_trains_mutex);
 	for (int i = 0; i < TRAIN_ENGINE_INSTANCE_COUNT_MAX; i++) {
 		if (grabbed_trains[i].is_valid && strcmp(grabbed_trains[i].name->str, train) == 0) {
 			grab_id = i;
@@ -117,7 +156,7 @@ bool train_grabbed(const char *train) {
 		return false;
 	}
 	bool grabbed = false;
-	pthread_mutex_lock(&grabbed_trains_mutex);
+	request_metrics_mutex_lock(&grabbed_trains_mutex);
 	for (int i = 0; i < TRAIN_ENGINE_INSTANCE_COUNT_MAX; i++) {
 		if (grabbed_trains[i].is_valid 
 				&& grabbed_trains[i].name != NULL 
@@ -130,6 +169,19 @@ bool train_grabbed(const char *train) {
 	return grabbed;
 }
 
+char *train_get_block_id(const char *train_id) {
+	t_bidib_train_position_query train_position_query = bidib_get_train_position(train_id);
+	char *block_id = NULL;
+	for (size_t i = 0; i < train_position_query.length; i++) {
+		block_id = config_get_block_id_of_segment(train_position_query.segments[i]);
+		if (block_id != NULL && strlen(block_id) > 0) {
+			break;
+		}
+	}
+	bidib_free_train_position_query(train_position_query);
+	return (block_id == NULL || strlen(block_id) == 0) ? NULL : block_id;
+}
+
 static bool train_position_is_at(const char *train_id, const char *segment) {
 	if (train_id == NULL || segment == NULL) {
 		syslog_server(LOG_ERR, "Train position is at - invalid (NULL) parameters");
@@ -526,16 +578,50 @@ static bool validate_route_signal_info_array(const char *route_id,
 	return true;
 }
 
+/**
+ * @brief For a train driving a route automatically, command its train engine instance 
+ * with the speed that the route's speed profile plans at the train's position. 
+ * Nothing is commanded if the planned speed was already commanded last, if the position 
+ * is beyond the profile, or if the train is no longer grabbed with the follower's grab-id. 
+ * Acquires the grabbed_trains_mutex while commanding.
+ * 
+ * @param follower speed profile, grab-id and train engine instance of the train, 
+ * and the speed commanded last, which is updated
+ * @param train_id The train driving the route
+ * @param pos_index index in the route path of the segment where the train is
+ */
+static void follow_route_speed_profile(t_route_speed_follower *follower, const char *train_id, 
+                                       unsigned int pos_index) {
+	if (pos_index >= follower->profile->len) {
+		return;
+	}
+	const int speed = follower->profile->speeds[pos_index];
+	if (speed == follower->speed_commanded || train_get_grab_id(train_id) != follower->grab_id) {
+		return;
+	}
+	request_metrics_mutex_lock(&grabbed_trains_mutex);
+	dyn_containers_set_train_engine_instance_inputs(follower->engine_instance, speed,
+	                                                follower->requested_forwards);
+	pthread_mutex_unlock(&grabbed_trains_mutex);
+	syslog_server(LOG_INFO, 
+	              "Follow route speed profile - train: %s - speed %d at route path index %u", 
+	              train_id, speed, pos_index);
+	follower->speed_commanded = speed;
+}
+
 /**
  * @brief For a train driving a route, set the signals to stop that the train passes.
+ * If the route is driven automatically, the train also follows the route's speed profile.
  * 
  * @param train_id The train driving the route
  * @param route The route to be driven
+ * @param speed_follower speed profile for automatic driving, or NULL for manual driving
  * @return true if signal updating successful (all passed signals were set to stop, 
  * and all signals have been passed or the route has been released or the system is stopping), 
  * otherwise returns false. 
  */
-static bool monitor_train_on_route(const char *train_id, t_interlocking_route *route) {
+static bool monitor_train_on_route(const char *train_id, t_interlocking_route *route, 
+                                   t_route_speed_follower *speed_follower) {
 	if (route == NULL || route->id == NULL) {
 		syslog_server(LOG_ERR, "Monitor train on route - invalid (NULL) route or route->id");
 		return false;
@@ -586,6 +672,9 @@ static bool monitor_train_on_route(const char *train_id, t_interlocking_route *r
 			              "Monitor train on route - route: %s train: %s - train is at index %u (%s)",
 			              route->id, train_id, train_pos_query.pos_index, 
 			              path_item != NULL ? path_item : "PATH-ITEM-IS-NULL");
+			if (speed_follower != NULL) {
+				follow_route_speed_profile(speed_follower, train_id, train_pos_query.pos_index);
+			}
 			signals_set_to_stop += 
 					update_route_signals_for_train_pos(&signal_info_array, route, 
 			                                           train_pos_query.pos_index);
@@ -603,7 +692,7 @@ static bool monitor_train_on_route(const char *train_id, t_interlocking_route *r
 	return true;
 }
 
-static bool drive_route(const int grab_id, const char* train_id, const char *route_id, bool is_automatic) {
+bool drive_route(const int grab_id, const char* train_id, const char *route_id, bool is_automatic) {
 	if (train_id == NULL || route_id == NULL) {
 		syslog_server(LOG_ERR, "Drive route - invalid (NULL) parameters");
 		return false;
@@ -618,52 +707,63 @@ static bool drive_route(const int grab_id, const char* train_id, const char *rou
 		return false;
 	}
 	
+	// In automatic mode, the train follows a speed profile that brakes for the destination
+	t_route_speed_profile speed_profile = { .len = 0, .speeds = NULL, .speed_max = 0 };
+	if (is_automatic) {
+		speed_profile = route_speed_profile_plan(route, train_id);
+		if (speed_profile.speeds == NULL) {
+			syslog_server(LOG_ERR, 
+			              "Drive route - route: %s train: %s - "
+			              "unable to start driving because no speed profile could be planned",
+			              route_id, train_id);
+			return false;
+		}
+	}
+	
 	// Driving starts: Driving direction is computed from the route orientation
 	syslog_server(LOG_NOTICE, 
 	              "Drive route - route: %s train: %s - %s driving starts", 
 	              route_id, train_id, is_automatic ? "automatic" : "manual");
 	
-	pthread_mutex_lock(&grabbed_trains_mutex);
+	request_metrics_mutex_lock(&grabbed_trains_mutex);
 	const int engine_instance = grabbed_trains[grab_id].dyn_containers_engine_instance;
 	const bool requested_forwards = is_forward_driving(route, train_id);
+	pthread_mutex_unlock(&grabbed_trains_mutex);
+	
+	t_route_speed_follower speed_follower = {
+		.profile = &speed_profile,
+		.grab_id = grab_id,
+		.engine_instance = engine_instance,
+		.requested_forwards = requested_forwards,
+		.speed_commanded = 0
+	};
 	if (is_automatic) {
-		dyn_containers_set_train_engine_instance_inputs(engine_instance,
-		                                                DRIVING_SPEED_SLOW, 
-		                                                requested_forwards);
+		follow_route_speed_profile(&speed_follower, train_id, 0);
 	}
-	pthread_mutex_unlock(&grabbed_trains_mutex);
 	
 	// Set the signals along the route to Stop as the train drives past them
 	// This will return as soon as the train has passed all but the destination signal
-	const bool result = monitor_train_on_route(train_id, route);
+	const bool result = monitor_train_on_route(train_id, route, 
+	                                           is_automatic ? &speed_follower : NULL);
 	
-	// If driving is automatic, slow train down at the end of the route
-	if (is_automatic && result) {
-		// Assumes that all routes have a path with a length of at least 2.
-		const char *pre_dest_segment = g_array_index(route->path, char *, route->path->len - 2);
-		while (running && !train_position_is_at(train_id, pre_dest_segment)
-		               && drive_route_params_valid(train_id, route)) {
-			usleep(TRAIN_DRIVE_TIME_STEP);
-		}
-		
-		if (train_get_grab_id(train_id) == grab_id) {
-			syslog_server(LOG_NOTICE, 
-			              "Drive route - route: %s train: %s - slowing down for end of route", 
-			              route_id, train_id);
-			pthread_mutex_lock(&grabbed_trains_mutex);
-			dyn_containers_set_train_engine_instance_inputs(engine_instance, 
-			                                                DRIVING_SPEED_STOPPING,
-			                                                requested_forwards);
-			pthread_mutex_unlock(&grabbed_trains_mutex);
-		}
-	}
-	
-	// Wait for train to reach the end of the route
+	// Wait for train to reach the end of the route; 
+	// if driving is automatic, keep following the speed profile until then
+	t_route_repeated_segment_flags repeated_segment_flags = get_route_repeated_segment_flags(route);
 	const char *dest_segment = g_array_index(route->path, char *, route->path->len - 1);
 	while (running && result && !is_segment_occupied(dest_segment) 
 	                         && drive_route_params_valid(train_id, route)) {
+		if (is_automatic) {
+			t_train_index_on_route_query train_pos_query = 
+					get_train_pos_index_in_route_ignore_repeated_segments(train_id, route, 
+					                                                      &repeated_segment_flags);
+			if (train_pos_query.err_code == OKAY_TRAIN_ON_ROUTE) {
+				follow_route_speed_profile(&speed_follower, train_id, train_pos_query.pos_index);
+			}
+		}
 		usleep(TRAIN_DRIVE_TIME_STEP);
 	}
+	free_route_repeated_segment_flags(&repeated_segment_flags);
+	route_speed_profile_free(&speed_profile);
 
 	// Logging timestamp before trying to acquire the mutex for grabbed trains, 
 	// such that we can roughly measure the time it takes to acquire the mutex
@@ -675,7 +775,7 @@ static bool drive_route(const int grab_id, const char* train_id, const char *rou
 	
 	// Driving stops
 	if (train_get_grab_id(train_id) == grab_id) {
-		pthread_mutex_lock(&grabbed_trains_mutex);
+		request_metrics_mutex_lock(&grabbed_trains_mutex);
 		clock_gettime(CLOCK_MONOTONIC, &tvb);
 		dyn_containers_set_train_engine_instance_inputs(engine_instance, 0, requested_forwards);
 		pthread_mutex_unlock(&grabbed_trains_mutex);
@@ -704,12 +804,214 @@ static bool drive_route(const int grab_id, const char* train_id, const char *rou
 	return true;
 }
 
-static int grab_train(const char *train, const char *engine) {
+static unsigned long long emergency_stop_now_ns(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long long) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+void emergency_stop_table_initialise(void) {
+	for (int i = 0; i < TRAIN_ENGINE_INSTANCE_COUNT_MAX; i++) {
+		atomic_store(&emergency_stop_grabbed[i], -1);
+		atomic_store(&emergency_stop_engine_instances[i], -1);
+	}
+	
+	t_bidib_id_list_query query = bidib_get_trains();
+	int count = 0;
+	for (size_t i = 0; i < query.length; i++) {
+		if (count >= EMERGENCY_STOP_TRAIN_COUNT_MAX) {
+			syslog_server(LOG_WARNING, 
+			              "Emergency stop table initialise - more than %d trains, "
+			              "train %s and following are only stopped via bidib directly", 
+			              EMERGENCY_STOP_TRAIN_COUNT_MAX, query.ids[i]);
+			break;
+		} else if (strlen(query.ids[i]) >= EMERGENCY_STOP_ID_LEN_MAX) {
+			syslog_server(LOG_WARNING, 
+			              "Emergency stop table initialise - train id %s is too long, skipped", 
+			              query.ids[i]);
+			continue;
+		}
+		strcpy(emergency_stop_trains[count].id, query.ids[i]);
+		count++;
+	}
+	bidib_free_id_list_query(query);
+	atomic_store(&emergency_stop_train_count, count);
+	syslog_server(LOG_INFO, "Emergency stop table initialise - %d trains resolved", count);
+}
+
+// Shall only be called while the grabbed_trains_mutex is locked
+static void emergency_stop_table_set_track_output(int grab_id, const char *track_output) {
+	t_emergency_stop_track_output *entry = &emergency_stop_track_outputs[grab_id];
+	atomic_fetch_add_explicit(&entry->seq, 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	strncpy(entry->value, track_output, sizeof(entry->value) - 1);
+	entry->value[sizeof(entry->value) - 1] = '\0';
+	atomic_fetch_add_explicit(&entry->seq, 1, memory_order_release);
+}
+
+/**
+ * @brief Records which train is grabbed with a grab-id, so that it can be stopped
+ * without acquiring the grabbed_trains_mutex. 
+ * Shall only be called while the grabbed_trains_mutex is locked.
+ * 
+ * @param grab_id grab-id of the train
+ * @param train id of the grabbed train, or NULL if the grab-id is released
+ * @param engine_instance dyn containers engine instance of the train, or -1
+ */
+static void emergency_stop_table_set_grabbed(int grab_id, const char *train, int engine_instance) {
+	int train_index = -1;
+	if (train != NULL) {
+		emergency_stop_table_set_track_output(grab_id, "master");
+		const int count = atomic_load(&emergency_stop_train_count);
+		for (int i = 0; i < count; i++) {
+			if (strcmp(emergency_stop_trains[i].id, train) == 0) {
+				train_index = i;
+				break;
+			}
+		}
+	}
+	atomic_store(&emergency_stop_engine_instances[grab_id], engine_instance);
+	atomic_store(&emergency_stop_grabbed[grab_id], train_index);
+}
+
+static void emergency_stop_table_get_track_output(int grab_id, char dest[32]) {
+	t_emergency_stop_track_output *entry = &emergency_stop_track_outputs[grab_id];
+	unsigned int seq_before;
+	unsigned int seq_after;
+	do {
+		seq_before = atomic_load_explicit(&entry->seq, memory_order_acquire);
+		memcpy(dest, entry->value, sizeof(entry->value));
+		atomic_thread_fence(memory_order_acquire);
+		seq_after = atomic_load_explicit(&entry->seq, memory_order_relaxed);
+	} while ((seq_before & 1) != 0 || seq_before != seq_after);
+	dest[31] = '\0';
+}
+
+static void emergency_stop_record_latency(unsigned long long start_ns) {
+	const unsigned long long latency_ns = emergency_stop_now_ns() - start_ns;
+	atomic_fetch_add(&emergency_stop_count, 1);
+	atomic_store(&emergency_stop_latency_last_ns, latency_ns);
+	atomic_fetch_add(&emergency_stop_latency_total_ns, latency_ns);
+	unsigned long long max_ns = atomic_load(&emergency_stop_latency_max_ns);
+	while (latency_ns > max_ns 
+	       && !atomic_compare_exchange_weak(&emergency_stop_latency_max_ns, &max_ns, latency_ns)) {
+		// max_ns has been updated by the failed exchange, retry
+	}
+}
+
+/**
+ * @brief Stops the train grabbed with grab_id immediately via bidib, bypassing the 
+ * dynamic containers, and requests speed 0 from its train engine so that the engine 
+ * does not resume driving. Does not acquire any lock of the server.
+ * 
+ * @param grab_id grab-id of the train to stop
+ * @param track_output track output to use, or NULL to use the last one of the train
+ * @param train_id (out) buffer for the id of the stopped train
+ * @return 0 if the train was stopped, -1 if the grab-id is not in use, 
+ * or -2 if bidib rejected the emergency stop
+ */
+static int emergency_stop_grabbed_train(int grab_id, const char *track_output, 
+                                        char train_id[EMERGENCY_STOP_ID_LEN_MAX]) {
+	const int train_index = atomic_load(&emergency_stop_grabbed[grab_id]);
+	if (train_index < 0) {
+		return -1;
+	}
+	strcpy(train_id, emergency_stop_trains[train_index].id);
+	
+	char last_track_output[32];
+	if (track_output == NULL) {
+		emergency_stop_table_get_track_output(grab_id, last_track_output);
+		track_output = last_track_output;
+	}
+	if (bidib_emergency_stop_train(train_id, track_output)) {
+		return -2;
+	}
+	bidib_flush();
+	
+	const int engine_instance = atomic_load(&emergency_stop_engine_instances[grab_id]);
+	if (engine_instance >= 0) {
+		dyn_containers_post_train_engine_instance_speed(engine_instance, 0, true);
+	}
+	return 0;
+}
+
+int emergency_stop_all_trains(void) {
+	const unsigned long long start_ns = emergency_stop_now_ns();
+	bool is_stopped[EMERGENCY_STOP_TRAIN_COUNT_MAX] = { false };
+	char train_id[EMERGENCY_STOP_ID_LEN_MAX];
+	
+	// Grabbed trains first on their own track output, they may be driven by a train engine
+	for (int grab_id = 0; grab_id < TRAIN_ENGINE_INSTANCE_COUNT_MAX; grab_id++) {
+		const int train_index = atomic_load(&emergency_stop_grabbed[grab_id]);
+		if (train_index >= 0 && emergency_stop_grabbed_train(grab_id, NULL, train_id) == 0) {
+			is_stopped[train_index] = true;
+		}
+	}
+	
+	// Then every train of the platform, as trains may have been grabbed or released 
+	// since the grab-ids were read without locking
+	const int count = atomic_load(&emergency_stop_train_count);
+	for (int i = 0; i < count; i++) {
+		if (bidib_emergency_stop_train(emergency_stop_trains[i].id, "master") == 0) {
+			is_stopped[i] = true;
+		}
+	}
+	bidib_flush();
+	
+	// Train engines started meanwhile must not resume driving either
+	for (int grab_id = 0; grab_id < TRAIN_ENGINE_INSTANCE_COUNT_MAX; grab_id++) {
+		const int engine_instance = atomic_load(&emergency_stop_engine_instances[grab_id]);
+		if (engine_instance >= 0) {
+			dyn_containers_post_train_engine_instance_speed(engine_instance, 0, true);
+		}
+	}
+	emergency_stop_record_latency(start_ns);
+	
+	int stopped_count = 0;
+	for (int i = 0; i < count; i++) {
+		stopped_count += is_stopped[i];
+	}
+	return stopped_count;
+}
+
+void emergency_stop_get_stats(t_emergency_stop_stats *stats) {
+	stats->count = atomic_load(&emergency_stop_count);
+	stats->latency_last_ns = atomic_load(&emergency_stop_latency_last_ns);
+	stats->latency_max_ns = atomic_load(&emergency_stop_latency_max_ns);
+	stats->latency_total_ns = atomic_load(&emergency_stop_latency_total_ns);
+}
+
+// Assigns the grab-id to the train, sets its track output to master, and starts an instance 
+// of the train engine for it; shall only be called with grabbed_trains_mutex acquired
+static bool assign_grab_id(int grab_id, const char *train, const char *engine) {
+	grabbed_trains[grab_id].name = g_string_new(train);
+	
+	strcpy(grabbed_trains[grab_id].track_output, "master");
+	
+	if (dyn_containers_set_train_engine_instance(&grabbed_trains[grab_id], train, engine)) {
+		g_string_free(grabbed_trains[grab_id].name, true);
+		grabbed_trains[grab_id].name = NULL;
+		syslog_server(LOG_ERR, 
+		              "Grab train - train: %s engine: %s - train engine could not be set", 
+		              train, engine);
+		return false;
+	}
+	grabbed_trains[grab_id].is_valid = true;
+	emergency_stop_table_set_grabbed(grab_id, train, 
+	                                 grabbed_trains[grab_id].dyn_containers_engine_instance);
+	checkpoint_set_grab(grab_id, train, engine);
+	syslog_server(LOG_NOTICE, 
+	              "Grab train - train: %s engine: %s - train grabbed with id: %d", 
+	              train, engine, grab_id);
+	return true;
+}
+
+int grab_train(const char *train, const char *engine) {
 	if (train == NULL || engine == NULL) {
 		syslog_server(LOG_ERR, "Grab train - invalid (NULL) parameters");
 		return -4;
 	}
-	pthread_mutex_lock(&grabbed_trains_mutex);
+	request_metrics_mutex_lock(&grabbed_trains_mutex);
 	// Check if train is already grabbed
 	for (int i = 0; i < TRAIN_ENGINE_INSTANCE_COUNT_MAX; i++) {
 		if (grabbed_trains[i].is_valid && strcmp(grabbed_trains[i].name->str, train) == 0) {
@@ -735,33 +1037,44 @@ static int grab_train(const char *train, const char *engine) {
 			increment_next_grab_id();
 		}
 	}
-	// Assign grab-id, set track output to master, set engine instance
 	const int grab_id = next_grab_id;
 	increment_next_grab_id(); // increment for next "grab" action
-	grabbed_trains[grab_id].name = g_string_new(train);
-	
-	strcpy(grabbed_trains[grab_id].track_output, "master");
-	
-	if (dyn_containers_set_train_engine_instance(&grabbed_trains[grab_id], train, engine)) {
+	const bool success = assign_grab_id(grab_id, train, engine);
+	pthread_mutex_unlock(&grabbed_trains_mutex);
+	return success ? grab_id : -1;
+}
+
+bool restore_grabbed_train(int grab_id, const char *train, const char *engine) {
+	if (train == NULL || engine == NULL 
+	    || grab_id < 0 || grab_id >= TRAIN_ENGINE_INSTANCE_COUNT_MAX) {
+		syslog_server(LOG_ERR, "Restore grabbed train - invalid parameters");
+		return false;
+	}
+	request_metrics_mutex_lock(&grabbed_trains_mutex);
+	bool in_use = grabbed_trains[grab_id].is_valid;
+	for (int i = 0; i < TRAIN_ENGINE_INSTANCE_COUNT_MAX && !in_use; i++) {
+		in_use = grabbed_trains[i].is_valid && strcmp(grabbed_trains[i].name->str, train) == 0;
+	}
+	if (in_use) {
 		pthread_mutex_unlock(&grabbed_trains_mutex);
 		syslog_server(LOG_ERR, 
-		              "Grab train - train: %s engine: %s - train engine could not be set", 
-		              train, engine);
-		return -1;
+		              "Restore grabbed train - grab-id: %d train: %s - "
+		              "grab-id or train already in use", 
+		              grab_id, train);
+		return false;
 	}
-	grabbed_trains[grab_id].is_valid = true;
+	const bool success = assign_grab_id(grab_id, train, engine);
 	pthread_mutex_unlock(&grabbed_trains_mutex);
-	syslog_server(LOG_NOTICE, 
-	              "Grab train - train: %s engine: %s - train grabbed with id: %d", 
-	              train, engine, grab_id);
-	return grab_id;
+	return success;
 }
 
 bool release_train(int grab_id) {
 	bool success = false;
-	pthread_mutex_lock(&grabbed_trains_mutex);
+	request_metrics_mutex_lock(&grabbed_trains_mutex);
 	if (grabbed_trains[grab_id].is_valid) {
 		grabbed_trains[grab_id].is_valid = false;
+		emergency_stop_table_set_grabbed(grab_id, NULL, -1);
+		checkpoint_clear_grab(grab_id);
 		dyn_containers_free_train_engine_instance(grabbed_trains[grab_id].dyn_containers_engine_instance);
 		syslog_server(LOG_NOTICE, 
 		              "Release train - grab-id: %d train: %s - released", 
@@ -781,7 +1094,7 @@ void release_all_grabbed_trains(void) {
 }
 
 char *train_id_from_grab_id(int grab_id) {
-	pthread_mutex_lock(&grabbed_trains_mutex);
+	request_metrics_mutex_lock(&grabbed_trains_mutex);
 	if (grab_id == -1 || !grabbed_trains[grab_id].is_valid) {
 		pthread_mutex_unlock(&grabbed_trains_mutex);
 		return NULL;
@@ -841,6 +1154,7 @@ o_con_status handler_grab_train(void *_, onion_request *req, onion_response *res
 		int grab_id = grab_train(data_train, data_engine);
 		// No extra syslog per case as grab_train logs extensively.
 		if (grab_id >= 0) {
+			command_journal_record_assigned_id("grab-id", grab_id);
 			send_some_gstring_and_free(res, HTTP_OK, build_grab_fdbk_json(session_id, grab_id));
 		} else if (grab_id == -4) {
 			send_common_feedback(res, HTTP_BAD_REQUEST, "invalid parameters");
@@ -897,7 +1211,7 @@ o_con_status handler_release_train(void *_, onion_request *req, onion_response *
 		              grab_id, train_id);
 		
 		// Set train speed to 0
-		pthread_mutex_lock(&grabbed_trains_mutex);
+		request_metrics_mutex_lock(&grabbed_trains_mutex);
 		const int engine_instance = grabbed_trains[grab_id].dyn_containers_engine_instance;
 		dyn_containers_set_train_engine_instance_inputs(engine_instance, 0, true);
 		pthread_mutex_unlock(&grabbed_trains_mutex);
@@ -922,7 +1236,7 @@ o_con_status handler_release_train(void *_, onion_request *req, onion_response *
 			              "train is not currently grabbed - abort", 
 			              grab_id, train_id);
 		} else {
-			onion_response_set_code(res, HTTP_OK);
+			set_response_code(res, HTTP_OK);
 			syslog_server(LOG_NOTICE, 
 			              "Request: Release train - grab-id: %d train: %s - finish", 
 			              grab_id, train_id);
@@ -1050,7 +1364,7 @@ o_con_status handler_request_route_by_id(void *_, onion_request *req, onion_resp
 		const char *result = grant_route_id(train_id, route_id);
 		// No extra syslog as grant_route_id logs extensively
 		if (strcmp(result, "granted") == 0) {
-			onion_response_set_code(res, HTTP_OK);
+			set_response_code(res, HTTP_OK);
 		} else if (strcmp(result, "not_known") == 0) {
 			send_common_feedback(res, HTTP_NOT_FOUND, "Route is not known");
 		} else if (strcmp(result, "already_granted") == 0) {
@@ -1079,6 +1393,107 @@ o_con_status handler_request_route_by_id(void *_, onion_request *req, onion_resp
 	}
 }
 
+static void append_plan_json(GString *dest, const char *field, 
+                             const GArray *plan_route_ids, float plan_length,
+                             bool add_trailing_comma) {
+	if (plan_route_ids == NULL) {
+		append_field_literal_value_from_str(dest, field, "null", add_trailing_comma);
+		return;
+	}
+	append_field_start_of_obj(dest, field);
+	append_field_strlist_value_from_garray_strs(dest, "route_ids", plan_route_ids, true);
+	append_field_float_value(dest, "length", plan_length, false);
+	append_end_of_obj(dest, add_trailing_comma);
+}
+
+o_con_status handler_plan_route(void *_, onion_request *req, onion_response *res) {
+	build_response_header(res);
+	if (running && ((onion_request_get_flags(req) & OR_METHODS) == OR_POST)) {
+		const char *data_session_id = onion_request_get_post(req, "session-id");
+		const char *data_grab_id = onion_request_get_post(req, "grab-id");
+		const char *data_target = onion_request_get_post(req, "target");
+		const int client_session_id = params_check_session_id(data_session_id);
+		const int grab_id = params_check_grab_id(data_grab_id, TRAIN_ENGINE_INSTANCE_COUNT_MAX);
+		
+		if (handle_param_miss_check(res, "Plan route", "session-id", data_session_id)
+			|| handle_param_miss_check(res, "Plan route", "grab-id", data_grab_id)
+			|| handle_param_miss_check(res, "Plan route", "target", data_target)) {
+			return OCS_PROCESSED;
+		} else if (client_session_id != session_id) {
+			send_common_feedback(res, HTTP_BAD_REQUEST, "invalid session-id");
+			syslog_server(LOG_ERR, 
+			              "Request: Plan route - to: %s - invalid session-id (%s)", 
+			              data_target, data_session_id);
+			return OCS_PROCESSED;
+		}
+		// If grab_id is valid, train_id will be, too.
+		char *train_id = train_id_from_grab_id(grab_id);
+		if (train_id == NULL) {
+			send_common_feedback(res, HTTP_BAD_REQUEST, "invalid grab-id");
+			syslog_server(LOG_ERR, 
+			              "Request: Plan route - to: %s - invalid grab-id (%s)",
+			              data_target, data_grab_id);
+			return OCS_PROCESSED;
+		}
+		const char *block_id = train_get_block_id(train_id);
+		if (block_id == NULL) {
+			send_common_feedback(res, HTTP_BAD_REQUEST, "current block of train unknown");
+			syslog_server(LOG_ERR, 
+			              "Request: Plan route - train: %s to: %s - current block of train unknown",
+			              train_id, data_target);
+			free(train_id);
+			return OCS_PROCESSED;
+		}
+		
+		syslog_server(LOG_NOTICE, 
+		              "Request: Plan route - train: %s from: %s to: %s - start",
+		              train_id, block_id, data_target);
+		
+		// 1. Shortest plan over all routes, and the shortest plan that only uses routes
+		//    that are not granted to other trains and have no granted conflicts.
+		float plan_length = 0.0f;
+		float plan_available_length = 0.0f;
+		request_metrics_mutex_lock(&interlocker_mutex);
+		GArray *plan = route_planner_plan(block_id, data_target, NULL, NULL, &plan_length);
+		GArray *plan_available = 
+				route_planner_plan(block_id, data_target, 
+				                   route_is_available_for_train, train_id, 
+				                   &plan_available_length);
+		pthread_mutex_unlock(&interlocker_mutex);
+		
+		if (plan == NULL) {
+			send_common_feedback(res, HTTP_NOT_FOUND, "No plan to the target exists");
+			syslog_server(LOG_NOTICE, 
+			              "Request: Plan route - train: %s from: %s to: %s - no plan exists",
+			              train_id, block_id, data_target);
+		} else {
+			// 2. Reply with both plans
+			GString *g_plans = g_string_sized_new(256);
+			g_string_assign(g_plans, "");
+			append_start_of_obj(g_plans, false);
+			append_field_str_value(g_plans, "source_block", block_id, true);
+			append_field_str_value(g_plans, "target", data_target, true);
+			append_plan_json(g_plans, "shortest", plan, plan_length, true);
+			append_plan_json(g_plans, "available", plan_available, plan_available_length, false);
+			append_end_of_obj(g_plans, false);
+			send_some_gstring_and_free(res, HTTP_OK, g_plans);
+			syslog_server(LOG_NOTICE, 
+			              "Request: Plan route - train: %s from: %s to: %s - "
+			              "routes: %u, available routes: %d - finish",
+			              train_id, block_id, data_target, plan->len, 
+			              plan_available == NULL ? -1 : (int) plan_available->len);
+			g_array_free(plan, true);
+		}
+		if (plan_available != NULL) {
+			g_array_free(plan_available, true);
+		}
+		free(train_id);
+		return OCS_PROCESSED;
+	} else {
+		return handle_req_run_or_method_fail(res, running, "Plan route");
+	}
+}
+
 o_con_status handler_driving_direction(void *_, onion_request *req, onion_response *res) {
 	// Notes regarding documentation:
 	// The driving direction is determined based on the route specified *and* the trains position 
@@ -1107,7 +1522,7 @@ o_con_status handler_driving_direction(void *_, onion_request *req, onion_respon
 		syslog_server(LOG_INFO, 
 		              "Request: Driving direction - train: %s route: %s - start", 
 		              data_train, route_id);
-		pthread_mutex_lock(&interlocker_mutex);
+		request_metrics_mutex_lock(&interlocker_mutex);
 		const t_interlocking_route *route = get_route(route_id);
 		if (route == NULL) {
 			send_common_feedback(res, HTTP_NOT_FOUND, "no route with given route-id known");
@@ -1220,7 +1635,7 @@ o_con_status handler_set_dcc_train_speed(void *_, onion_request *req, onion_resp
 			return OCS_PROCESSED;
 		}
 		
-		pthread_mutex_lock(&grabbed_trains_mutex);
+		request_metrics_mutex_lock(&grabbed_trains_mutex);
 		if (grab_id == -1 || !grabbed_trains[grab_id].is_valid) {
 			pthread_mutex_unlock(&grabbed_trains_mutex);
 			send_common_feedback(res, HTTP_BAD_REQUEST, "invalid grab-id");
@@ -1249,18 +1664,20 @@ o_con_status handler_set_dcc_train_speed(void *_, onion_request *req, onion_resp
 			return OCS_PROCESSED;
 		}
 		
-		syslog_server(LOG_NOTICE, 
-		              "Request: Set dcc train speed - train: %s speed: %d - start",
-		              grabbed_trains[grab_id].name->str, speed);
 		strcpy(grabbed_trains[grab_id].track_output, data_track_output);
+		emergency_stop_table_set_track_output(grab_id, data_track_output);
 		const int eng_instance = grabbed_trains[grab_id].dyn_containers_engine_instance;
-		dyn_containers_set_train_engine_instance_inputs(eng_instance, abs(speed), speed >= 0);
+		// Speed commands are coalesced: only the latest one per LET tick reaches the 
+		// train engine, so this does not need to wait for the dyn_containers_mutex
+		const bool superseded = 
+				dyn_containers_post_train_engine_instance_speed(eng_instance, abs(speed), speed >= 0);
 		
-		syslog_server(LOG_NOTICE, 
-		              "Request: Set dcc train speed - train: %s speed: %d - finish",
-		              grabbed_trains[grab_id].name->str, speed);
+		syslog_server(LOG_INFO, 
+		              "Request: Set dcc train speed - train: %s speed: %d%s - finish",
+		              grabbed_trains[grab_id].name->str, speed, 
+		              superseded ? " (superseded pending speed)" : "");
 		pthread_mutex_unlock(&grabbed_trains_mutex);
-		onion_response_set_code(res, HTTP_OK);
+		set_response_code(res, HTTP_OK);
 		return OCS_PROCESSED;
 	} else {
 		return handle_req_run_or_method_fail(res, running, "Set dcc train speed");
@@ -1292,7 +1709,7 @@ o_con_status handler_set_calibrated_train_speed(void *_, onion_request *req, oni
 			return OCS_PROCESSED;
 		} 
 		
-		pthread_mutex_lock(&grabbed_trains_mutex);
+		request_metrics_mutex_lock(&grabbed_trains_mutex);
 		if (grab_id == -1 || !grabbed_trains[grab_id].is_valid) {
 			pthread_mutex_unlock(&grabbed_trains_mutex);
 			send_common_feedback(res, HTTP_BAD_REQUEST, "invalid grab-id");
@@ -1321,7 +1738,7 @@ o_con_status handler_set_calibrated_train_speed(void *_, onion_request *req, oni
 			              grabbed_trains[grab_id].name->str, speed);
 		} else {
 			bidib_flush();
-			onion_response_set_code(res, HTTP_OK);
+			set_response_code(res, HTTP_OK);
 			syslog_server(LOG_NOTICE, 
 			              "Request: Set calibrated train speed - train: %s speed: %d - finish",
 			              grabbed_trains[grab_id].name->str, speed);
@@ -1334,6 +1751,7 @@ o_con_status handler_set_calibrated_train_speed(void *_, onion_request *req, oni
 }
 
 o_con_status handler_set_train_emergency_stop(void *_, onion_request *req, onion_response *res) {
+	const unsigned long long start_ns = emergency_stop_now_ns();
 	build_response_header(res);
 	if (running && ((onion_request_get_flags(req) & OR_METHODS) == OR_POST)) {
 		const char *data_session_id = onion_request_get_post(req, "session-id");
@@ -1355,40 +1773,55 @@ o_con_status handler_set_train_emergency_stop(void *_, onion_request *req, onion
 			return OCS_PROCESSED;
 		}
 		
-		pthread_mutex_lock(&grabbed_trains_mutex);
-		if (grab_id == -1 || !grabbed_trains[grab_id].is_valid) {
-			pthread_mutex_unlock(&grabbed_trains_mutex);
+		// No lock is acquired, the train is resolved via the emergency stop table
+		char train_id[EMERGENCY_STOP_ID_LEN_MAX] = "";
+		const int stop_result = (grab_id == -1) 
+		                        ? -1 
+		                        : emergency_stop_grabbed_train(grab_id, data_track_output, train_id);
+		if (stop_result == 0) {
+			emergency_stop_record_latency(start_ns);
+		}
+		
+		// Logging only after the train has been stopped
+		if (stop_result == -1) {
 			send_common_feedback(res, HTTP_BAD_REQUEST, "invalid grab-id");
 			syslog_server(LOG_ERR, 
 			              "Request: Set train emergency stop - invalid grab-id (%s)", 
 			              data_grab_id);
-			return OCS_PROCESSED;
-		}
-		
-		syslog_server(LOG_NOTICE, 
-		              "Request: Set train emergency stop - train: %s - start",
-		              grabbed_trains[grab_id].name->str);
-		
-		if (bidib_emergency_stop_train(grabbed_trains[grab_id].name->str, data_track_output)) {
+		} else if (stop_result == -2) {
 			send_common_feedback(res, HTTP_BAD_REQUEST, "invalid parameter values");
 			syslog_server(LOG_ERR, 
 			              "Request: Set train emergency stop - train: %s - "
 			              "invalid parameter values - abort", 
-			              grabbed_trains[grab_id].name->str);
+			              train_id);
 		} else {
-			bidib_flush();
-			onion_response_set_code(res, HTTP_OK);
+			set_response_code(res, HTTP_OK);
 			syslog_server(LOG_NOTICE, 
-			              "Request: Set train emergency stop - train: %s - finish",
-			              grabbed_trains[grab_id].name->str);
+			              "Request: Set train emergency stop - train: %s - finish (%llu ns)",
+			              train_id, emergency_stop_now_ns() - start_ns);
 		}
-		pthread_mutex_unlock(&grabbed_trains_mutex);
 		return OCS_PROCESSED;
 	} else {
 		return handle_req_run_or_method_fail(res, running, "Set train emergency stop");
 	}
 }
 
+o_con_status handler_set_all_trains_emergency_stop(void *_, onion_request *req, 
+                                                   onion_response *res) {
+	build_response_header(res);
+	// Anyone who sees a hazard may stop all trains, also without a session of their own
+	if (running && ((onion_request_get_flags(req) & OR_METHODS) == OR_POST)) {
+		const int stopped_count = emergency_stop_all_trains();
+		set_response_code(res, HTTP_OK);
+		syslog_server(LOG_NOTICE, 
+		              "Request: Set all trains emergency stop - stopped trains: %d - finish",
+		              stopped_count);
+		return OCS_PROCESSED;
+	} else {
+		return handle_req_run_or_method_fail(res, running, "Set all trains emergency stop");
+	}
+}
+
 o_con_status handler_set_train_peripheral(void *_, onion_request *req, onion_response *res) {
 	build_response_header(res);
 	if (running && ((onion_request_get_flags(req) & OR_METHODS) == OR_POST)) {
@@ -1415,7 +1848,7 @@ o_con_status handler_set_train_peripheral(void *_, onion_request *req, onion_res
 			return OCS_PROCESSED;
 		} 
 		
-		pthread_mutex_lock(&grabbed_trains_mutex);
+		request_metrics_mutex_lock(&grabbed_trains_mutex);
 		if (grab_id == -1 || !grabbed_trains[grab_id].is_valid) {
 			pthread_mutex_unlock(&grabbed_trains_mutex);
 			send_common_feedback(res, HTTP_BAD_REQUEST, "invalid grab-id");
@@ -1445,7 +1878,7 @@ o_con_status handler_set_train_peripheral(void *_, onion_request *req, onion_res
 			              grabbed_trains[grab_id].name->str, data_peripheral, state);
 		} else {
 			bidib_flush();
-			onion_response_set_code(res, HTTP_OK);
+			set_response_code(res, HTTP_OK);
 			syslog_server(LOG_NOTICE, 
 			              "Request: Set train peripheral - train: %s peripheral: %s state: %d"
 			              " - finish",
@@ -34,6 +34,9 @@
 #define TRAIN_ENGINE_COUNT_MAX			4
 #define TRAIN_ENGINE_INSTANCE_COUNT_MAX	5
 
+#define EMERGENCY_STOP_TRAIN_COUNT_MAX	64
+#define EMERGENCY_STOP_ID_LEN_MAX		64
+
 #define MICROSECOND 1
 #define TRAIN_DRIVE_TIME_STEP 	10000 * MICROSECOND		// 0.01 seconds
 
@@ -50,11 +53,51 @@ typedef struct {
 
 extern t_train_data grabbed_trains[TRAIN_ENGINE_INSTANCE_COUNT_MAX];
 
+typedef struct {
+	unsigned long long count;
+	unsigned long long latency_last_ns;
+	unsigned long long latency_max_ns;
+	unsigned long long latency_total_ns;
+} t_emergency_stop_stats;
+
 
 int train_get_grab_id(const char *train);
 
 bool train_grabbed(const char *train);
 
+/**
+ * @brief Returns the block in which the train currently is.
+ * The caller is NOT responsible for freeing the returned string.
+ * 
+ * @param train_id id of the train
+ * @return char* id of the block, or NULL if the current block of the train is unknown
+ */
+char *train_get_block_id(const char *train_id);
+
+/**
+ * @brief Grabs a train, i.e., assigns it a grab-id and starts an instance of the 
+ * train engine for it.
+ * 
+ * @param train id of the train
+ * @param engine name of the train engine
+ * @return int the grab-id if successful, -1 if the train engine could not be started,
+ * -2 if all grab-ids are in use, -3 if the train is already grabbed, 
+ * -4 if the parameters are invalid
+ */
+int grab_train(const char *train, const char *engine);
+
+/**
+ * @brief Grabs a train with the given grab-id, e.g., when restoring a checkpoint, 
+ * such that the drivers can continue to use their grab-ids.
+ * 
+ * @param grab_id grab-id to assign
+ * @param train id of the train
+ * @param engine name of the train engine
+ * @return true if the train was grabbed, false if the grab-id or the train is already 
+ * in use or the train engine could not be started
+ */
+bool restore_grabbed_train(int grab_id, const char *train, const char *engine);
+
 bool release_train(int grab_id);
 
 void release_all_grabbed_trains(void);
@@ -67,6 +110,43 @@ void release_all_grabbed_trains(void);
  */
 char *train_id_from_grab_id(int grab_id);
 
+/**
+ * @brief Resolves the ids of all trains of the platform for the emergency stop path.
+ * Shall be called at startup once bidib has been started and before any train is grabbed.
+ */
+void emergency_stop_table_initialise(void);
+
+/**
+ * @brief Immediately stops all trains of the platform via bidib, bypassing the dynamic
+ * containers, and requests speed 0 from all train engine instances in use. 
+ * Does not acquire any lock of the server, every train of the platform is stopped 
+ * regardless of whether it is grabbed.
+ * 
+ * @return int number of trains for which the emergency stop was issued
+ */
+int emergency_stop_all_trains(void);
+
+/**
+ * @brief Gets the number of emergency stops and their latency, measured from the arrival 
+ * of the request until the stop has been flushed to bidib.
+ * 
+ * @param stats (out) the statistics
+ */
+void emergency_stop_get_stats(t_emergency_stop_stats *stats);
+
+/**
+ * @brief Drives a train along a route that has been granted to it, and releases the 
+ * route once the train has reached its destination. Blocks until then.
+ * 
+ * @param grab_id grab-id of the train
+ * @param train_id id of the train
+ * @param route_id id of the route
+ * @param is_automatic whether the speed shall be controlled by the server (automatic)
+ * or by the driver (manual)
+ * @return true if the route was driven, otherwise false
+ */
+bool drive_route(const int grab_id, const char* train_id, const char *route_id, bool is_automatic);
+
 o_con_status handler_grab_train(void *_, onion_request *req, onion_response *res);
 
 o_con_status handler_release_train(void *_, onion_request *req, onion_response *res);
@@ -75,6 +155,8 @@ o_con_status handler_request_route(void *_, onion_request *req, onion_response *
 
 o_con_status handler_request_route_by_id(void *_, onion_request *req, onion_response *res);
 
+o_con_status handler_plan_route(void *_, onion_request *req, onion_response *res);
+
 o_con_status handler_driving_direction(void *_, onion_request *req, onion_response *res);
 
 o_con_status handler_drive_route(void *_, onion_request *req, onion_response *res);
@@ -87,5 +169,8 @@ o_con_status handler_set_train_peripheral(void *_, onion_request *req, onion_res
 
 o_con_status handler_set_train_emergency_stop(void *_, onion_request *req, onion_response *res);
 
+o_con_status handler_set_all_trains_emergency_stop(void *_, onion_request *req, 
+                                                   onion_response *res);
+
 
 #endif  // HANDLER_DRIVER_H
\ No newline at end of file
@@ -29,6 +29,7 @@
 #include <bidib/bidib.h>
 #include <pthread.h>
 #include <glib.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -42,6 +43,14 @@
 #include "websocket_uploader/engine_uploader.h"
 #include "json_response_builder.h"
 #include "communication_utils.h"
+#include "fleet_scheduler.h"
+#include "state_stream.h"
+#include "response_cache.h"
+#include "request_metrics.h"
+#include "request_lanes.h"
+#include "bidib_messages.h"
+#include "command_journal.h"
+#include "memory_footprint.h"
 
 ///NOTE: Handlers/endpoints that do NOT require parameters/args passed from clients
 //       now use HTTP method GET. All other stick with POST. Need to adjust clients accordingly.
@@ -135,11 +144,10 @@ o_con_status handler_get_trains(void *_, onion_request *req, onion_response *res
 	build_response_header(res);
 	if (running && ((onion_request_get_flags(req) & OR_METHODS) == OR_GET)) {
 		GString *g_trains = get_trains_json();
-		if (g_trains != NULL) {
-			send_some_gstring_and_free(res, HTTP_OK, g_trains);
+		if (response_cache_send_validated(req, res, g_trains)) {
 			syslog_server(LOG_INFO, "Request: Get trains - done");
 		} else {
-			onion_response_set_code(res, HTTP_INTERNAL_ERROR);
+			set_response_code(res, HTTP_INTERNAL_ERROR);
 			syslog_server(LOG_ERR, "Request: Get trains - unable to build reply message");
 		}
 		
@@ -182,7 +190,7 @@ static GString *get_train_state_json_given_statequery(const char *train_id,
 	append_field_int_value(g_train_state, "speed_step", tr_state_query.data.set_speed_step, true);
 	append_field_int_value(g_train_state, "detected_kmh_speed", tr_state_query.data.detected_kmh_speed, true);
 	
-	pthread_mutex_lock(&interlocker_mutex);
+	request_metrics_mutex_lock(&interlocker_mutex);
 	const char *route_id = interlocking_table_get_route_id_of_train(train_id);
 	pthread_mutex_unlock(&interlocker_mutex);
 	append_field_str_value(g_train_state, "route_id", route_id == NULL ? "" : route_id, true);
@@ -200,13 +208,19 @@ static GString *get_train_state_json_given_statequery(const char *train_id,
 		int added_blocks = 0;
 		for (size_t i = 0; i < train_position_query.length; i++) {
 			const char *block_id = config_get_block_id_of_segment(train_position_query.segments[i]);
+			if (block_id == NULL || strlen(block_id) == 0) {
+				continue;
+			}
 			GString *search_str = g_string_new("");
-			g_string_append_printf(search_str, "\"%s\"", block_id);
+			append_str_value(search_str, block_id);
 			// only add block if it does not already exist in the list (and thus in g_train_state)
 			// Naively, if e.g., "block12" was added, then block1 will be found.
 			// -> fix is to include the '"'s in the search.
-			if (block_id != NULL && strlen(block_id) > 0 && strstr(g_train_state->str, search_str->str) == NULL) {
-				g_string_append_printf(g_train_state, "%s\"%s\"", added_blocks > 0 ? ", " : "", block_id);
+			if (strstr(g_train_state->str, search_str->str) == NULL) {
+				if (added_blocks > 0) {
+					g_string_append(g_train_state, ", ");
+				}
+				g_string_append(g_train_state, search_str->str);
 				++added_blocks;
 			}
 			g_string_free(search_str, true);
@@ -231,7 +245,7 @@ o_con_status handler_get_train_state(void *_, onion_request *req, onion_response
 		t_bidib_train_state_query train_state_query = bidib_get_train_state(data_train);
 		if (!train_state_query.known) {
 			bidib_free_train_state_query(train_state_query);
-			onion_response_set_code(res, HTTP_NOT_FOUND);
+			set_response_code(res, HTTP_NOT_FOUND);
 			syslog_server(LOG_WARNING, 
 			              "Request: Get train state - train: %s - unknown train/train state", 
 			              data_train);
@@ -244,7 +258,7 @@ o_con_status handler_get_train_state(void *_, onion_request *req, onion_response
 			send_some_gstring_and_free(res, HTTP_OK, ret_string);
 			syslog_server(LOG_INFO, "Request: Get train state - train: %s - done", data_train);
 		} else {
-			onion_response_set_code(res, HTTP_INTERNAL_ERROR);
+			set_response_code(res, HTTP_INTERNAL_ERROR);
 			syslog_server(LOG_ERR, 
 			              "Request: Get train state - train: %s - unable to build reply message", 
 			              data_train);
@@ -282,10 +296,10 @@ static GString *get_train_states_json() {
 			GString *g_train_state = get_train_state_json_given_statequery(query.ids[i], tr_state_q);
 			if (g_train_state != NULL) {
 				if (added_trains > 0) {
-					g_string_append_printf(g_train_states, "%s", ",\n");
+					g_string_append(g_train_states, ",\n");
 				}
 				added_trains++;
-				g_string_append_printf(g_train_states, "%s", g_train_state->str);
+				g_string_append(g_train_states, g_train_state->str);
 				g_string_free(g_train_state, true);
 			}
 		}
@@ -306,7 +320,7 @@ o_con_status handler_get_train_states(void *_, onion_request *req, onion_respons
 			send_some_gstring_and_free(res, HTTP_OK, g_train_states);
 			syslog_server(LOG_INFO, "Request: Get train states - done");
 		} else {
-			onion_response_set_code(res, HTTP_INTERNAL_ERROR);
+			set_response_code(res, HTTP_INTERNAL_ERROR);
 			syslog_server(LOG_ERR, "Request: Get train states - unable to build reply message");
 		}
 		return OCS_PROCESSED;
@@ -372,7 +386,7 @@ o_con_status handler_get_train_peripherals(void *_, onion_request *req, onion_re
 		if (handle_param_miss_check(res, "Get train peripherals", "train", data_train)) {
 			return OCS_PROCESSED;
 		} else if (!train_known(data_train)) {
-			onion_response_set_code(res, HTTP_NOT_FOUND);
+			set_response_code(res, HTTP_NOT_FOUND);
 			syslog_server(LOG_WARNING, 
 			              "Request: Get train peripherals - train: %s - unknown train", 
 			              data_train);
@@ -386,7 +400,7 @@ o_con_status handler_get_train_peripherals(void *_, onion_request *req, onion_re
 			              "Request: Get train peripherals - train: %s - done",
 			              data_train);
 		} else {
-			onion_response_set_code(res, HTTP_INTERNAL_ERROR);
+			set_response_code(res, HTTP_INTERNAL_ERROR);
 			syslog_server(LOG_ERR, 
 			              "Request: Get train peripherals - train: %s - unable to build reply message",
 			              data_train);
@@ -436,17 +450,22 @@ static GString *get_engines_or_interlockers_json(bool engines) {
 	return g_json_ret;
 }
 
+static GString *build_engines_or_interlockers_json(void *context) {
+	return get_engines_or_interlockers_json(*(bool *) context);
+}
+
 static o_con_status get_engines_interlockers_common(onion_request *req, onion_response *res, 
                                                     bool engines) {
 	build_response_header(res);
 	const char *l_name = engines ? "Get engines" : "Get interlockers";
 	if (running && ((onion_request_get_flags(req) & OR_METHODS) == OR_GET)) {
-		GString *g_ret = get_engines_or_interlockers_json(engines);
-		if (g_ret != NULL) {
-			send_some_gstring_and_free(res, HTTP_OK, g_ret);
+		if (response_cache_send(req, res, engines ? "engines" : "interlockers",
+		                        engines ? RESPONSE_CACHE_SCOPE_ENGINES 
+		                                : RESPONSE_CACHE_SCOPE_INTERLOCKERS,
+		                        build_engines_or_interlockers_json, &engines)) {
 			syslog_server(LOG_INFO, "Request: %s - done", l_name);
 		} else {
-			onion_response_set_code(res, HTTP_INTERNAL_ERROR);
+			set_response_code(res, HTTP_INTERNAL_ERROR);
 			syslog_server(LOG_ERR, "Request: %s - unable to build reply message", l_name);
 		}
 		return OCS_PROCESSED;
@@ -526,7 +545,7 @@ o_con_status handler_get_track_outputs(void *_, onion_request *req, onion_respon
 			send_some_gstring_and_free(res, HTTP_OK, g_track_outputs);
 			syslog_server(LOG_INFO, "Request: Get track outputs - done");
 		} else {
-			onion_response_set_code(res, HTTP_INTERNAL_ERROR);
+			set_response_code(res, HTTP_INTERNAL_ERROR);
 			syslog_server(LOG_ERR, "Request: Get track outputs - unable to build reply message");
 		}
 		return OCS_PROCESSED;
@@ -580,7 +599,10 @@ static GString *get_accessory_aspects_json_listonly(const char *acc_id, bool is_
 	append_field_start_of_list(g_aspects_list, "aspects");
 	
 	for (size_t i = 0; i < query.length; i++) {
-		g_string_append_printf(g_aspects_list, "%s\"%s\"", i != 0 ? ", " : "", query.ids[i]);
+		if (i != 0) {
+			g_string_append(g_aspects_list, ", ");
+		}
+		append_str_value(g_aspects_list, query.ids[i]);
 	}
 	append_end_of_list(g_aspects_list, false, false);
 	bidib_free_id_list_query(query);
@@ -667,11 +689,10 @@ static o_con_status get_points_signals_common(onion_request *req, onion_response
 	const char *l_name = points ? "Get points" : "Get signals";
 	if (running && ((onion_request_get_flags(req) & OR_METHODS) == OR_GET)) {
 		GString *g_ret = get_accessories_json(points);
-		if (g_ret != NULL) {
-			send_some_gstring_and_free(res, HTTP_OK, g_ret);
+		if (response_cache_send_validated(req, res, g_ret)) {
 			syslog_server(LOG_INFO, "Request: %s - done", l_name);
 		} else {
-			onion_response_set_code(res, HTTP_INTERNAL_ERROR);
+			set_response_code(res, HTTP_INTERNAL_ERROR);
 			syslog_server(LOG_ERR, 
 			              "Request: %s - unable to build reply message", 
 			              l_name);
@@ -727,7 +748,9 @@ static GString *get_point_details_json(const char *point_id) {
 		return NULL;
 	}
 	
-	g_string_append_printf(g_details, "\n%s,\n", g_aspects_list->str);
+	g_string_append_c(g_details, '\n');
+	g_string_append(g_details, g_aspects_list->str);
+	g_string_append(g_details, ",\n");
 	g_string_free(g_aspects_list, true);
 	
 	// field: state
@@ -785,7 +808,7 @@ o_con_status handler_get_point_details(void *_, onion_request *req, onion_respon
 		if (handle_param_miss_check(res, "Get point details", "point", data_point)) {
 			return OCS_PROCESSED;
 		} else if (!is_type_point(data_point)) {
-			onion_response_set_code(res, HTTP_NOT_FOUND);
+			set_response_code(res, HTTP_NOT_FOUND);
 			return OCS_PROCESSED;
 		}
 		
@@ -794,7 +817,7 @@ o_con_status handler_get_point_details(void *_, onion_request *req, onion_respon
 			send_some_gstring_and_free(res, HTTP_OK, g_details);
 			syslog_server(LOG_INFO, "Request: Get point details - point: %s - done", data_point);
 		} else {
-			onion_response_set_code(res, HTTP_INTERNAL_ERROR);
+			set_response_code(res, HTTP_INTERNAL_ERROR);
 			syslog_server(LOG_ERR, 
 			              "Request: Get point details - point: %s - unable to build reply message", 
 			              data_point);
@@ -841,6 +864,16 @@ static GString *get_accessory_aspects_json(const char *acc_id, bool is_point) {
 	return g_aspects;
 }
 
+typedef struct {
+	const char *acc_id;
+	bool is_point;
+} t_acc_aspects_context;
+
+static GString *build_accessory_aspects_json(void *context) {
+	const t_acc_aspects_context *acc_context = context;
+	return get_accessory_aspects_json(acc_context->acc_id, acc_context->is_point);
+}
+
 static o_con_status get_acc_aspects_common(onion_request *req, onion_response *res, bool point) {
 	build_response_header(res);
 	const char *l_name = point ? "Get point aspects" : "Get signal aspects";
@@ -852,20 +885,25 @@ static o_con_status get_acc_aspects_common(onion_request *req, onion_response *r
 		if (handle_param_miss_check(res, l_name, acc_type_name, data_acc)) {
 			return OCS_PROCESSED;
 		} else if ((point && !is_type_point(data_acc)) || (!point && !is_type_signal(data_acc))) {
-			onion_response_set_code(res, HTTP_NOT_FOUND);
+			set_response_code(res, HTTP_NOT_FOUND);
 			return OCS_PROCESSED;
 		} 
 		
-		GString *g_aspects = get_accessory_aspects_json(data_acc, point);
-		if (g_aspects != NULL) {
-			send_some_gstring_and_free(res, HTTP_OK, g_aspects);
+		// The aspects of an accessory are fixed by the config
+		t_acc_aspects_context context = {.acc_id = data_acc, .is_point = point};
+		GString *g_key = g_string_new("");
+		g_string_printf(g_key, "%s-aspects:%s", acc_type_name, data_acc);
+		const bool sent = response_cache_send(req, res, g_key->str, RESPONSE_CACHE_SCOPE_CONFIG,
+		                                      build_accessory_aspects_json, &context);
+		g_string_free(g_key, true);
+		if (sent) {
 			syslog_server(LOG_INFO, "Request: %s - %s: %s - done", l_name, acc_type_name, data_acc);
 		} else {
 			///NOTE: get_accessory_aspects_json also returns NULL if the input data_acc is NULL,
 			//       and then HTTP_BAD_REQUEST would be the appropriate code. But this case is 
 			//       checked already in the 'if' before the mentioned function is called,
 			//       and for all other cases where it returns NULL, INTERNAL_ERROR is appropriate.
-			onion_response_set_code(res, HTTP_INTERNAL_ERROR);
+			set_response_code(res, HTTP_INTERNAL_ERROR);
 			syslog_server(LOG_ERR, 
 			              "Request: %s - %s: %s - unable to build reply message", 
 			               l_name, acc_type_name, data_acc);
@@ -927,15 +965,16 @@ static GString *get_segments_json() {
 			append_field_start_of_list(g_segments, "occupied-by");
 			for (size_t j = 0; j < seg_state_query.data.dcc_address_cnt; j++) {
 				t_bidib_id_query id_query = bidib_get_train_id(seg_state_query.data.dcc_addresses[j]);
-				g_string_append_printf(g_segments, "%s\"%s\"", 
-				                       j != 0 ? ", " : "", 
-				                       id_query.known ? id_query.id : "unknown");
+				if (j != 0) {
+					g_string_append(g_segments, ", ");
+				}
+				append_str_value(g_segments, id_query.known ? id_query.id : "unknown");
 				bidib_free_id_query(id_query);
 			}
 			// In case we know the segment is occupied, but no addresses are present, the 
 			// loop above won't add "unknown", so deal with this case separately
 			if (seg_state_query.data.dcc_address_cnt == 0) {
-				g_string_append_printf(g_segments, "\"unknown\"");
+				g_string_append(g_segments, "\"unknown\"");
 			}
 			append_end_of_list(g_segments, false, false);
 		}
@@ -957,7 +996,7 @@ o_con_status handler_get_segments(void *_, onion_request *req, onion_response *r
 			send_some_gstring_and_free(res, HTTP_OK, g_segments);
 			syslog_server(LOG_INFO, "Request: Get segments - done");
 		} else {
-			onion_response_set_code(res, HTTP_INTERNAL_ERROR);
+			set_response_code(res, HTTP_INTERNAL_ERROR);
 			syslog_server(LOG_ERR, 
 			              "Request: Get segments - unable to build reply message");
 		}
@@ -1031,7 +1070,7 @@ o_con_status handler_get_reversers(void *_, onion_request *req, onion_response *
 	build_response_header(res);
 	if (running && ((onion_request_get_flags(req) & OR_METHODS) == OR_GET)) {
 		if (!reversers_state_update()) {
-			onion_response_set_code(res, HTTP_INTERNAL_ERROR);
+			set_response_code(res, HTTP_INTERNAL_ERROR);
 			syslog_server(LOG_ERR, "Request: Get reversers - unable to request state update");
 			return OCS_PROCESSED;
 		}
@@ -1040,7 +1079,7 @@ o_con_status handler_get_reversers(void *_, onion_request *req, onion_response *
 			send_some_gstring_and_free(res, HTTP_OK, g_reversers);
 			syslog_server(LOG_INFO, "Request: Get reversers - done");
 		} else {
-			onion_response_set_code(res, HTTP_INTERNAL_ERROR);
+			set_response_code(res, HTTP_INTERNAL_ERROR);
 			syslog_server(LOG_ERR, "Request: Get reversers - unable to build reply message");
 		}
 		return OCS_PROCESSED;
@@ -1105,11 +1144,10 @@ o_con_status handler_get_peripherals(void *_, onion_request *req, onion_response
 	build_response_header(res);
 	if (running && ((onion_request_get_flags(req) & OR_METHODS) == OR_GET)) {
 		GString *g_peripherals = get_peripherals_json();
-		if (g_peripherals != NULL) {
-			send_some_gstring_and_free(res, HTTP_OK, g_peripherals);
+		if (response_cache_send_validated(req, res, g_peripherals)) {
 			syslog_server(LOG_INFO, "Request: Get peripherals - done");
 		} else {
-			onion_response_set_code(res, HTTP_INTERNAL_ERROR);
+			set_response_code(res, HTTP_INTERNAL_ERROR);
 			syslog_server(LOG_ERR, "Request: Get peripherals - unable to build reply message");
 		}
 		return OCS_PROCESSED;
@@ -1121,7 +1159,7 @@ o_con_status handler_get_peripherals(void *_, onion_request *req, onion_response
 o_con_status handler_get_verification_option(void *_, onion_request *req, onion_response *res) {
 	build_response_header(res);
 	if ((onion_request_get_flags(req) & OR_METHODS) == OR_GET) {
-		onion_response_set_code(res, HTTP_OK);
+		set_response_code(res, HTTP_OK);
 		onion_response_printf(res, 
 		                      "{\"verification-enabled\": %s }", 
 		                      verification_enabled ? "true" : "false");
@@ -1135,9 +1173,10 @@ o_con_status handler_get_verification_option(void *_, onion_request *req, onion_
 o_con_status handler_get_verification_url(void *_, onion_request *req, onion_response *res) {
     build_response_header(res);
 	if ((onion_request_get_flags(req) & OR_METHODS) == OR_GET) {
-		const char *verif_url = get_verifier_url();
+		char *verif_url = get_verifier_url();
 		send_single_str_field_feedback(res, HTTP_OK, "verification-url", 
 		                               verif_url == NULL ? "null" : verif_url);
+		free(verif_url);
 		syslog_server(LOG_INFO, "Request: Get verification url - done");
 		return OCS_PROCESSED;
 	} else {
@@ -1166,7 +1205,7 @@ static GString* get_granted_routes_json() {
 	append_start_of_obj(g_granted_routes, false);
 	append_field_start_of_list(g_granted_routes, "granted-routes");
 	
-	pthread_mutex_lock(&interlocker_mutex);
+	request_metrics_mutex_lock(&interlocker_mutex);
 	GArray *route_ids = interlocking_table_get_all_route_ids_shallowcpy();
 	
 	int routes_added = 0;
@@ -1210,7 +1249,7 @@ o_con_status handler_get_granted_routes(void *_, onion_request *req, onion_respo
 			send_some_gstring_and_free(res, HTTP_OK, g_granted_routes);
 			syslog_server(LOG_INFO, "Request: Get granted routes - done");
 		} else {
-			onion_response_set_code(res, HTTP_INTERNAL_ERROR);
+			set_response_code(res, HTTP_INTERNAL_ERROR);
 			syslog_server(LOG_ERR, "Request: Get granted routes - unable to build reply message");
 		}
 		return OCS_PROCESSED;
@@ -1219,6 +1258,247 @@ o_con_status handler_get_granted_routes(void *_, onion_request *req, onion_respo
 	}
 }
 
+static GString *get_scheduler_json(void) {
+	t_fleet_train_stats stats[FLEET_SCHEDULER_TRAIN_COUNT_MAX];
+	unsigned long long elapsed_ms = 0;
+	const unsigned int train_count = fleet_scheduler_get_stats(stats, &elapsed_ms);
+	const float elapsed_h = elapsed_ms / 3600000.0f;
+	
+	GString *g_scheduler = g_string_sized_new(256 + 352 * train_count);
+	g_string_assign(g_scheduler, "");
+	append_start_of_obj(g_scheduler, false);
+	append_field_bool_value(g_scheduler, "active", fleet_scheduler_is_active(), true);
+	append_field_uint_value(g_scheduler, "elapsed_ms", (unsigned int) elapsed_ms, true);
+	
+	unsigned long long stops_reached_total = 0;
+	append_field_start_of_list(g_scheduler, "trains");
+	for (unsigned int i = 0; i < train_count; i++) {
+		const t_fleet_train_stats *train_stats = &stats[i];
+		stops_reached_total += train_stats->stops_reached;
+		append_start_of_obj(g_scheduler, true);
+		append_field_str_value(g_scheduler, "train", train_stats->train_id, true);
+		append_field_int_value(g_scheduler, "priority", train_stats->priority, true);
+		append_field_bool_value(g_scheduler, "active", train_stats->active, true);
+		append_field_uint_value(g_scheduler, "stops_reached", 
+		                        (unsigned int) train_stats->stops_reached, true);
+		append_field_float_value(g_scheduler, "stops_per_hour", 
+		                         elapsed_h > 0.0f ? train_stats->stops_reached / elapsed_h : 0.0f, 
+		                         true);
+		append_field_uint_value(g_scheduler, "routes_driven", 
+		                        (unsigned int) train_stats->routes_driven, true);
+		append_field_uint_value(g_scheduler, "grant_refusals", 
+		                        (unsigned int) train_stats->grant_refusals, true);
+		append_field_uint_value(g_scheduler, "precedence_yields", 
+		                        (unsigned int) train_stats->precedence_yields, true);
+		append_field_uint_value(g_scheduler, "plan_failures", 
+		                        (unsigned int) train_stats->plan_failures, true);
+		append_field_uint_value(g_scheduler, "wait_ms_total", 
+		                        (unsigned int) train_stats->wait_ms_total, true);
+		append_field_uint_value(g_scheduler, "wait_ms_max", 
+		                        (unsigned int) train_stats->wait_ms_max, true);
+		append_field_uint_value(g_scheduler, "drive_ms_total", 
+		                        (unsigned int) train_stats->drive_ms_total, false);
+		append_end_of_obj(g_scheduler, i + 1 < train_count);
+	}
+	append_end_of_list(g_scheduler, true, train_count > 0);
+	append_field_float_value(g_scheduler, "stops_per_hour", 
+	                         elapsed_h > 0.0f ? stops_reached_total / elapsed_h : 0.0f, false);
+	append_end_of_obj(g_scheduler, false);
+	return g_scheduler;
+}
+
+o_con_status handler_get_scheduler(void *_, onion_request *req, onion_response *res) {
+	build_response_header(res);
+	if (running && ((onion_request_get_flags(req) & OR_METHODS) == OR_GET)) {
+		GString *g_scheduler = get_scheduler_json();
+		send_some_gstring_and_free(res, HTTP_OK, g_scheduler);
+		syslog_server(LOG_INFO, "Request: Get scheduler - done");
+		return OCS_PROCESSED;
+	} else {
+		return handle_req_run_or_method_fail(res, running, "Get scheduler");
+	}
+}
+
+o_con_status handler_get_state_stream(void *_, onion_request *req, onion_response *res) {
+	build_response_header(res);
+	if (running && ((onion_request_get_flags(req) & OR_METHODS) == OR_GET)) {
+		syslog_server(LOG_INFO, "Request: Get state stream - start");
+		if (state_stream_serve(res)) {
+			syslog_server(LOG_INFO, "Request: Get state stream - client disconnected - finish");
+		} else {
+			send_common_feedback(res, HTTP_SERVICE_UNAVAILABLE, 
+			                     "maximum number of state stream clients reached");
+			syslog_server(LOG_WARNING, 
+			              "Request: Get state stream - maximum number of clients reached - abort");
+		}
+		return OCS_PROCESSED;
+	} else {
+		return handle_req_run_or_method_fail(res, running, "Get state stream");
+	}
+}
+
+typedef struct {
+	GString *(*build)(void);
+	const char *name;
+} t_snapshot_section;
+
+static GString *get_points_json(void) {
+	return get_accessories_json(true);
+}
+
+static GString *get_signals_json(void) {
+	return get_accessories_json(false);
+}
+
+// Sections of the world snapshot, in the order in which they are captured
+static const t_snapshot_section snapshot_sections[] = {
+	{get_segments_json, "segments"},
+	{get_train_states_json, "train-states"},
+	{get_reversers_json, "reversers"},
+	{get_points_json, "points"},
+	{get_signals_json, "signals"},
+	{get_granted_routes_json, "granted-routes"},
+	{get_track_outputs_json, "track-outputs"}
+};
+#define SNAPSHOT_SECTION_COUNT (sizeof(snapshot_sections) / sizeof(snapshot_sections[0]))
+
+// Mutex to lock when capturing a snapshot, so that captures do not interleave
+static pthread_mutex_t snapshot_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Number of captures in which at least one section changed
+static unsigned int snapshot_generation = 0;
+// Generation in which each section last changed, and its content at that time
+static unsigned int snapshot_section_generations[SNAPSHOT_SECTION_COUNT] = {0};
+static GString *snapshot_section_contents[SNAPSHOT_SECTION_COUNT] = {NULL};
+
+/**
+ * @brief Captures all sections of the world snapshot back to back, and increments 
+ * the snapshot generation if any section changed since the last capture.
+ * Each section is the content of its own monitor endpoint. 
+ * 
+ * @param since generation the client already has; sections that did not change since
+ * are omitted. Pass 0 (or an unknown generation) to get all sections.
+ * @return GString* containing the generation and the changed sections in json format.
+ * Returns NULL if a section could not be built.
+ */
+static GString *get_snapshot_json(unsigned int since) {
+	GString *sections[SNAPSHOT_SECTION_COUNT] = {NULL};
+	
+	pthread_mutex_lock(&snapshot_mutex);
+	for (size_t i = 0; i < SNAPSHOT_SECTION_COUNT; i++) {
+		sections[i] = snapshot_sections[i].build();
+		if (sections[i] == NULL) {
+			pthread_mutex_unlock(&snapshot_mutex);
+			syslog_server(LOG_ERR, "Get snapshot json - unable to build section %s", 
+			              snapshot_sections[i].name);
+			for (size_t j = 0; j < i; j++) {
+				g_string_free(sections[j], true);
+			}
+			return NULL;
+		}
+	}
+	bool changed = false;
+	for (size_t i = 0; i < SNAPSHOT_SECTION_COUNT; i++) {
+		if (snapshot_section_contents[i] == NULL 
+		    || !g_string_equal(snapshot_section_contents[i], sections[i])) {
+			changed = true;
+			break;
+		}
+	}
+	if (changed) {
+		snapshot_generation++;
+		for (size_t i = 0; i < SNAPSHOT_SECTION_COUNT; i++) {
+			if (snapshot_section_contents[i] == NULL 
+			    || !g_string_equal(snapshot_section_contents[i], sections[i])) {
+				if (snapshot_section_contents[i] != NULL) {
+					g_string_free(snapshot_section_contents[i], true);
+				}
+				snapshot_section_contents[i] = g_string_new(sections[i]->str);
+				snapshot_section_generations[i] = snapshot_generation;
+			}
+		}
+	}
+	const unsigned int generation = snapshot_generation;
+	unsigned int section_generations[SNAPSHOT_SECTION_COUNT];
+	memcpy(section_generations, snapshot_section_generations, sizeof(section_generations));
+	pthread_mutex_unlock(&snapshot_mutex);
+	
+	// A generation that is unknown, e.g., from before a server restart, gets all sections
+	const bool complete = since == 0 || since > generation;
+	GString *g_snapshot = g_string_sized_new(256);
+	g_string_assign(g_snapshot, "");
+	append_start_of_obj(g_snapshot, false);
+	append_field_uint_value(g_snapshot, "generation", generation, true);
+	append_field_bool_value(g_snapshot, "complete", complete, false);
+	for (size_t i = 0; i < SNAPSHOT_SECTION_COUNT; i++) {
+		if (complete || section_generations[i] > since) {
+			// Merge the section's object "{\n...\n}" into the snapshot object
+			g_string_append_c(g_snapshot, ',');
+			g_string_append_len(g_snapshot, sections[i]->str + 1, sections[i]->len - 3);
+		}
+		g_string_free(sections[i], true);
+	}
+	append_end_of_obj(g_snapshot, false);
+	return g_snapshot;
+}
+
+o_con_status handler_get_snapshot(void *_, onion_request *req, onion_response *res) {
+	build_response_header(res);
+	///NOTE: uses POST instead of GET to allow parameter passing via POST dict/data
+	if (running && ((onion_request_get_flags(req) & OR_METHODS) == OR_POST)) {
+		const char *data_since = onion_request_get_post(req, "since");
+		unsigned int since = 0;
+		if (data_since != NULL) {
+			if (!params_check_is_number(data_since)) {
+				send_common_feedback(res, HTTP_BAD_REQUEST, "invalid generation");
+				syslog_server(LOG_ERR, "Request: Get snapshot - invalid generation");
+				return OCS_PROCESSED;
+			}
+			since = (unsigned int) strtoul(data_since, NULL, 10);
+		}
+		GString *g_snapshot = get_snapshot_json(since);
+		if (g_snapshot != NULL) {
+			send_some_gstring_and_free(res, HTTP_OK, g_snapshot);
+			syslog_server(LOG_INFO, "Request: Get snapshot - since: %u - done", since);
+		} else {
+			set_response_code(res, HTTP_INTERNAL_ERROR);
+			syslog_server(LOG_ERR, "Request: Get snapshot - unable to build reply message");
+		}
+		return OCS_PROCESSED;
+	} else {
+		return handle_req_run_or_method_fail(res, running, "Get snapshot");
+	}
+}
+
+static GString *get_engines_json(void) {
+	return get_engines_or_interlockers_json(true);
+}
+
+static GString *get_interlockers_json(void) {
+	return get_engines_or_interlockers_json(false);
+}
+
+// Replies that can be built by name, in addition to the snapshot sections
+static const t_snapshot_section named_replies[] = {
+	{get_trains_json, "trains"},
+	{get_peripherals_json, "peripherals"},
+	{get_engines_json, "engines"},
+	{get_interlockers_json, "interlockers"}
+};
+
+GString *monitor_reply_json(const char *endpoint) {
+	for (size_t i = 0; i < SNAPSHOT_SECTION_COUNT; i++) {
+		if (strcmp(endpoint, snapshot_sections[i].name) == 0) {
+			return snapshot_sections[i].build();
+		}
+	}
+	for (size_t i = 0; i < sizeof(named_replies) / sizeof(named_replies[0]); i++) {
+		if (strcmp(endpoint, named_replies[i].name) == 0) {
+			return named_replies[i].build();
+		}
+	}
+	return NULL;
+}
+
 /**
  * @brief Get information on a particular route, specified by the parameter route_id.
  * The returned string is formatted to comply with the json-schema: 
@@ -1238,7 +1518,7 @@ static GString* get_route_json(const char *route_id) {
 	if (route_id == NULL) {
 		return NULL;
 	}
-	pthread_mutex_lock(&interlocker_mutex);
+	request_metrics_mutex_lock(&interlocker_mutex);
 	const t_interlocking_route *route = get_route(route_id);
 	if (route == NULL) {
 		pthread_mutex_unlock(&interlocker_mutex);
@@ -1309,7 +1589,7 @@ o_con_status handler_get_route(void *_, onion_request *req, onion_response *res)
 		if (handle_param_miss_check(res, "Get route", "route-id", data_route_id)) {
 			return OCS_PROCESSED;
 		} else if (strcmp(route_id, "") == 0 || get_route(route_id) == NULL) {
-			onion_response_set_code(res, HTTP_NOT_FOUND);
+			set_response_code(res, HTTP_NOT_FOUND);
 			syslog_server(LOG_ERR, "Request: Get route - unknown route-id");
 			return OCS_PROCESSED;
 		}
@@ -1320,7 +1600,7 @@ o_con_status handler_get_route(void *_, onion_request *req, onion_response *res)
 			send_some_gstring_and_free(res, HTTP_OK, g_route);
 			syslog_server(LOG_INFO, "Request: Get route - route: %s - finished", route_id);
 		} else {
-			onion_response_set_code(res, HTTP_INTERNAL_ERROR);
+			set_response_code(res, HTTP_INTERNAL_ERROR);
 			syslog_server(LOG_ERR, 
 			              "Request: Get route - route: %s - invalid route-id or internal error", 
 			              route_id);
@@ -1331,6 +1611,71 @@ o_con_status handler_get_route(void *_, onion_request *req, onion_response *res)
 	}
 }
 
+// Available also while the system is not running, so that scraping does not fail
+o_con_status handler_get_metrics(void *_, onion_request *req, onion_response *res) {
+	build_response_header(res);
+	if ((onion_request_get_flags(req) & OR_METHODS) == OR_GET) {
+		onion_response_set_header(res, "Content-Type", "text/plain; version=0.0.4");
+		GString *metrics = request_metrics_prometheus();
+		request_lanes_append_prometheus(metrics);
+		command_journal_append_prometheus(metrics);
+		memory_footprint_append_prometheus(metrics);
+		send_some_gstring_and_free(res, HTTP_OK, metrics);
+		syslog_server(LOG_INFO, "Request: Get metrics - done");
+		return OCS_PROCESSED;
+	} else {
+		return handle_req_run_or_method_fail(res, true, "Get metrics");
+	}
+}
+
+static GString *get_memory_json(void) {
+	t_memory_usage usages[MEMORY_SUBSYSTEM_COUNT];
+	memory_footprint_get(usages);
+	
+	GString *g_memory = g_string_sized_new(128 + 96 * MEMORY_SUBSYSTEM_COUNT);
+	g_string_assign(g_memory, "");
+	append_start_of_obj(g_memory, false);
+	size_t accounted_bytes = 0;
+	append_field_start_of_list(g_memory, "subsystems");
+	for (int i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++) {
+		accounted_bytes += usages[i].bytes;
+		append_start_of_obj(g_memory, true);
+		append_field_str_value(g_memory, "subsystem", memory_footprint_subsystem_name(i), true);
+		append_field_ulonglong_value(g_memory, "bytes", usages[i].bytes, true);
+		append_field_ulonglong_value(g_memory, "peak_bytes", usages[i].peak_bytes, false);
+		append_end_of_obj(g_memory, i + 1 < MEMORY_SUBSYSTEM_COUNT);
+	}
+	append_end_of_list(g_memory, true, true);
+	append_field_ulonglong_value(g_memory, "accounted_bytes", accounted_bytes, true);
+	append_field_ulonglong_value(g_memory, "resident_bytes", memory_footprint_rss(), false);
+	append_end_of_obj(g_memory, false);
+	return g_memory;
+}
+
+// Available also while the system is not running, to compare the footprint after a shutdown
+o_con_status handler_get_memory(void *_, onion_request *req, onion_response *res) {
+	build_response_header(res);
+	if ((onion_request_get_flags(req) & OR_METHODS) == OR_GET) {
+		send_some_gstring_and_free(res, HTTP_OK, get_memory_json());
+		syslog_server(LOG_INFO, "Request: Get memory - done");
+		return OCS_PROCESSED;
+	} else {
+		return handle_req_run_or_method_fail(res, true, "Get memory");
+	}
+}
+
+o_con_status handler_get_bidib_messages(void *_, onion_request *req, onion_response *res) {
+	build_response_header(res);
+	if (running && ((onion_request_get_flags(req) & OR_METHODS) == OR_GET)) {
+		onion_response_set_header(res, "Content-Type", "text/plain");
+		send_some_gstring_and_free(res, HTTP_OK, bidib_messages_render());
+		syslog_server(LOG_INFO, "Request: Get BiDiB messages - done");
+		return OCS_PROCESSED;
+	} else {
+		return handle_req_run_or_method_fail(res, running, "Get BiDiB messages");
+	}
+}
+
 // Returns debugging information related to the ForeC dynamic containers.
 // Provides data values seen by the environment (dyn_containers_interface.c)
 // and those set by the containers (dyn_containers.forec).
@@ -1349,6 +1694,25 @@ static GString *debug_info(void) {
 		dyn_containers_actuate_reaction_counter
 	);
 	
+	t_emergency_stop_stats emergency_stop_stats;
+	emergency_stop_get_stats(&emergency_stop_stats);
+	const char info_template_emergency_stop[] = 
+	    "Emergency stops: \n"
+	    "* count: %llu \n"
+	    "* latency last: %llu ns \n"
+	    "* latency max: %llu ns \n"
+	    "* latency avg: %llu ns \n"
+	    "\n";
+	
+	g_string_append_printf(
+		info_str, info_template_emergency_stop, 
+		emergency_stop_stats.count,
+		emergency_stop_stats.latency_last_ns,
+		emergency_stop_stats.latency_max_ns,
+		emergency_stop_stats.count > 0 
+		 ? emergency_stop_stats.latency_total_ns / emergency_stop_stats.count : 0
+	);
+	
 	const char info_template1[] = 
 	    "dyn_containers_interface: (external value, internal value) \n"
 	    "  running: %d \n"
@@ -1419,6 +1783,7 @@ static GString *debug_info(void) {
 	    "    output_train_engine_type: %d, %d \n"
 	    "    output_nominal_speed: %d, %d \n"
 	    "    output_nominal_forwards: %d, %d \n"
+	    "    speed requests posted: %llu, superseded: %llu \n"
 	    "  \n";
 	
 	t_forec_intern_input_train_engine_instance__global_0_0 
@@ -1438,6 +1803,9 @@ static GString *debug_info(void) {
 		&forec_intern_output_train_engine_instance_4__global_0_0.value,
 	};
 	for (int i = 0; i < TRAIN_ENGINE_INSTANCE_COUNT_MAX; i++) {
+		unsigned long long speeds_posted = 0;
+		unsigned long long speeds_superseded = 0;
+		dyn_containers_get_speed_mailbox_stats(i, &speeds_posted, &speeds_superseded);
 		g_string_append_printf(
 			info_str, info_template3,
 			i,
@@ -1467,7 +1835,9 @@ static GString *debug_info(void) {
 			forec_intern_output_train_engine_instance[i]->nominal_speed,
 			
 			dyn_containers_interface->train_engine_instances_io[i].output_nominal_forwards,
-			forec_intern_output_train_engine_instance[i]->nominal_forwards
+			forec_intern_output_train_engine_instance[i]->nominal_forwards,
+			
+			speeds_posted, speeds_superseded
 		);
 	}
 	
@@ -1482,7 +1852,7 @@ o_con_status handler_get_debug_info(void *_, onion_request *req, onion_response
 			send_some_gstring_and_free(res, HTTP_OK, debug_info_str);
 			syslog_server(LOG_NOTICE, "Request: Get debug info - done");
 		} else {
-			onion_response_set_code(res, HTTP_INTERNAL_ERROR);
+			set_response_code(res, HTTP_INTERNAL_ERROR);
 			syslog_server(LOG_ERR, "Request: Get debug info - internal error");
 		}
 		return OCS_PROCESSED;
@@ -1521,7 +1891,7 @@ o_con_status handler_get_debug_info_extra(void *_, onion_request *req, onion_res
 			send_some_gstring_and_free(res, HTTP_OK, debug_info_extra_str);
 			syslog_server(LOG_NOTICE, "Request: Get debug info extra");
 		} else {
-			onion_response_set_code(res, HTTP_INTERNAL_ERROR);
+			set_response_code(res, HTTP_INTERNAL_ERROR);
 			syslog_server(LOG_ERR, "Request: Get debug info extra - internal error");
 		}
 		return OCS_PROCESSED;
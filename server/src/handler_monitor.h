@@ -28,6 +28,7 @@
 #ifndef HANDLER_MONITOR_H
 #define HANDLER_MONITOR_H
 
+#include <glib.h>
 #include <onion/onion.h>
 #include "dyn_containers_interface.h"
 #include "dyn_containers.h"
@@ -78,11 +79,34 @@ o_con_status handler_get_verification_url(void *_, onion_request *req, onion_res
 
 o_con_status handler_get_granted_routes(void *_, onion_request *req, onion_response *res);
 
+o_con_status handler_get_scheduler(void *_, onion_request *req, onion_response *res);
+
+o_con_status handler_get_state_stream(void *_, onion_request *req, onion_response *res);
+
+o_con_status handler_get_snapshot(void *_, onion_request *req, onion_response *res);
+
 o_con_status handler_get_route(void *_, onion_request *req, onion_response *res);
 
+o_con_status handler_get_metrics(void *_, onion_request *req, onion_response *res);
+
+o_con_status handler_get_memory(void *_, onion_request *req, onion_response *res);
+
+o_con_status handler_get_bidib_messages(void *_, onion_request *req, onion_response *res);
+
 o_con_status handler_get_debug_info(void *_, onion_request *req, onion_response *res);
 
 o_con_status handler_get_debug_info_extra(void *_, onion_request *req, onion_response *res);
 
+/**
+ * @brief Builds the json reply of a monitor endpoint without a request, 
+ * e.g., for benchmarking how it is built and encoded.
+ * 
+ * @param endpoint name of a snapshot section (see handler_get_snapshot), 
+ * or one of "trains", "peripherals", "engines" and "interlockers"
+ * @return GString* containing the reply in json format.
+ * Returns NULL if the endpoint is unknown or its reply could not be built.
+ */
+GString *monitor_reply_json(const char *endpoint);
+
 #endif  // HANDLER_MONITOR_H
 
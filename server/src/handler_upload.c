@@ -33,14 +33,21 @@
 #include <limits.h>
 #include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
 #include <unistd.h>
 
 #include "handler_upload.h"
 #include "server.h"
-#include "dynlib.h"
 #include "dyn_containers_interface.h"
-#include "websocket_uploader/engine_uploader.h"
+#include "upload_pipeline.h"
+#include "param_verification.h"
 #include "communication_utils.h"
+#include "json_response_builder.h"
+#include "response_cache.h"
+#include "request_metrics.h"
+#include "checkpoint.h"
+#include "command_journal.h"
 
 typedef onion_connection_status o_con_status;
 
@@ -120,7 +127,7 @@ static bool engine_file_exists(const char filename[]) {
 	return false;
 }
 
-static bool remove_engine_files(const char library_name[]) {
+bool remove_engine_files(const char library_name[]) {
 	// Remove the prefix "lib"
 	char name[PATH_MAX + NAME_MAX];
 	strcpy(name, library_name + 3);
@@ -141,6 +148,64 @@ static bool plugin_is_unremovable(const char name[]) {
 	return (strstr(name, "(unremovable)") != NULL);
 }
 
+// Sends the result of a finished upload, or the failure of an unknown upload
+static void send_upload_result(onion_response *res, const t_upload_status *status, 
+                               bool is_known) {
+	if (!is_known) {
+		send_common_feedback(res, HTTP_INTERNAL_ERROR, "upload result is no longer available");
+	} else if (status->status_code == HTTP_OK) {
+		set_response_code(res, HTTP_OK);
+	} else if (status->message != NULL && status->message_is_json) {
+		// If the reply message (from the verification server) is in JSON format, 
+		// send it directly -> the OpenAPI spec conformance thus relies on the 
+		// verification server adhering to the spec.
+		send_some_gstring_and_free(res, status->status_code, status->message);
+		return;
+	} else {
+		send_common_feedback(res, status->status_code, 
+		                     status->message != NULL ? status->message->str : "upload failed");
+	}
+	if (is_known && status->message != NULL) {
+		g_string_free(status->message, true);
+	}
+}
+
+// Queues the upload, and replies with its id if is_async, otherwise with its result
+static o_con_status submit_upload(onion_response *res, const t_upload_request *upload, 
+                                  bool is_async, const char *request_name) {
+	const unsigned int upload_id = upload_pipeline_submit(upload);
+	if (upload_id == 0) {
+		if (upload->kind == UPLOAD_ENGINE) {
+			remove_engine_files(upload->libname);
+		} else {
+			remove_interlocker_files(upload->libname);
+		}
+		send_common_feedback(res, HTTP_SERVICE_UNAVAILABLE, "upload queue is full");
+		syslog_server(LOG_WARNING, "Request: %s - file: %s - upload queue is full - abort", 
+		              request_name, upload->filename);
+		return OCS_PROCESSED;
+	}
+	
+	if (is_async) {
+		command_journal_record_assigned_id("upload-id", upload_id);
+		GString *g_feedback = g_string_sized_new(32);
+		append_start_of_obj(g_feedback, false);
+		append_field_uint_value(g_feedback, "upload-id", upload_id, false);
+		append_end_of_obj(g_feedback, false);
+		send_some_gstring_and_free(res, CUSTOM_HTTP_CODE_ACCEPTED, g_feedback);
+		syslog_server(LOG_NOTICE, "Request: %s - file: %s - queued as upload %u - finish", 
+		              request_name, upload->filename, upload_id);
+		return OCS_PROCESSED;
+	}
+	
+	t_upload_status status;
+	const bool is_known = upload_pipeline_get_status(upload_id, true, &status);
+	send_upload_result(res, &status, is_known);
+	syslog_server(LOG_NOTICE, "Request: %s - file: %s - finish with %d", 
+	              request_name, upload->filename, is_known ? status.status_code : -1);
+	return OCS_PROCESSED;
+}
+
 
 o_con_status handler_upload_engine(void *_, onion_request *req, onion_response *res) {
 	build_response_header(res);
@@ -151,6 +216,7 @@ o_con_status handler_upload_engine(void *_, onion_request *req, onion_response *
 		// like the client has to provide both a file and the filename.
 		const char *filename = onion_request_get_post(req, "file");
 		const char *temp_filepath = onion_request_get_file(req, "file");
+		const char *data_async = onion_request_get_post(req, "async");
 		
 		if (handle_param_miss_check(res, "Upload engine", "file", filename)) {
 			return OCS_PROCESSED;
@@ -159,7 +225,12 @@ o_con_status handler_upload_engine(void *_, onion_request *req, onion_response *
 			send_common_feedback(res, HTTP_BAD_REQUEST, "engine file is invalid or missing");
 			syslog_server(LOG_ERR, "Request: Upload engine - engine file is invalid or missing");
 			return OCS_PROCESSED;
+		} else if (data_async != NULL && !params_check_is_bool_string(data_async)) {
+			send_common_feedback(res, HTTP_BAD_REQUEST, "invalid async");
+			syslog_server(LOG_ERR, "Request: Upload engine - invalid async (%s)", data_async);
+			return OCS_PROCESSED;
 		}
+		const bool is_async = data_async != NULL && strcasecmp("true", data_async) == 0;
 		
 		syslog_server(LOG_NOTICE, "Request: Upload engine - engine file: %s - start", filename);
 		
@@ -184,68 +255,12 @@ o_con_status handler_upload_engine(void *_, onion_request *req, onion_response *
 		              "Request: Upload engine - engine file: %s - copied engine file from %s to %s", 
 		              filename, temp_filepath, final_filepath);
 		
-		if (verification_enabled) {
-			verif_result engine_verif_result = verify_engine_model(final_filepath);
-			if (!engine_verif_result.success) {
-				// Stop upload if verification did not succeed
-				syslog_server(LOG_NOTICE, "Request: Upload Engine - engine verification failed - abort");
-				remove_engine_files(libname);
-				// If the reply message (from the verification server) is NOT in json format,
-				// send it via common_feedback; if it IS in JSON format, send it directly.
-				// -> the OpenAPI spec conformance thus relies on the verification server
-				//    adhering to the spec, which is fragile, but all other options would be
-				//    quite complicated.
-				// If there's no message, reason for verification failure is unknown.
-				if (engine_verif_result.message != NULL && !engine_verif_result.message_is_json_str) {
-					send_common_feedback(res, HTTP_BAD_REQUEST, engine_verif_result.message->str);
-					g_string_free(engine_verif_result.message, true);
-				} else if (engine_verif_result.message != NULL && engine_verif_result.message_is_json_str) {
-					send_some_gstring_and_free(res, HTTP_BAD_REQUEST, engine_verif_result.message);
-				} else {
-					send_common_feedback(res, HTTP_BAD_REQUEST, 
-					                     "verification failed due to unknown reason");
-				}
-				return OCS_PROCESSED;
-			}
-		}
-		
-		char filepath[sizeof(final_filepath)];
-		remove_file_extension(filepath, final_filepath, ".sctx");
-		const dynlib_status status = dynlib_compile_scchart(filepath, engine_dir);
-		if (status == DYNLIB_COMPILE_SCCHARTS_C_ERR || status == DYNLIB_COMPILE_SHARED_SCCHARTS_ERR) {
-			remove_engine_files(libname);
-			
-			send_common_feedback(res, HTTP_INTERNAL_ERROR, "engine file could not be compiled");
-			syslog_server(LOG_ERR, 
-			              "Request: Upload engine - engine file: %s - could not be "
-			              "compiled into a C file and then to a shared library - abort", 
-			              filepath);
-			return OCS_PROCESSED;
-		}
-		syslog_server(LOG_DEBUG, 
-		              "Request: Upload engine - engine file: %s - engine compiled",
-		              filename);
-		
-		pthread_mutex_lock(&dyn_containers_mutex);
-		const int engine_slot = dyn_containers_get_free_engine_slot();
-		if (engine_slot < 0) {
-			pthread_mutex_unlock(&dyn_containers_mutex);
-			remove_engine_files(libname);
-			
-			send_common_feedback(res, CUSTOM_HTTP_CODE_CONFLICT, "No available engine slot");
-			syslog_server(LOG_WARNING, 
-			              "Request: Upload engine - engine file: %s - "
-			              "no available engine slot - abort", 
-			              filename);
-			return OCS_PROCESSED;
-		}
-		
-		snprintf(filepath, sizeof(filepath), "%s/%s", engine_dir, libname);
-		dyn_containers_set_engine(engine_slot, filepath);
-		pthread_mutex_unlock(&dyn_containers_mutex);
-		onion_response_set_code(res, HTTP_OK);
-		syslog_server(LOG_NOTICE, "Request: Upload engine - engine file: %s - finish", filename);
-		return OCS_PROCESSED;
+		t_upload_request upload = { .kind = UPLOAD_ENGINE };
+		snprintf(upload.filename, sizeof(upload.filename), "%s", filename);
+		snprintf(upload.output_dir, sizeof(upload.output_dir), "%s", engine_dir);
+		remove_file_extension(upload.model_path, final_filepath, ".sctx");
+		snprintf(upload.libname, sizeof(upload.libname), "%s", libname);
+		return submit_upload(res, &upload, is_async, "Upload engine");
 	} else {
 		return handle_req_run_or_method_fail(res, running, "Upload engine");
 	}
@@ -268,7 +283,7 @@ o_con_status handler_remove_engine(void *_, onion_request *req, onion_response *
 		
 		syslog_server(LOG_NOTICE, "Request: Remove engine - engine: %s - start", name);
 		
-		pthread_mutex_lock(&dyn_containers_mutex);
+		request_metrics_mutex_lock(&dyn_containers_mutex);
 		const int engine_slot = dyn_containers_get_engine_slot(name);
 		if (engine_slot < 0) {
 			pthread_mutex_unlock(&dyn_containers_mutex);
@@ -289,12 +304,14 @@ o_con_status handler_remove_engine(void *_, onion_request *req, onion_response *
 			return OCS_PROCESSED;
 		}
 		
+		response_cache_invalidate(RESPONSE_CACHE_SCOPE_ENGINES);
+		checkpoint_clear_plugin(UPLOAD_ENGINE, name);
 		if (!remove_engine_files(name)) {
 			syslog_server(LOG_WARNING, 
 			              "Request: Remove engine - engine: %s - files could not be removed", 
 			              name);
 		}
-		onion_response_set_code(res, HTTP_OK);
+		set_response_code(res, HTTP_OK);
 		syslog_server(LOG_NOTICE, "Request: Remove engine - engine: %s - finish", name);
 		return OCS_PROCESSED;
 	} else {
@@ -322,7 +339,7 @@ static bool interlocker_file_exists(const char filename[]) {
 	return false;
 }
 
-static bool remove_interlocker_files(const char library_name[]) {
+bool remove_interlocker_files(const char library_name[]) {
 	// Remove the prefix "libinterlocker_"
 	char name[PATH_MAX + NAME_MAX];
 	strcpy(name, library_name + 15);
@@ -344,6 +361,7 @@ o_con_status handler_upload_interlocker(void *_, onion_request *req, onion_respo
 	if (running && ((onion_request_get_flags(req) & OR_METHODS) == OR_POST)) {
 		const char *filename = onion_request_get_post(req, "file");
 		const char *temp_filepath = onion_request_get_file(req, "file");
+		const char *data_async = onion_request_get_post(req, "async");
 		
 		if (handle_param_miss_check(res, "Upload interlocker", "file", filename)) {
 			return OCS_PROCESSED;
@@ -353,7 +371,12 @@ o_con_status handler_upload_interlocker(void *_, onion_request *req, onion_respo
 			syslog_server(LOG_ERR, 
 			              "Request: Upload interlocker - interlocker file is invalid or missing");
 			return OCS_PROCESSED;
+		} else if (data_async != NULL && !params_check_is_bool_string(data_async)) {
+			send_common_feedback(res, HTTP_BAD_REQUEST, "invalid async");
+			syslog_server(LOG_ERR, "Request: Upload interlocker - invalid async (%s)", data_async);
+			return OCS_PROCESSED;
 		}
+		const bool is_async = data_async != NULL && strcasecmp("true", data_async) == 0;
 		
 		syslog_server(LOG_NOTICE, 
 		              "Request: Upload interlocker - interlocker file: %s - start", 
@@ -381,44 +404,12 @@ o_con_status handler_upload_interlocker(void *_, onion_request *req, onion_respo
 		              "copied interlocker BahnDSL file from %s to %s",
 		              filename, temp_filepath, final_filepath);
 		
-		char filepath[sizeof(final_filepath)];
-		remove_file_extension(filepath, final_filepath, ".bahn");
-		const dynlib_status status = dynlib_compile_bahndsl(filepath, interlocker_dir);
-		if (status == DYNLIB_COMPILE_SHARED_BAHNDSL_ERR) {
-			send_common_feedback(res, HTTP_INTERNAL_ERROR, "interlocker file could not be compiled");
-			syslog_server(LOG_ERR, 
-			              "Request: Upload interlocker - interlocker file: %s - "
-			              "interlocker could not be compiled - abort", 
-			              filename);
-			remove_interlocker_files(libname);
-			return OCS_PROCESSED;
-		}
-		syslog_server(LOG_DEBUG, 
-		              "Request: Upload interlocker - interlocker file: %s - interlocker compiled", 
-		              filename);
-		
-		pthread_mutex_lock(&dyn_containers_mutex);
-		const int interlocker_slot = dyn_containers_get_free_interlocker_slot();
-		if (interlocker_slot < 0) {
-			pthread_mutex_unlock(&dyn_containers_mutex);
-			remove_interlocker_files(libname);
-			
-			send_common_feedback(res, CUSTOM_HTTP_CODE_CONFLICT, "no interlocker slot available");
-			syslog_server(LOG_WARNING, 
-			              "Request: Upload interlocker - interlocker file: %s - "
-			              "no available interlocker slot - abort", 
-			              filename);
-			return OCS_PROCESSED;
-		}
-		
-		snprintf(filepath, sizeof(filepath), "%s/%s", interlocker_dir, libname);
-		dyn_containers_set_interlocker(interlocker_slot, filepath);
-		pthread_mutex_unlock(&dyn_containers_mutex);
-		onion_response_set_code(res, HTTP_OK);
-		syslog_server(LOG_NOTICE, 
-		              "Request: Upload interlocker - interlocker file: %s - finish",
-		              filename);
-		return OCS_PROCESSED;
+		t_upload_request upload = { .kind = UPLOAD_INTERLOCKER };
+		snprintf(upload.filename, sizeof(upload.filename), "%s", filename);
+		snprintf(upload.output_dir, sizeof(upload.output_dir), "%s", interlocker_dir);
+		remove_file_extension(upload.model_path, final_filepath, ".bahn");
+		snprintf(upload.libname, sizeof(upload.libname), "%s", libname);
+		return submit_upload(res, &upload, is_async, "Upload interlocker");
 	} else {
 		return handle_req_run_or_method_fail(res, running, "Upload interlocker");
 	}
@@ -441,7 +432,7 @@ o_con_status handler_remove_interlocker(void *_, onion_request *req, onion_respo
 		
 		syslog_server(LOG_NOTICE, "Request: Remove interlocker - interlocker: %s - start", name);
 		
-		pthread_mutex_lock(&dyn_containers_mutex);
+		request_metrics_mutex_lock(&dyn_containers_mutex);
 		const int interlocker_slot = dyn_containers_get_interlocker_slot(name);
 		if (interlocker_slot < 0) {
 			pthread_mutex_unlock(&dyn_containers_mutex);
@@ -464,13 +455,15 @@ o_con_status handler_remove_interlocker(void *_, onion_request *req, onion_respo
 			return OCS_PROCESSED;
 		}
 		
+		response_cache_invalidate(RESPONSE_CACHE_SCOPE_INTERLOCKERS);
+		checkpoint_clear_plugin(UPLOAD_INTERLOCKER, name);
 		if (!remove_interlocker_files(name)) {
 			syslog_server(LOG_WARNING, 
 			              "Request: Remove interlocker - interlocker: %s - "
 			              "files could not be removed", 
 			              name);
 		}
-		onion_response_set_code(res, HTTP_OK);
+		set_response_code(res, HTTP_OK);
 		syslog_server(LOG_NOTICE, 
 		              "Request: Remove interlocker - interlocker: %s - finish",
 		              name);
@@ -479,3 +472,56 @@ o_con_status handler_remove_interlocker(void *_, onion_request *req, onion_respo
 		return handle_req_run_or_method_fail(res, running, "Remove interlocker");
 	}
 }
+
+o_con_status handler_get_upload_status(void *_, onion_request *req, onion_response *res) {
+	build_response_header(res);
+	if ((onion_request_get_flags(req) & OR_METHODS) == OR_POST) {
+		const char *data_upload_id = onion_request_get_post(req, "upload-id");
+		if (handle_param_miss_check(res, "Get upload status", "upload-id", data_upload_id)) {
+			return OCS_PROCESSED;
+		} else if (!params_check_is_number(data_upload_id)) {
+			send_common_feedback(res, HTTP_BAD_REQUEST, "invalid upload-id");
+			syslog_server(LOG_ERR, "Request: Get upload status - invalid upload-id (%s)", 
+			              data_upload_id);
+			return OCS_PROCESSED;
+		}
+		
+		t_upload_status status;
+		const unsigned int upload_id = strtoul(data_upload_id, NULL, 10);
+		if (!upload_pipeline_get_status(upload_id, false, &status)) {
+			send_common_feedback(res, HTTP_NOT_FOUND, "upload could not be found");
+			syslog_server(LOG_ERR, "Request: Get upload status - upload %u could not be found", 
+			              upload_id);
+			return OCS_PROCESSED;
+		}
+		
+		const bool is_finished = status.state == UPLOAD_SUCCEEDED || status.state == UPLOAD_FAILED;
+		GString *g_feedback = g_string_sized_new(256);
+		append_start_of_obj(g_feedback, false);
+		append_field_uint_value(g_feedback, "upload-id", status.id, true);
+		append_field_str_value(g_feedback, "kind", 
+		                       status.kind == UPLOAD_ENGINE ? "engine" : "interlocker", true);
+		append_field_str_value(g_feedback, "file", status.filename, true);
+		append_field_str_value(g_feedback, "state", upload_pipeline_state_name(status.state), 
+		                       is_finished);
+		if (is_finished) {
+			append_field_int_value(g_feedback, "code", status.status_code, 
+			                       status.message != NULL);
+		}
+		if (status.message != NULL && status.message_is_json) {
+			append_field_literal_value_from_str(g_feedback, "verification", 
+			                                    status.message->str, false);
+		} else if (status.message != NULL) {
+			append_field_str_value(g_feedback, "msg", status.message->str, false);
+		}
+		append_end_of_obj(g_feedback, false);
+		if (status.message != NULL) {
+			g_string_free(status.message, true);
+		}
+		send_some_gstring_and_free(res, HTTP_OK, g_feedback);
+		syslog_server(LOG_INFO, "Request: Get upload status - upload %u - done", upload_id);
+		return OCS_PROCESSED;
+	} else {
+		return handle_req_run_or_method_fail(res, true, "Get upload status");
+	}
+}
@@ -38,6 +38,22 @@ bool clear_engine_dir(void);
 
 bool clear_interlocker_dir(void);
 
+/**
+ * Removes the model, the generated sources and the library of an engine.
+ * 
+ * @param library_name name of the engine library, e.g., "libengine"
+ * @return true if all files could be removed
+ */
+bool remove_engine_files(const char library_name[]);
+
+/**
+ * Removes the model and the library of an interlocker.
+ * 
+ * @param library_name name of the interlocker library, e.g., "libinterlocker_default"
+ * @return true if all files could be removed
+ */
+bool remove_interlocker_files(const char library_name[]);
+
 
 o_con_status handler_upload_engine(void *_, onion_request *req, onion_response *res);
 
@@ -47,6 +63,8 @@ o_con_status handler_upload_interlocker(void *_, onion_request *req, onion_respo
 
 o_con_status handler_remove_interlocker(void *_, onion_request *req, onion_response *res);
 
+o_con_status handler_get_upload_status(void *_, onion_request *req, onion_response *res);
+
 
 #endif  // HANDLER_UPLOAD_H
 
@@ -32,6 +32,8 @@
 
 #include "interlocking.h"
 #include "server.h"
+#include "route_planner.h"
+#include "memory_footprint.h"
 #include "parsers/interlocking_parser.h"
 
 GHashTable *route_hash_table = NULL;
@@ -100,13 +102,19 @@ bool interlocking_table_initialise(const char *config_dir) {
 	route_hash_table = parse_interlocking_table(config_dir);
 	if (route_hash_table != NULL) {
 		create_route_str_to_ids_hashtable();
-		return true;
+		const bool success = route_planner_initialise();
+		memory_footprint_set(MEMORY_SUBSYSTEM_INTERLOCKING_TABLE, 
+		                     interlocking_table_memory_footprint());
+		return success;
 	}
 	
 	return false;
 }
 
 void free_interlocking_table(void) {
+	// free route graph index, which refers to the routes of the interlocking table
+	route_planner_free();
+	
 	// free route-string to route ids hash table
 	if (route_string_to_ids_hashtable != NULL) {
 		g_hash_table_destroy(route_string_to_ids_hashtable);
@@ -120,6 +128,7 @@ void free_interlocking_table(void) {
 		route_hash_table = NULL;
 	}
 	
+	memory_footprint_set(MEMORY_SUBSYSTEM_INTERLOCKING_TABLE, 0);
 	syslog_server(LOG_NOTICE, "Interlocking table freed");
 }
 
@@ -188,3 +197,42 @@ unsigned int interlocking_table_get_size() {
 	
 	return 0;
 }
+
+size_t interlocking_table_memory_footprint(void) {
+	if (route_hash_table == NULL) {
+		return 0;
+	}
+	size_t bytes = memory_footprint_of_hash_table(route_hash_table);
+	GHashTableIter iter;
+	gpointer key, value;
+	g_hash_table_iter_init(&iter, route_hash_table);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		const t_interlocking_route *route = value;
+		bytes += memory_footprint_of_string(key) 
+		         + memory_footprint_of_block(sizeof(t_interlocking_route)) 
+		         + memory_footprint_of_string(route->id) 
+		         + memory_footprint_of_string(route->source) 
+		         + memory_footprint_of_string(route->destination) 
+		         + memory_footprint_of_string(route->orientation) 
+		         + memory_footprint_of_string_array(route->path, 8, false) 
+		         + memory_footprint_of_string_array(route->sections, 8, false) 
+		         + memory_footprint_of_array(route->points, 8, false) 
+		         + memory_footprint_of_string_array(route->signals, 8, false) 
+		         + memory_footprint_of_string_array(route->conflicts, 8, false) 
+		         + memory_footprint_of_string(route->train);
+		for (unsigned int i = 0; route->points != NULL && i < route->points->len; i++) {
+			bytes += memory_footprint_of_string(
+					g_array_index(route->points, t_interlocking_point, i).id);
+		}
+	}
+	
+	// The route ids in the lookup table are owned by the routes
+	if (route_string_to_ids_hashtable != NULL) {
+		bytes += memory_footprint_of_hash_table(route_string_to_ids_hashtable);
+		g_hash_table_iter_init(&iter, route_string_to_ids_hashtable);
+		while (g_hash_table_iter_next(&iter, &key, &value)) {
+			bytes += memory_footprint_of_string(key) + memory_footprint_of_array(value, 8, false);
+		}
+	}
+	return bytes + route_planner_memory_footprint();
+}
@@ -128,5 +128,13 @@ t_interlocking_route *get_route(const char *route_id);
  */
 unsigned int interlocking_table_get_size();
 
+/**
+ * Returns the estimated bytes held by the interlocking table: its routes, the lookup 
+ * table of route ids by source and destination signal, and the route graph index.
+ * 
+ * @return estimated bytes (see memory_footprint.h), 0 if no interlocking table exists
+ */
+size_t interlocking_table_memory_footprint(void);
+
 #endif  // INTERLOCKING_H
 
@@ -27,14 +27,117 @@
 
 #include "json_response_builder.h"
 
+#include <math.h>
+
+// Fields and values are written piecewise with g_string_append*, no format strings are parsed.
+
+static inline void append_field_key(GString *dest, const char *field) {
+	// Field names are string literals in the handlers, they need no escaping
+	g_string_append_len(dest, "\n\"", 2);
+	g_string_append(dest, field);
+	g_string_append_len(dest, "\": ", 3);
+}
+
+static inline void append_trailing_comma(GString *dest, bool add_trailing_comma) {
+	if (add_trailing_comma) {
+		g_string_append_c(dest, ',');
+	}
+}
+
+// Appends value_str enclosed in quote marks, with quote marks, backslashes 
+// and control characters escaped.
+static void append_escaped_str(GString *dest, const char *value_str) {
+	static const char hex_digits[] = "0123456789abcdef";
+	g_string_append_c(dest, '"');
+	const char *run_start = value_str;
+	for (const char *c = value_str; *c != '\0'; c++) {
+		const unsigned char uc = (unsigned char) *c;
+		if (uc >= 0x20 && uc != '"' && uc != '\\') {
+			continue;
+		}
+		g_string_append_len(dest, run_start, c - run_start);
+		run_start = c + 1;
+		switch (uc) {
+			case '"':  g_string_append_len(dest, "\\\"", 2); break;
+			case '\\': g_string_append_len(dest, "\\\\", 2); break;
+			case '\n': g_string_append_len(dest, "\\n", 2); break;
+			case '\r': g_string_append_len(dest, "\\r", 2); break;
+			case '\t': g_string_append_len(dest, "\\t", 2); break;
+			default: {
+				const char escaped[6] = {'\\', 'u', '0', '0', 
+				                         hex_digits[uc >> 4], hex_digits[uc & 0xf]};
+				g_string_append_len(dest, escaped, sizeof(escaped));
+				break;
+			}
+		}
+	}
+	g_string_append(dest, run_start);
+	g_string_append_c(dest, '"');
+}
+
+static void append_ulonglong(GString *dest, unsigned long long value) {
+	char digits[20];
+	size_t i = sizeof(digits);
+	do {
+		digits[--i] = (char) ('0' + value % 10);
+		value /= 10;
+	} while (value > 0);
+	g_string_append_len(dest, digits + i, sizeof(digits) - i);
+}
+
+static void append_longlong(GString *dest, long long value) {
+	if (value < 0) {
+		g_string_append_c(dest, '-');
+		// Negate in unsigned arithmetic, so that the minimum value does not overflow
+		append_ulonglong(dest, 0ULL - (unsigned long long) value);
+	} else {
+		append_ulonglong(dest, (unsigned long long) value);
+	}
+}
+
+// Appends value_float with six decimal places, like %f, but independent of the locale.
+static void append_float(GString *dest, float value_float) {
+	const double value = value_float;
+	if (!isfinite(value)) {
+		// Not representable in json
+		g_string_append_len(dest, "null", 4);
+		return;
+	}
+	if (fabs(value) >= 1e12) {
+		char buffer[G_ASCII_DTOSTR_BUF_SIZE];
+		g_string_append(dest, g_ascii_formatd(buffer, sizeof(buffer), "%f", value));
+		return;
+	}
+	const unsigned long long scaled = (unsigned long long) llround(fabs(value) * 1e6);
+	if (value < 0 && scaled > 0) {
+		g_string_append_c(dest, '-');
+	}
+	append_ulonglong(dest, scaled / 1000000);
+	char decimals[7] = {'.'};
+	unsigned long long fraction = scaled % 1000000;
+	for (size_t i = 6; i > 0; i--) {
+		decimals[i] = (char) ('0' + fraction % 10);
+		fraction /= 10;
+	}
+	g_string_append_len(dest, decimals, sizeof(decimals));
+}
 
 GString* append_field_str_value(GString *dest, const char *field, 
                                 const char *value_str, bool add_trailing_comma) {
 	if (dest == NULL || field == NULL || value_str == NULL) {
 		return NULL;
 	}
-	g_string_append_printf(dest, "\n\"%s\": \"%s\"%s", 
-	                       field, value_str, add_trailing_comma ? "," : "");
+	append_field_key(dest, field);
+	append_escaped_str(dest, value_str);
+	append_trailing_comma(dest, add_trailing_comma);
+	return dest;
+}
+
+GString* append_str_value(GString *dest, const char *value_str) {
+	if (dest == NULL || value_str == NULL) {
+		return NULL;
+	}
+	append_escaped_str(dest, value_str);
 	return dest;
 }
 
@@ -43,8 +146,11 @@ GString* append_field_str_value_from_int(GString *dest, const char *field,
 	if (dest == NULL || field == NULL) {
 		return NULL;
 	}
-	g_string_append_printf(dest, "\n\"%s\": \"%d\"%s", 
-	                       field, value_int, add_trailing_comma ? "," : "");
+	append_field_key(dest, field);
+	g_string_append_c(dest, '"');
+	append_longlong(dest, value_int);
+	g_string_append_c(dest, '"');
+	append_trailing_comma(dest, add_trailing_comma);
 	return dest;
 }
 
@@ -53,8 +159,9 @@ GString* append_field_literal_value_from_str(GString *dest, const char *field,
 	if (dest == NULL || field == NULL || value_str == NULL) {
 		return NULL;
 	}
-	g_string_append_printf(dest, "\n\"%s\": %s%s", 
-	                       field, value_str, add_trailing_comma ? "," : "");
+	append_field_key(dest, field);
+	g_string_append(dest, value_str);
+	append_trailing_comma(dest, add_trailing_comma);
 	return dest;
 }
 
@@ -64,16 +171,21 @@ GString* append_field_strlist_value(GString *dest, const char *field,
 	if (dest == NULL || field == NULL || value_liststr == NULL) {
 		return NULL;
 	}
-	g_string_append_printf(dest, "\n\"%s\": [", field);
+	append_field_key(dest, field);
+	g_string_append_c(dest, '[');
 	
 	for(unsigned int i = 0; i < list_len; ++i) {
 		const char * list_elem = value_liststr[i];
 		if (list_elem != NULL) {
 			// append to json list and add "," if not last element
-			g_string_append_printf(dest, "\"%s\"%s", list_elem, (i+1 < list_len) ? ", " : "");
+			append_escaped_str(dest, list_elem);
+			if (i+1 < list_len) {
+				g_string_append_len(dest, ", ", 2);
+			}
 		}
 	}
-	g_string_append_printf(dest, "]%s", add_trailing_comma ? "," : "");
+	g_string_append_c(dest, ']');
+	append_trailing_comma(dest, add_trailing_comma);
 	
 	return dest;
 }
@@ -85,19 +197,23 @@ static GString* append_field_value_garray_strs_base(GString *dest, const char *f
 	if (dest == NULL || field == NULL) {
 		return NULL;
 	}
-	if (g_strarray == NULL || g_strarray->len == 0) {
-		g_string_append_printf(dest, "\n\"%s\": []%s", field, add_trailing_comma ? "," : "");
-		return dest;
-	}
-	const char *format_str_value_elem = add_value_quote_marks ? "\"%s\"%s" : "%s%s";
-	
-	g_string_append_printf(dest, "\n\"%s\": [", field);
-	for (unsigned int i = 0; i < g_strarray->len; ++i) {
-		g_string_append_printf(dest, format_str_value_elem, 
-		                       g_array_index(g_strarray, char *, i), 
-		                       (i+1 < g_strarray->len) ? ", " : "");
+	append_field_key(dest, field);
+	g_string_append_c(dest, '[');
+	if (g_strarray != NULL) {
+		for (unsigned int i = 0; i < g_strarray->len; ++i) {
+			const char *list_elem = g_array_index(g_strarray, char *, i);
+			if (add_value_quote_marks) {
+				append_escaped_str(dest, list_elem);
+			} else {
+				g_string_append(dest, list_elem);
+			}
+			if (i+1 < g_strarray->len) {
+				g_string_append_len(dest, ", ", 2);
+			}
+		}
 	}
-	g_string_append_printf(dest, "]%s", add_trailing_comma ? "," : "");
+	g_string_append_c(dest, ']');
+	append_trailing_comma(dest, add_trailing_comma);
 	
 	return dest;
 }
@@ -118,7 +234,9 @@ GString* append_field_emptylist_value(GString *dest, const char *field, bool add
 	if (dest == NULL || field == NULL) {
 		return NULL;
 	}
-	g_string_append_printf(dest, "\n\"%s\": []%s", field, add_trailing_comma ? "," : "");
+	append_field_key(dest, field);
+	g_string_append_len(dest, "[]", 2);
+	append_trailing_comma(dest, add_trailing_comma);
 	return dest;
 }
 
@@ -127,8 +245,13 @@ GString* append_field_bool_value(GString *dest, const char *field, bool value_bo
 	if (dest == NULL || field == NULL) {
 		return NULL;
 	}
-	g_string_append_printf(dest, "\n\"%s\": %s%s", 
-	                       field, value_bool ? "true" : "false", add_trailing_comma ? "," : "");
+	append_field_key(dest, field);
+	if (value_bool) {
+		g_string_append_len(dest, "true", 4);
+	} else {
+		g_string_append_len(dest, "false", 5);
+	}
+	append_trailing_comma(dest, add_trailing_comma);
 	return dest;
 }
 
@@ -137,8 +260,9 @@ GString* append_field_int_value(GString *dest, const char *field, int value_int,
 	if (dest == NULL || field == NULL) {
 		return NULL;
 	}
-	g_string_append_printf(dest, "\n\"%s\": %d%s", 
-	                       field, value_int, add_trailing_comma ? "," : "");
+	append_field_key(dest, field);
+	append_longlong(dest, value_int);
+	append_trailing_comma(dest, add_trailing_comma);
 	return dest;
 }
 
@@ -147,8 +271,21 @@ GString* append_field_uint_value(GString *dest, const char *field, unsigned int
 	if (dest == NULL || field == NULL) {
 		return NULL;
 	}
-	g_string_append_printf(dest, "\n\"%s\": %u%s", 
-	                       field, value_uint, add_trailing_comma ? "," : "");
+	append_field_key(dest, field);
+	append_ulonglong(dest, value_uint);
+	append_trailing_comma(dest, add_trailing_comma);
+	return dest;
+}
+
+GString* append_field_ulonglong_value(GString *dest, const char *field, 
+                                      unsigned long long value_ulonglong, 
+                                      bool add_trailing_comma) {
+	if (dest == NULL || field == NULL) {
+		return NULL;
+	}
+	append_field_key(dest, field);
+	append_ulonglong(dest, value_ulonglong);
+	append_trailing_comma(dest, add_trailing_comma);
 	return dest;
 }
 
@@ -157,8 +294,9 @@ GString* append_field_float_value(GString *dest, const char *field,
 	if (dest == NULL || field == NULL) {
 		return NULL;
 	}
-	g_string_append_printf(dest, "\n\"%s\": %f%s", 
-	                       field, value_float, add_trailing_comma ? "," : "");
+	append_field_key(dest, field);
+	append_float(dest, value_float);
+	append_trailing_comma(dest, add_trailing_comma);
 	return dest;
 }
 
@@ -166,7 +304,8 @@ GString* append_field_start_of_list(GString *dest, const char *field) {
 	if (dest == NULL || field == NULL) {
 		return NULL;
 	}
-	g_string_append_printf(dest, "\n\"%s\": [", field);
+	append_field_key(dest, field);
+	g_string_append_c(dest, '[');
 	return dest;
 }
 
@@ -174,8 +313,11 @@ GString* append_end_of_list(GString *dest, bool add_trailing_comma, bool with_pr
 	if (dest == NULL) {
 		return NULL;
 	}
-	g_string_append_printf(dest, "%s]%s", 
-	                       with_prepend_newline ? "\n" : "", add_trailing_comma ? "," : "");
+	if (with_prepend_newline) {
+		g_string_append_c(dest, '\n');
+	}
+	g_string_append_c(dest, ']');
+	append_trailing_comma(dest, add_trailing_comma);
 	return dest;
 }
 
@@ -183,7 +325,8 @@ GString* append_field_start_of_obj(GString *dest, const char *field) {
 	if (dest == NULL || field == NULL) {
 		return NULL;
 	}
-	g_string_append_printf(dest, "\n\"%s\": {", field);
+	append_field_key(dest, field);
+	g_string_append_c(dest, '{');
 	return dest;
 }
 
@@ -191,7 +334,10 @@ GString* append_start_of_obj(GString *dest, bool with_prepend_newline) {
 	if (dest == NULL) {
 		return NULL;
 	}
-	g_string_append_printf(dest, "%s{", with_prepend_newline ? "\n" : "");
+	if (with_prepend_newline) {
+		g_string_append_c(dest, '\n');
+	}
+	g_string_append_c(dest, '{');
 	return dest;
 }
 
@@ -199,6 +345,7 @@ GString* append_end_of_obj(GString *dest, bool add_trailing_comma) {
 	if (dest == NULL) {
 		return NULL;
 	}
-	g_string_append_printf(dest, "\n}%s", add_trailing_comma ? "," : "");
+	g_string_append_len(dest, "\n}", 2);
+	append_trailing_comma(dest, add_trailing_comma);
 	return dest;
 }
@@ -36,6 +36,8 @@
  * where the value is represented in json as a string.
  * Example. Input: field=`mystr`, value_str=`helloworld`.
  * Resulting addition to `dest`: `\n"mystr": "helloworld"`.
+ * Quote marks, backslashes and control characters in the value are escaped.
+ * Field names are not escaped.
  * 
  * @param dest String to be added to
  * @param field name of the json field to add
@@ -78,6 +80,7 @@ GString* append_field_literal_value_from_str(GString *dest, const char *field, c
  * @brief Adds a json field with a list of strings as the value of the field.
  * Example. Input: field=`mystrlist`, value_liststr=list with strings `hello`, `world`.
  * Resulting addition to `dest`: `\n"mystrlist": ["hello", "world"]`.
+ * The strings are escaped like in append_field_str_value.
  * 
  * @param dest String to be added to
  * @param field name of the json field to add
@@ -148,6 +151,18 @@ GString* append_field_emptylist_value(GString *dest, const char *field, bool add
 GString* append_field_bool_value(GString *dest, const char *field, bool value_bool, 
                                  bool add_trailing_comma);
 
+/**
+ * @brief Adds a string value enclosed in quote marks, escaped like in append_field_str_value, 
+ * e.g., as an item of a list, or as a value in compact json without newlines.
+ * Example. Input: value_str=`my"string`.
+ * Resulting addition to `dest`: `"my\"string"`.
+ * 
+ * @param dest String to be added to
+ * @param value_str value to add
+ * @return GString* modified "dest" string
+ */
+GString* append_str_value(GString *dest, const char *value_str);
+
 /**
  * @brief Adds a json field with a number value (from int).
  * Example. Input: field=`mynumber`, value_int=`5`.
@@ -176,10 +191,27 @@ GString* append_field_int_value(GString *dest, const char *field, int value_int,
 GString* append_field_uint_value(GString *dest, const char *field, unsigned int value_uint, 
                                  bool add_trailing_comma);
 
+/**
+ * @brief Adds a json field with a number value (from unsigned long long), 
+ * e.g., for byte counts and durations that may exceed the range of unsigned int.
+ * Example. Input: field=`mybytes`, value_ulonglong=`5000000000`.
+ * Resulting addition to `dest`: `\n"mybytes": 5000000000`.
+ * 
+ * @param dest String to be added to
+ * @param field name of the json field to add
+ * @param value_ulonglong field value
+ * @param add_trailing_comma if true, adds comma after the field and value
+ * @return GString* modified "dest" string
+ */
+GString* append_field_ulonglong_value(GString *dest, const char *field, 
+                                      unsigned long long value_ulonglong, 
+                                      bool add_trailing_comma);
+
 /**
  * @brief Adds a json field with a (real) number value (from float).
  * Example. Input: field=`myreal`, value_float=`15.124`.
- * Resulting addition to `dest`: `\n"myreal": 15.124`.
+ * Resulting addition to `dest`: `\n"myreal": 15.124000`.
+ * Always six decimal places with `.` as decimal point, and `null` if the value is not finite.
  * 
  * @param dest String to be added to
  * @param field name of the json field to add
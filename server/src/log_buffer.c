@@ -0,0 +1,167 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <syslog.h>
+
+#include "log_buffer.h"
+
+#define LOG_BUFFER_INDEX_MASK (LOG_BUFFER_CAPACITY - 1)
+
+_Static_assert((LOG_BUFFER_CAPACITY & LOG_BUFFER_INDEX_MASK) == 0, 
+               "LOG_BUFFER_CAPACITY must be a power of two");
+
+// Bounded multi-producer ring buffer (Vyukov): the sequence number of a record tells 
+// whether it is free for the producer at a position (sequence == position) or 
+// published for the consumer at a position (sequence == position + 1).
+typedef struct {
+	atomic_size_t sequence;
+	int priority;
+	char message[LOG_BUFFER_MESSAGE_LEN_MAX];
+} t_log_record;
+
+static t_log_record records[LOG_BUFFER_CAPACITY];
+static atomic_size_t enqueue_position = 0;
+// Only accessed by the writer thread
+static size_t dequeue_position = 0;
+
+// Counts the published records, so that the writer thread can sleep while there are none
+static sem_t published;
+static pthread_t writer_thread;
+static atomic_bool writer_running = false;
+static atomic_bool writer_stopping = false;
+static atomic_ullong dropped = 0;
+
+static void write_record(void) {
+	t_log_record *record = &records[dequeue_position & LOG_BUFFER_INDEX_MASK];
+	// The semaphore counts records published at any position, the one at this position 
+	// may still be formatted by its producer
+	while (atomic_load_explicit(&record->sequence, memory_order_acquire) != dequeue_position + 1) {
+		sched_yield();
+	}
+	syslog(record->priority, "server: %s", record->message);
+	atomic_store_explicit(&record->sequence, dequeue_position + LOG_BUFFER_CAPACITY, 
+	                      memory_order_release);
+	dequeue_position++;
+}
+
+static void *log_buffer_writer(void *_) {
+	unsigned long long dropped_reported = 0;
+	while (true) {
+		sem_wait(&published);
+		if (atomic_load(&writer_stopping)) {
+			break;
+		}
+		write_record();
+		
+		const unsigned long long dropped_now = atomic_load(&dropped);
+		if (dropped_now != dropped_reported) {
+			syslog(LOG_WARNING, "server: Log buffer - %llu records dropped because it was full", 
+			       dropped_now - dropped_reported);
+			dropped_reported = dropped_now;
+		}
+	}
+	// Drain the records published before stopping
+	while (sem_trywait(&published) == 0) {
+		write_record();
+	}
+	return NULL;
+}
+
+bool log_buffer_start(void) {
+	if (atomic_load(&writer_running)) {
+		return true;
+	}
+	for (size_t i = 0; i < LOG_BUFFER_CAPACITY; i++) {
+		atomic_init(&records[i].sequence, i);
+	}
+	atomic_store(&enqueue_position, 0);
+	dequeue_position = 0;
+	atomic_store(&writer_stopping, false);
+	if (sem_init(&published, 0, 0) != 0) {
+		return false;
+	}
+	if (pthread_create(&writer_thread, NULL, log_buffer_writer, NULL) != 0) {
+		sem_destroy(&published);
+		return false;
+	}
+	atomic_store(&writer_running, true);
+	return true;
+}
+
+void log_buffer_stop(void) {
+	if (!atomic_exchange(&writer_running, false)) {
+		return;
+	}
+	atomic_store(&writer_stopping, true);
+	// Wakes up the writer thread; the post does not belong to any record
+	sem_post(&published);
+	pthread_join(writer_thread, NULL);
+	sem_destroy(&published);
+}
+
+bool log_buffer_push(int priority, const char *format, va_list args) {
+	if (!atomic_load(&writer_running)) {
+		return false;
+	}
+	size_t position = atomic_load_explicit(&enqueue_position, memory_order_relaxed);
+	t_log_record *record;
+	while (true) {
+		record = &records[position & LOG_BUFFER_INDEX_MASK];
+		const size_t sequence = atomic_load_explicit(&record->sequence, memory_order_acquire);
+		const intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+		if (difference == 0) {
+			if (atomic_compare_exchange_weak_explicit(&enqueue_position, &position, position + 1, 
+			                                          memory_order_relaxed, 
+			                                          memory_order_relaxed)) {
+				break;
+			}
+		} else if (difference < 0) {
+			// Not yet written by the writer thread since the last round, i.e., full
+			atomic_fetch_add(&dropped, 1);
+			return true;
+		} else {
+			position = atomic_load_explicit(&enqueue_position, memory_order_relaxed);
+		}
+	}
+	record->priority = priority;
+	vsnprintf(record->message, LOG_BUFFER_MESSAGE_LEN_MAX, format, args);
+	atomic_store_explicit(&record->sequence, position + 1, memory_order_release);
+	sem_post(&published);
+	return true;
+}
+
+unsigned long long log_buffer_dropped_count(void) {
+	return atomic_load(&dropped);
+}
@@ -0,0 +1,71 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#ifndef LOG_BUFFER_H
+#define LOG_BUFFER_H
+
+#include <stdarg.h>
+#include <stdbool.h>
+
+// Number of records the ring buffer holds, must be a power of two
+#define LOG_BUFFER_CAPACITY		512
+// Maximum length of a formatted log message, longer messages are truncated
+#define LOG_BUFFER_MESSAGE_LEN_MAX	1024
+
+/**
+ * Starts the background thread that writes the buffered log records to syslog.
+ * Until it is started, log_buffer_push refuses all records.
+ * 
+ * @return true if the writer thread was started
+ */
+bool log_buffer_start(void);
+
+/**
+ * Writes all records still in the buffer to syslog and stops the writer thread.
+ */
+void log_buffer_stop(void);
+
+/**
+ * Formats a log record into the ring buffer, to be written to syslog by the writer thread.
+ * Never blocks and does not take any lock; safe to call from any thread.
+ * 
+ * @param priority syslog priority of the record
+ * @param format printf format of the message
+ * @param args arguments of the format
+ * @return true if the record was buffered or, because the buffer was full, dropped 
+ * (see log_buffer_dropped_count), false if the writer thread is not running
+ */
+bool log_buffer_push(int priority, const char *format, va_list args);
+
+/**
+ * @return number of records dropped because the buffer was full
+ */
+unsigned long long log_buffer_dropped_count(void);
+
+#endif  // LOG_BUFFER_H
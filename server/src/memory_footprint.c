@@ -0,0 +1,186 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "memory_footprint.h"
+
+// Smallest array that GArray allocates, in bytes
+#define GARRAY_DATA_SIZE_MIN	16
+// Fewest buckets of a GHashTable
+#define GHASHTABLE_SIZE_MIN		8
+// Fields of GArray's and GHashTable's private structs
+#define GARRAY_HEADER_SIZE		(sizeof(void *) + 5 * sizeof(unsigned int) + sizeof(void *))
+#define GHASHTABLE_HEADER_SIZE	(13 * sizeof(void *))
+
+static const char *subsystem_names[MEMORY_SUBSYSTEM_COUNT] = {
+	"interlocking_table", "config_tables", "track_state_cache", "response_cache", 
+	"dyn_containers"
+};
+
+static atomic_size_t subsystem_bytes[MEMORY_SUBSYSTEM_COUNT];
+static atomic_size_t subsystem_peak_bytes[MEMORY_SUBSYSTEM_COUNT];
+
+
+static size_t nearest_power_of_two(size_t size) {
+	size_t power = 1;
+	while (power < size) {
+		power <<= 1;
+	}
+	return power;
+}
+
+size_t memory_footprint_of_block(size_t size) {
+	// glibc adds a size field to each chunk, aligns chunks to two words, and has a 
+	// minimum chunk size of four words
+	const size_t alignment = 2 * sizeof(size_t);
+	const size_t chunk_size = (size + sizeof(size_t) + alignment - 1) & ~(alignment - 1);
+	return chunk_size > 4 * sizeof(size_t) ? chunk_size : 4 * sizeof(size_t);
+}
+
+size_t memory_footprint_of_string(const char *str) {
+	return str != NULL ? memory_footprint_of_block(strlen(str) + 1) : 0;
+}
+
+size_t memory_footprint_of_gstring(const GString *gstr) {
+	if (gstr == NULL) {
+		return 0;
+	}
+	return memory_footprint_of_block(sizeof(GString)) 
+	       + memory_footprint_of_block(gstr->allocated_len);
+}
+
+size_t memory_footprint_of_array(GArray *array, unsigned int reserved_len, 
+                                 bool zero_terminated) {
+	if (array == NULL) {
+		return 0;
+	}
+	// GArray grows its data to the nearest power of two, starting with the reserved length
+	const size_t len = (array->len > reserved_len ? array->len : reserved_len) + zero_terminated;
+	const size_t data_size = nearest_power_of_two(len * g_array_get_element_size(array));
+	return memory_footprint_of_block(GARRAY_HEADER_SIZE) 
+	       + memory_footprint_of_block(data_size > GARRAY_DATA_SIZE_MIN 
+	                                   ? data_size : GARRAY_DATA_SIZE_MIN);
+}
+
+size_t memory_footprint_of_string_array(GArray *array, unsigned int reserved_len, 
+                                        bool zero_terminated) {
+	size_t bytes = memory_footprint_of_array(array, reserved_len, zero_terminated);
+	for (unsigned int i = 0; array != NULL && i < array->len; i++) {
+		bytes += memory_footprint_of_string(g_array_index(array, char *, i));
+	}
+	return bytes;
+}
+
+size_t memory_footprint_of_hash_table(GHashTable *table) {
+	if (table == NULL) {
+		return 0;
+	}
+	// GHashTable doubles its buckets once they are about 16/17 occupied, and has 
+	// separate arrays for the keys, the values and the hashes
+	const size_t entries = g_hash_table_size(table);
+	size_t buckets = nearest_power_of_two(entries + entries / 16 + 1);
+	buckets = buckets > GHASHTABLE_SIZE_MIN ? buckets : GHASHTABLE_SIZE_MIN;
+	return memory_footprint_of_block(GHASHTABLE_HEADER_SIZE) 
+	       + 2 * memory_footprint_of_block(buckets * sizeof(void *)) 
+	       + memory_footprint_of_block(buckets * sizeof(unsigned int));
+}
+
+static void update_peak(t_memory_subsystem subsystem, size_t bytes) {
+	size_t peak = atomic_load(&subsystem_peak_bytes[subsystem]);
+	while (bytes > peak 
+	       && !atomic_compare_exchange_weak(&subsystem_peak_bytes[subsystem], &peak, bytes)) {
+		;
+	}
+}
+
+void memory_footprint_set(t_memory_subsystem subsystem, size_t bytes) {
+	atomic_store(&subsystem_bytes[subsystem], bytes);
+	update_peak(subsystem, bytes);
+}
+
+void memory_footprint_add(t_memory_subsystem subsystem, size_t bytes) {
+	update_peak(subsystem, atomic_fetch_add(&subsystem_bytes[subsystem], bytes) + bytes);
+}
+
+void memory_footprint_subtract(t_memory_subsystem subsystem, size_t bytes) {
+	atomic_fetch_sub(&subsystem_bytes[subsystem], bytes);
+}
+
+const char *memory_footprint_subsystem_name(t_memory_subsystem subsystem) {
+	return subsystem < MEMORY_SUBSYSTEM_COUNT ? subsystem_names[subsystem] : "unknown";
+}
+
+void memory_footprint_get(t_memory_usage usages[MEMORY_SUBSYSTEM_COUNT]) {
+	for (int i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++) {
+		usages[i].bytes = atomic_load(&subsystem_bytes[i]);
+		usages[i].peak_bytes = atomic_load(&subsystem_peak_bytes[i]);
+	}
+}
+
+size_t memory_footprint_rss(void) {
+	FILE *statm = fopen("/proc/self/statm", "r");
+	if (statm == NULL) {
+		return 0;
+	}
+	unsigned long size_pages = 0;
+	unsigned long resident_pages = 0;
+	const bool is_read = fscanf(statm, "%lu %lu", &size_pages, &resident_pages) == 2;
+	fclose(statm);
+	return is_read ? (size_t) resident_pages * (size_t) sysconf(_SC_PAGESIZE) : 0;
+}
+
+void memory_footprint_append_prometheus(GString *dest) {
+	t_memory_usage usages[MEMORY_SUBSYSTEM_COUNT];
+	memory_footprint_get(usages);
+	
+	g_string_append(dest, 
+	                "# HELP swtbahn_memory_bytes Estimated memory held by the subsystem.\n"
+	                "# TYPE swtbahn_memory_bytes gauge\n");
+	for (int i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++) {
+		g_string_append_printf(dest, "swtbahn_memory_bytes{subsystem=\"%s\"} %zu\n", 
+		                       subsystem_names[i], usages[i].bytes);
+	}
+	g_string_append(dest, 
+	                "# HELP swtbahn_memory_peak_bytes Largest estimated memory held by the "
+	                "subsystem.\n"
+	                "# TYPE swtbahn_memory_peak_bytes gauge\n");
+	for (int i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++) {
+		g_string_append_printf(dest, "swtbahn_memory_peak_bytes{subsystem=\"%s\"} %zu\n", 
+		                       subsystem_names[i], usages[i].peak_bytes);
+	}
+	g_string_append_printf(dest, 
+	                       "# HELP swtbahn_memory_resident_bytes Resident set size of the "
+	                       "server.\n"
+	                       "# TYPE swtbahn_memory_resident_bytes gauge\n"
+	                       "swtbahn_memory_resident_bytes %zu\n", 
+	                       memory_footprint_rss());
+}
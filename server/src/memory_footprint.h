@@ -0,0 +1,138 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+#ifndef MEMORY_FOOTPRINT_H
+#define MEMORY_FOOTPRINT_H
+
+#include <glib.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Subsystems whose heap and shared memory is accounted for
+typedef enum {
+	// Routes of the interlocking table, its lookup table and the route graph
+	MEMORY_SUBSYSTEM_INTERLOCKING_TABLE,
+	// Tables of the track, train and extras configuration
+	MEMORY_SUBSYSTEM_CONFIG_TABLES,
+	// Track states allocated for the interlockers while they run
+	MEMORY_SUBSYSTEM_TRACK_STATE_CACHE,
+	// Responses cached for conditional requests (see response_cache.h)
+	MEMORY_SUBSYSTEM_RESPONSE_CACHE,
+	// Shared memory segment of the dynamic library containers
+	MEMORY_SUBSYSTEM_DYN_CONTAINERS,
+	MEMORY_SUBSYSTEM_COUNT
+} t_memory_subsystem;
+
+typedef struct {
+	size_t bytes;
+	// Largest number of bytes since the server started
+	size_t peak_bytes;
+} t_memory_usage;
+
+/**
+ * The footprints are estimates of what the allocator reserves: glibc's chunk 
+ * overhead and alignment, and the growth policies of GArray and GHashTable.
+ * 
+ * @param size requested size of an allocation
+ * @return estimated footprint of the allocation
+ */
+size_t memory_footprint_of_block(size_t size);
+
+/**
+ * @return estimated footprint of a string allocated with strdup or malloc, 0 for NULL
+ */
+size_t memory_footprint_of_string(const char *str);
+
+/**
+ * @return estimated footprint of a GString, 0 for NULL
+ */
+size_t memory_footprint_of_gstring(const GString *gstr);
+
+/**
+ * Only the array itself is accounted for, not what its elements point to.
+ * 
+ * @param array array whose footprint is estimated
+ * @param reserved_len number of elements reserved when the array was created
+ * @param zero_terminated whether the array was created zero-terminated
+ * @return estimated footprint of the array, 0 for NULL
+ */
+size_t memory_footprint_of_array(GArray *array, unsigned int reserved_len, 
+                                 bool zero_terminated);
+
+/**
+ * As memory_footprint_of_array, but also accounts for the strings of the array.
+ * 
+ * @return estimated footprint of an array of strings that it owns, 0 for NULL
+ */
+size_t memory_footprint_of_string_array(GArray *array, unsigned int reserved_len, 
+                                        bool zero_terminated);
+
+/**
+ * Only the hash table itself is accounted for, not its keys and values.
+ * 
+ * @return estimated footprint of a hash table, 0 for NULL
+ */
+size_t memory_footprint_of_hash_table(GHashTable *table);
+
+/**
+ * Replaces the accounted bytes of a subsystem, e.g., once its tables are loaded.
+ */
+void memory_footprint_set(t_memory_subsystem subsystem, size_t bytes);
+
+/**
+ * Adds to the accounted bytes of a subsystem when it allocates.
+ */
+void memory_footprint_add(t_memory_subsystem subsystem, size_t bytes);
+
+/**
+ * Subtracts from the accounted bytes of a subsystem when it frees.
+ */
+void memory_footprint_subtract(t_memory_subsystem subsystem, size_t bytes);
+
+/**
+ * @return name of the subsystem in reports, e.g., "interlocking_table"
+ */
+const char *memory_footprint_subsystem_name(t_memory_subsystem subsystem);
+
+/**
+ * @param usages filled with the accounted bytes of each subsystem
+ */
+void memory_footprint_get(t_memory_usage usages[MEMORY_SUBSYSTEM_COUNT]);
+
+/**
+ * @return resident set size of the server process in bytes, 0 if unknown
+ */
+size_t memory_footprint_rss(void);
+
+/**
+ * Appends the accounted bytes of each subsystem and the resident set size 
+ * in the Prometheus text format.
+ */
+void memory_footprint_append_prometheus(GString *dest);
+
+#endif  // MEMORY_FOOTPRINT_H
@@ -30,6 +30,7 @@
 #include "track_config_parser.h"
 #include "train_config_parser.h"
 #include "extras_config_parser.h"
+#include "../memory_footprint.h"
 
 const char TRACK_CONFIG_FILENAME[] = "bidib_track_config.yml";
 const char TRAIN_CONFIG_FILENAME[] = "bidib_train_config.yml";
@@ -142,3 +143,128 @@ void free_config_data(t_config_data config_data) {
     
     syslog_server(LOG_NOTICE, "Config data freed");
 }
+
+// Footprint of a table, its id keys, and its values as measured by value_footprint
+static size_t table_footprint(GHashTable *table, size_t (*value_footprint)(const void *)) {
+    if (table == NULL) {
+        return 0;
+    }
+    size_t bytes = memory_footprint_of_hash_table(table);
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, table);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        bytes += memory_footprint_of_string(key) + value_footprint(value);
+    }
+    return bytes;
+}
+
+static size_t segment_footprint(const void *value) {
+    const t_config_segment *segment = value;
+    return memory_footprint_of_block(sizeof(t_config_segment))
+           + memory_footprint_of_string(segment->id);
+}
+
+static size_t signal_footprint(const void *value) {
+    const t_config_signal *signal = value;
+    return memory_footprint_of_block(sizeof(t_config_signal))
+           + memory_footprint_of_string(signal->id)
+           + memory_footprint_of_string(signal->initial)
+           + memory_footprint_of_string_array(signal->aspects, 4, false)
+           + memory_footprint_of_string(signal->type);
+}
+
+static size_t point_footprint(const void *value) {
+    const t_config_point *point = value;
+    return memory_footprint_of_block(sizeof(t_config_point))
+           + memory_footprint_of_string(point->id)
+           + memory_footprint_of_string(point->initial)
+           + memory_footprint_of_string(point->segment)
+           + memory_footprint_of_string(point->normal_aspect)
+           + memory_footprint_of_string(point->reverse_aspect);
+}
+
+static size_t peripheral_footprint(const void *value) {
+    const t_config_peripheral *peripheral = value;
+    return memory_footprint_of_block(sizeof(t_config_peripheral))
+           + memory_footprint_of_string(peripheral->id)
+           + memory_footprint_of_string(peripheral->initial)
+           + memory_footprint_of_string_array(peripheral->aspects, 4, false)
+           + memory_footprint_of_string(peripheral->type);
+}
+
+static size_t train_footprint(const void *value) {
+    const t_config_train *train = value;
+    return memory_footprint_of_block(sizeof(t_config_train))
+           + memory_footprint_of_string(train->id)
+           + memory_footprint_of_string(train->type)
+           + memory_footprint_of_string_array(train->peripherals, 4, false)
+           + memory_footprint_of_array(train->calibration, 10, false);
+}
+
+static size_t block_footprint(const void *value) {
+    const t_config_block *block = value;
+    return memory_footprint_of_block(sizeof(t_config_block))
+           + memory_footprint_of_string(block->id)
+           + memory_footprint_of_string_array(block->train_types, 8, false)
+           + memory_footprint_of_string_array(block->signals, 2, false)
+           + memory_footprint_of_string_array(block->main_segments, 2, false)
+           + memory_footprint_of_string_array(block->overlaps, 2, false)
+           + memory_footprint_of_string(block->direction);
+}
+
+static size_t reverser_footprint(const void *value) {
+    const t_config_reverser *reverser = value;
+    return memory_footprint_of_block(sizeof(t_config_reverser))
+           + memory_footprint_of_string(reverser->id)
+           + memory_footprint_of_string(reverser->board)
+           + memory_footprint_of_string(reverser->block);
+}
+
+static size_t crossing_footprint(const void *value) {
+    const t_config_crossing *crossing = value;
+    return memory_footprint_of_block(sizeof(t_config_crossing))
+           + memory_footprint_of_string(crossing->id)
+           + memory_footprint_of_string(crossing->main_segment);
+}
+
+static size_t signal_type_footprint(const void *value) {
+    const t_config_signal_type *signal_type = value;
+    return memory_footprint_of_block(sizeof(t_config_signal_type))
+           + memory_footprint_of_string(signal_type->id)
+           + memory_footprint_of_string(signal_type->initial)
+           + memory_footprint_of_string_array(signal_type->aspects, 3, false);
+}
+
+static size_t composite_signal_footprint(const void *value) {
+    const t_config_composite_signal *composite_signal = value;
+    return memory_footprint_of_block(sizeof(t_config_composite_signal))
+           + memory_footprint_of_string(composite_signal->id)
+           + memory_footprint_of_string(composite_signal->distant)
+           + memory_footprint_of_string(composite_signal->entry)
+           + memory_footprint_of_string(composite_signal->exit)
+           + memory_footprint_of_string(composite_signal->block);
+}
+
+static size_t peripheral_type_footprint(const void *value) {
+    const t_config_peripheral_type *peripheral_type = value;
+    return memory_footprint_of_block(sizeof(t_config_peripheral_type))
+           + memory_footprint_of_string(peripheral_type->id)
+           + memory_footprint_of_string(peripheral_type->initial)
+           + memory_footprint_of_string_array(peripheral_type->aspects, 3, false);
+}
+
+size_t config_data_memory_footprint(const t_config_data *config_data) {
+    return memory_footprint_of_string(config_data->module_name)
+           + table_footprint(config_data->table_segments, segment_footprint)
+           + table_footprint(config_data->table_signals, signal_footprint)
+           + table_footprint(config_data->table_points, point_footprint)
+           + table_footprint(config_data->table_peripherals, peripheral_footprint)
+           + table_footprint(config_data->table_trains, train_footprint)
+           + table_footprint(config_data->table_blocks, block_footprint)
+           + table_footprint(config_data->table_reversers, reverser_footprint)
+           + table_footprint(config_data->table_crossings, crossing_footprint)
+           + table_footprint(config_data->table_signal_types, signal_type_footprint)
+           + table_footprint(config_data->table_composite_signals, composite_signal_footprint)
+           + table_footprint(config_data->table_peripheral_types, peripheral_type_footprint);
+}
@@ -35,4 +35,9 @@ bool parse_config_data(const char *config_dir, t_config_data *config_data);
 
 void free_config_data(t_config_data config_data);
 
+/**
+ * @return estimated bytes held by the config tables (see memory_footprint.h)
+ */
+size_t config_data_memory_footprint(const t_config_data *config_data);
+
 #endif  // CONFIG_DATA_PARSER_H
\ No newline at end of file
@@ -0,0 +1,1262 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#include <glib.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <yaml.h>
+
+#include "railway_simulation.h"
+#include "server.h"
+#include "parsers/parser_util.h"
+
+// BiDiB serial framing
+#define BIDIB_MAGIC					0xfe
+#define BIDIB_ESCAPE				0xfd
+#define BIDIB_MESSAGE_LEN_MAX		64
+#define BIDIB_PACKET_LEN_MAX		256
+
+// BiDiB message types handled or sent by the simulation
+enum {
+	SIM_MSG_SYS_GET_MAGIC = 0x01,
+	SIM_MSG_SYS_GET_P_VERSION = 0x02,
+	SIM_MSG_SYS_GET_UNIQUE_ID = 0x05,
+	SIM_MSG_SYS_GET_SW_VERSION = 0x06,
+	SIM_MSG_SYS_PING = 0x07,
+	SIM_MSG_NODETAB_GETALL = 0x0b,
+	SIM_MSG_NODETAB_GETNEXT = 0x0c,
+	SIM_MSG_FEATURE_GETALL = 0x10,
+	SIM_MSG_FEATURE_GETNEXT = 0x11,
+	SIM_MSG_FEATURE_GET = 0x12,
+	SIM_MSG_FEATURE_SET = 0x13,
+	SIM_MSG_BM_GET_RANGE = 0x20,
+	SIM_MSG_BM_ADDR_GET_RANGE = 0x24,
+	SIM_MSG_BOOST_OFF = 0x30,
+	SIM_MSG_BOOST_ON = 0x31,
+	SIM_MSG_BOOST_QUERY = 0x32,
+	SIM_MSG_ACCESSORY_SET = 0x38,
+	SIM_MSG_ACCESSORY_GET = 0x39,
+	SIM_MSG_LC_OUTPUT = 0x40,
+	SIM_MSG_LC_OUTPUT_QUERY = 0x44,
+	SIM_MSG_CS_SET_STATE = 0x62,
+	SIM_MSG_CS_DRIVE = 0x64,
+	SIM_MSG_CS_ACCESSORY = 0x65,
+	
+	SIM_MSG_SYS_MAGIC = 0x81,
+	SIM_MSG_SYS_PONG = 0x82,
+	SIM_MSG_SYS_P_VERSION = 0x83,
+	SIM_MSG_SYS_UNIQUE_ID = 0x84,
+	SIM_MSG_SYS_SW_VERSION = 0x85,
+	SIM_MSG_NODETAB_COUNT = 0x88,
+	SIM_MSG_NODETAB = 0x89,
+	SIM_MSG_FEATURE = 0x90,
+	SIM_MSG_FEATURE_NA = 0x91,
+	SIM_MSG_FEATURE_COUNT = 0x92,
+	SIM_MSG_BM_OCC = 0xa0,
+	SIM_MSG_BM_FREE = 0xa1,
+	SIM_MSG_BM_MULTIPLE = 0xa2,
+	SIM_MSG_BM_ADDRESS = 0xa3,
+	SIM_MSG_BOOST_STAT = 0xb0,
+	SIM_MSG_ACCESSORY_STATE = 0xb8,
+	SIM_MSG_LC_STAT = 0xc0,
+	SIM_MSG_CS_STATE = 0xe1,
+	SIM_MSG_CS_DRIVE_ACK = 0xe2,
+	SIM_MSG_CS_ACCESSORY_ACK = 0xe3
+};
+
+// Class bit of a unique id for nodes that are interfaces
+#define BIDIB_CLASS_INTERFACE		0x10
+#define BIDIB_BOOST_STATE_ON		0x80
+#define BIDIB_BOOST_STATE_OFF		0x00
+#define BIDIB_CS_STATE_QUERY		0xff
+#define BIDIB_CS_STATE_GO			0x03
+// Highest speed step of MSG_CS_DRIVE, step 1 is the emergency stop
+#define BIDIB_SPEED_STEP_MAX		127
+
+typedef struct {
+	char *id;
+	uint8_t unique_id[7];
+	// -1 if the feature is not available
+	int16_t features[256];
+	uint8_t accessory_aspects[256];
+	uint8_t message_number;
+	// Position of NODETAB_GETNEXT and FEATURE_GETNEXT
+	unsigned int nodetab_next;
+	unsigned int feature_next;
+} t_sim_node;
+
+typedef struct {
+	char *id;
+	unsigned int node;
+	uint8_t address;
+	float length_cm;
+	// Trains occupying the segment, with their front or rear
+	int occupants[2];
+	unsigned int occupant_count;
+} t_sim_segment;
+
+typedef struct {
+	unsigned int node;
+	uint8_t number;
+	bool is_point;
+	uint8_t aspect_count;
+	// Only for points
+	uint8_t normal_value;
+	uint8_t reverse_value;
+	int segment;
+	// Aspect the accessory reaches at moving_until_us
+	bool moving;
+	uint8_t target_aspect;
+	int64_t moving_until_us;
+} t_sim_accessory;
+
+// A train on segment `at` coming from segment `from` may continue to segment `to`, 
+// if the points on `at` are in the given positions
+typedef struct {
+	int from;
+	int at;
+	int to;
+	unsigned int condition_count;
+	int condition_accessories[4];
+	bool condition_reverse[4];
+} t_sim_transition;
+
+typedef struct {
+	char *id;
+	uint16_t dcc_address;
+	float length_cm;
+	bool placed;
+	// Segment of the front, and the segment the train came from
+	int segment;
+	int from;
+	// Segment still occupied by the rear of the train, or -1
+	int rear;
+	float position_cm;
+	uint8_t speed_step;
+	// DCC direction that moves the train away from `from`
+	bool heading_forward;
+	bool stopped_at_end;
+} t_sim_train;
+
+typedef struct {
+	GArray *nodes;
+	GArray *segments;
+	GArray *accessories;
+	GArray *transitions;
+	GArray *trains;
+	// Segment ids and accessory keys (node << 8 | number) to their index + 1
+	GHashTable *segment_indices;
+	GHashTable *accessory_indices;
+	GHashTable *point_accessories;
+	uint8_t boost_state;
+	uint8_t cs_state;
+} t_sim_railway;
+
+static pthread_mutex_t simulation_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t simulation_thread;
+static volatile bool simulation_running = false;
+static t_sim_railway railway;
+
+static unsigned int tick_ms = RAILWAY_SIMULATION_TICK_MS;
+static unsigned int point_latency_ms = RAILWAY_SIMULATION_POINT_LATENCY_MS;
+static unsigned int signal_latency_ms = RAILWAY_SIMULATION_SIGNAL_LATENCY_MS;
+static unsigned int max_speed_cm_s = RAILWAY_SIMULATION_MAX_SPEED_CM_S;
+static unsigned int train_count_max = UINT8_MAX;
+
+// Downlink packet being received from libbidib
+static uint8_t downlink_packet[BIDIB_PACKET_LEN_MAX];
+static size_t downlink_len = 0;
+static bool downlink_escaped = false;
+
+// Uplink bytes waiting to be read by libbidib
+static pthread_mutex_t uplink_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t uplink[RAILWAY_SIMULATION_UPLINK_LEN];
+static size_t uplink_head = 0;
+static size_t uplink_len = 0;
+// Number of messages dropped because the uplink was full
+static unsigned long uplink_dropped = 0;
+static bool uplink_overflowing = false;
+
+
+static int64_t now_us(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static unsigned int env_setting(const char *name, unsigned int default_value, 
+                                unsigned int max_value) {
+	const char *value = getenv(name);
+	if (value == NULL) {
+		return default_value;
+	}
+	char *end = NULL;
+	const unsigned long number = strtoul(value, &end, 10);
+	if (end == value || *end != '\0' || number > max_value) {
+		syslog_server(LOG_WARNING, "Railway simulation - invalid %s (%s), using %u", 
+		              name, value, default_value);
+		return default_value;
+	}
+	return (unsigned int) number;
+}
+
+
+// --- BiDiB framing ---
+
+static uint8_t crc8_update(uint8_t crc, uint8_t byte) {
+	crc ^= byte;
+	for (int i = 0; i < 8; i++) {
+		crc = (crc & 0x01) ? (crc >> 1) ^ 0x8c : (crc >> 1);
+	}
+	return crc;
+}
+
+// Appends a byte to a packet being framed, escaping it if it is a magic or escape byte
+static size_t packet_put_escaped(uint8_t packet[], size_t len, uint8_t byte) {
+	if (byte == BIDIB_MAGIC || byte == BIDIB_ESCAPE) {
+		packet[len++] = BIDIB_ESCAPE;
+		packet[len++] = byte ^ 0x20;
+	} else {
+		packet[len++] = byte;
+	}
+	return len;
+}
+
+/**
+ * Queues a framed packet for libbidib. A packet that does not fit completely is dropped, 
+ * so that libbidib never reads a truncated message while it lags behind.
+ */
+static void uplink_put(const uint8_t packet[], size_t len) {
+	pthread_mutex_lock(&uplink_mutex);
+	if (len > RAILWAY_SIMULATION_UPLINK_LEN - uplink_len) {
+		uplink_dropped++;
+		if (!uplink_overflowing) {
+			uplink_overflowing = true;
+			syslog_server(LOG_WARNING, "Railway simulation - uplink full, dropping messages "
+			              "until libbidib has read the waiting ones");
+		}
+		pthread_mutex_unlock(&uplink_mutex);
+		return;
+	}
+	uplink_overflowing = false;
+	for (size_t i = 0; i < len; i++) {
+		uplink[(uplink_head + uplink_len) % RAILWAY_SIMULATION_UPLINK_LEN] = packet[i];
+		uplink_len++;
+	}
+	pthread_mutex_unlock(&uplink_mutex);
+}
+
+/**
+ * Sends a message from a node as a packet of its own.
+ * Shall only be called with simulation_mutex acquired.
+ */
+static void send_message(unsigned int node_index, uint8_t type, 
+                         const uint8_t data[], size_t data_len) {
+	t_sim_node *node = &g_array_index(railway.nodes, t_sim_node, node_index);
+	uint8_t message[BIDIB_MESSAGE_LEN_MAX];
+	size_t len = 1;
+	if (node_index > 0) {
+		message[len++] = (uint8_t) node_index;
+	}
+	message[len++] = 0x00;
+	message[len++] = node->message_number;
+	message[len++] = type;
+	if (data_len > sizeof(message) - len) {
+		data_len = sizeof(message) - len;
+	}
+	memcpy(message + len, data, data_len);
+	len += data_len;
+	message[0] = (uint8_t) (len - 1);
+	// Message numbers run from 1 to 255
+	node->message_number = node->message_number == 255 ? 1 : node->message_number + 1;
+	
+	// Every byte of the message and its CRC may be escaped
+	uint8_t packet[2 * (BIDIB_MESSAGE_LEN_MAX + 1) + 2];
+	size_t packet_len = 0;
+	uint8_t crc = 0;
+	packet[packet_len++] = BIDIB_MAGIC;
+	for (size_t i = 0; i < len; i++) {
+		crc = crc8_update(crc, message[i]);
+		packet_len = packet_put_escaped(packet, packet_len, message[i]);
+	}
+	packet_len = packet_put_escaped(packet, packet_len, crc);
+	packet[packet_len++] = BIDIB_MAGIC;
+	uplink_put(packet, packet_len);
+}
+
+uint8_t railway_simulation_read(int *byte_read) {
+	uint8_t byte = 0x00;
+	pthread_mutex_lock(&uplink_mutex);
+	if (uplink_len > 0) {
+		byte = uplink[uplink_head];
+		uplink_head = (uplink_head + 1) % RAILWAY_SIMULATION_UPLINK_LEN;
+		uplink_len--;
+		*byte_read = 1;
+	} else {
+		*byte_read = 0;
+	}
+	pthread_mutex_unlock(&uplink_mutex);
+	if (*byte_read == 0) {
+		// libbidib polls without waiting
+		usleep(1000);
+	}
+	return byte;
+}
+
+
+// --- Accessories, occupancy and trains ---
+
+// Shall only be called with simulation_mutex acquired
+static t_sim_accessory *accessory_of(unsigned int node, uint8_t number) {
+	const gpointer index = g_hash_table_lookup(railway.accessory_indices, 
+	                                           GUINT_TO_POINTER(node << 8 | number));
+	return index == NULL ? NULL 
+	       : &g_array_index(railway.accessories, t_sim_accessory, GPOINTER_TO_UINT(index) - 1);
+}
+
+// Shall only be called with simulation_mutex acquired
+static void send_accessory_state(unsigned int node_index, uint8_t number) {
+	const t_sim_node *node = &g_array_index(railway.nodes, t_sim_node, node_index);
+	const t_sim_accessory *accessory = accessory_of(node_index, number);
+	uint8_t data[5] = { number, node->accessory_aspects[number], 
+	                    accessory != NULL ? accessory->aspect_count : 2, 0x00, 0x00 };
+	if (accessory != NULL && accessory->moving) {
+		const int64_t remaining_us = accessory->moving_until_us - now_us();
+		// Still moving, wait time in units of 100 ms
+		data[1] = accessory->target_aspect;
+		data[3] = 0x01;
+		data[4] = (uint8_t) MIN(MAX(remaining_us / 100000 + 1, 1), 127);
+	}
+	send_message(node_index, SIM_MSG_ACCESSORY_STATE, data, sizeof(data));
+}
+
+// Shall only be called with simulation_mutex acquired
+static void set_accessory(unsigned int node_index, uint8_t number, uint8_t aspect) {
+	t_sim_accessory *accessory = accessory_of(node_index, number);
+	const unsigned int latency_ms = 
+			(accessory != NULL && accessory->is_point) ? point_latency_ms : signal_latency_ms;
+	if (accessory == NULL || latency_ms == 0) {
+		g_array_index(railway.nodes, t_sim_node, node_index).accessory_aspects[number] = aspect;
+		if (accessory != NULL) {
+			accessory->moving = false;
+		}
+	} else {
+		accessory->moving = true;
+		accessory->target_aspect = aspect;
+		accessory->moving_until_us = now_us() + (int64_t) latency_ms * 1000;
+	}
+	send_accessory_state(node_index, number);
+}
+
+// Shall only be called with simulation_mutex acquired
+static void send_segment_address(const t_sim_segment *segment) {
+	uint8_t data[1 + 2 * 2] = { segment->address, 0x00, 0x00 };
+	size_t len = 1;
+	for (unsigned int i = 0; i < segment->occupant_count; i++) {
+		const t_sim_train *train = 
+				&g_array_index(railway.trains, t_sim_train, segment->occupants[i]);
+		data[len++] = train->dcc_address & 0xff;
+		// Bit 7 marks a locomotive whose orientation is inverted
+		data[len++] = ((train->dcc_address >> 8) & 0x3f) | (train->heading_forward ? 0x00 : 0x80);
+	}
+	send_message(segment->node, SIM_MSG_BM_ADDRESS, data, MAX(len, 3));
+}
+
+// Shall only be called with simulation_mutex acquired
+static void occupy_segment(int segment_index, int train_index, bool occupy) {
+	if (segment_index < 0) {
+		return;
+	}
+	t_sim_segment *segment = &g_array_index(railway.segments, t_sim_segment, segment_index);
+	unsigned int i = 0;
+	while (i < segment->occupant_count && segment->occupants[i] != train_index) {
+		i++;
+	}
+	const bool is_occupant = i < segment->occupant_count;
+	if (occupy && !is_occupant && segment->occupant_count < 2) {
+		segment->occupants[segment->occupant_count++] = train_index;
+		if (segment->occupant_count == 1) {
+			send_message(segment->node, SIM_MSG_BM_OCC, &segment->address, 1);
+		}
+		send_segment_address(segment);
+	} else if (!occupy && is_occupant) {
+		segment->occupants[i] = segment->occupants[--segment->occupant_count];
+		if (segment->occupant_count == 0) {
+			send_message(segment->node, SIM_MSG_BM_FREE, &segment->address, 1);
+		}
+		send_segment_address(segment);
+	}
+}
+
+// Shall only be called with simulation_mutex acquired
+static bool transition_is_set(const t_sim_transition *transition) {
+	for (unsigned int i = 0; i < transition->condition_count; i++) {
+		const t_sim_accessory *point = &g_array_index(railway.accessories, t_sim_accessory, 
+		                                              transition->condition_accessories[i]);
+		const uint8_t aspect = 
+				g_array_index(railway.nodes, t_sim_node, point->node).accessory_aspects[point->number];
+		const uint8_t required = 
+				transition->condition_reverse[i] ? point->reverse_value : point->normal_value;
+		if (point->moving || aspect != required) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Finds the segment that a train on segment `at` coming from `from` continues to 
+ * with the current positions of the points, or -1 if the track ends or a point is not set.
+ * Shall only be called with simulation_mutex acquired.
+ */
+static int next_segment(int from, int at) {
+	// Transitions at the start of a route and trains without a known origin match any 
+	// origin, but only if no transition matches the origin exactly
+	int next = -1;
+	for (unsigned int i = 0; i < railway.transitions->len; i++) {
+		const t_sim_transition *transition = 
+				&g_array_index(railway.transitions, t_sim_transition, i);
+		if (transition->at != at || transition->to == from || !transition_is_set(transition)) {
+			continue;
+		} else if (from >= 0 && transition->from == from) {
+			return transition->to;
+		} else if (next < 0 && (from < 0 || transition->from < 0)) {
+			next = transition->to;
+		}
+	}
+	return next;
+}
+
+// Finds a segment that a train on `at` can come from to continue to `to`, or -1
+static int previous_segment(int at, int to) {
+	for (unsigned int i = 0; i < railway.transitions->len; i++) {
+		const t_sim_transition *transition = 
+				&g_array_index(railway.transitions, t_sim_transition, i);
+		if (transition->at == at && transition->to == to && transition->from >= 0) {
+			return transition->from;
+		}
+	}
+	return -1;
+}
+
+// Shall only be called with simulation_mutex acquired
+static void turn_train_around(int train_index) {
+	t_sim_train *train = &g_array_index(railway.trains, t_sim_train, train_index);
+	const t_sim_segment *segment = &g_array_index(railway.segments, t_sim_segment, train->segment);
+	// The train is only kept on the segment of its front
+	occupy_segment(train->rear, train_index, false);
+	train->rear = -1;
+	train->from = previous_segment(train->segment, train->from);
+	train->position_cm = MAX(segment->length_cm - train->position_cm, 0.0f);
+	train->heading_forward = !train->heading_forward;
+	train->stopped_at_end = false;
+}
+
+// Shall only be called with simulation_mutex acquired
+static void move_train(int train_index, float duration_s) {
+	t_sim_train *train = &g_array_index(railway.trains, t_sim_train, train_index);
+	if (!train->placed || train->speed_step <= 1) {
+		return;
+	}
+	float distance_cm = duration_s * max_speed_cm_s * (train->speed_step - 1) 
+	                    / (BIDIB_SPEED_STEP_MAX - 1);
+	while (distance_cm > 0.0f) {
+		const t_sim_segment *segment = 
+				&g_array_index(railway.segments, t_sim_segment, train->segment);
+		const float remaining_cm = segment->length_cm - train->position_cm;
+		if (distance_cm < remaining_cm) {
+			train->position_cm += distance_cm;
+			break;
+		}
+		const int next = next_segment(train->from, train->segment);
+		if (next < 0) {
+			// End of the track or point not set, the train waits at the end of the segment
+			train->position_cm = segment->length_cm;
+			if (!train->stopped_at_end) {
+				train->stopped_at_end = true;
+				syslog_server(LOG_DEBUG, 
+				              "Railway simulation - train %s stopped at the end of %s", 
+				              train->id, segment->id);
+			}
+			break;
+		}
+		distance_cm -= remaining_cm;
+		occupy_segment(train->rear, train_index, false);
+		train->rear = train->segment;
+		train->from = train->segment;
+		train->segment = next;
+		train->position_cm = 0.0f;
+		train->stopped_at_end = false;
+		occupy_segment(train->segment, train_index, true);
+	}
+	if (train->rear >= 0 && train->position_cm >= train->length_cm) {
+		occupy_segment(train->rear, train_index, false);
+		train->rear = -1;
+	}
+}
+
+// Shall only be called with simulation_mutex acquired
+static void drive_train(uint16_t dcc_address, uint8_t speed) {
+	for (unsigned int i = 0; i < railway.trains->len; i++) {
+		t_sim_train *train = &g_array_index(railway.trains, t_sim_train, i);
+		if (train->dcc_address != dcc_address) {
+			continue;
+		}
+		// Bit 7 is the direction, 1 is forward
+		const bool forward = (speed & 0x80) != 0;
+		train->speed_step = speed & 0x7f;
+		if (train->placed && train->speed_step > 1 && forward != train->heading_forward) {
+			turn_train_around(i);
+		}
+	}
+}
+
+
+// --- Downlink messages ---
+
+// Shall only be called with simulation_mutex acquired
+static void send_occupancy_range(unsigned int node_index, uint8_t start, uint8_t end) {
+	// Ranges are multiples of 8 detectors
+	uint8_t data[2 + 16] = { start, 0 };
+	const unsigned int count = MIN((unsigned int) (end - start) / 8, 16);
+	data[1] = (uint8_t) (count * 8);
+	for (unsigned int i = 0; i < railway.segments->len; i++) {
+		const t_sim_segment *segment = &g_array_index(railway.segments, t_sim_segment, i);
+		if (segment->node == node_index && segment->occupant_count > 0 
+		    && segment->address >= start && (unsigned int) (segment->address - start) < count * 8) {
+			const unsigned int bit = segment->address - start;
+			data[2 + bit / 8] |= 1 << (bit % 8);
+		}
+	}
+	send_message(node_index, SIM_MSG_BM_MULTIPLE, data, 2 + count);
+}
+
+// Shall only be called with simulation_mutex acquired
+static void send_node_table_entry(unsigned int node_index) {
+	t_sim_node *node = &g_array_index(railway.nodes, t_sim_node, node_index);
+	// Only the interface has the other nodes as its children
+	const unsigned int entry = node_index == 0 ? node->nodetab_next : node_index;
+	uint8_t data[2 + 7] = { 1, node_index == 0 ? (uint8_t) entry : 0 };
+	memcpy(data + 2, g_array_index(railway.nodes, t_sim_node, entry).unique_id, 7);
+	send_message(node_index, SIM_MSG_NODETAB, data, sizeof(data));
+	if (node_index == 0) {
+		node->nodetab_next = (node->nodetab_next + 1) % railway.nodes->len;
+	}
+}
+
+// Shall only be called with simulation_mutex acquired
+static void send_feature(unsigned int node_index, uint8_t number) {
+	const t_sim_node *node = &g_array_index(railway.nodes, t_sim_node, node_index);
+	if (node->features[number] < 0) {
+		send_message(node_index, SIM_MSG_FEATURE_NA, &number, 1);
+	} else {
+		const uint8_t data[2] = { number, (uint8_t) node->features[number] };
+		send_message(node_index, SIM_MSG_FEATURE, data, sizeof(data));
+	}
+}
+
+// Shall only be called with simulation_mutex acquired
+static void process_message(unsigned int node_index, uint8_t type, 
+                            const uint8_t data[], size_t len) {
+	t_sim_node *node = &g_array_index(railway.nodes, t_sim_node, node_index);
+	switch (type) {
+		case SIM_MSG_SYS_GET_MAGIC: {
+			const uint8_t magic[2] = { 0xfe, 0xaf };
+			send_message(node_index, SIM_MSG_SYS_MAGIC, magic, sizeof(magic));
+			break;
+		}
+		case SIM_MSG_SYS_GET_P_VERSION: {
+			const uint8_t version[2] = { 8, 0 };
+			send_message(node_index, SIM_MSG_SYS_P_VERSION, version, sizeof(version));
+			break;
+		}
+		case SIM_MSG_SYS_GET_UNIQUE_ID:
+			send_message(node_index, SIM_MSG_SYS_UNIQUE_ID, node->unique_id, 7);
+			break;
+		case SIM_MSG_SYS_GET_SW_VERSION: {
+			const uint8_t version[3] = { 0, 1, 0 };
+			send_message(node_index, SIM_MSG_SYS_SW_VERSION, version, sizeof(version));
+			break;
+		}
+		case SIM_MSG_SYS_PING:
+			send_message(node_index, SIM_MSG_SYS_PONG, data, MIN(len, 1));
+			break;
+		case SIM_MSG_NODETAB_GETALL: {
+			const uint8_t count = node_index == 0 ? (uint8_t) railway.nodes->len : 1;
+			node->nodetab_next = 0;
+			send_message(node_index, SIM_MSG_NODETAB_COUNT, &count, 1);
+			break;
+		}
+		case SIM_MSG_NODETAB_GETNEXT:
+			send_node_table_entry(node_index);
+			break;
+		case SIM_MSG_FEATURE_GETALL: {
+			uint8_t count = 0;
+			for (unsigned int i = 0; i < 256; i++) {
+				count += node->features[i] >= 0;
+			}
+			node->feature_next = 0;
+			send_message(node_index, SIM_MSG_FEATURE_COUNT, &count, 1);
+			break;
+		}
+		case SIM_MSG_FEATURE_GETNEXT:
+			while (node->feature_next < 256 && node->features[node->feature_next] < 0) {
+				node->feature_next++;
+			}
+			if (node->feature_next < 256) {
+				send_feature(node_index, (uint8_t) node->feature_next++);
+			} else {
+				const uint8_t none = 0xff;
+				send_message(node_index, SIM_MSG_FEATURE_NA, &none, 1);
+			}
+			break;
+		case SIM_MSG_FEATURE_GET:
+			if (len >= 1) {
+				send_feature(node_index, data[0]);
+			}
+			break;
+		case SIM_MSG_FEATURE_SET:
+			if (len >= 2) {
+				node->features[data[0]] = data[1];
+				send_feature(node_index, data[0]);
+			}
+			break;
+		case SIM_MSG_BM_GET_RANGE:
+			if (len >= 2) {
+				send_occupancy_range(node_index, data[0], data[1]);
+			}
+			break;
+		case SIM_MSG_BM_ADDR_GET_RANGE:
+			for (unsigned int i = 0; len >= 2 && i < railway.segments->len; i++) {
+				const t_sim_segment *segment = &g_array_index(railway.segments, t_sim_segment, i);
+				if (segment->node == node_index 
+				    && segment->address >= data[0] && segment->address < data[1]) {
+					send_segment_address(segment);
+				}
+			}
+			break;
+		case SIM_MSG_BOOST_OFF:
+		case SIM_MSG_BOOST_ON:
+		case SIM_MSG_BOOST_QUERY:
+			if (type != SIM_MSG_BOOST_QUERY) {
+				railway.boost_state = 
+						type == SIM_MSG_BOOST_ON ? BIDIB_BOOST_STATE_ON : BIDIB_BOOST_STATE_OFF;
+			}
+			send_message(node_index, SIM_MSG_BOOST_STAT, &railway.boost_state, 1);
+			break;
+		case SIM_MSG_ACCESSORY_SET:
+			if (len >= 2) {
+				set_accessory(node_index, data[0], data[1]);
+			}
+			break;
+		case SIM_MSG_ACCESSORY_GET:
+			if (len >= 1) {
+				send_accessory_state(node_index, data[0]);
+			}
+			break;
+		case SIM_MSG_LC_OUTPUT:
+		case SIM_MSG_LC_OUTPUT_QUERY:
+			// Peripherals switch at once, the port and its state are echoed
+			send_message(node_index, SIM_MSG_LC_STAT, data, len);
+			break;
+		case SIM_MSG_CS_SET_STATE:
+			if (len >= 1 && data[0] != BIDIB_CS_STATE_QUERY) {
+				railway.cs_state = data[0];
+			}
+			send_message(node_index, SIM_MSG_CS_STATE, &railway.cs_state, 1);
+			break;
+		case SIM_MSG_CS_DRIVE:
+			if (len >= 5) {
+				// Bit 0 of the active flags marks the speed as valid
+				if (data[3] & 0x01) {
+					drive_train((uint16_t) (data[0] | data[1] << 8), data[4]);
+				}
+				const uint8_t ack[3] = { data[0], data[1], 0x01 };
+				send_message(node_index, SIM_MSG_CS_DRIVE_ACK, ack, sizeof(ack));
+			}
+			break;
+		case SIM_MSG_CS_ACCESSORY:
+			if (len >= 2) {
+				const uint8_t ack[3] = { data[0], data[1], 0x01 };
+				send_message(node_index, SIM_MSG_CS_ACCESSORY_ACK, ack, sizeof(ack));
+			}
+			break;
+		default:
+			// Acknowledgements, e.g., of occupancy messages, and unsupported messages
+			break;
+	}
+}
+
+// Shall only be called with simulation_mutex acquired
+static void process_packet(const uint8_t packet[], size_t len) {
+	uint8_t crc = 0;
+	for (size_t i = 0; i < len; i++) {
+		crc = crc8_update(crc, packet[i]);
+	}
+	if (len < 2 || crc != 0) {
+		syslog_server(LOG_WARNING, "Railway simulation - dropped packet with invalid CRC");
+		return;
+	}
+	// Without the CRC
+	len--;
+	for (size_t i = 0; i < len; i += packet[i] + 1) {
+		const uint8_t *message = packet + i + 1;
+		const size_t message_len = MIN((size_t) packet[i], len - i - 1);
+		// Address stack: the interface (0) or one of its children (n, 0)
+		size_t j = 0;
+		unsigned int node_index = 0;
+		if (j < message_len && message[j] != 0x00) {
+			node_index = message[j++];
+			while (j < message_len && message[j] != 0x00) {
+				j++;
+			}
+		}
+		// Skip the terminating 0 and the message number
+		j += 2;
+		if (j >= message_len || node_index >= railway.nodes->len) {
+			continue;
+		}
+		process_message(node_index, message[j], message + j + 1, message_len - j - 1);
+	}
+}
+
+void railway_simulation_write(uint8_t byte) {
+	if (byte == BIDIB_MAGIC) {
+		if (downlink_len > 0) {
+			pthread_mutex_lock(&simulation_mutex);
+			if (simulation_running) {
+				process_packet(downlink_packet, downlink_len);
+			}
+			pthread_mutex_unlock(&simulation_mutex);
+		}
+		downlink_len = 0;
+		downlink_escaped = false;
+	} else if (byte == BIDIB_ESCAPE) {
+		downlink_escaped = true;
+	} else if (downlink_len < sizeof(downlink_packet)) {
+		downlink_packet[downlink_len++] = downlink_escaped ? byte ^ 0x20 : byte;
+		downlink_escaped = false;
+	}
+}
+
+
+// --- Configuration ---
+
+static yaml_node_t *yaml_mapping_get(yaml_document_t *document, yaml_node_t *mapping, 
+                                     const char *key) {
+	if (mapping == NULL || mapping->type != YAML_MAPPING_NODE) {
+		return NULL;
+	}
+	for (yaml_node_pair_t *pair = mapping->data.mapping.pairs.start; 
+	     pair < mapping->data.mapping.pairs.top; pair++) {
+		yaml_node_t *key_node = yaml_document_get_node(document, pair->key);
+		if (key_node != NULL && key_node->type == YAML_SCALAR_NODE 
+		    && str_equal((const char *) key_node->data.scalar.value, key)) {
+			return yaml_document_get_node(document, pair->value);
+		}
+	}
+	return NULL;
+}
+
+static const char *yaml_mapping_get_scalar(yaml_document_t *document, yaml_node_t *mapping, 
+                                           const char *key) {
+	yaml_node_t *node = yaml_mapping_get(document, mapping, key);
+	return (node != NULL && node->type == YAML_SCALAR_NODE) 
+	       ? (const char *) node->data.scalar.value : NULL;
+}
+
+static unsigned int yaml_sequence_len(yaml_node_t *sequence) {
+	return (sequence != NULL && sequence->type == YAML_SEQUENCE_NODE) 
+	       ? (unsigned int) (sequence->data.sequence.items.top 
+	                         - sequence->data.sequence.items.start) 
+	       : 0;
+}
+
+static yaml_node_t *yaml_sequence_get(yaml_document_t *document, yaml_node_t *sequence, 
+                                      unsigned int index) {
+	return yaml_document_get_node(document, sequence->data.sequence.items.start[index]);
+}
+
+static unsigned long parse_number(const char *str) {
+	return str == NULL ? 0 : strtoul(str, NULL, 0);
+}
+
+// Loads the root mapping of a configuration file into document
+static bool load_config_document(const char config_dir[], const char file[], 
+                                 yaml_document_t *document, bool required) {
+	FILE *fh = NULL;
+	yaml_parser_t parser;
+	if (!init_config_parser(config_dir, file, &fh, &parser)) {
+		syslog_server(required ? LOG_ERR : LOG_WARNING, 
+		              "Railway simulation - unable to open %s", file);
+		return false;
+	}
+	const bool loaded = yaml_parser_load(&parser, document) != 0;
+	destroy_parser(fh, &parser);
+	if (!loaded || yaml_document_get_root_node(document) == NULL) {
+		if (loaded) {
+			yaml_document_delete(document);
+		}
+		syslog_server(LOG_ERR, "Railway simulation - unable to parse %s", file);
+		return false;
+	}
+	return true;
+}
+
+static int node_index_of(const char *board_id) {
+	for (unsigned int i = 0; board_id != NULL && i < railway.nodes->len; i++) {
+		if (str_equal(g_array_index(railway.nodes, t_sim_node, i).id, board_id)) {
+			return (int) i;
+		}
+	}
+	return -1;
+}
+
+static int segment_index_of(const char *segment_id) {
+	const gpointer index = segment_id == NULL ? NULL 
+	                       : g_hash_table_lookup(railway.segment_indices, segment_id);
+	return index == NULL ? -1 : (int) GPOINTER_TO_UINT(index) - 1;
+}
+
+static bool load_boards(const char config_dir[]) {
+	yaml_document_t document;
+	if (!load_config_document(config_dir, "bidib_board_config.yml", &document, true)) {
+		return false;
+	}
+	yaml_node_t *boards = 
+			yaml_mapping_get(&document, yaml_document_get_root_node(&document), "boards");
+	const unsigned int board_count = MIN(yaml_sequence_len(boards), UINT8_MAX);
+	int interface = -1;
+	for (unsigned int i = 0; i < board_count; i++) {
+		yaml_node_t *board = yaml_sequence_get(&document, boards, i);
+		t_sim_node node = { .message_number = 1 };
+		node.id = g_strdup(yaml_mapping_get_scalar(&document, board, "id"));
+		const unsigned long long unique_id = 
+				strtoull(yaml_mapping_get_scalar(&document, board, "unique-id") ?: "0", NULL, 0);
+		for (unsigned int j = 0; j < 7; j++) {
+			node.unique_id[j] = (uint8_t) (unique_id >> (8 * (6 - j)));
+		}
+		for (unsigned int j = 0; j < 256; j++) {
+			node.features[j] = -1;
+		}
+		yaml_node_t *features = yaml_mapping_get(&document, board, "features");
+		for (unsigned int j = 0; j < yaml_sequence_len(features); j++) {
+			yaml_node_t *feature = yaml_sequence_get(&document, features, j);
+			const unsigned long number = 
+					parse_number(yaml_mapping_get_scalar(&document, feature, "number"));
+			node.features[number & 0xff] = 
+					(int16_t) (parse_number(yaml_mapping_get_scalar(&document, feature, "value"))
+					           & 0xff);
+		}
+		if (interface < 0 && (node.unique_id[0] & BIDIB_CLASS_INTERFACE)) {
+			interface = (int) i;
+		}
+		g_array_append_val(railway.nodes, node);
+	}
+	yaml_document_delete(&document);
+	
+	if (railway.nodes->len == 0) {
+		syslog_server(LOG_ERR, "Railway simulation - no boards configured");
+		return false;
+	}
+	// The interface is the node with local address 0
+	if (interface > 0) {
+		const t_sim_node node = g_array_index(railway.nodes, t_sim_node, interface);
+		g_array_remove_index(railway.nodes, interface);
+		g_array_prepend_val(railway.nodes, node);
+	}
+	return true;
+}
+
+static void add_accessory(unsigned int node, t_sim_accessory *accessory) {
+	const guint key = node << 8 | accessory->number;
+	if (g_hash_table_contains(railway.accessory_indices, GUINT_TO_POINTER(key))) {
+		return;
+	}
+	accessory->node = node;
+	g_array_append_val(railway.accessories, *accessory);
+	g_hash_table_insert(railway.accessory_indices, GUINT_TO_POINTER(key), 
+	                    GUINT_TO_POINTER(railway.accessories->len));
+}
+
+static void load_accessories(yaml_document_t *document, yaml_node_t *board, 
+                             unsigned int node, const char *kind, bool is_point) {
+	yaml_node_t *accessories = yaml_mapping_get(document, board, kind);
+	for (unsigned int i = 0; i < yaml_sequence_len(accessories); i++) {
+		yaml_node_t *item = yaml_sequence_get(document, accessories, i);
+		yaml_node_t *aspects = yaml_mapping_get(document, item, "aspects");
+		t_sim_accessory accessory = {
+			.number = (uint8_t) parse_number(yaml_mapping_get_scalar(document, item, "number")),
+			.is_point = is_point,
+			.aspect_count = (uint8_t) MAX(yaml_sequence_len(aspects), 2),
+			.normal_value = 0x01,
+			.reverse_value = 0x00,
+			.segment = segment_index_of(yaml_mapping_get_scalar(document, item, "segment"))
+		};
+		const char *initial = yaml_mapping_get_scalar(document, item, "initial");
+		for (unsigned int j = 0; j < yaml_sequence_len(aspects); j++) {
+			yaml_node_t *aspect = yaml_sequence_get(document, aspects, j);
+			const char *aspect_id = yaml_mapping_get_scalar(document, aspect, "id") ?: "";
+			const uint8_t value = 
+					(uint8_t) parse_number(yaml_mapping_get_scalar(document, aspect, "value"));
+			if (initial != NULL && str_equal(aspect_id, initial)) {
+				g_array_index(railway.nodes, t_sim_node, node).accessory_aspects[accessory.number] = 
+						value;
+			}
+			if (!is_point) {
+				continue;
+			} else if (str_equal(aspect_id, "normal")) {
+				accessory.normal_value = value;
+			} else if (str_equal(aspect_id, "reverse")) {
+				accessory.reverse_value = value;
+			}
+		}
+		add_accessory(node, &accessory);
+		if (is_point) {
+			const char *point_id = yaml_mapping_get_scalar(document, item, "id");
+			if (point_id != NULL) {
+				g_hash_table_insert(railway.point_accessories, g_strdup(point_id), 
+				                    GUINT_TO_POINTER(railway.accessories->len));
+			}
+		}
+	}
+}
+
+static bool load_track(const char config_dir[]) {
+	yaml_document_t document;
+	if (!load_config_document(config_dir, "bidib_track_config.yml", &document, true)) {
+		return false;
+	}
+	yaml_node_t *boards = 
+			yaml_mapping_get(&document, yaml_document_get_root_node(&document), "boards");
+	// Segments first, the points refer to them
+	for (unsigned int i = 0; i < yaml_sequence_len(boards); i++) {
+		yaml_node_t *board = yaml_sequence_get(&document, boards, i);
+		const int node = node_index_of(yaml_mapping_get_scalar(&document, board, "id"));
+		yaml_node_t *segments = yaml_mapping_get(&document, board, "segments");
+		for (unsigned int j = 0; node >= 0 && j < yaml_sequence_len(segments); j++) {
+			yaml_node_t *item = yaml_sequence_get(&document, segments, j);
+			const char *segment_id = yaml_mapping_get_scalar(&document, item, "id");
+			if (segment_id == NULL || segment_index_of(segment_id) >= 0) {
+				continue;
+			}
+			const char *length = yaml_mapping_get_scalar(&document, item, "length");
+			t_sim_segment segment = {
+				.id = g_strdup(segment_id),
+				.node = (unsigned int) node,
+				.address = (uint8_t) parse_number(
+						yaml_mapping_get_scalar(&document, item, "address")),
+				.length_cm = length == NULL ? 10.0f : MAX(parse_float(length), 1.0f)
+			};
+			g_array_append_val(railway.segments, segment);
+			g_hash_table_insert(railway.segment_indices, segment.id, 
+			                    GUINT_TO_POINTER(railway.segments->len));
+		}
+	}
+	for (unsigned int i = 0; i < yaml_sequence_len(boards); i++) {
+		yaml_node_t *board = yaml_sequence_get(&document, boards, i);
+		const int node = node_index_of(yaml_mapping_get_scalar(&document, board, "id"));
+		if (node >= 0) {
+			load_accessories(&document, board, (unsigned int) node, "points-board", true);
+			load_accessories(&document, board, (unsigned int) node, "signals-board", false);
+		}
+	}
+	yaml_document_delete(&document);
+	return true;
+}
+
+static void add_transition(const t_sim_transition *transition) {
+	for (unsigned int i = 0; i < railway.transitions->len; i++) {
+		const t_sim_transition *other = &g_array_index(railway.transitions, t_sim_transition, i);
+		if (other->from == transition->from && other->at == transition->at 
+		    && other->to == transition->to) {
+			return;
+		}
+	}
+	g_array_append_val(railway.transitions, *transition);
+}
+
+static bool load_routes(const char config_dir[]) {
+	yaml_document_t document;
+	if (!load_config_document(config_dir, "interlocking_table.yml", &document, false)) {
+		// The trains cannot leave the segments they are placed on
+		return true;
+	}
+	yaml_node_t *routes = yaml_mapping_get(&document, yaml_document_get_root_node(&document), 
+	                                       "interlocking-table");
+	GArray *path = g_array_new(false, false, sizeof(int));
+	for (unsigned int i = 0; i < yaml_sequence_len(routes); i++) {
+		yaml_node_t *route = yaml_sequence_get(&document, routes, i);
+		yaml_node_t *path_items = yaml_mapping_get(&document, route, "path");
+		yaml_node_t *points = yaml_mapping_get(&document, route, "points");
+		// Only the segments of the path, without its signals
+		g_array_set_size(path, 0);
+		for (unsigned int j = 0; j < yaml_sequence_len(path_items); j++) {
+			const int segment = segment_index_of(yaml_mapping_get_scalar(
+					&document, yaml_sequence_get(&document, path_items, j), "id"));
+			if (segment >= 0) {
+				g_array_append_val(path, segment);
+			}
+		}
+		for (unsigned int j = 0; j + 1 < path->len; j++) {
+			t_sim_transition transition = {
+				.from = j > 0 ? g_array_index(path, int, j - 1) : -1,
+				.at = g_array_index(path, int, j),
+				.to = g_array_index(path, int, j + 1)
+			};
+			for (unsigned int k = 0; k < yaml_sequence_len(points); k++) {
+				yaml_node_t *point = yaml_sequence_get(&document, points, k);
+				const char *point_id = yaml_mapping_get_scalar(&document, point, "id");
+				const gpointer index = point_id == NULL ? NULL 
+				                       : g_hash_table_lookup(railway.point_accessories, point_id);
+				if (index == NULL || transition.condition_count == 4) {
+					continue;
+				}
+				const int accessory = (int) GPOINTER_TO_UINT(index) - 1;
+				if (g_array_index(railway.accessories, t_sim_accessory, accessory).segment 
+				    == transition.at) {
+					const char *position = 
+							yaml_mapping_get_scalar(&document, point, "position");
+					transition.condition_accessories[transition.condition_count] = accessory;
+					transition.condition_reverse[transition.condition_count] = 
+							str_equal(position ?: "", "reverse");
+					transition.condition_count++;
+				}
+			}
+			add_transition(&transition);
+		}
+	}
+	g_array_free(path, true);
+	yaml_document_delete(&document);
+	return true;
+}
+
+static bool load_trains(const char config_dir[]) {
+	yaml_document_t document;
+	if (!load_config_document(config_dir, "bidib_train_config.yml", &document, true)) {
+		return false;
+	}
+	yaml_node_t *trains = 
+			yaml_mapping_get(&document, yaml_document_get_root_node(&document), "trains");
+	for (unsigned int i = 0; i < yaml_sequence_len(trains); i++) {
+		yaml_node_t *item = yaml_sequence_get(&document, trains, i);
+		const char *length = yaml_mapping_get_scalar(&document, item, "length");
+		t_sim_train train = {
+			.id = g_strdup(yaml_mapping_get_scalar(&document, item, "id") ?: "train"),
+			.dcc_address = (uint16_t) parse_number(
+					yaml_mapping_get_scalar(&document, item, "dcc-address")),
+			.length_cm = length == NULL ? 20.0f : parse_float(length),
+			.segment = -1,
+			.from = -1,
+			.rear = -1,
+			.heading_forward = true
+		};
+		g_array_append_val(railway.trains, train);
+	}
+	yaml_document_delete(&document);
+	return true;
+}
+
+// Places the trains on the main segments of the first blocks, without reporting them yet
+static bool place_trains(const char config_dir[]) {
+	yaml_document_t document;
+	if (!load_config_document(config_dir, "extras_config.yml", &document, false)) {
+		// The trains are not on the track
+		return true;
+	}
+	yaml_node_t *blocks = 
+			yaml_mapping_get(&document, yaml_document_get_root_node(&document), "blocks");
+	unsigned int block = 0;
+	for (unsigned int i = 0; i < MIN(railway.trains->len, train_count_max); i++) {
+		int segment = -1;
+		while (segment < 0 && block < yaml_sequence_len(blocks)) {
+			yaml_node_t *main = yaml_mapping_get(
+					&document, yaml_sequence_get(&document, blocks, block++), "main");
+			if (yaml_sequence_len(main) > 0) {
+				yaml_node_t *first = yaml_sequence_get(&document, main, 0);
+				if (first->type == YAML_SCALAR_NODE) {
+					segment = segment_index_of((const char *) first->data.scalar.value);
+				}
+			}
+		}
+		if (segment < 0) {
+			break;
+		}
+		t_sim_train *train = &g_array_index(railway.trains, t_sim_train, i);
+		train->placed = true;
+		train->segment = segment;
+		t_sim_segment *placed_on = &g_array_index(railway.segments, t_sim_segment, segment);
+		placed_on->occupants[placed_on->occupant_count++] = (int) i;
+	}
+	yaml_document_delete(&document);
+	return true;
+}
+
+static void free_railway(void) {
+	for (unsigned int i = 0; railway.nodes != NULL && i < railway.nodes->len; i++) {
+		g_free(g_array_index(railway.nodes, t_sim_node, i).id);
+	}
+	for (unsigned int i = 0; railway.trains != NULL && i < railway.trains->len; i++) {
+		g_free(g_array_index(railway.trains, t_sim_train, i).id);
+	}
+	// The segment ids are freed with the hash table
+	if (railway.segment_indices != NULL) {
+		g_hash_table_destroy(railway.segment_indices);
+	}
+	if (railway.accessory_indices != NULL) {
+		g_hash_table_destroy(railway.accessory_indices);
+	}
+	if (railway.point_accessories != NULL) {
+		g_hash_table_destroy(railway.point_accessories);
+	}
+	GArray *arrays[] = { railway.nodes, railway.segments, railway.accessories, 
+	                     railway.transitions, railway.trains };
+	for (unsigned int i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++) {
+		if (arrays[i] != NULL) {
+			g_array_free(arrays[i], true);
+		}
+	}
+	memset(&railway, 0, sizeof(railway));
+}
+
+
+// --- Simulation thread ---
+
+static void *simulation_run(void *_) {
+	int64_t last_tick_us = now_us();
+	while (simulation_running) {
+		usleep(tick_ms * 1000);
+		pthread_mutex_lock(&simulation_mutex);
+		const int64_t tick_us = now_us();
+		for (unsigned int i = 0; i < railway.accessories->len; i++) {
+			t_sim_accessory *accessory = &g_array_index(railway.accessories, t_sim_accessory, i);
+			if (accessory->moving && accessory->moving_until_us <= tick_us) {
+				accessory->moving = false;
+				g_array_index(railway.nodes, t_sim_node, accessory->node)
+						.accessory_aspects[accessory->number] = accessory->target_aspect;
+				send_accessory_state(accessory->node, accessory->number);
+			}
+		}
+		// Trains only move while the track output is on
+		if (railway.boost_state == BIDIB_BOOST_STATE_ON) {
+			for (unsigned int i = 0; i < railway.trains->len; i++) {
+				move_train((int) i, (float) (tick_us - last_tick_us) / 1000000.0f);
+			}
+		}
+		last_tick_us = tick_us;
+		pthread_mutex_unlock(&simulation_mutex);
+	}
+	return NULL;
+}
+
+bool railway_simulation_start(const char config_dir[]) {
+	pthread_mutex_lock(&simulation_mutex);
+	if (simulation_running) {
+		pthread_mutex_unlock(&simulation_mutex);
+		return false;
+	}
+	tick_ms = MAX(env_setting("SWTBAHN_SIM_TICK_MS", RAILWAY_SIMULATION_TICK_MS, 1000), 1);
+	point_latency_ms = env_setting("SWTBAHN_SIM_POINT_LATENCY_MS", 
+	                               RAILWAY_SIMULATION_POINT_LATENCY_MS, 60000);
+	signal_latency_ms = env_setting("SWTBAHN_SIM_SIGNAL_LATENCY_MS", 
+	                                RAILWAY_SIMULATION_SIGNAL_LATENCY_MS, 60000);
+	max_speed_cm_s = env_setting("SWTBAHN_SIM_MAX_SPEED_CM_S", 
+	                             RAILWAY_SIMULATION_MAX_SPEED_CM_S, 10000);
+	train_count_max = env_setting("SWTBAHN_SIM_TRAIN_COUNT", UINT8_MAX, UINT8_MAX);
+	
+	railway.nodes = g_array_new(false, true, sizeof(t_sim_node));
+	railway.segments = g_array_new(false, true, sizeof(t_sim_segment));
+	railway.accessories = g_array_new(false, true, sizeof(t_sim_accessory));
+	railway.transitions = g_array_new(false, true, sizeof(t_sim_transition));
+	railway.trains = g_array_new(false, true, sizeof(t_sim_train));
+	railway.segment_indices = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	railway.accessory_indices = g_hash_table_new(g_direct_hash, g_direct_equal);
+	railway.point_accessories = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	railway.boost_state = BIDIB_BOOST_STATE_OFF;
+	railway.cs_state = BIDIB_CS_STATE_GO;
+	
+	if (!load_boards(config_dir) || !load_track(config_dir) || !load_routes(config_dir) 
+	    || !load_trains(config_dir) || !place_trains(config_dir)) {
+		free_railway();
+		pthread_mutex_unlock(&simulation_mutex);
+		return false;
+	}
+	
+	pthread_mutex_lock(&uplink_mutex);
+	uplink_head = 0;
+	uplink_len = 0;
+	uplink_dropped = 0;
+	uplink_overflowing = false;
+	pthread_mutex_unlock(&uplink_mutex);
+	downlink_len = 0;
+	downlink_escaped = false;
+	
+	simulation_running = true;
+	if (pthread_create(&simulation_thread, NULL, simulation_run, NULL) != 0) {
+		simulation_running = false;
+		free_railway();
+		pthread_mutex_unlock(&simulation_mutex);
+		syslog_server(LOG_ERR, "Railway simulation - unable to start the simulation thread");
+		return false;
+	}
+	syslog_server(LOG_NOTICE, 
+	              "Railway simulation - started with %u nodes, %u segments, %u accessories, "
+	              "%u transitions and %u trains", 
+	              railway.nodes->len, railway.segments->len, railway.accessories->len, 
+	              railway.transitions->len, MIN(railway.trains->len, train_count_max));
+	pthread_mutex_unlock(&simulation_mutex);
+	return true;
+}
+
+void railway_simulation_stop(void) {
+	pthread_mutex_lock(&simulation_mutex);
+	if (!simulation_running) {
+		pthread_mutex_unlock(&simulation_mutex);
+		return;
+	}
+	simulation_running = false;
+	pthread_mutex_unlock(&simulation_mutex);
+	pthread_join(simulation_thread, NULL);
+	
+	pthread_mutex_lock(&simulation_mutex);
+	free_railway();
+	pthread_mutex_unlock(&simulation_mutex);
+	pthread_mutex_lock(&uplink_mutex);
+	if (uplink_dropped > 0) {
+		syslog_server(LOG_WARNING, "Railway simulation - dropped %lu BiDiB messages", 
+		              uplink_dropped);
+	}
+	uplink_len = 0;
+	pthread_mutex_unlock(&uplink_mutex);
+	syslog_server(LOG_NOTICE, "Railway simulation - stopped");
+}
@@ -0,0 +1,91 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#ifndef RAILWAY_SIMULATION_H
+#define RAILWAY_SIMULATION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Serial device name that makes the server drive the simulated railway instead of the 
+// BiDiB interface at a serial port
+#define RAILWAY_SIMULATION_DEVICE			"simulation"
+
+// Defaults of the settings read from the environment (see railway_simulation_start)
+#define RAILWAY_SIMULATION_TICK_MS			20
+#define RAILWAY_SIMULATION_POINT_LATENCY_MS	500
+#define RAILWAY_SIMULATION_SIGNAL_LATENCY_MS	50
+#define RAILWAY_SIMULATION_MAX_SPEED_CM_S	50
+// Bytes of BiDiB messages waiting to be read by libbidib
+#define RAILWAY_SIMULATION_UPLINK_LEN		(1 << 16)
+
+/**
+ * Builds the simulated railway from the BiDiB board, track and train configuration and 
+ * the interlocking table in config_dir, and starts the thread that moves the trains.
+ * 
+ * The simulation behaves like a BiDiB interface with the configured boards as its nodes: 
+ * points and signals reach their commanded aspect after a latency, trains move along the 
+ * segments of the interlocking table's routes with their commanded speed, and occupancy and 
+ * train positions (DCC addresses) are reported for the segments they occupy. The trains are 
+ * placed on the main segments of the first blocks of the extras configuration.
+ * 
+ * The environment variables SWTBAHN_SIM_TICK_MS, SWTBAHN_SIM_POINT_LATENCY_MS, 
+ * SWTBAHN_SIM_SIGNAL_LATENCY_MS, SWTBAHN_SIM_MAX_SPEED_CM_S (speed at the highest speed step) 
+ * and SWTBAHN_SIM_TRAIN_COUNT (number of trains placed on the track) override the defaults.
+ * Shall be called before libbidib is started with railway_simulation_read and 
+ * railway_simulation_write.
+ * 
+ * @param config_dir directory of the configuration files, ending with a slash
+ * @return true if the configuration could be loaded and the thread could be started
+ */
+bool railway_simulation_start(const char config_dir[]);
+
+/**
+ * Stops the simulation thread and frees the simulated railway.
+ * Shall be called after libbidib has been stopped.
+ */
+void railway_simulation_stop(void);
+
+/**
+ * Read function for bidib_start_pointer, does not block.
+ * 
+ * @param byte_read (out) 1 if a byte was read, otherwise 0
+ * @return the next byte sent by the simulated BiDiB interface
+ */
+uint8_t railway_simulation_read(int *byte_read);
+
+/**
+ * Write function for bidib_start_pointer. The simulated BiDiB interface processes a packet 
+ * once its terminating magic byte has been written.
+ * 
+ * @param byte next byte sent to the simulated BiDiB interface
+ */
+void railway_simulation_write(uint8_t byte);
+
+#endif  // RAILWAY_SIMULATION_H
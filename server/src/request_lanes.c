@@ -0,0 +1,237 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "request_lanes.h"
+#include "server.h"
+#include "communication_utils.h"
+#include "handler_driver.h"
+
+#define REQUEST_LANES_HANDLER_COUNT_MAX	128
+// Every train that can be grabbed may drive a route at once, which blocks its worker for the 
+// whole route, with workers to spare for route requests and uploads
+#define LONG_RUNNING_WORKER_COUNT		(TRAIN_ENGINE_INSTANCE_COUNT_MAX + 3)
+
+typedef onion_connection_status (*t_handler)(void *, onion_request *, onion_response *);
+
+typedef struct {
+	const char *name;
+	const char *env_name;
+	// Maximum number of requests handled at once
+	unsigned int workers;
+	// Maximum number of requests waiting for a worker
+	unsigned int queue_depth;
+	// Maximum time a request waits for a worker
+	unsigned int queue_timeout_ms;
+	// Seconds after which a rejected client should retry
+	const char *retry_after;
+	
+	pthread_mutex_t mutex;
+	pthread_cond_t worker_free;
+	unsigned int active;
+	unsigned int queued;
+	unsigned long long rejected;
+} t_lane;
+
+typedef struct {
+	t_lane *lane;
+	void *handler;
+	void *handler_data;
+} t_lane_handler;
+
+static t_lane lanes[REQUEST_LANE_COUNT] = {
+	[REQUEST_LANE_CONTROL] = {
+		"control", "CONTROL", 8, 16, 5000, "1", 
+		PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0
+	},
+	[REQUEST_LANE_LONG_RUNNING] = {
+		"long-running", "LONG_RUNNING", LONG_RUNNING_WORKER_COUNT, 4, 10000, "10", 
+		PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0
+	},
+	[REQUEST_LANE_MONITOR] = {
+		"monitor", "MONITOR", 8, 8, 1000, "1", 
+		PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0
+	}
+};
+
+// Only appended to before the server listens, so it is read without locking
+static t_lane_handler lane_handlers[REQUEST_LANES_HANDLER_COUNT_MAX];
+static unsigned int lane_handler_count = 0;
+
+// Returns the value of the environment variable SWTBAHN_<env_name>_<suffix>,
+// or default_value if it is not set or not a number
+static unsigned int env_uint(const char *env_name, const char *suffix, unsigned int min_value,
+                             unsigned int default_value) {
+	char variable[64];
+	snprintf(variable, sizeof(variable), "SWTBAHN_%s_%s", env_name, suffix);
+	const char *value = getenv(variable);
+	if (value == NULL) {
+		return default_value;
+	}
+	char *end = NULL;
+	const unsigned long number = strtoul(value, &end, 10);
+	if (end == value || *end != '\0' || number < min_value || number > 1024) {
+		syslog_server(LOG_WARNING, "Request lanes - invalid %s (%s), using %u", 
+		              variable, value, default_value);
+		return default_value;
+	}
+	return (unsigned int) number;
+}
+
+void request_lanes_configure_from_env(void) {
+	for (int i = 0; i < REQUEST_LANE_COUNT; i++) {
+		t_lane *lane = &lanes[i];
+		lane->workers = env_uint(lane->env_name, "WORKERS", 1, lane->workers);
+		lane->queue_depth = env_uint(lane->env_name, "QUEUE", 0, lane->queue_depth);
+		syslog_server(LOG_INFO, "Request lanes - %s: %u workers, queue depth %u", 
+		              lane->name, lane->workers, lane->queue_depth);
+	}
+}
+
+unsigned int request_lanes_thread_count(void) {
+	unsigned int count = 0;
+	for (int i = 0; i < REQUEST_LANE_COUNT; i++) {
+		count += lanes[i].workers + lanes[i].queue_depth;
+	}
+	return count;
+}
+
+void *request_lanes_wrap(t_request_lane lane, void *handler, void *handler_data) {
+	if (lane_handler_count >= REQUEST_LANES_HANDLER_COUNT_MAX || lane >= REQUEST_LANE_COUNT) {
+		return NULL;
+	}
+	t_lane_handler *lane_handler = &lane_handlers[lane_handler_count++];
+	lane_handler->lane = &lanes[lane];
+	lane_handler->handler = handler;
+	lane_handler->handler_data = handler_data;
+	return lane_handler;
+}
+
+// Waits for a free worker of the lane; returns false if the request has to be rejected
+static bool lane_enter(t_lane *lane) {
+	pthread_mutex_lock(&lane->mutex);
+	if (lane->active < lane->workers) {
+		lane->active++;
+		pthread_mutex_unlock(&lane->mutex);
+		return true;
+	}
+	if (lane->queued >= lane->queue_depth) {
+		lane->rejected++;
+		pthread_mutex_unlock(&lane->mutex);
+		return false;
+	}
+	
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += lane->queue_timeout_ms / 1000;
+	deadline.tv_nsec += (lane->queue_timeout_ms % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+	lane->queued++;
+	int err = 0;
+	while (lane->active >= lane->workers && err != ETIMEDOUT) {
+		err = pthread_cond_timedwait(&lane->worker_free, &lane->mutex, &deadline);
+	}
+	lane->queued--;
+	const bool admitted = lane->active < lane->workers;
+	if (admitted) {
+		lane->active++;
+	} else {
+		lane->rejected++;
+	}
+	pthread_mutex_unlock(&lane->mutex);
+	return admitted;
+}
+
+static void lane_leave(t_lane *lane) {
+	pthread_mutex_lock(&lane->mutex);
+	lane->active--;
+	pthread_cond_signal(&lane->worker_free);
+	pthread_mutex_unlock(&lane->mutex);
+}
+
+onion_connection_status request_lanes_handler(void *data, onion_request *req, 
+                                              onion_response *res) {
+	t_lane_handler *lane_handler = data;
+	t_lane *lane = lane_handler->lane;
+	if (!lane_enter(lane)) {
+		build_response_header(res);
+		onion_response_set_header(res, "Retry-After", lane->retry_after);
+		send_common_feedback(res, HTTP_SERVICE_UNAVAILABLE, "server busy, retry later");
+		syslog_server(LOG_WARNING, "Request lanes - %s lane is full, rejected %s", 
+		              lane->name, onion_request_get_path(req));
+		return OCS_PROCESSED;
+	}
+	const onion_connection_status status = 
+			((t_handler) lane_handler->handler)(lane_handler->handler_data, req, res);
+	lane_leave(lane);
+	return status;
+}
+
+void request_lanes_append_prometheus(GString *dest) {
+	unsigned int active[REQUEST_LANE_COUNT];
+	unsigned int queued[REQUEST_LANE_COUNT];
+	unsigned long long rejected[REQUEST_LANE_COUNT];
+	for (int i = 0; i < REQUEST_LANE_COUNT; i++) {
+		pthread_mutex_lock(&lanes[i].mutex);
+		active[i] = lanes[i].active;
+		queued[i] = lanes[i].queued;
+		rejected[i] = lanes[i].rejected;
+		pthread_mutex_unlock(&lanes[i].mutex);
+	}
+	
+	g_string_append(dest, 
+	                "# HELP swtbahn_lane_active_requests Requests being handled by the lane.\n"
+	                "# TYPE swtbahn_lane_active_requests gauge\n");
+	for (int i = 0; i < REQUEST_LANE_COUNT; i++) {
+		g_string_append_printf(dest, "swtbahn_lane_active_requests{lane=\"%s\"} %u\n", 
+		                       lanes[i].name, active[i]);
+	}
+	g_string_append(dest, 
+	                "# HELP swtbahn_lane_queued_requests Requests waiting for a worker.\n"
+	                "# TYPE swtbahn_lane_queued_requests gauge\n");
+	for (int i = 0; i < REQUEST_LANE_COUNT; i++) {
+		g_string_append_printf(dest, "swtbahn_lane_queued_requests{lane=\"%s\"} %u\n", 
+		                       lanes[i].name, queued[i]);
+	}
+	g_string_append(dest, 
+	                "# HELP swtbahn_lane_rejected_total Requests answered with 503.\n"
+	                "# TYPE swtbahn_lane_rejected_total counter\n");
+	for (int i = 0; i < REQUEST_LANE_COUNT; i++) {
+		g_string_append_printf(dest, "swtbahn_lane_rejected_total{lane=\"%s\"} %llu\n", 
+		                       lanes[i].name, rejected[i]);
+	}
+}
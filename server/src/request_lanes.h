@@ -0,0 +1,90 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#ifndef REQUEST_LANES_H
+#define REQUEST_LANES_H
+
+#include <glib.h>
+#include <onion/onion.h>
+
+// Lanes with separate admission limits, so that overload of one lane 
+// does not delay the requests of the others
+typedef enum {
+	// Commands that change the state of the track, e.g., speeds and points
+	REQUEST_LANE_CONTROL,
+	// Requests that block for seconds or longer, e.g., driving a route or uploading an engine
+	REQUEST_LANE_LONG_RUNNING,
+	// Queries of the state and static assets
+	REQUEST_LANE_MONITOR,
+	REQUEST_LANE_COUNT
+} t_request_lane;
+
+/**
+ * Reads the number of workers and the queue depth of each lane from the environment variables
+ * SWTBAHN_<LANE>_WORKERS and SWTBAHN_<LANE>_QUEUE, with <LANE> being CONTROL, LONG_RUNNING
+ * or MONITOR. Lanes without these variables keep their defaults.
+ * Shall only be called before the server starts listening.
+ */
+void request_lanes_configure_from_env(void);
+
+/**
+ * @return number of threads needed to serve the workers and queues of all lanes at once
+ */
+unsigned int request_lanes_thread_count(void);
+
+/**
+ * Wraps a handler such that its requests are admitted by the given lane: at most 
+ * the lane's number of workers are handled at once, up to the lane's queue depth wait 
+ * for a worker, all others are answered with 503 Service Unavailable and Retry-After.
+ * Shall only be called before the server starts listening.
+ * 
+ * @param lane lane that admits the requests
+ * @param handler onion handler function
+ * @param handler_data data passed to the handler function as first argument
+ * @return data to register together with request_lanes_handler, 
+ * or NULL if too many handlers were wrapped
+ */
+void *request_lanes_wrap(t_request_lane lane, void *handler, void *handler_data);
+
+/**
+ * Onion handler that admits the request to the lane given by data (see request_lanes_wrap),
+ * and then calls the wrapped handler.
+ */
+onion_connection_status request_lanes_handler(void *data, onion_request *req, 
+                                              onion_response *res);
+
+/**
+ * Appends the number of active, queued and rejected requests of each lane to a string 
+ * in the Prometheus text exposition format.
+ * 
+ * @param dest string to append to
+ */
+void request_lanes_append_prometheus(GString *dest);
+
+#endif  // REQUEST_LANES_H
@@ -0,0 +1,265 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "request_metrics.h"
+#include "server.h"
+
+typedef onion_connection_status (*t_handler)(void *, onion_request *, onion_response *);
+
+// Upper bounds of the latency histogram buckets, in microseconds; the last bucket is +Inf
+static const unsigned long long latency_bucket_bounds_us[] = {
+	500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 
+	1000000, 2500000, 5000000, 10000000
+};
+#define LATENCY_BUCKET_COUNT \
+	(sizeof(latency_bucket_bounds_us) / sizeof(latency_bucket_bounds_us[0]) + 1)
+
+typedef struct {
+	// 0 while the slot is unused
+	atomic_int code;
+	atomic_ullong count;
+} t_code_count;
+
+typedef struct {
+	char name[64];
+	void *handler;
+	void *handler_data;
+	atomic_ullong count;
+	atomic_ullong latency_us_sum;
+	// Not cumulative, the Prometheus buckets are accumulated on export
+	atomic_ullong latency_buckets[LATENCY_BUCKET_COUNT];
+	t_code_count codes[REQUEST_METRICS_CODE_COUNT_MAX];
+	atomic_ullong codes_other;
+} t_endpoint_metrics;
+
+typedef struct {
+	pthread_mutex_t *mutex;
+	const char *name;
+	atomic_ullong acquisitions;
+	atomic_ullong contended;
+	atomic_ullong wait_us_sum;
+} t_mutex_metrics;
+
+// Only appended to before the server listens, so they are read without locking
+static t_endpoint_metrics endpoints[REQUEST_METRICS_ENDPOINT_COUNT_MAX];
+static unsigned int endpoint_count = 0;
+static t_mutex_metrics mutexes[REQUEST_METRICS_MUTEX_COUNT_MAX];
+static unsigned int mutex_count = 0;
+
+// Status code of the response to the request handled by this thread; onion's default is 200
+static _Thread_local int response_code = HTTP_OK;
+
+static unsigned long long now_us(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void record_code(t_endpoint_metrics *endpoint, int code) {
+	for (unsigned int i = 0; i < REQUEST_METRICS_CODE_COUNT_MAX; i++) {
+		int slot_code = atomic_load(&endpoint->codes[i].code);
+		if (slot_code == 0) {
+			// Claim the unused slot; if another thread was faster, slot_code is its code
+			int expected = 0;
+			if (atomic_compare_exchange_strong(&endpoint->codes[i].code, &expected, code)) {
+				slot_code = code;
+			} else {
+				slot_code = expected;
+			}
+		}
+		if (slot_code == code) {
+			atomic_fetch_add(&endpoint->codes[i].count, 1);
+			return;
+		}
+	}
+	atomic_fetch_add(&endpoint->codes_other, 1);
+}
+
+static onion_connection_status request_metrics_handler(void *data, onion_request *req, 
+                                                       onion_response *res) {
+	t_endpoint_metrics *endpoint = data;
+	response_code = HTTP_OK;
+	const unsigned long long start_us = now_us();
+	const onion_connection_status status = 
+			((t_handler) endpoint->handler)(endpoint->handler_data, req, res);
+	const unsigned long long latency_us = now_us() - start_us;
+	
+	unsigned int bucket = 0;
+	while (bucket < LATENCY_BUCKET_COUNT - 1 && latency_us > latency_bucket_bounds_us[bucket]) {
+		bucket++;
+	}
+	atomic_fetch_add(&endpoint->latency_buckets[bucket], 1);
+	atomic_fetch_add(&endpoint->latency_us_sum, latency_us);
+	atomic_fetch_add(&endpoint->count, 1);
+	record_code(endpoint, response_code);
+	return status;
+}
+
+void request_metrics_url_add(onion_url *urls, const char *path, void *handler, 
+                             void *handler_data) {
+	if (endpoint_count >= REQUEST_METRICS_ENDPOINT_COUNT_MAX) {
+		syslog_server(LOG_WARNING, "Request metrics - too many endpoints, %s is not measured", 
+		              path);
+		onion_url_add_with_data(urls, path, handler, handler_data, NULL);
+		return;
+	}
+	t_endpoint_metrics *endpoint = &endpoints[endpoint_count++];
+	// Regular expression anchors are not part of the endpoint name
+	snprintf(endpoint->name, sizeof(endpoint->name), "%s", path[0] == '^' ? path + 1 : path);
+	endpoint->handler = handler;
+	endpoint->handler_data = handler_data;
+	onion_url_add_with_data(urls, path, request_metrics_handler, endpoint, NULL);
+}
+
+void request_metrics_record_code(int status_code) {
+	response_code = status_code;
+}
+
+int request_metrics_response_code(void) {
+	return response_code;
+}
+
+void request_metrics_track_mutex(pthread_mutex_t *mutex, const char *name) {
+	if (mutex_count >= REQUEST_METRICS_MUTEX_COUNT_MAX) {
+		syslog_server(LOG_WARNING, "Request metrics - too many mutexes, %s is not measured", name);
+		return;
+	}
+	mutexes[mutex_count].mutex = mutex;
+	mutexes[mutex_count].name = name;
+	mutex_count++;
+}
+
+void request_metrics_mutex_lock(pthread_mutex_t *mutex) {
+	t_mutex_metrics *metrics = NULL;
+	for (unsigned int i = 0; i < mutex_count; i++) {
+		if (mutexes[i].mutex == mutex) {
+			metrics = &mutexes[i];
+			break;
+		}
+	}
+	if (metrics == NULL) {
+		pthread_mutex_lock(mutex);
+		return;
+	}
+	atomic_fetch_add(&metrics->acquisitions, 1);
+	// Uncontended locks are not timed
+	if (pthread_mutex_trylock(mutex) == 0) {
+		return;
+	}
+	const unsigned long long start_us = now_us();
+	pthread_mutex_lock(mutex);
+	atomic_fetch_add(&metrics->wait_us_sum, now_us() - start_us);
+	atomic_fetch_add(&metrics->contended, 1);
+}
+
+static void append_endpoint_metrics(GString *dest, t_endpoint_metrics *endpoint) {
+	unsigned long long cumulative = 0;
+	for (unsigned int i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+		cumulative += atomic_load(&endpoint->latency_buckets[i]);
+		if (i < LATENCY_BUCKET_COUNT - 1) {
+			g_string_append_printf(dest, 
+			                       "swtbahn_http_request_duration_seconds_bucket"
+			                       "{endpoint=\"%s\",le=\"%g\"} %llu\n", 
+			                       endpoint->name, latency_bucket_bounds_us[i] / 1e6, cumulative);
+		} else {
+			g_string_append_printf(dest, 
+			                       "swtbahn_http_request_duration_seconds_bucket"
+			                       "{endpoint=\"%s\",le=\"+Inf\"} %llu\n", 
+			                       endpoint->name, cumulative);
+		}
+	}
+	g_string_append_printf(dest, 
+	                       "swtbahn_http_request_duration_seconds_sum{endpoint=\"%s\"} %.6f\n"
+	                       "swtbahn_http_request_duration_seconds_count{endpoint=\"%s\"} %llu\n",
+	                       endpoint->name, atomic_load(&endpoint->latency_us_sum) / 1e6, 
+	                       endpoint->name, cumulative);
+}
+
+GString *request_metrics_prometheus(void) {
+	GString *metrics = g_string_sized_new(2048 + 1536 * endpoint_count);
+	
+	g_string_append(metrics, 
+	                "# HELP swtbahn_http_requests_total Handled requests by endpoint and status.\n"
+	                "# TYPE swtbahn_http_requests_total counter\n");
+	for (unsigned int i = 0; i < endpoint_count; i++) {
+		t_endpoint_metrics *endpoint = &endpoints[i];
+		for (unsigned int j = 0; j < REQUEST_METRICS_CODE_COUNT_MAX; j++) {
+			const int code = atomic_load(&endpoint->codes[j].code);
+			if (code != 0) {
+				g_string_append_printf(metrics, 
+				                       "swtbahn_http_requests_total"
+				                       "{endpoint=\"%s\",code=\"%d\"} %llu\n", 
+				                       endpoint->name, code, 
+				                       atomic_load(&endpoint->codes[j].count));
+			}
+		}
+		const unsigned long long codes_other = atomic_load(&endpoint->codes_other);
+		if (codes_other > 0) {
+			g_string_append_printf(metrics, 
+			                       "swtbahn_http_requests_total"
+			                       "{endpoint=\"%s\",code=\"other\"} %llu\n", 
+			                       endpoint->name, codes_other);
+		}
+	}
+	
+	g_string_append(metrics, 
+	                "# HELP swtbahn_http_request_duration_seconds Time spent in the handler.\n"
+	                "# TYPE swtbahn_http_request_duration_seconds histogram\n");
+	for (unsigned int i = 0; i < endpoint_count; i++) {
+		append_endpoint_metrics(metrics, &endpoints[i]);
+	}
+	
+	g_string_append(metrics, 
+	                "# HELP swtbahn_mutex_acquisitions_total Locks of the mutex.\n"
+	                "# TYPE swtbahn_mutex_acquisitions_total counter\n");
+	for (unsigned int i = 0; i < mutex_count; i++) {
+		g_string_append_printf(metrics, "swtbahn_mutex_acquisitions_total{mutex=\"%s\"} %llu\n", 
+		                       mutexes[i].name, atomic_load(&mutexes[i].acquisitions));
+	}
+	g_string_append(metrics, 
+	                "# HELP swtbahn_mutex_contended_total Locks of the mutex that had to wait.\n"
+	                "# TYPE swtbahn_mutex_contended_total counter\n");
+	for (unsigned int i = 0; i < mutex_count; i++) {
+		g_string_append_printf(metrics, "swtbahn_mutex_contended_total{mutex=\"%s\"} %llu\n", 
+		                       mutexes[i].name, atomic_load(&mutexes[i].contended));
+	}
+	g_string_append(metrics, 
+	                "# HELP swtbahn_mutex_wait_seconds_total Time spent waiting for the mutex.\n"
+	                "# TYPE swtbahn_mutex_wait_seconds_total counter\n");
+	for (unsigned int i = 0; i < mutex_count; i++) {
+		g_string_append_printf(metrics, "swtbahn_mutex_wait_seconds_total{mutex=\"%s\"} %.6f\n", 
+		                       mutexes[i].name, atomic_load(&mutexes[i].wait_us_sum) / 1e6);
+	}
+	return metrics;
+}
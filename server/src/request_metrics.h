@@ -0,0 +1,93 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#ifndef REQUEST_METRICS_H
+#define REQUEST_METRICS_H
+
+#include <glib.h>
+#include <onion/onion.h>
+#include <pthread.h>
+
+// Maximum number of endpoints whose requests are measured
+#define REQUEST_METRICS_ENDPOINT_COUNT_MAX	128
+// Maximum number of distinct status codes counted per endpoint
+#define REQUEST_METRICS_CODE_COUNT_MAX		8
+// Maximum number of mutexes whose wait times are measured
+#define REQUEST_METRICS_MUTEX_COUNT_MAX		8
+
+/**
+ * Registers a handler for a path, like onion_url_add_with_data, but wrapped so that 
+ * the number of requests, their status codes, and their latencies are measured.
+ * Shall only be called before the server starts listening.
+ * 
+ * @param urls url handler to add to
+ * @param path path (regular expression) to handle, also used as the endpoint name
+ * @param handler onion handler function
+ * @param handler_data data passed to the handler function as first argument
+ */
+void request_metrics_url_add(onion_url *urls, const char *path, void *handler, 
+                             void *handler_data);
+
+/**
+ * Records the status code of the response to the request handled by the calling thread.
+ * Called by set_response_code, so that the code does not have to be read back from onion.
+ * 
+ * @param status_code http status code
+ */
+void request_metrics_record_code(int status_code);
+
+/**
+ * @return status code recorded for the request handled by the calling thread so far
+ */
+int request_metrics_response_code(void);
+
+/**
+ * Registers a mutex whose wait times are measured when it is locked 
+ * with request_metrics_mutex_lock.
+ * Shall only be called before the server starts listening.
+ * 
+ * @param mutex mutex to measure
+ * @param name name of the mutex in the metrics
+ */
+void request_metrics_track_mutex(pthread_mutex_t *mutex, const char *name);
+
+/**
+ * Locks a mutex like pthread_mutex_lock. If the mutex is registered and already locked, 
+ * the time spent waiting for it is measured.
+ * 
+ * @param mutex mutex to lock
+ */
+void request_metrics_mutex_lock(pthread_mutex_t *mutex);
+
+/**
+ * @return GString* containing all metrics in the Prometheus text exposition format (0.0.4)
+ */
+GString *request_metrics_prometheus(void);
+
+#endif  // REQUEST_METRICS_H
@@ -0,0 +1,194 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "response_cache.h"
+#include "server.h"
+#include "communication_utils.h"
+#include "response_encoding.h"
+#include "memory_footprint.h"
+
+// Length of a quoted 64-bit hexadecimal ETag with encoding suffix, including the terminating 0
+#define RESPONSE_CACHE_ETAG_LEN	24
+
+typedef struct {
+	GString *content;
+	char etag[RESPONSE_CACHE_ETAG_LEN];
+	t_response_cache_scope scope;
+	// Generations of the config and of the scope when the content was built
+	unsigned long long config_generation;
+	unsigned long long scope_generation;
+	// Estimated bytes of the entry, its content and its key
+	size_t footprint;
+} t_response_cache_entry;
+
+// Mutex to lock when accessing the cached responses and the generations
+static pthread_mutex_t response_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Key -> t_response_cache_entry
+static GHashTable *response_cache_entries = NULL;
+static unsigned long long response_cache_generations[RESPONSE_CACHE_SCOPE_COUNT] = {0};
+
+static void free_entry(void *pointer) {
+	t_response_cache_entry *entry = pointer;
+	memory_footprint_subtract(MEMORY_SUBSYSTEM_RESPONSE_CACHE, entry->footprint);
+	g_string_free(entry->content, true);
+	free(entry);
+}
+
+// FNV-1a, the ETag only has to change whenever the content changes
+static void compute_etag(const GString *content, char etag[RESPONSE_CACHE_ETAG_LEN]) {
+	uint64_t hash = 14695981039346656037ULL;
+	for (gsize i = 0; i < content->len; i++) {
+		hash ^= (unsigned char) content->str[i];
+		hash *= 1099511628211ULL;
+	}
+	snprintf(etag, RESPONSE_CACHE_ETAG_LEN, "\"%016" PRIx64 "\"", hash);
+}
+
+static bool etag_matches(onion_request *req, const char *etag) {
+	const char *if_none_match = onion_request_get_header(req, "If-None-Match");
+	if (if_none_match == NULL) {
+		return false;
+	}
+	// The header may list several (weak) ETags, all are compared weakly
+	return strcmp(if_none_match, "*") == 0 || strstr(if_none_match, etag) != NULL;
+}
+
+static void send_with_etag(onion_request *req, onion_response *res, 
+                           const char *content_etag, GString *content) {
+	// The same content has a different ETag in each encoding
+	char etag[RESPONSE_CACHE_ETAG_LEN];
+	if (response_encoding_current() == RESPONSE_ENCODING_CBOR) {
+		snprintf(etag, sizeof(etag), "%.17s-cbor\"", content_etag);
+	} else {
+		strcpy(etag, content_etag);
+	}
+	onion_response_set_header(res, "ETag", etag);
+	// Clients may store the response, but have to revalidate it on every use
+	onion_response_set_header(res, "Cache-Control", "no-cache");
+	if (etag_matches(req, etag)) {
+		g_string_free(content, true);
+		set_response_code(res, HTTP_NOT_MODIFIED);
+	} else {
+		send_some_gstring_and_free(res, HTTP_OK, content);
+	}
+}
+
+static bool entry_is_valid(const t_response_cache_entry *entry) {
+	return entry->config_generation == response_cache_generations[RESPONSE_CACHE_SCOPE_CONFIG]
+	       && entry->scope_generation == response_cache_generations[entry->scope];
+}
+
+void response_cache_invalidate(t_response_cache_scope scope) {
+	pthread_mutex_lock(&response_cache_mutex);
+	response_cache_generations[scope]++;
+	pthread_mutex_unlock(&response_cache_mutex);
+}
+
+bool response_cache_send(onion_request *req, onion_response *res, const char *key,
+                         t_response_cache_scope scope, t_response_cache_builder build,
+                         void *context) {
+	char etag[RESPONSE_CACHE_ETAG_LEN];
+	
+	pthread_mutex_lock(&response_cache_mutex);
+	if (response_cache_entries == NULL) {
+		response_cache_entries = g_hash_table_new_full(g_str_hash, g_str_equal, 
+		                                               free, free_entry);
+	}
+	t_response_cache_entry *entry = g_hash_table_lookup(response_cache_entries, key);
+	if (entry != NULL && entry_is_valid(entry)) {
+		// Copy, so that the mutex is not held while sending
+		GString *content = g_string_new_len(entry->content->str, entry->content->len);
+		strcpy(etag, entry->etag);
+		pthread_mutex_unlock(&response_cache_mutex);
+		send_with_etag(req, res, etag, content);
+		return true;
+	}
+	const unsigned long long config_generation = 
+			response_cache_generations[RESPONSE_CACHE_SCOPE_CONFIG];
+	const unsigned long long scope_generation = response_cache_generations[scope];
+	pthread_mutex_unlock(&response_cache_mutex);
+	
+	// Built without the mutex, builders may query BiDiB and take other locks
+	GString *content = build(context);
+	if (content == NULL) {
+		return false;
+	}
+	compute_etag(content, etag);
+	
+	pthread_mutex_lock(&response_cache_mutex);
+	// Only store the content if no invalidation happened while it was built
+	if (config_generation == response_cache_generations[RESPONSE_CACHE_SCOPE_CONFIG]
+	    && scope_generation == response_cache_generations[scope]) {
+		entry = malloc(sizeof(t_response_cache_entry));
+		if (entry != NULL) {
+			entry->content = g_string_new_len(content->str, content->len);
+			strcpy(entry->etag, etag);
+			entry->scope = scope;
+			entry->config_generation = config_generation;
+			entry->scope_generation = scope_generation;
+			entry->footprint = memory_footprint_of_block(sizeof(t_response_cache_entry)) 
+			                   + memory_footprint_of_gstring(entry->content) 
+			                   + memory_footprint_of_string(key);
+			memory_footprint_add(MEMORY_SUBSYSTEM_RESPONSE_CACHE, entry->footprint);
+			g_hash_table_replace(response_cache_entries, strdup(key), entry);
+		} else {
+			syslog_server(LOG_ERR, "Response cache - can't allocate entry for %s", key);
+		}
+	}
+	pthread_mutex_unlock(&response_cache_mutex);
+	
+	send_with_etag(req, res, etag, content);
+	return true;
+}
+
+bool response_cache_send_validated(onion_request *req, onion_response *res, GString *gstr) {
+	if (gstr == NULL) {
+		return false;
+	}
+	char etag[RESPONSE_CACHE_ETAG_LEN];
+	compute_etag(gstr, etag);
+	send_with_etag(req, res, etag, gstr);
+	return true;
+}
+
+void response_cache_free(void) {
+	pthread_mutex_lock(&response_cache_mutex);
+	if (response_cache_entries != NULL) {
+		g_hash_table_destroy(response_cache_entries);
+		response_cache_entries = NULL;
+	}
+	pthread_mutex_unlock(&response_cache_mutex);
+}
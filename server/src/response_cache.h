@@ -0,0 +1,95 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <glib.h>
+#include <onion/onion.h>
+#include <stdbool.h>
+
+// What the content of a cached response depends on; each scope has its own generation
+typedef enum {
+	// Track config and connected BiDiB boards, changes on startup and shutdown
+	RESPONSE_CACHE_SCOPE_CONFIG,
+	// Loaded train engines, changes on engine upload and removal
+	RESPONSE_CACHE_SCOPE_ENGINES,
+	// Loaded interlockers, changes on interlocker upload and removal
+	RESPONSE_CACHE_SCOPE_INTERLOCKERS,
+	RESPONSE_CACHE_SCOPE_COUNT
+} t_response_cache_scope;
+
+// Builds the content of a response, returns NULL on failure
+typedef GString *(*t_response_cache_builder)(void *context);
+
+/**
+ * Invalidates all cached responses of a scope. Invalidating the config scope
+ * invalidates the responses of all scopes.
+ * 
+ * @param scope scope whose generation is incremented
+ */
+void response_cache_invalidate(t_response_cache_scope scope);
+
+/**
+ * Sends a cached response with a strong ETag. The response content is only built 
+ * if the cache has no entry for the key that is valid in the current generation of 
+ * the scope. If the If-None-Match header of the request matches the ETag, only 
+ * 304 Not Modified is sent.
+ * 
+ * @param req request whose If-None-Match header is compared
+ * @param res response to send over
+ * @param key endpoint and parameters that identify the response content
+ * @param scope what the response content depends on
+ * @param build builds the response content
+ * @param context passed to build
+ * @return true if a response was sent, false if the content could not be built 
+ * (nothing is sent in this case)
+ */
+bool response_cache_send(onion_request *req, onion_response *res, const char *key,
+                         t_response_cache_scope scope, t_response_cache_builder build,
+                         void *context);
+
+/**
+ * Sends an uncached response with a strong ETag that is derived from its content.
+ * For responses that depend on the track state, so that clients that poll them still
+ * only receive 304 Not Modified while the state is unchanged.
+ * 
+ * @param req request whose If-None-Match header is compared
+ * @param res response to send over
+ * @param gstr response content, ownership is transferred. If NULL, nothing is sent.
+ * @return true if a response was sent, false otherwise
+ */
+bool response_cache_send_validated(onion_request *req, onion_response *res, GString *gstr);
+
+/**
+ * Frees all cached responses.
+ */
+void response_cache_free(void);
+
+#endif  // RESPONSE_CACHE_H
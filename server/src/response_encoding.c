@@ -0,0 +1,415 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "response_encoding.h"
+
+// Nesting depth of objects and arrays up to which json is transcoded
+#define RESPONSE_ENCODING_DEPTH_MAX	64
+
+typedef onion_connection_status (*t_handler)(void *, onion_request *, onion_response *);
+
+static _Thread_local t_response_encoding response_encoding = RESPONSE_ENCODING_JSON;
+
+typedef struct {
+	const char *pos;
+	const char *end;
+	GString *out;
+	unsigned int depth;
+} t_json_cursor;
+
+// CBOR major types
+enum {
+	CBOR_UINT = 0,
+	CBOR_NEGINT = 1,
+	CBOR_TEXT = 3
+};
+
+#define CBOR_INDEFINITE_ARRAY	0x9f
+#define CBOR_INDEFINITE_MAP		0xbf
+#define CBOR_FALSE				0xf4
+#define CBOR_TRUE				0xf5
+#define CBOR_NULL				0xf6
+#define CBOR_FLOAT32			0xfa
+#define CBOR_FLOAT64			0xfb
+#define CBOR_BREAK				0xff
+
+onion_connection_status response_encoding_handler(void *handler, onion_request *req, 
+                                                  onion_response *res) {
+	const char *accept = onion_request_get_header(req, "Accept");
+	response_encoding = accept != NULL && strstr(accept, RESPONSE_ENCODING_CBOR_MEDIA_TYPE) != NULL
+	                    ? RESPONSE_ENCODING_CBOR : RESPONSE_ENCODING_JSON;
+	onion_response_set_header(res, "Vary", "Accept");
+	const onion_connection_status status = ((t_handler) handler)(NULL, req, res);
+	response_encoding = RESPONSE_ENCODING_JSON;
+	return status;
+}
+
+t_response_encoding response_encoding_current(void) {
+	return response_encoding;
+}
+
+static void write_byte(GString *out, uint8_t byte) {
+	g_string_append_c(out, (char) byte);
+}
+
+static void write_big_endian(GString *out, uint64_t value, unsigned int byte_count) {
+	char bytes[8];
+	for (unsigned int i = byte_count; i > 0; i--) {
+		bytes[i - 1] = (char) (value & 0xff);
+		value >>= 8;
+	}
+	g_string_append_len(out, bytes, byte_count);
+}
+
+// Writes the initial byte of a data item and its argument in the shortest form
+static void write_head(GString *out, uint8_t major_type, uint64_t argument) {
+	const uint8_t major = (uint8_t) (major_type << 5);
+	if (argument < 24) {
+		write_byte(out, major | (uint8_t) argument);
+	} else if (argument <= UINT8_MAX) {
+		write_byte(out, major | 24);
+		write_big_endian(out, argument, 1);
+	} else if (argument <= UINT16_MAX) {
+		write_byte(out, major | 25);
+		write_big_endian(out, argument, 2);
+	} else if (argument <= UINT32_MAX) {
+		write_byte(out, major | 26);
+		write_big_endian(out, argument, 4);
+	} else {
+		write_byte(out, major | 27);
+		write_big_endian(out, argument, 8);
+	}
+}
+
+static void write_real(GString *out, double value) {
+	const float value_single = (float) value;
+	// The json only has the precision of the floats it was built from
+	if ((double) value_single == value 
+	    || fabs((double) value_single - value) <= fabs(value) * FLT_EPSILON) {
+		uint32_t bits;
+		memcpy(&bits, &value_single, sizeof(bits));
+		write_byte(out, CBOR_FLOAT32);
+		write_big_endian(out, bits, 4);
+	} else {
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		write_byte(out, CBOR_FLOAT64);
+		write_big_endian(out, bits, 8);
+	}
+}
+
+static void skip_whitespace(t_json_cursor *cursor) {
+	while (cursor->pos < cursor->end 
+	       && (*cursor->pos == ' ' || *cursor->pos == '\n' 
+	           || *cursor->pos == '\r' || *cursor->pos == '\t')) {
+		cursor->pos++;
+	}
+}
+
+static int hex_value(char c) {
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	} else if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	} else if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+static bool read_hex4(t_json_cursor *cursor, uint32_t *code_unit) {
+	if (cursor->end - cursor->pos < 4) {
+		return false;
+	}
+	*code_unit = 0;
+	for (int i = 0; i < 4; i++) {
+		const int value = hex_value(cursor->pos[i]);
+		if (value < 0) {
+			return false;
+		}
+		*code_unit = (*code_unit << 4) | (uint32_t) value;
+	}
+	cursor->pos += 4;
+	return true;
+}
+
+static void append_utf8(GString *dest, uint32_t code_point) {
+	if (code_point < 0x80) {
+		g_string_append_c(dest, (char) code_point);
+	} else if (code_point < 0x800) {
+		g_string_append_c(dest, (char) (0xc0 | (code_point >> 6)));
+		g_string_append_c(dest, (char) (0x80 | (code_point & 0x3f)));
+	} else if (code_point < 0x10000) {
+		g_string_append_c(dest, (char) (0xe0 | (code_point >> 12)));
+		g_string_append_c(dest, (char) (0x80 | ((code_point >> 6) & 0x3f)));
+		g_string_append_c(dest, (char) (0x80 | (code_point & 0x3f)));
+	} else {
+		g_string_append_c(dest, (char) (0xf0 | (code_point >> 18)));
+		g_string_append_c(dest, (char) (0x80 | ((code_point >> 12) & 0x3f)));
+		g_string_append_c(dest, (char) (0x80 | ((code_point >> 6) & 0x3f)));
+		g_string_append_c(dest, (char) (0x80 | (code_point & 0x3f)));
+	}
+}
+
+// Decodes the escape sequence after a backslash
+static bool read_escape(t_json_cursor *cursor, GString *dest) {
+	if (cursor->pos >= cursor->end) {
+		return false;
+	}
+	const char c = *cursor->pos++;
+	switch (c) {
+		case '"':  g_string_append_c(dest, '"'); return true;
+		case '\\': g_string_append_c(dest, '\\'); return true;
+		case '/':  g_string_append_c(dest, '/'); return true;
+		case 'b':  g_string_append_c(dest, '\b'); return true;
+		case 'f':  g_string_append_c(dest, '\f'); return true;
+		case 'n':  g_string_append_c(dest, '\n'); return true;
+		case 'r':  g_string_append_c(dest, '\r'); return true;
+		case 't':  g_string_append_c(dest, '\t'); return true;
+		case 'u': {
+			uint32_t code_point;
+			if (!read_hex4(cursor, &code_point)) {
+				return false;
+			}
+			// Surrogate pair
+			if (code_point >= 0xd800 && code_point < 0xdc00) {
+				uint32_t low;
+				if (cursor->end - cursor->pos < 2 || cursor->pos[0] != '\\' 
+				    || cursor->pos[1] != 'u') {
+					return false;
+				}
+				cursor->pos += 2;
+				if (!read_hex4(cursor, &low) || low < 0xdc00 || low >= 0xe000) {
+					return false;
+				}
+				code_point = 0x10000 + ((code_point - 0xd800) << 10) + (low - 0xdc00);
+			}
+			append_utf8(dest, code_point);
+			return true;
+		}
+		default:
+			return false;
+	}
+}
+
+static bool transcode_string(t_json_cursor *cursor) {
+	// cursor is at the opening quote mark
+	const char *start = ++cursor->pos;
+	const char *c = start;
+	while (c < cursor->end && *c != '"' && *c != '\\') {
+		c++;
+	}
+	if (c >= cursor->end) {
+		return false;
+	}
+	if (*c == '"') {
+		// No escape sequences, the bytes are copied as they are
+		write_head(cursor->out, CBOR_TEXT, (uint64_t) (c - start));
+		g_string_append_len(cursor->out, start, c - start);
+		cursor->pos = c + 1;
+		return true;
+	}
+	
+	GString *decoded = g_string_new_len(start, c - start);
+	cursor->pos = c;
+	while (cursor->pos < cursor->end && *cursor->pos != '"') {
+		if (*cursor->pos == '\\') {
+			cursor->pos++;
+			if (!read_escape(cursor, decoded)) {
+				g_string_free(decoded, true);
+				return false;
+			}
+		} else {
+			g_string_append_c(decoded, *cursor->pos++);
+		}
+	}
+	if (cursor->pos >= cursor->end) {
+		g_string_free(decoded, true);
+		return false;
+	}
+	cursor->pos++;
+	write_head(cursor->out, CBOR_TEXT, decoded->len);
+	g_string_append_len(cursor->out, decoded->str, decoded->len);
+	g_string_free(decoded, true);
+	return true;
+}
+
+static bool transcode_number(t_json_cursor *cursor) {
+	const char *start = cursor->pos;
+	bool is_real = false;
+	while (cursor->pos < cursor->end) {
+		const char c = *cursor->pos;
+		if (c == '.' || c == 'e' || c == 'E') {
+			is_real = true;
+		} else if (!((c >= '0' && c <= '9') || c == '-' || c == '+')) {
+			break;
+		}
+		cursor->pos++;
+	}
+	const size_t len = cursor->pos - start;
+	if (len == 0 || len >= 64) {
+		return false;
+	}
+	char number[64];
+	memcpy(number, start, len);
+	number[len] = '\0';
+	char *number_end = NULL;
+	
+	if (!is_real) {
+		errno = 0;
+		const long long value = strtoll(number, &number_end, 10);
+		if (*number_end != '\0') {
+			return false;
+		}
+		if (errno != ERANGE) {
+			if (value >= 0) {
+				write_head(cursor->out, CBOR_UINT, (uint64_t) value);
+			} else {
+				write_head(cursor->out, CBOR_NEGINT, (uint64_t) (-(value + 1)));
+			}
+			return true;
+		}
+	}
+	const double value = g_ascii_strtod(number, &number_end);
+	if (*number_end != '\0') {
+		return false;
+	}
+	write_real(cursor->out, value);
+	return true;
+}
+
+static bool transcode_literal(t_json_cursor *cursor, const char *literal, uint8_t simple_value) {
+	const size_t len = strlen(literal);
+	if ((size_t) (cursor->end - cursor->pos) < len || memcmp(cursor->pos, literal, len) != 0) {
+		return false;
+	}
+	cursor->pos += len;
+	write_byte(cursor->out, simple_value);
+	return true;
+}
+
+static bool transcode_value(t_json_cursor *cursor);
+
+// Transcodes the members of an object or the elements of an array
+static bool transcode_container(t_json_cursor *cursor, bool is_object) {
+	if (++cursor->depth > RESPONSE_ENCODING_DEPTH_MAX) {
+		return false;
+	}
+	const char closing = is_object ? '}' : ']';
+	write_byte(cursor->out, is_object ? CBOR_INDEFINITE_MAP : CBOR_INDEFINITE_ARRAY);
+	cursor->pos++;
+	skip_whitespace(cursor);
+	if (cursor->pos < cursor->end && *cursor->pos == closing) {
+		cursor->pos++;
+		write_byte(cursor->out, CBOR_BREAK);
+		cursor->depth--;
+		return true;
+	}
+	while (cursor->pos < cursor->end) {
+		if (is_object) {
+			if (*cursor->pos != '"' || !transcode_string(cursor)) {
+				return false;
+			}
+			skip_whitespace(cursor);
+			if (cursor->pos >= cursor->end || *cursor->pos != ':') {
+				return false;
+			}
+			cursor->pos++;
+			skip_whitespace(cursor);
+		}
+		if (!transcode_value(cursor)) {
+			return false;
+		}
+		skip_whitespace(cursor);
+		if (cursor->pos >= cursor->end) {
+			return false;
+		} else if (*cursor->pos == ',') {
+			cursor->pos++;
+			skip_whitespace(cursor);
+		} else if (*cursor->pos == closing) {
+			cursor->pos++;
+			write_byte(cursor->out, CBOR_BREAK);
+			cursor->depth--;
+			return true;
+		} else {
+			return false;
+		}
+	}
+	return false;
+}
+
+static bool transcode_value(t_json_cursor *cursor) {
+	if (cursor->pos >= cursor->end) {
+		return false;
+	}
+	switch (*cursor->pos) {
+		case '{':
+			return transcode_container(cursor, true);
+		case '[':
+			return transcode_container(cursor, false);
+		case '"':
+			return transcode_string(cursor);
+		case 't':
+			return transcode_literal(cursor, "true", CBOR_TRUE);
+		case 'f':
+			return transcode_literal(cursor, "false", CBOR_FALSE);
+		case 'n':
+			return transcode_literal(cursor, "null", CBOR_NULL);
+		default:
+			return transcode_number(cursor);
+	}
+}
+
+GString *response_encoding_json_to_cbor(const char *json, size_t json_len) {
+	if (json == NULL) {
+		return NULL;
+	}
+	// CBOR is usually less than two thirds the size of the json built by json_response_builder
+	t_json_cursor cursor = {
+		.pos = json, 
+		.end = json + json_len, 
+		.out = g_string_sized_new(json_len * 2 / 3 + 16), 
+		.depth = 0
+	};
+	skip_whitespace(&cursor);
+	bool valid = transcode_value(&cursor);
+	skip_whitespace(&cursor);
+	if (!valid || cursor.pos != cursor.end) {
+		g_string_free(cursor.out, true);
+		return NULL;
+	}
+	return cursor.out;
+}
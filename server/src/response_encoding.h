@@ -0,0 +1,78 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#ifndef RESPONSE_ENCODING_H
+#define RESPONSE_ENCODING_H
+
+#include <glib.h>
+#include <onion/onion.h>
+#include <stdbool.h>
+
+#define RESPONSE_ENCODING_CBOR_MEDIA_TYPE	"application/cbor"
+
+typedef enum {
+	RESPONSE_ENCODING_JSON,
+	// CBOR (RFC 8949) with the same structure as the json, 
+	// objects and arrays are encoded with indefinite length
+	RESPONSE_ENCODING_CBOR
+} t_response_encoding;
+
+/**
+ * Onion handler that negotiates the encoding of the reply from the Accept header 
+ * of the request, and then calls the wrapped handler. Replies that the wrapped handler 
+ * sends via send_some_gstring_and_free are encoded accordingly.
+ * Register with onion_url_add_with_data, passing the wrapped handler as data.
+ * 
+ * @param handler wrapped handler
+ * @param req request
+ * @param res response
+ * @return connection status returned by the wrapped handler
+ */
+onion_connection_status response_encoding_handler(void *handler, onion_request *req, 
+                                                  onion_response *res);
+
+/**
+ * @return encoding negotiated for the request handled by the calling thread, 
+ * RESPONSE_ENCODING_JSON outside of response_encoding_handler
+ */
+t_response_encoding response_encoding_current(void);
+
+/**
+ * Transcodes json to CBOR. Strings are decoded to UTF-8, integers are encoded as 
+ * CBOR integers, and real numbers as single precision floats if that does not lose 
+ * precision, otherwise as double precision floats.
+ * 
+ * @param json json to transcode
+ * @param json_len length of json in bytes
+ * @return GString* containing the CBOR encoding (binary, may contain 0 bytes), 
+ * or NULL if json is not valid json
+ */
+GString *response_encoding_json_to_cbor(const char *json, size_t json_len);
+
+#endif  // RESPONSE_ENCODING_H
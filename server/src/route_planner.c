@@ -0,0 +1,288 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "route_planner.h"
+#include "server.h"
+#include "bahn_data_util.h"
+#include "memory_footprint.h"
+
+/**
+ * Route graph index, with the adjacency stored as arrays (compressed sparse rows):
+ * The outgoing edges of node n are edge_offsets[n] to edge_offsets[n + 1] - 1.
+ */
+typedef struct {
+	unsigned int node_count;
+	unsigned int edge_count;
+	// Signal ids of the nodes, owned by the interlocking table
+	const char **node_ids;
+	// Signal id -> node index + 1
+	GHashTable *node_indices;
+	unsigned int *edge_offsets;
+	unsigned int *edge_targets;
+	float *edge_weights;
+	// Routes of the edges, owned by the interlocking table
+	t_interlocking_route **edge_routes;
+} t_route_graph;
+
+static t_route_graph route_graph = {};
+
+static int get_node_index(const char *signal_id) {
+	if (route_graph.node_indices == NULL || signal_id == NULL) {
+		return -1;
+	}
+	const unsigned int index_plus_one = 
+			GPOINTER_TO_UINT(g_hash_table_lookup(route_graph.node_indices, signal_id));
+	return (int) index_plus_one - 1;
+}
+
+static unsigned int add_node(const char *signal_id) {
+	const int node_index = get_node_index(signal_id);
+	if (node_index >= 0) {
+		return node_index;
+	}
+	route_graph.node_ids[route_graph.node_count] = signal_id;
+	g_hash_table_insert(route_graph.node_indices, (gpointer) signal_id, 
+	                    GUINT_TO_POINTER(route_graph.node_count + 1));
+	return route_graph.node_count++;
+}
+
+bool route_planner_initialise(void) {
+	route_planner_free();
+	
+	GArray *route_ids = interlocking_table_get_all_route_ids_shallowcpy();
+	const unsigned int route_count = route_ids->len;
+	
+	// Every route adds at most two nodes
+	route_graph.node_ids = malloc(sizeof(char *) * (2 * route_count + 1));
+	route_graph.node_indices = g_hash_table_new(g_str_hash, g_str_equal);
+	route_graph.edge_targets = malloc(sizeof(unsigned int) * (route_count + 1));
+	route_graph.edge_weights = malloc(sizeof(float) * (route_count + 1));
+	route_graph.edge_routes = malloc(sizeof(t_interlocking_route *) * (route_count + 1));
+	unsigned int *edge_sources = malloc(sizeof(unsigned int) * (route_count + 1));
+	if (route_graph.node_ids == NULL || route_graph.edge_targets == NULL
+	    || route_graph.edge_weights == NULL || route_graph.edge_routes == NULL
+	    || edge_sources == NULL) {
+		syslog_server(LOG_ERR, "Route planner initialise - unable to allocate memory");
+		free(edge_sources);
+		g_array_free(route_ids, true);
+		route_planner_free();
+		return false;
+	}
+	
+	// 1. Nodes, and the source node of each edge
+	unsigned int edge_count = 0;
+	for (unsigned int i = 0; i < route_count; i++) {
+		t_interlocking_route *route = get_route(g_array_index(route_ids, char *, i));
+		if (route == NULL || route->source == NULL || route->destination == NULL) {
+			continue;
+		}
+		edge_sources[edge_count] = add_node(route->source);
+		route_graph.edge_targets[edge_count] = add_node(route->destination);
+		route_graph.edge_weights[edge_count] = route->length;
+		route_graph.edge_routes[edge_count] = route;
+		edge_count++;
+	}
+	g_array_free(route_ids, true);
+	route_graph.edge_count = edge_count;
+	
+	// 2. Sort the edges by their source node
+	route_graph.edge_offsets = calloc(route_graph.node_count + 1, sizeof(unsigned int));
+	unsigned int *edge_targets = malloc(sizeof(unsigned int) * (edge_count + 1));
+	float *edge_weights = malloc(sizeof(float) * (edge_count + 1));
+	t_interlocking_route **edge_routes = malloc(sizeof(t_interlocking_route *) * (edge_count + 1));
+	if (route_graph.edge_offsets == NULL || edge_targets == NULL 
+	    || edge_weights == NULL || edge_routes == NULL) {
+		syslog_server(LOG_ERR, "Route planner initialise - unable to allocate memory");
+		free(edge_sources);
+		free(edge_targets);
+		free(edge_weights);
+		free(edge_routes);
+		route_planner_free();
+		return false;
+	}
+	for (unsigned int i = 0; i < edge_count; i++) {
+		route_graph.edge_offsets[edge_sources[i] + 1]++;
+	}
+	for (unsigned int n = 0; n < route_graph.node_count; n++) {
+		route_graph.edge_offsets[n + 1] += route_graph.edge_offsets[n];
+	}
+	unsigned int next_edge[route_graph.node_count + 1];
+	memcpy(next_edge, route_graph.edge_offsets, sizeof(unsigned int) * route_graph.node_count);
+	for (unsigned int i = 0; i < edge_count; i++) {
+		const unsigned int e = next_edge[edge_sources[i]]++;
+		edge_targets[e] = route_graph.edge_targets[i];
+		edge_weights[e] = route_graph.edge_weights[i];
+		edge_routes[e] = route_graph.edge_routes[i];
+	}
+	free(edge_sources);
+	free(route_graph.edge_targets);
+	free(route_graph.edge_weights);
+	free(route_graph.edge_routes);
+	route_graph.edge_targets = edge_targets;
+	route_graph.edge_weights = edge_weights;
+	route_graph.edge_routes = edge_routes;
+	
+	syslog_server(LOG_NOTICE, "Route planner initialise - %u signals, %u routes - done", 
+	              route_graph.node_count, route_graph.edge_count);
+	return true;
+}
+
+void route_planner_free(void) {
+	if (route_graph.node_indices != NULL) {
+		g_hash_table_destroy(route_graph.node_indices);
+	}
+	free(route_graph.node_ids);
+	free(route_graph.edge_offsets);
+	free(route_graph.edge_targets);
+	free(route_graph.edge_weights);
+	free(route_graph.edge_routes);
+	route_graph = (t_route_graph) {};
+}
+
+size_t route_planner_memory_footprint(void) {
+	if (route_graph.node_ids == NULL) {
+		return 0;
+	}
+	const size_t route_count = interlocking_table_get_size();
+	const size_t edge_count = route_graph.edge_count;
+	return memory_footprint_of_block(sizeof(char *) * (2 * route_count + 1)) 
+	       + memory_footprint_of_hash_table(route_graph.node_indices) 
+	       + memory_footprint_of_block(sizeof(unsigned int) * (route_graph.node_count + 1)) 
+	       + memory_footprint_of_block(sizeof(unsigned int) * (edge_count + 1)) 
+	       + memory_footprint_of_block(sizeof(float) * (edge_count + 1)) 
+	       + memory_footprint_of_block(sizeof(t_interlocking_route *) * (edge_count + 1));
+}
+
+// Marks the nodes of the signals of a block (or of a single signal) in node_flags. 
+// Returns the number of marked nodes.
+static unsigned int mark_nodes_of(const char *id, bool node_flags[]) {
+	const int node_index = get_node_index(id);
+	if (node_index >= 0) {
+		node_flags[node_index] = true;
+		return 1;
+	}
+	char *block_signals[route_graph.node_count + 1];
+	const int block_signals_len = 
+			config_get_array_string_value("block", id, "block_signals", block_signals);
+	unsigned int marked = 0;
+	for (int i = 0; i < block_signals_len; i++) {
+		const int signal_node_index = get_node_index(block_signals[i]);
+		if (signal_node_index >= 0) {
+			node_flags[signal_node_index] = true;
+			marked++;
+		}
+	}
+	return marked;
+}
+
+GArray *route_planner_plan(const char *source_block_id, const char *target_id,
+                           t_route_planner_route_filter filter, void *filter_context,
+                           float *plan_length) {
+	if (source_block_id == NULL || target_id == NULL || route_graph.node_count == 0) {
+		syslog_server(LOG_ERR, "Route planner plan - invalid parameters or no route graph");
+		return NULL;
+	}
+	
+	const unsigned int node_count = route_graph.node_count;
+	bool is_source[node_count];
+	bool is_target[node_count];
+	memset(is_source, 0, sizeof(is_source));
+	memset(is_target, 0, sizeof(is_target));
+	if (mark_nodes_of(source_block_id, is_source) == 0 
+	    || mark_nodes_of(target_id, is_target) == 0) {
+		syslog_server(LOG_ERR, 
+		              "Route planner plan - from: %s to: %s - source or target has no signals",
+		              source_block_id, target_id);
+		return NULL;
+	}
+	
+	// Dijkstra from all source nodes at once. The graph only has one node per signal, 
+	// so a linear scan for the closest node is cheaper than maintaining a heap.
+	float distance[node_count];
+	int previous_edge[node_count];
+	bool is_settled[node_count];
+	for (unsigned int n = 0; n < node_count; n++) {
+		distance[n] = is_source[n] ? 0.0f : FLT_MAX;
+		previous_edge[n] = -1;
+		is_settled[n] = false;
+	}
+	int reached_target = -1;
+	while (reached_target < 0) {
+		int closest = -1;
+		for (unsigned int n = 0; n < node_count; n++) {
+			if (!is_settled[n] && distance[n] < FLT_MAX
+			    && (closest < 0 || distance[n] < distance[closest])) {
+				closest = n;
+			}
+		}
+		if (closest < 0) {
+			break;
+		}
+		is_settled[closest] = true;
+		if (is_target[closest]) {
+			reached_target = closest;
+			break;
+		}
+		for (unsigned int e = route_graph.edge_offsets[closest]; 
+		     e < route_graph.edge_offsets[closest + 1]; e++) {
+			const unsigned int next = route_graph.edge_targets[e];
+			const float next_distance = distance[closest] + route_graph.edge_weights[e];
+			if (is_settled[next] || next_distance >= distance[next]) {
+				continue;
+			}
+			if (filter != NULL && !filter(route_graph.edge_routes[e], filter_context)) {
+				continue;
+			}
+			distance[next] = next_distance;
+			previous_edge[next] = e;
+		}
+	}
+	
+	if (reached_target < 0) {
+		syslog_server(LOG_INFO, "Route planner plan - from: %s to: %s - no plan exists",
+		              source_block_id, target_id);
+		return NULL;
+	}
+	
+	// Follow the edges back to the source, then reverse into driving order
+	GArray *plan_route_ids = g_array_new(FALSE, FALSE, sizeof(char *));
+	for (int e = previous_edge[reached_target]; e >= 0; ) {
+		const t_interlocking_route *route = route_graph.edge_routes[e];
+		g_array_prepend_val(plan_route_ids, route->id);
+		e = previous_edge[get_node_index(route->source)];
+	}
+	if (plan_length != NULL) {
+		*plan_length = distance[reached_target];
+	}
+	return plan_route_ids;
+}
@@ -0,0 +1,86 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#ifndef ROUTE_PLANNER_H
+#define ROUTE_PLANNER_H
+
+#include <glib.h>
+#include <stdbool.h>
+
+#include "interlocking.h"
+
+/**
+ * Filter for the routes that a plan may use.
+ * 
+ * @param route candidate route of the plan
+ * @param context context that was passed to route_planner_plan
+ * @return true if the route may be used, otherwise false
+ */
+typedef bool (*t_route_planner_route_filter)(const t_interlocking_route *route, void *context);
+
+/**
+ * Builds the route graph index from the interlocking table: 
+ * The signals are the nodes, and each route is an edge from its source signal to its 
+ * destination signal, weighted by the route length. 
+ * Shall only be called after the interlocking table has been initialised.
+ *
+ * @return true if successful, otherwise false
+ */
+bool route_planner_initialise(void);
+
+/**
+ * Frees the route graph index.
+ */
+void route_planner_free(void);
+
+/**
+ * @return estimated bytes held by the route graph index (see memory_footprint.h)
+ */
+size_t route_planner_memory_footprint(void);
+
+/**
+ * Plans the shortest sequence of routes from one of the signals of a block to a target,
+ * which is either a signal or a block. If the target is a block, the sequence ends at any
+ * of the signals of the target block.
+ * The caller is responsible for freeing the returned array, but not the contained 
+ * route IDs(!), which are owned by the interlocking table.
+ * 
+ * @param source_block_id id of the block from which the plan starts
+ * @param target_id id of the target signal or block
+ * @param filter filter for the routes that may be used, or NULL to allow all routes
+ * @param filter_context context that is passed to the filter
+ * @param plan_length set to the sum of the route lengths of the plan, if not NULL
+ * @return array of route IDs in driving order (empty if the source already is the target),
+ * or NULL if no plan exists or the parameters are invalid
+ */
+GArray *route_planner_plan(const char *source_block_id, const char *target_id,
+                           t_route_planner_route_filter filter, void *filter_context,
+                           float *plan_length);
+
+#endif  // ROUTE_PLANNER_H
@@ -0,0 +1,199 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "route_speed_profile.h"
+#include "server.h"
+#include "bahn_data_util.h"
+
+// Largest number of calibrated speeds of a train
+#define CALIBRATION_LEN_MAX 16
+
+static float speed_step_to_cm_per_s(float speed_step) {
+	return speed_step * SPEED_PROFILE_CM_PER_S_PER_SPEED_STEP;
+}
+
+static float cm_per_s_to_speed_step(float cm_per_s) {
+	return cm_per_s / SPEED_PROFILE_CM_PER_S_PER_SPEED_STEP;
+}
+
+/**
+ * @brief Gets the highest speed step that the train shall be driven with, 
+ * i.e., the highest step of its calibration.
+ * 
+ * @param train_id id of the train
+ * @return int highest speed step
+ */
+static int get_train_speed_max(const char *train_id) {
+	int calibration[CALIBRATION_LEN_MAX];
+	const int calibration_len = 
+			config_get_bounded_array_int_value("train", train_id, "calibration", 
+			                                   calibration, CALIBRATION_LEN_MAX);
+	if (calibration_len <= 0 || calibration_len > CALIBRATION_LEN_MAX) {
+		return SPEED_PROFILE_SPEED_MAX_DEFAULT;
+	}
+	int speed_max = 0;
+	for (int i = 0; i < calibration_len; i++) {
+		if (calibration[i] > speed_max) {
+			speed_max = calibration[i];
+		}
+	}
+	return speed_max > SPEED_PROFILE_SPEED_MAX ? SPEED_PROFILE_SPEED_MAX : speed_max;
+}
+
+/**
+ * @brief Gets the deceleration of the train, which is lower for heavier trains.
+ * 
+ * @param train_id id of the train
+ * @return float deceleration in cm/s^2
+ */
+static float get_train_deceleration(const char *train_id) {
+	const float weight = config_get_scalar_float_value("train", train_id, "weight");
+	if (weight <= 0.0f) {
+		return SPEED_PROFILE_DECELERATION_REF;
+	}
+	float factor = SPEED_PROFILE_WEIGHT_REF / weight;
+	factor = factor < 0.5f ? 0.5f : (factor > 1.5f ? 1.5f : factor);
+	return SPEED_PROFILE_DECELERATION_REF * factor;
+}
+
+/**
+ * @brief Gets the speed limit of the block that a path item belongs to.
+ * 
+ * @param item_id id of the route path item
+ * @return int speed limit as speed step, or SPEED_PROFILE_SPEED_MAX if there is no limit
+ */
+static int get_path_item_speed_limit(const char *item_id) {
+	if (!is_type_segment(item_id)) {
+		return SPEED_PROFILE_SPEED_MAX;
+	}
+	const char *block_id = config_get_block_id_of_segment(item_id);
+	if (block_id == NULL || block_id[0] == '\0') {
+		return SPEED_PROFILE_SPEED_MAX;
+	}
+	const float limit_kmh = config_get_scalar_float_value("block", block_id, "limit");
+	if (limit_kmh <= 0.0f) {
+		return SPEED_PROFILE_SPEED_MAX;
+	}
+	const float limit_cm_per_s = limit_kmh * 100000.0f / 3600.0f / SPEED_PROFILE_MODEL_SCALE;
+	const float limit_speed_step = cm_per_s_to_speed_step(limit_cm_per_s);
+	return limit_speed_step > SPEED_PROFILE_SPEED_MAX ? SPEED_PROFILE_SPEED_MAX 
+	                                                   : (int) limit_speed_step;
+}
+
+t_route_speed_profile route_speed_profile_plan(const t_interlocking_route *route, 
+                                               const char *train_id) {
+	t_route_speed_profile profile = { .len = 0, .speeds = NULL, .speed_max = 0 };
+	if (route == NULL || route->path == NULL || route->path->len < 2 || train_id == NULL) {
+		syslog_server(LOG_ERR, "Route speed profile plan - invalid parameters");
+		return profile;
+	}
+	
+	const unsigned int len = route->path->len;
+	float *lengths = malloc(len * sizeof(float));
+	int *speeds = malloc(len * sizeof(int));
+	if (lengths == NULL || speeds == NULL) {
+		syslog_server(LOG_ERR, 
+		              "Route speed profile plan - route: %s train: %s - "
+		              "unable to allocate memory", 
+		              route->id, train_id);
+		free(lengths);
+		free(speeds);
+		return profile;
+	}
+	
+	// 1. Lengths of the path items; signals have no length
+	float lengths_sum = 0.0f;
+	unsigned int segment_count = 0;
+	for (unsigned int i = 0; i < len; i++) {
+		const char *item_id = g_array_index(route->path, char *, i);
+		lengths[i] = 0.0f;
+		if (is_type_segment(item_id)) {
+			lengths[i] = config_get_scalar_float_value("segment", item_id, "length");
+			lengths_sum += lengths[i];
+			segment_count++;
+		}
+	}
+	if (lengths_sum <= 0.0f && route->length > 0.0f && segment_count > 0) {
+		// No segment lengths configured, spread the route length over its segments
+		for (unsigned int i = 0; i < len; i++) {
+			const char *item_id = g_array_index(route->path, char *, i);
+			if (is_type_segment(item_id)) {
+				lengths[i] = route->length / segment_count;
+			}
+		}
+	}
+	
+	// 2. Braking curve, planned backwards from the destination: 
+	//    Stop once the destination is reached, creep once the segment before it is reached.
+	//    Otherwise, the train may only be as fast as it can still decelerate to the speed 
+	//    of the next path item within the length of that item.
+	const int speed_max = get_train_speed_max(train_id);
+	const float deceleration = get_train_deceleration(train_id);
+	const int speed_creep = speed_max < SPEED_PROFILE_SPEED_CREEP ? speed_max 
+	                                                               : SPEED_PROFILE_SPEED_CREEP;
+	speeds[len - 1] = 0;
+	speeds[len - 2] = speed_creep;
+	for (int i = (int) len - 3; i >= 0; i--) {
+		const float v_next = speed_step_to_cm_per_s(speeds[i + 1]);
+		const float v_brake = sqrtf(v_next * v_next + 2.0f * deceleration * lengths[i + 1]);
+		int speed = (int) cm_per_s_to_speed_step(v_brake);
+		
+		const int speed_limit = get_path_item_speed_limit(g_array_index(route->path, char *, i));
+		speed = speed > speed_limit ? speed_limit : speed;
+		speed = speed > speed_max ? speed_max : speed;
+		// Never slower than creeping, as the train would otherwise stop before the destination
+		speeds[i] = speed < speed_creep ? speed_creep : speed;
+	}
+	free(lengths);
+	
+	profile.len = len;
+	profile.speeds = speeds;
+	for (unsigned int i = 0; i < len; i++) {
+		if (speeds[i] > profile.speed_max) {
+			profile.speed_max = speeds[i];
+		}
+	}
+	syslog_server(LOG_INFO, 
+	              "Route speed profile plan - route: %s train: %s - "
+	              "max speed: %d, deceleration: %.1f cm/s^2",
+	              route->id, train_id, profile.speed_max, deceleration);
+	return profile;
+}
+
+void route_speed_profile_free(t_route_speed_profile *profile) {
+	if (profile == NULL) {
+		return;
+	}
+	free(profile->speeds);
+	profile->speeds = NULL;
+	profile->len = 0;
+}
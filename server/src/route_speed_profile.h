@@ -0,0 +1,80 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+#ifndef ROUTE_SPEED_PROFILE_H
+#define ROUTE_SPEED_PROFILE_H
+
+#include "interlocking.h"
+
+// Speed step from which a train creeps towards the destination signal
+#define SPEED_PROFILE_SPEED_CREEP				25
+// Speed step used for trains without calibration data
+#define SPEED_PROFILE_SPEED_MAX_DEFAULT			40
+#define SPEED_PROFILE_SPEED_MAX					126
+
+// Approximate speed in cm/s that a train drives per DCC speed step
+#define SPEED_PROFILE_CM_PER_S_PER_SPEED_STEP	0.45f
+// Deceleration in cm/s^2 of a train with the reference weight (in g)
+#define SPEED_PROFILE_DECELERATION_REF			18.0f
+#define SPEED_PROFILE_WEIGHT_REF				75.0f
+// Model scale, to convert the (scale) km/h of block speed limits into cm/s
+#define SPEED_PROFILE_MODEL_SCALE				87.0f
+
+typedef struct {
+	// Number of items in the route path
+	unsigned int len;
+	// Speed step to command once the train has reached route->path[i]
+	int *speeds;
+	// Highest speed step of the profile
+	int speed_max;
+} t_route_speed_profile;
+
+/**
+ * @brief Plans the fastest speed profile with which the train can drive the route and 
+ * still stop at the destination signal. The profile respects the speed limits of the 
+ * blocks along the route and the highest calibrated speed of the train, and decelerates
+ * according to the segment lengths and the weight of the train, such that the train 
+ * creeps into the destination segment. 
+ * Shall only be called while the config and interlocking table are loaded.
+ * 
+ * @param route route to be driven, with at least two path items
+ * @param train_id id of the train that drives the route
+ * @return t_route_speed_profile the profile, with speeds == NULL if the planning failed.
+ * Has to be freed with route_speed_profile_free.
+ */
+t_route_speed_profile route_speed_profile_plan(const t_interlocking_route *route, 
+                                               const char *train_id);
+
+/**
+ * @brief Frees the speeds of a speed profile.
+ * 
+ * @param profile profile to free
+ */
+void route_speed_profile_free(t_route_speed_profile *profile);
+
+#endif  // ROUTE_SPEED_PROFILE_H
@@ -38,15 +38,22 @@
 #include <time.h>
 #include <unistd.h>
 
+#include "server.h"
 #include "handler_monitor.h"
 #include "handler_admin.h"
 #include "handler_driver.h"
 #include "handler_controller.h"
 #include "handler_upload.h"
+#include "state_stream.h"
+#include "response_encoding.h"
+#include "asset_store.h"
+#include "request_metrics.h"
+#include "request_lanes.h"
+#include "command_journal.h"
+#include "log_buffer.h"
+#include "dyn_containers_interface.h"
 #include "websocket_uploader/engine_uploader.h"
 
-#define INPUT_MAX_LEN 256
-
 
 volatile time_t session_id = 0;
 volatile bool running = false;
@@ -55,29 +62,149 @@ char serial_device[INPUT_MAX_LEN];
 char config_directory[INPUT_MAX_LEN];
 
 
-void syslog_server(int priority, const char *format, ...) {
-	char string[1024];
+volatile int syslog_server_level = LOG_INFO;
+
+void syslog_server_write(int priority, const char *format, ...) {
 	va_list arg;
 	va_start(arg, format);
-	vsnprintf(string, 1024, format, arg);
-	
-	syslog(priority, "server: %s", string);
+	// Written synchronously only while the log buffer is not running
+	if (!log_buffer_push(priority, format, arg)) {
+		char string[LOG_BUFFER_MESSAGE_LEN_MAX];
+		vsnprintf(string, LOG_BUFFER_MESSAGE_LEN_MAX, format, arg);
+		syslog(priority, "server: %s", string);
+	}
 	va_end(arg);
 }
 
 void build_response_header(onion_response *res) {
 	onion_response_set_header(res, "Access-Control-Allow-Origin",  "*");
 	onion_response_set_header(res, "Access-Control-Allow-Headers", 
-	                               "Authorization, Origin, X-Requested-With, Content-Type, Accept");
+	                               "Authorization, Origin, X-Requested-With, Content-Type, Accept, "
+	                               "If-None-Match");
 	onion_response_set_header(res, "Access-Control-Allow-Methods", 
 	                               "POST, GET, PUT, DELETE, OPTIONS");
+	onion_response_set_header(res, "Access-Control-Expose-Headers", "ETag");
+}
+
+// Requests of these paths block for seconds or longer. Startup and shutdown are admitted by 
+// the control lane instead, so that the operator is not queued behind the driving trains
+static const char *long_running_paths[] = {
+	"driver/request-route", "driver/request-route-by-id", "driver/drive-route", 
+	"upload/engine", "upload/interlocker"
+};
+
+// Requests of these paths are admitted without limit: emergency stops have to get through 
+// also under overload, the state stream limits its clients itself, and the home page 
+// redirects internally to the assets, whose lane admits the request again. Admitting it 
+// twice in the same lane could deadlock a full lane
+static const char *unlimited_paths[] = {
+	"driver/set-train-emergency-stop", "driver/set-all-trains-emergency-stop", 
+	"monitor/state-stream", ""
+};
+
+// Threads for the requests admitted without limit and for rejecting requests of full lanes
+#define UNLIMITED_THREAD_COUNT 8
+
+// Requests of these paths are queries, although their paths are below those of the commands
+static const char *unjournaled_paths[] = {
+	"controller/get-interlocker", "driver/plan", "driver/direction", "upload/status"
+};
+
+// Requests of these paths are journaled only once they have been answered, so that 
+// the journal does not delay the stop
+static const char *journaled_after_handling_paths[] = {
+	"driver/set-train-emergency-stop", "driver/set-all-trains-emergency-stop"
+};
+
+static bool is_journaled_after_handling(const char *path) {
+	for (size_t i = 0; 
+	     i < sizeof(journaled_after_handling_paths) / sizeof(journaled_after_handling_paths[0]); 
+	     i++) {
+		if (strcmp(path, journaled_after_handling_paths[i]) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Returns whether the requests of the path change the state and are thus journaled 
+// (see command_journal.h)
+static bool is_journaled(const char *path) {
+	for (size_t i = 0; i < sizeof(unjournaled_paths) / sizeof(unjournaled_paths[0]); i++) {
+		if (strcmp(path, unjournaled_paths[i]) == 0) {
+			return false;
+		}
+	}
+	return g_str_has_prefix(path, "admin/") || g_str_has_prefix(path, "controller/") 
+	       || g_str_has_prefix(path, "driver/") || g_str_has_prefix(path, "upload/");
+}
+
+// Returns the lane that admits the requests of the path, 
+// or REQUEST_LANE_COUNT if they are admitted without limit
+static t_request_lane request_lane_of(const char *path) {
+	for (size_t i = 0; i < sizeof(unlimited_paths) / sizeof(unlimited_paths[0]); i++) {
+		if (strcmp(path, unlimited_paths[i]) == 0) {
+			return REQUEST_LANE_COUNT;
+		}
+	}
+	for (size_t i = 0; i < sizeof(long_running_paths) / sizeof(long_running_paths[0]); i++) {
+		if (strcmp(path, long_running_paths[i]) == 0) {
+			return REQUEST_LANE_LONG_RUNNING;
+		}
+	}
+	if (g_str_has_prefix(path, "admin/") || g_str_has_prefix(path, "controller/") 
+	    || g_str_has_prefix(path, "driver/")) {
+		return REQUEST_LANE_CONTROL;
+	}
+	return REQUEST_LANE_MONITOR;
+}
+
+// Registers a handler whose requests are admitted by the lane of the path (see request_lanes.h), 
+// measured (see request_metrics.h), and journaled if they change the state
+static void url_add_in_lane(onion_url *urls, const char *path, void *handler, 
+                            void *handler_data) {
+	void *journal_handler = 
+			is_journaled(path) 
+			? command_journal_wrap(handler, handler_data, is_journaled_after_handling(path)) 
+			: NULL;
+	if (journal_handler != NULL) {
+		handler = command_journal_handler;
+		handler_data = journal_handler;
+	}
+	const t_request_lane lane = request_lane_of(path);
+	void *lane_handler = NULL;
+	if (lane != REQUEST_LANE_COUNT) {
+		lane_handler = request_lanes_wrap(lane, handler, handler_data);
+	}
+	if (lane_handler != NULL) {
+		request_metrics_url_add(urls, path, request_lanes_handler, lane_handler);
+	} else {
+		request_metrics_url_add(urls, path, handler, handler_data);
+	}
+}
+
+static void url_add_measured(onion_url *urls, const char *path, void *handler) {
+	url_add_in_lane(urls, path, handler, NULL);
+}
+
+// Registers a handler whose json replies are encoded as CBOR if the client accepts it
+static void url_add_negotiated(onion_url *urls, const char *path, void *handler) {
+	url_add_in_lane(urls, path, response_encoding_handler, handler);
 }
 
+static const char assets_local_path[] = "../src/assets/";
+
 static onion_connection_status handler_assets(void *_, onion_request *req, onion_response *res) {
 	build_response_header(res);
 	onion_response_set_header(res, "Cache-Control", "max-age=43200");
 	
-	const char local_path[] = "../src/assets/";
+	const char *filename = onion_request_get_path(req);
+	if (asset_store_serve(filename, req, res)) {
+		return OCS_PROCESSED;
+	}
+	
+	// Not preloaded, e.g., added after startup or too large
+	const char *local_path = assets_local_path;
 	char *global_path = realpath(local_path, NULL);
 	if (!global_path) {
 		syslog_server(LOG_ERR, 
@@ -97,7 +224,6 @@ static onion_connection_status handler_assets(void *_, onion_request *req, onion
 		return OCS_NOT_IMPLEMENTED;
 	}
 	
-	const char *filename = onion_request_get_path(req);
 	GString *full_filename = g_string_new(global_path);
 	onion_low_free(global_path);
 	g_string_append(full_filename, filename);
@@ -139,94 +265,131 @@ int main(int argc, char **argv) {
 	}
 	
 	openlog("swtbahn", 0, LOG_LOCAL0);
+	if (!log_buffer_start()) {
+		syslog_server(LOG_WARNING, "Cannot start the log buffer, logging synchronously");
+	}
 	syslog_server(LOG_NOTICE, "SWTbahn server started");
-	///TODO: Consider making configurable a max_thread count to limit 
-	// overloading on weaker setups. Default by onion is 16
+	request_lanes_configure_from_env();
 	onion *o = onion_new(O_THREADED);
+	// Each state stream client occupies a thread for as long as it is connected
+	onion_set_max_threads(o, request_lanes_thread_count() + UNLIMITED_THREAD_COUNT 
+	                         + STATE_STREAM_CLIENT_COUNT_MAX);
 	onion_set_hostname(o, argv[3]);
 	onion_set_port(o, argv[4]);
 	onion_url *urls = onion_root_url(o);
 	
+	request_metrics_track_mutex(&grabbed_trains_mutex, "grabbed_trains_mutex");
+	request_metrics_track_mutex(&interlocker_mutex, "interlocker_mutex");
+	request_metrics_track_mutex(&dyn_containers_mutex, "dyn_containers_mutex");
+	
 	// --- assets ---
-	onion_url_add(urls, "^assets", handler_assets);
+	url_add_measured(urls, "^assets", handler_assets);
 	
 	// --- home page ---
-	onion_url_add_with_data(urls, "", onion_shortcut_internal_redirect, "assets/index.html", NULL);
+	url_add_in_lane(urls, "", onion_shortcut_internal_redirect, "assets/index.html");
 	
 	// --- admin functions ---
-	onion_url_add(urls, "admin/startup", handler_startup);
-	onion_url_add(urls, "admin/shutdown", handler_shutdown);
-	onion_url_add(urls, "admin/set-track-output", handler_set_track_output);
-	onion_url_add(urls, "admin/set-verification-option", handler_set_verification_option);
-	onion_url_add(urls, "admin/set-verification-url", handler_set_verification_url);
-	onion_url_add(urls, "admin/release-train", handler_admin_release_train);
-	onion_url_add(urls, "admin/set-dcc-train-speed", handler_admin_set_dcc_train_speed);
+	url_add_measured(urls, "admin/startup", handler_startup);
+	url_add_measured(urls, "admin/shutdown", handler_shutdown);
+	url_add_measured(urls, "admin/set-track-output", handler_set_track_output);
+	url_add_measured(urls, "admin/set-verification-option", handler_set_verification_option);
+	url_add_measured(urls, "admin/set-verification-url", handler_set_verification_url);
+	url_add_measured(urls, "admin/set-log-level", handler_set_log_level);
+	url_add_measured(urls, "admin/release-train", handler_admin_release_train);
+	url_add_measured(urls, "admin/set-dcc-train-speed", handler_admin_set_dcc_train_speed);
+	url_add_measured(urls, "admin/start-scheduler", handler_start_scheduler);
+	url_add_measured(urls, "admin/stop-scheduler", handler_stop_scheduler);
 	
 	// --- track controller functions ---
-	onion_url_add(urls, "controller/release-route", handler_release_route);
-	onion_url_add(urls, "controller/set-point", handler_set_point);
-	onion_url_add(urls, "controller/set-signal", handler_set_signal);
-	onion_url_add(urls, "controller/set-peripheral", handler_set_peripheral);
-	onion_url_add(urls, "controller/get-interlocker", handler_get_interlocker);
-	onion_url_add(urls, "controller/set-interlocker", handler_set_interlocker);
-	onion_url_add(urls, "controller/unset-interlocker", handler_unset_interlocker);
+	url_add_measured(urls, "controller/release-route", handler_release_route);
+	url_add_measured(urls, "controller/set-point", handler_set_point);
+	url_add_measured(urls, "controller/set-signal", handler_set_signal);
+	url_add_measured(urls, "controller/set-peripheral", handler_set_peripheral);
+	url_add_measured(urls, "controller/set-accessories", handler_set_accessories);
+	url_add_measured(urls, "controller/get-interlocker", handler_get_interlocker);
+	url_add_measured(urls, "controller/set-interlocker", handler_set_interlocker);
+	url_add_measured(urls, "controller/unset-interlocker", handler_unset_interlocker);
 	
 	// --- train driver functions ---
-	onion_url_add(urls, "driver/grab-train", handler_grab_train);
-	onion_url_add(urls, "driver/release-train", handler_release_train);
-	onion_url_add(urls, "driver/request-route", handler_request_route);
+	url_add_negotiated(urls, "driver/grab-train", handler_grab_train);
+	url_add_negotiated(urls, "driver/release-train", handler_release_train);
+	url_add_negotiated(urls, "driver/request-route", handler_request_route);
 	/// NOTE: Changed path from request-route-id to request-route-by-id
-	onion_url_add(urls, "driver/request-route-by-id", handler_request_route_by_id);
-	onion_url_add(urls, "driver/direction", handler_driving_direction);
-	onion_url_add(urls, "driver/drive-route", handler_drive_route);
-	onion_url_add(urls, "driver/set-dcc-train-speed", handler_set_dcc_train_speed);
-	onion_url_add(urls, "driver/set-calibrated-train-speed", handler_set_calibrated_train_speed);
-	onion_url_add(urls, "driver/set-train-emergency-stop", handler_set_train_emergency_stop);
-	onion_url_add(urls, "driver/set-train-peripheral", handler_set_train_peripheral);
+	url_add_negotiated(urls, "driver/request-route-by-id", handler_request_route_by_id);
+	url_add_negotiated(urls, "driver/plan", handler_plan_route);
+	url_add_negotiated(urls, "driver/direction", handler_driving_direction);
+	url_add_negotiated(urls, "driver/drive-route", handler_drive_route);
+	url_add_negotiated(urls, "driver/set-dcc-train-speed", handler_set_dcc_train_speed);
+	url_add_negotiated(urls, "driver/set-calibrated-train-speed", handler_set_calibrated_train_speed);
+	url_add_negotiated(urls, "driver/set-train-emergency-stop", handler_set_train_emergency_stop);
+	url_add_negotiated(urls, "driver/set-all-trains-emergency-stop", 
+	                   handler_set_all_trains_emergency_stop);
+	url_add_negotiated(urls, "driver/set-train-peripheral", handler_set_train_peripheral);
 	
 	// --- upload functions ---
-	onion_url_add(urls, "upload/engine", handler_upload_engine);
-	onion_url_add(urls, "upload/remove-engine", handler_remove_engine);
-	onion_url_add(urls, "upload/interlocker", handler_upload_interlocker);
-	onion_url_add(urls, "upload/remove-interlocker", handler_remove_interlocker);
+	url_add_measured(urls, "upload/engine", handler_upload_engine);
+	url_add_measured(urls, "upload/remove-engine", handler_remove_engine);
+	url_add_measured(urls, "upload/interlocker", handler_upload_interlocker);
+	url_add_measured(urls, "upload/remove-interlocker", handler_remove_interlocker);
+	url_add_measured(urls, "upload/status", handler_get_upload_status);
 	
 	// --- monitor functions ---
-	onion_url_add(urls, "monitor/platform-name", handler_get_platform_name);
-	onion_url_add(urls, "monitor/trains", handler_get_trains);
-	onion_url_add(urls, "monitor/train-state", handler_get_train_state);
-	onion_url_add(urls, "monitor/train-states", handler_get_train_states);
-	onion_url_add(urls, "monitor/train-peripherals", handler_get_train_peripherals);
-	onion_url_add(urls, "monitor/engines", handler_get_engines);
-	onion_url_add(urls, "monitor/interlockers", handler_get_interlockers);
-	onion_url_add(urls, "monitor/track-outputs", handler_get_track_outputs);
-	onion_url_add(urls, "monitor/points", handler_get_points);
-	onion_url_add(urls, "monitor/signals", handler_get_signals);
-	onion_url_add(urls, "monitor/point-details", handler_get_point_details);
-	onion_url_add(urls, "monitor/signal-details", handler_get_signal_details);
-	onion_url_add(urls, "monitor/point-aspects", handler_get_point_aspects);
-	onion_url_add(urls, "monitor/signal-aspects", handler_get_signal_aspects);
-	onion_url_add(urls, "monitor/segments", handler_get_segments);
-	onion_url_add(urls, "monitor/reversers", handler_get_reversers);
-	onion_url_add(urls, "monitor/peripherals", handler_get_peripherals);
-	onion_url_add(urls, "monitor/verification-option", handler_get_verification_option);
-	onion_url_add(urls, "monitor/verification-url", handler_get_verification_url);
-	onion_url_add(urls, "monitor/granted-routes", handler_get_granted_routes);
-	onion_url_add(urls, "monitor/route", handler_get_route);
-	onion_url_add(urls, "monitor/debug", handler_get_debug_info);
+	url_add_negotiated(urls, "monitor/platform-name", handler_get_platform_name);
+	url_add_negotiated(urls, "monitor/trains", handler_get_trains);
+	url_add_negotiated(urls, "monitor/train-state", handler_get_train_state);
+	url_add_negotiated(urls, "monitor/train-states", handler_get_train_states);
+	url_add_negotiated(urls, "monitor/train-peripherals", handler_get_train_peripherals);
+	url_add_negotiated(urls, "monitor/engines", handler_get_engines);
+	url_add_negotiated(urls, "monitor/interlockers", handler_get_interlockers);
+	url_add_negotiated(urls, "monitor/track-outputs", handler_get_track_outputs);
+	url_add_negotiated(urls, "monitor/points", handler_get_points);
+	url_add_negotiated(urls, "monitor/signals", handler_get_signals);
+	url_add_negotiated(urls, "monitor/point-details", handler_get_point_details);
+	url_add_negotiated(urls, "monitor/signal-details", handler_get_signal_details);
+	url_add_negotiated(urls, "monitor/point-aspects", handler_get_point_aspects);
+	url_add_negotiated(urls, "monitor/signal-aspects", handler_get_signal_aspects);
+	url_add_negotiated(urls, "monitor/segments", handler_get_segments);
+	url_add_negotiated(urls, "monitor/reversers", handler_get_reversers);
+	url_add_negotiated(urls, "monitor/peripherals", handler_get_peripherals);
+	url_add_negotiated(urls, "monitor/verification-option", handler_get_verification_option);
+	url_add_negotiated(urls, "monitor/verification-url", handler_get_verification_url);
+	url_add_negotiated(urls, "monitor/granted-routes", handler_get_granted_routes);
+	url_add_negotiated(urls, "monitor/scheduler", handler_get_scheduler);
+	url_add_measured(urls, "monitor/state-stream", handler_get_state_stream);
+	url_add_negotiated(urls, "monitor/snapshot", handler_get_snapshot);
+	url_add_negotiated(urls, "monitor/route", handler_get_route);
+	url_add_measured(urls, "monitor/metrics", handler_get_metrics);
+	url_add_negotiated(urls, "monitor/memory", handler_get_memory);
+	url_add_measured(urls, "monitor/bidib-messages", handler_get_bidib_messages);
+	url_add_measured(urls, "monitor/debug", handler_get_debug_info);
 	/// NOTE: Changed path from debug_extra to debug-extra
-	onion_url_add(urls, "monitor/debug-extra", handler_get_debug_info_extra);
+	url_add_measured(urls, "monitor/debug-extra", handler_get_debug_info_extra);
 	
 	load_cached_verifier_url();
+	verifier_client_start();
+	
+	char *assets_global_path = realpath(assets_local_path, NULL);
+	if (assets_global_path != NULL) {
+		asset_store_load(assets_global_path);
+		onion_low_free(assets_global_path);
+	} else {
+		syslog_server(LOG_WARNING, "Cannot preload the assets in %s", assets_local_path);
+	}
 	
+	command_journal_start();
 	onion_listen(o);
 	onion_free(o);
+	asset_store_free();
 	if (running) {
 		shutdown_server();
 	}
+	command_journal_stop();
+	verifier_client_stop();
 	cache_verifier_url();
 	free_verifier_url();
 	
 	syslog_server(LOG_NOTICE, "SWTbahn server stopped");
+	log_buffer_stop();
 	closelog();
 	
 	return 0;
@@ -31,13 +31,32 @@
 #include <syslog.h>
 #include <onion/onion.h>
 
+// Maximum length of the serial device and config directory arguments
+#define INPUT_MAX_LEN 256
+
 extern volatile time_t session_id;
 extern volatile bool running;
 extern volatile bool verification_enabled;
-extern char serial_device[128];
-extern char config_directory[128];
+extern char serial_device[INPUT_MAX_LEN];
+extern char config_directory[INPUT_MAX_LEN];
+
+// Messages with a priority above this level are compiled out (override with -D)
+#ifndef SYSLOG_SERVER_LEVEL_MAX
+#define SYSLOG_SERVER_LEVEL_MAX LOG_DEBUG
+#endif
+
+// Messages with a priority above this level are skipped before being formatted
+extern volatile int syslog_server_level;
+
+// Use syslog_server instead, which skips disabled priorities
+void syslog_server_write(int priority, const char *format, ...);
 
-void syslog_server(int priority, const char *format, ...);
+#define syslog_server(priority, ...) \
+	do { \
+		if ((priority) <= SYSLOG_SERVER_LEVEL_MAX && (priority) <= syslog_server_level) { \
+			syslog_server_write((priority), __VA_ARGS__); \
+		} \
+	} while (0)
 
 void build_response_header(onion_response *res);
 
@@ -0,0 +1,412 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#include <bidib/bidib.h>
+#include <glib.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "state_stream.h"
+#include "server.h"
+#include "handler_controller.h"
+#include "handler_driver.h"
+#include "interlocking.h"
+#include "communication_utils.h"
+#include "json_response_builder.h"
+#include "request_metrics.h"
+
+// Mutex to lock when accessing the recorded state, the deltas, and the counters
+static pthread_mutex_t state_stream_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Signalled whenever the state has been sampled, and when the stream stops
+static pthread_cond_t state_stream_cond = PTHREAD_COND_INITIALIZER;
+
+static pthread_t state_stream_thread;
+// Signalled when a change is notified or the stream stops, to wake up the change detector
+static pthread_cond_t state_stream_wakeup = PTHREAD_COND_INITIALIZER;
+static bool state_stream_change_notified = false;
+static bool state_stream_started = false;
+static bool state_stream_stopping = false;
+static unsigned int state_stream_client_count = 0;
+
+// Number of times the state has been sampled
+static unsigned long long state_stream_sample_count = 0;
+// Number of deltas, i.e., number of samples in which the state changed
+static unsigned long long state_stream_generation = 0;
+// State object key (type:id) -> state object (compact json without newlines)
+static GHashTable *state_stream_state = NULL;
+// Delta events, the delta of generation g is at index g % STATE_STREAM_HISTORY_LEN
+static GString *state_stream_history[STATE_STREAM_HISTORY_LEN];
+
+static void add_state_object(GHashTable *sample, const char *type, const char *id, 
+                             GString *object) {
+	g_hash_table_insert(sample, g_strdup_printf("%s:%s", type, id), g_string_free(object, false));
+}
+
+static void sample_segments(GHashTable *sample) {
+	t_bidib_id_list_query seg_query = bidib_get_connected_segments();
+	for (size_t i = 0; i < seg_query.length; i++) {
+		t_bidib_segment_state_query seg_state_query = bidib_get_segment_state(seg_query.ids[i]);
+		GString *object = g_string_new("{\"type\":\"segment\",\"id\":");
+		append_str_value(object, seg_query.ids[i]);
+		g_string_append(object, seg_state_query.known && seg_state_query.data.occupied 
+		                         ? ",\"occupied\":true}" : ",\"occupied\":false}");
+		add_state_object(sample, "segment", seg_query.ids[i], object);
+		bidib_free_segment_state_query(seg_state_query);
+	}
+	bidib_free_id_list_query(seg_query);
+}
+
+static void sample_accessories(GHashTable *sample, bool point_accessories) {
+	const char *type = point_accessories ? "point" : "signal";
+	t_bidib_id_list_query query = point_accessories ? bidib_get_connected_points() 
+	                                                : bidib_get_connected_signals();
+	for (size_t i = 0; i < query.length; i++) {
+		t_bidib_unified_accessory_state_query acc_state = 
+				point_accessories ? bidib_get_point_state(query.ids[i]) 
+				                  : bidib_get_signal_state(query.ids[i]);
+		const char *state = "unknown";
+		if (acc_state.known) {
+			state = acc_state.type == BIDIB_ACCESSORY_BOARD 
+			        ? acc_state.board_accessory_state.state_id 
+			        : acc_state.dcc_accessory_state.state_id;
+		}
+		GString *object = g_string_new(point_accessories ? "{\"type\":\"point\",\"id\":" 
+		                                                 : "{\"type\":\"signal\",\"id\":");
+		append_str_value(object, query.ids[i]);
+		g_string_append(object, ",\"state\":");
+		append_str_value(object, state);
+		g_string_append_c(object, '}');
+		add_state_object(sample, type, query.ids[i], object);
+		bidib_free_unified_accessory_state_query(acc_state);
+	}
+	bidib_free_id_list_query(query);
+}
+
+static void sample_trains(GHashTable *sample) {
+	t_bidib_id_list_query query = bidib_get_trains();
+	for (size_t i = 0; i < query.length; i++) {
+		t_bidib_train_state_query tr_state_query = bidib_get_train_state(query.ids[i]);
+		if (!tr_state_query.known) {
+			bidib_free_train_state_query(tr_state_query);
+			continue;
+		}
+		t_bidib_train_position_query train_position_query = bidib_get_train_position(query.ids[i]);
+		GString *object = g_string_new("{\"type\":\"train\",\"id\":");
+		append_str_value(object, query.ids[i]);
+		g_string_append(object, train_grabbed(query.ids[i]) ? ",\"grabbed\":true" 
+		                                                     : ",\"grabbed\":false");
+		g_string_append(object, tr_state_query.data.set_is_forwards 
+		                        ? ",\"direction\":\"forwards\"" : ",\"direction\":\"backwards\"");
+		g_string_append_printf(object, ",\"speed_step\":%d", tr_state_query.data.set_speed_step);
+		g_string_append(object, train_position_query.length > 0 ? ",\"on_track\":true" 
+		                                                        : ",\"on_track\":false");
+		g_string_append(object, ",\"occupied_segments\":[");
+		for (size_t j = 0; j < train_position_query.length; j++) {
+			if (j > 0) {
+				g_string_append_c(object, ',');
+			}
+			append_str_value(object, train_position_query.segments[j]);
+		}
+		g_string_append(object, "]}");
+		add_state_object(sample, "train", query.ids[i], object);
+		bidib_free_train_position_query(train_position_query);
+		bidib_free_train_state_query(tr_state_query);
+	}
+	bidib_free_id_list_query(query);
+}
+
+static void sample_routes(GHashTable *sample) {
+	request_metrics_mutex_lock(&interlocker_mutex);
+	GArray *route_ids = interlocking_table_get_all_route_ids_shallowcpy();
+	for (unsigned int i = 0; i < route_ids->len; i++) {
+		const t_interlocking_route *route = get_route(g_array_index(route_ids, char *, i));
+		if (route == NULL) {
+			continue;
+		}
+		GString *object = g_string_new("{\"type\":\"route\",\"id\":");
+		append_str_value(object, route->id);
+		g_string_append(object, ",\"granted_to_train\":");
+		append_str_value(object, route->train == NULL ? "" : route->train);
+		g_string_append_c(object, '}');
+		add_state_object(sample, "route", route->id, object);
+	}
+	pthread_mutex_unlock(&interlocker_mutex);
+	// free the GArray but not the contained strings, as it was created by shallow copy.
+	g_array_free(route_ids, true);
+}
+
+// Shall only be called with state_stream_mutex locked.
+static GString *build_snapshot_event(void) {
+	GString *event = g_string_new("");
+	g_string_append_printf(event, "id: %llu\nevent: snapshot\ndata: [", state_stream_generation);
+	if (state_stream_state != NULL) {
+		GHashTableIter iter;
+		gpointer key, value;
+		bool first = true;
+		g_hash_table_iter_init(&iter, state_stream_state);
+		while (g_hash_table_iter_next(&iter, &key, &value)) {
+			if (!first) {
+				g_string_append_c(event, ',');
+			}
+			g_string_append(event, (const char *) value);
+			first = false;
+		}
+	}
+	g_string_append(event, "]\n\n");
+	return event;
+}
+
+// Appends the removal of the state object with the key (type:id) to the delta
+static void append_removal(GString *delta, const char *key) {
+	const char *separator = strchr(key, ':');
+	if (delta->len > 0) {
+		g_string_append_c(delta, ',');
+	}
+	g_string_append(delta, "{\"type\":\"");
+	g_string_append_len(delta, key, separator - key);
+	g_string_append(delta, "\",\"id\":");
+	append_str_value(delta, separator + 1);
+	g_string_append(delta, ",\"removed\":true}");
+}
+
+// Compares the sample with the recorded state, records the delta if the state changed 
+// (including removed state objects), and replaces the recorded state with the sample.
+static void record_sample(GHashTable *sample) {
+	GString *delta = g_string_new("");
+	GHashTableIter iter;
+	gpointer key, value;
+	g_hash_table_iter_init(&iter, sample);
+	
+	pthread_mutex_lock(&state_stream_mutex);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		const char *recorded = state_stream_state == NULL 
+		                       ? NULL : g_hash_table_lookup(state_stream_state, key);
+		if (recorded == NULL || strcmp(recorded, (const char *) value) != 0) {
+			if (delta->len > 0) {
+				g_string_append_c(delta, ',');
+			}
+			g_string_append(delta, (const char *) value);
+		}
+	}
+	if (state_stream_state != NULL) {
+		// State objects that disappeared, e.g., trains whose state became unknown, 
+		// are sent as removals so that clients do not keep stale objects
+		g_hash_table_iter_init(&iter, state_stream_state);
+		while (g_hash_table_iter_next(&iter, &key, &value)) {
+			if (!g_hash_table_contains(sample, key)) {
+				append_removal(delta, (const char *) key);
+			}
+		}
+		g_hash_table_destroy(state_stream_state);
+	}
+	state_stream_state = sample;
+	
+	if (delta->len > 0) {
+		state_stream_generation++;
+		const unsigned int index = state_stream_generation % STATE_STREAM_HISTORY_LEN;
+		if (state_stream_history[index] != NULL) {
+			g_string_free(state_stream_history[index], true);
+		}
+		GString *event = g_string_new("");
+		g_string_append_printf(event, "id: %llu\nevent: delta\ndata: [%s]\n\n", 
+		                       state_stream_generation, delta->str);
+		state_stream_history[index] = event;
+	}
+	state_stream_sample_count++;
+	pthread_cond_broadcast(&state_stream_cond);
+	pthread_mutex_unlock(&state_stream_mutex);
+	g_string_free(delta, true);
+}
+
+// Waits until a change is notified or the period elapses, but at least the minimum period
+static void wait_for_change(void) {
+	usleep(STATE_STREAM_MIN_PERIOD_US);
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_nsec += (STATE_STREAM_PERIOD_US - STATE_STREAM_MIN_PERIOD_US) * 1000L;
+	deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+	deadline.tv_nsec %= 1000000000L;
+	pthread_mutex_lock(&state_stream_mutex);
+	while (!state_stream_change_notified && !state_stream_stopping) {
+		if (pthread_cond_timedwait(&state_stream_wakeup, &state_stream_mutex, &deadline) != 0) {
+			break;
+		}
+	}
+	state_stream_change_notified = false;
+	pthread_mutex_unlock(&state_stream_mutex);
+}
+
+static void *detect_state_changes(void *_) {
+	while (true) {
+		pthread_mutex_lock(&state_stream_mutex);
+		const bool stopping = state_stream_stopping;
+		const bool has_clients = state_stream_client_count > 0;
+		pthread_mutex_unlock(&state_stream_mutex);
+		if (stopping) {
+			break;
+		}
+		
+		// Only sample while clients are connected, the first sample after a pause 
+		// is sent to the clients as a snapshot anyway
+		if (has_clients) {
+			GHashTable *sample = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+			sample_segments(sample);
+			sample_accessories(sample, true);
+			sample_accessories(sample, false);
+			sample_trains(sample);
+			sample_routes(sample);
+			record_sample(sample);
+		}
+		wait_for_change();
+	}
+	return NULL;
+}
+
+void state_stream_start(void) {
+	pthread_mutex_lock(&state_stream_mutex);
+	state_stream_stopping = false;
+	state_stream_started = 
+			pthread_create(&state_stream_thread, NULL, detect_state_changes, NULL) == 0;
+	pthread_mutex_unlock(&state_stream_mutex);
+	if (!state_stream_started) {
+		syslog_server(LOG_ERR, "State stream start - unable to create change detector thread");
+	}
+}
+
+void state_stream_notify_change(void) {
+	pthread_mutex_lock(&state_stream_mutex);
+	state_stream_change_notified = true;
+	pthread_cond_signal(&state_stream_wakeup);
+	pthread_mutex_unlock(&state_stream_mutex);
+}
+
+void state_stream_stop(void) {
+	pthread_mutex_lock(&state_stream_mutex);
+	const bool started = state_stream_started;
+	state_stream_stopping = true;
+	state_stream_started = false;
+	pthread_cond_broadcast(&state_stream_cond);
+	pthread_cond_broadcast(&state_stream_wakeup);
+	pthread_mutex_unlock(&state_stream_mutex);
+	if (!started) {
+		return;
+	}
+	pthread_join(state_stream_thread, NULL);
+	
+	pthread_mutex_lock(&state_stream_mutex);
+	if (state_stream_state != NULL) {
+		g_hash_table_destroy(state_stream_state);
+		state_stream_state = NULL;
+	}
+	for (unsigned int i = 0; i < STATE_STREAM_HISTORY_LEN; i++) {
+		if (state_stream_history[i] != NULL) {
+			g_string_free(state_stream_history[i], true);
+			state_stream_history[i] = NULL;
+		}
+	}
+	pthread_mutex_unlock(&state_stream_mutex);
+	syslog_server(LOG_INFO, "State stream stop - done");
+}
+
+static bool write_event(onion_response *res, GString *event) {
+	const bool written = onion_response_write(res, event->str, event->len) >= 0 
+	                     && onion_response_flush(res) >= 0;
+	g_string_free(event, true);
+	return written;
+}
+
+// Waits for the state to be sampled or the stream to stop, for at most one second.
+// Shall only be called with state_stream_mutex locked.
+static void wait_for_sample(void) {
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += 1;
+	pthread_cond_timedwait(&state_stream_cond, &state_stream_mutex, &deadline);
+}
+
+bool state_stream_serve(onion_response *res) {
+	pthread_mutex_lock(&state_stream_mutex);
+	if (!state_stream_started || state_stream_client_count >= STATE_STREAM_CLIENT_COUNT_MAX) {
+		pthread_mutex_unlock(&state_stream_mutex);
+		return false;
+	}
+	state_stream_client_count++;
+	// Wait for a fresh sample, as the state is not sampled while no clients are connected
+	const unsigned long long sample_count = state_stream_sample_count;
+	while (running && !state_stream_stopping && state_stream_sample_count == sample_count) {
+		wait_for_sample();
+	}
+	GString *event = build_snapshot_event();
+	unsigned long long generation_sent = state_stream_generation;
+	pthread_mutex_unlock(&state_stream_mutex);
+	
+	onion_response_set_header(res, "Content-Type", "text/event-stream");
+	onion_response_set_header(res, "Cache-Control", "no-cache");
+	set_response_code(res, HTTP_OK);
+	bool connected = write_event(res, event);
+	
+	time_t last_write = time(NULL);
+	while (connected && running) {
+		pthread_mutex_lock(&state_stream_mutex);
+		if (state_stream_generation == generation_sent && !state_stream_stopping) {
+			wait_for_sample();
+		}
+		if (state_stream_stopping) {
+			pthread_mutex_unlock(&state_stream_mutex);
+			break;
+		}
+		event = NULL;
+		if (state_stream_generation - generation_sent > STATE_STREAM_HISTORY_LEN) {
+			// The client is too far behind for the recorded deltas
+			event = build_snapshot_event();
+		} else if (state_stream_generation != generation_sent) {
+			event = g_string_new("");
+			for (unsigned long long g = generation_sent + 1; g <= state_stream_generation; g++) {
+				g_string_append(event, state_stream_history[g % STATE_STREAM_HISTORY_LEN]->str);
+			}
+		}
+		generation_sent = state_stream_generation;
+		pthread_mutex_unlock(&state_stream_mutex);
+		
+		if (event != NULL) {
+			last_write = time(NULL);
+			connected = write_event(res, event);
+		} else if (time(NULL) - last_write >= STATE_STREAM_KEEPALIVE_S) {
+			last_write = time(NULL);
+			connected = write_event(res, g_string_new(": keep-alive\n\n"));
+		}
+	}
+	
+	pthread_mutex_lock(&state_stream_mutex);
+	state_stream_client_count--;
+	pthread_mutex_unlock(&state_stream_mutex);
+	return true;
+}
@@ -0,0 +1,80 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#ifndef STATE_STREAM_H
+#define STATE_STREAM_H
+
+#include <onion/onion.h>
+#include <stdbool.h>
+
+// Every stream client occupies one server thread while it is connected
+#define STATE_STREAM_CLIENT_COUNT_MAX	16
+// Period in which the state is sampled for changes while clients are connected
+#define STATE_STREAM_PERIOD_US			100000
+// Minimum period between samples when changes are notified (see state_stream_notify_change)
+#define STATE_STREAM_MIN_PERIOD_US		20000
+// Number of deltas kept for clients that are behind; older clients get a new snapshot
+#define STATE_STREAM_HISTORY_LEN		64
+// Period of the keep-alive comments, which also detect disconnected clients
+#define STATE_STREAM_KEEPALIVE_S		15
+
+/**
+ * Starts the change detector, which samples the segment occupancy, the train positions
+ * and speeds, the signal and point aspects, and the route grants while stream clients
+ * are connected, and records the changes as deltas.
+ * Shall only be called after the config has been loaded.
+ */
+void state_stream_start(void);
+
+/**
+ * Stops the change detector, makes all stream clients return, and frees the recorded state.
+ * Shall be called before the config is freed.
+ */
+void state_stream_stop(void);
+
+/**
+ * Notifies the change detector that the state has probably changed, e.g., because 
+ * a BiDiB feedback message arrived, so that it samples the state before its period elapses.
+ */
+void state_stream_notify_change(void);
+
+/**
+ * Streams the state to a client as server-sent events (text/event-stream): 
+ * First a `snapshot` event with all state objects, then a `delta` event with the 
+ * changed state objects whenever the state changes. State objects that disappear are 
+ * sent in a delta as {"type": ..., "id": ..., "removed": true}. The event id is the 
+ * generation of the state. Blocks until the client disconnects or the stream is stopped.
+ * 
+ * @param res response to stream to
+ * @return true if the client was streamed to, 
+ * false if the maximum number of stream clients is reached or the stream is not started
+ */
+bool state_stream_serve(onion_response *res);
+
+#endif  // STATE_STREAM_H
@@ -0,0 +1,338 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "upload_pipeline.h"
+#include "server.h"
+#include "handler_upload.h"
+#include "compile_cache.h"
+#include "dyn_containers_interface.h"
+#include "websocket_uploader/engine_uploader.h"
+#include "communication_utils.h"
+#include "response_cache.h"
+#include "request_metrics.h"
+#include "checkpoint.h"
+
+typedef struct {
+	// 0 while the slot is unused
+	unsigned int id;
+	t_upload_request request;
+	e_upload_state state;
+	int status_code;
+	GString *message;
+	bool message_is_json;
+} t_upload_job;
+
+typedef struct {
+	// Path of the model with the extension ".sctx"
+	char model_file[PATH_MAX + NAME_MAX + 8];
+	verif_result result;
+} t_verification;
+
+static pthread_mutex_t pipeline_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Signalled when an upload is queued or the pipeline stops
+static pthread_cond_t job_queued = PTHREAD_COND_INITIALIZER;
+// Signalled when an upload has finished
+static pthread_cond_t job_finished = PTHREAD_COND_INITIALIZER;
+static pthread_t workers[UPLOAD_PIPELINE_WORKER_COUNT];
+static unsigned int worker_count = 0;
+static bool pipeline_stopping = false;
+
+static t_upload_job jobs[UPLOAD_PIPELINE_JOB_COUNT_MAX];
+static unsigned int next_job_id = 1;
+// Ids of the queued uploads, in the order they were submitted
+static unsigned int job_queue[UPLOAD_PIPELINE_QUEUE_LEN];
+static unsigned int job_queue_head = 0;
+static unsigned int job_queue_len = 0;
+
+static const char *state_names[] = { "queued", "processing", "succeeded", "failed" };
+
+// Returns the job with the id, or NULL if its slot has been reused; 
+// shall only be called with pipeline_mutex acquired
+static t_upload_job *job_of(unsigned int id) {
+	t_upload_job *job = &jobs[id % UPLOAD_PIPELINE_JOB_COUNT_MAX];
+	return (id != 0 && job->id == id) ? job : NULL;
+}
+
+static bool job_is_finished(const t_upload_job *job) {
+	return job->state == UPLOAD_SUCCEEDED || job->state == UPLOAD_FAILED;
+}
+
+static void set_job_result(t_upload_job *job, int status_code, const char *message) {
+	job->status_code = status_code;
+	job->message = message != NULL ? g_string_new(message) : NULL;
+	job->message_is_json = false;
+}
+
+static void *verify_model(void *data) {
+	t_verification *verification = data;
+	verification->result = verify_engine_model(verification->model_file);
+	return NULL;
+}
+
+// Verifies the engine while it is compiled, and loads it if both succeed
+static void process_engine(t_upload_job *job, const t_upload_request *request) {
+	t_verification verification = { .result = { .success = true } };
+	snprintf(verification.model_file, sizeof(verification.model_file), 
+	         "%s.sctx", request->model_path);
+	pthread_t verifier;
+	bool verifying = false;
+	if (verification_enabled && !request->skip_verification) {
+		verifying = pthread_create(&verifier, NULL, verify_model, &verification) == 0;
+		if (!verifying) {
+			verify_model(&verification);
+		}
+	}
+	
+	const dynlib_status status = 
+			compile_cache_compile(TRAIN_ENGINE, request->model_path, request->output_dir);
+	if (verifying) {
+		pthread_join(verifier, NULL);
+	}
+	
+	if (!verification.result.success) {
+		remove_engine_files(request->libname);
+		syslog_server(LOG_NOTICE, 
+		              "Upload pipeline - engine file: %s - verification failed - abort", 
+		              request->filename);
+		if (verification.result.message != NULL) {
+			job->status_code = HTTP_BAD_REQUEST;
+			job->message = verification.result.message;
+			job->message_is_json = verification.result.message_is_json_str;
+		} else {
+			set_job_result(job, HTTP_BAD_REQUEST, "verification failed due to unknown reason");
+		}
+		return;
+	}
+	if (verification.result.message != NULL) {
+		g_string_free(verification.result.message, true);
+	}
+	if (status == DYNLIB_COMPILE_SCCHARTS_C_ERR || status == DYNLIB_COMPILE_SHARED_SCCHARTS_ERR) {
+		remove_engine_files(request->libname);
+		set_job_result(job, HTTP_INTERNAL_ERROR, "engine file could not be compiled");
+		syslog_server(LOG_ERR, 
+		              "Upload pipeline - engine file: %s - could not be "
+		              "compiled into a C file and then to a shared library - abort", 
+		              request->filename);
+		return;
+	}
+	
+	request_metrics_mutex_lock(&dyn_containers_mutex);
+	const int engine_slot = dyn_containers_get_free_engine_slot();
+	if (engine_slot < 0) {
+		pthread_mutex_unlock(&dyn_containers_mutex);
+		remove_engine_files(request->libname);
+		set_job_result(job, CUSTOM_HTTP_CODE_CONFLICT, "No available engine slot");
+		syslog_server(LOG_WARNING, 
+		              "Upload pipeline - engine file: %s - no available engine slot - abort", 
+		              request->filename);
+		return;
+	}
+	char library_path[PATH_MAX + NAME_MAX];
+	snprintf(library_path, sizeof(library_path), "%s/%s", request->output_dir, request->libname);
+	dyn_containers_set_engine(engine_slot, library_path);
+	pthread_mutex_unlock(&dyn_containers_mutex);
+	response_cache_invalidate(RESPONSE_CACHE_SCOPE_ENGINES);
+	checkpoint_set_plugin(request);
+	set_job_result(job, HTTP_OK, NULL);
+}
+
+// Compiles the interlocker and loads it
+static void process_interlocker(t_upload_job *job, const t_upload_request *request) {
+	const dynlib_status status = 
+			compile_cache_compile(INTERLOCKER, request->model_path, request->output_dir);
+	if (status == DYNLIB_COMPILE_SHARED_BAHNDSL_ERR) {
+		remove_interlocker_files(request->libname);
+		set_job_result(job, HTTP_INTERNAL_ERROR, "interlocker file could not be compiled");
+		syslog_server(LOG_ERR, 
+		              "Upload pipeline - interlocker file: %s - "
+		              "interlocker could not be compiled - abort", 
+		              request->filename);
+		return;
+	}
+	
+	request_metrics_mutex_lock(&dyn_containers_mutex);
+	const int interlocker_slot = dyn_containers_get_free_interlocker_slot();
+	if (interlocker_slot < 0) {
+		pthread_mutex_unlock(&dyn_containers_mutex);
+		remove_interlocker_files(request->libname);
+		set_job_result(job, CUSTOM_HTTP_CODE_CONFLICT, "no interlocker slot available");
+		syslog_server(LOG_WARNING, 
+		              "Upload pipeline - interlocker file: %s - "
+		              "no available interlocker slot - abort", 
+		              request->filename);
+		return;
+	}
+	char library_path[PATH_MAX + NAME_MAX];
+	snprintf(library_path, sizeof(library_path), "%s/%s", request->output_dir, request->libname);
+	dyn_containers_set_interlocker(interlocker_slot, library_path);
+	pthread_mutex_unlock(&dyn_containers_mutex);
+	response_cache_invalidate(RESPONSE_CACHE_SCOPE_INTERLOCKERS);
+	checkpoint_set_plugin(request);
+	set_job_result(job, HTTP_OK, NULL);
+}
+
+static void *upload_worker(void *_) {
+	pthread_mutex_lock(&pipeline_mutex);
+	while (true) {
+		while (job_queue_len == 0 && !pipeline_stopping) {
+			pthread_cond_wait(&job_queued, &pipeline_mutex);
+		}
+		if (pipeline_stopping) {
+			break;
+		}
+		const unsigned int id = job_queue[job_queue_head];
+		job_queue_head = (job_queue_head + 1) % UPLOAD_PIPELINE_QUEUE_LEN;
+		job_queue_len--;
+		t_upload_job *job = job_of(id);
+		job->state = UPLOAD_PROCESSING;
+		const t_upload_request request = job->request;
+		pthread_mutex_unlock(&pipeline_mutex);
+		
+		syslog_server(LOG_NOTICE, "Upload pipeline - upload %u: %s - start", id, request.filename);
+		// The result is written into a copy, the job may be read while it is processed
+		t_upload_job result = { .id = id };
+		if (request.kind == UPLOAD_ENGINE) {
+			process_engine(&result, &request);
+		} else {
+			process_interlocker(&result, &request);
+		}
+		syslog_server(LOG_NOTICE, "Upload pipeline - upload %u: %s - finish with %d", 
+		              id, request.filename, result.status_code);
+		
+		pthread_mutex_lock(&pipeline_mutex);
+		job->status_code = result.status_code;
+		job->message = result.message;
+		job->message_is_json = result.message_is_json;
+		job->state = result.status_code == HTTP_OK ? UPLOAD_SUCCEEDED : UPLOAD_FAILED;
+		pthread_cond_broadcast(&job_finished);
+	}
+	pthread_mutex_unlock(&pipeline_mutex);
+	return NULL;
+}
+
+void upload_pipeline_start(void) {
+	compile_cache_init();
+	pthread_mutex_lock(&pipeline_mutex);
+	pipeline_stopping = false;
+	worker_count = 0;
+	for (unsigned int i = 0; i < UPLOAD_PIPELINE_WORKER_COUNT; i++) {
+		if (pthread_create(&workers[worker_count], NULL, upload_worker, NULL) == 0) {
+			worker_count++;
+		}
+	}
+	pthread_mutex_unlock(&pipeline_mutex);
+	if (worker_count < UPLOAD_PIPELINE_WORKER_COUNT) {
+		syslog_server(LOG_ERR, "Upload pipeline start - only %u of %d workers could be created", 
+		              worker_count, UPLOAD_PIPELINE_WORKER_COUNT);
+	}
+}
+
+void upload_pipeline_stop(void) {
+	pthread_mutex_lock(&pipeline_mutex);
+	pipeline_stopping = true;
+	pthread_cond_broadcast(&job_queued);
+	const unsigned int count = worker_count;
+	worker_count = 0;
+	pthread_mutex_unlock(&pipeline_mutex);
+	for (unsigned int i = 0; i < count; i++) {
+		pthread_join(workers[i], NULL);
+	}
+	
+	pthread_mutex_lock(&pipeline_mutex);
+	for (; job_queue_len > 0; job_queue_len--) {
+		t_upload_job *job = job_of(job_queue[job_queue_head]);
+		job_queue_head = (job_queue_head + 1) % UPLOAD_PIPELINE_QUEUE_LEN;
+		if (job->request.kind == UPLOAD_ENGINE) {
+			remove_engine_files(job->request.libname);
+		} else {
+			remove_interlocker_files(job->request.libname);
+		}
+		set_job_result(job, HTTP_SERVICE_UNAVAILABLE, "upload aborted because the server stopped");
+		job->state = UPLOAD_FAILED;
+	}
+	pthread_cond_broadcast(&job_finished);
+	pthread_mutex_unlock(&pipeline_mutex);
+}
+
+unsigned int upload_pipeline_submit(const t_upload_request *request) {
+	pthread_mutex_lock(&pipeline_mutex);
+	t_upload_job *job = &jobs[next_job_id % UPLOAD_PIPELINE_JOB_COUNT_MAX];
+	if (worker_count == 0 || job_queue_len >= UPLOAD_PIPELINE_QUEUE_LEN 
+	    || (job->id != 0 && !job_is_finished(job))) {
+		pthread_mutex_unlock(&pipeline_mutex);
+		return 0;
+	}
+	if (job->message != NULL) {
+		g_string_free(job->message, true);
+	}
+	memset(job, 0, sizeof(t_upload_job));
+	job->id = next_job_id++;
+	// 0 is not a valid id
+	if (next_job_id == 0) {
+		next_job_id = 1;
+	}
+	job->request = *request;
+	job->state = UPLOAD_QUEUED;
+	job_queue[(job_queue_head + job_queue_len) % UPLOAD_PIPELINE_QUEUE_LEN] = job->id;
+	job_queue_len++;
+	const unsigned int id = job->id;
+	pthread_cond_signal(&job_queued);
+	pthread_mutex_unlock(&pipeline_mutex);
+	return id;
+}
+
+bool upload_pipeline_get_status(unsigned int id, bool wait, t_upload_status *status) {
+	pthread_mutex_lock(&pipeline_mutex);
+	t_upload_job *job = job_of(id);
+	while (wait && job != NULL && !job_is_finished(job)) {
+		pthread_cond_wait(&job_finished, &pipeline_mutex);
+		job = job_of(id);
+	}
+	if (job == NULL) {
+		pthread_mutex_unlock(&pipeline_mutex);
+		return false;
+	}
+	status->id = job->id;
+	status->kind = job->request.kind;
+	status->state = job->state;
+	snprintf(status->filename, sizeof(status->filename), "%s", job->request.filename);
+	status->status_code = job->status_code;
+	status->message = job->message != NULL ? g_string_new(job->message->str) : NULL;
+	status->message_is_json = job->message_is_json;
+	pthread_mutex_unlock(&pipeline_mutex);
+	return true;
+}
+
+const char *upload_pipeline_state_name(e_upload_state state) {
+	return state_names[state];
+}
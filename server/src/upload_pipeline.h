@@ -0,0 +1,123 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+
+#ifndef UPLOAD_PIPELINE_H
+#define UPLOAD_PIPELINE_H
+
+#include <glib.h>
+#include <limits.h>
+#include <stdbool.h>
+
+// Number of uploads compiled at once
+#define UPLOAD_PIPELINE_WORKER_COUNT	2
+// Maximum number of uploads waiting for a worker
+#define UPLOAD_PIPELINE_QUEUE_LEN		8
+// Number of uploads whose status is kept, must exceed the workers and the queue
+#define UPLOAD_PIPELINE_JOB_COUNT_MAX	64
+
+typedef enum {
+	UPLOAD_ENGINE,
+	UPLOAD_INTERLOCKER
+} e_upload_kind;
+
+typedef enum {
+	UPLOAD_QUEUED,
+	UPLOAD_PROCESSING,
+	UPLOAD_SUCCEEDED,
+	UPLOAD_FAILED
+} e_upload_state;
+
+typedef struct {
+	e_upload_kind kind;
+	// Name of the uploaded file, e.g., "engine.sctx"
+	char filename[NAME_MAX];
+	// Directory of the model and its library
+	char output_dir[PATH_MAX];
+	// Path of the model without extension, e.g., "engines/engine"
+	char model_path[PATH_MAX + NAME_MAX];
+	// Name of the library without extension, e.g., "libengine"
+	char libname[NAME_MAX];
+	// Whether the engine was verified before, e.g., when it is restored from a checkpoint
+	bool skip_verification;
+} t_upload_request;
+
+typedef struct {
+	unsigned int id;
+	e_upload_kind kind;
+	e_upload_state state;
+	char filename[NAME_MAX];
+	// Http status code of the result, only set once the upload has finished
+	int status_code;
+	// Reason of a failure, or NULL; owned by the caller of upload_pipeline_get_status
+	GString *message;
+	bool message_is_json;
+} t_upload_status;
+
+/**
+ * Starts the workers that verify, compile and load uploaded engines and interlockers.
+ * Shall only be called after the dynamic containers have been started.
+ */
+void upload_pipeline_start(void);
+
+/**
+ * Lets the workers finish their current upload, fails the queued uploads, 
+ * and waits for the workers to return.
+ * Shall be called before the dynamic containers are stopped.
+ */
+void upload_pipeline_stop(void);
+
+/**
+ * Queues an upload whose model has been moved into its output directory. 
+ * An engine is verified (if verification is enabled) while it is compiled. 
+ * The library is only loaded into a free slot if both succeed; otherwise 
+ * the files of the upload are removed.
+ * 
+ * @param request upload to queue
+ * @return id of the upload (greater than 0), or 0 if the queue is full or 
+ * the pipeline is not started
+ */
+unsigned int upload_pipeline_submit(const t_upload_request *request);
+
+/**
+ * Gets the status of an upload.
+ * 
+ * @param id id of the upload
+ * @param wait whether to wait until the upload has finished
+ * @param status (out) status of the upload, its message has to be freed by the caller
+ * @return true if the upload is known, false if the id is unknown or too old
+ */
+bool upload_pipeline_get_status(unsigned int id, bool wait, t_upload_status *status);
+
+/**
+ * @param state state of an upload
+ * @return name of the state, e.g., "queued"
+ */
+const char *upload_pipeline_state_name(e_upload_state state);
+
+#endif  // UPLOAD_PIPELINE_H
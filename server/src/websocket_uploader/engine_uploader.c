@@ -29,36 +29,74 @@
 #include "../server.h"
 
 #include <glib.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include "mongoose.h"
 
-typedef struct {
-	bool started;
-	bool finished;
-	bool success;
-	bool message_is_json_str;
-	GString* file_path;
-	GString* message;
-} ws_verif_data;
+typedef enum {
+	VERIF_QUEUED,
+	VERIF_SENT,
+	VERIF_STARTED,
+	VERIF_FINISHED
+} e_verif_state;
 
-///TODO: Protect against concur access with a mutex
-char *verifier_url = NULL;
+typedef struct ws_verif_request {
+	unsigned int id;
+	e_verif_state state;
+	// Request message, only kept until it has been sent
+	GString* request_msg;
+	// Time (mg_millis) until which the request has to be sent or the verification has to start
+	int64_t deadline_ms;
+	verif_result result;
+	struct ws_verif_request *next;
+} ws_verif_request;
+
+// Protects verifier_url, the outstanding requests and the client state
+static pthread_mutex_t verifier_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Signalled when an outstanding request has finished
+static pthread_cond_t verif_finished = PTHREAD_COND_INITIALIZER;
+
+static char *verifier_url = NULL;
+// Incremented whenever verifier_url changes, so that the client reconnects
+static unsigned int verifier_url_generation = 0;
 
 static const char cache_file_verifier_url[] = "verifier_url_cache.txt";
 
+// Upper bound of one poll; the client thread is woken up earlier when a request is queued
 static const unsigned int websocket_single_poll_length_ms = 250;
-static const unsigned int websocket_max_polls_before_start = 60;
+// Time within which a request has to be sent, and within which the verification has to start
+static const unsigned int websocket_start_timeout_ms = 15000;
+static const unsigned int websocket_reconnect_backoff_min_ms = 250;
+static const unsigned int websocket_reconnect_backoff_max_ms = 30000;
 
 static const char msg_type_field_key[] = "\"__MESSAGE_TYPE__\"";
 static const char msg_type_start_sig[] = "\"__MESSAGE_TYPE__\":\"ENG_VERIFICATION_REQUEST_START\"";
 static const char msg_type_start_sctx_field_key[] = "\"sctx\"";
+static const char msg_request_id_field_key[] = "\"__REQUEST_ID__\"";
 static const char msg_type_received_sig[] = "\"__MESSAGE_TYPE__\":\"ENG_VERIFICATION_REQUEST_RECEIVED\"";
 static const char msg_type_result_sig[] = "\"__MESSAGE_TYPE__\":\"ENG_VERIFICATION_REQUEST_RESULT\"";
 static const char msg_type_result_status_true_sig[] = "\"status\":true";
 static const char msg_type_result_status_false_sig[] = "\"status\":false";
 
-bool parse_model_into_verif_msg_str(GString *destination, const char *model_file_path);
-void process_verif_server_reply(struct mg_ws_message *ws_msg, ws_verif_data* ws_data_ptr);
-void send_verif_req_message(struct mg_connection *ws_connection, ws_verif_data* ws_data_ptr);
+// Outstanding requests in the order they were queued
+static ws_verif_request *verif_requests = NULL;
+static unsigned int next_request_id = 1;
+
+static pthread_t client_thread;
+static volatile bool client_running = false;
+// Wakes up the client thread; only valid while client_running
+static struct mg_connection *client_wakeup_pipe = NULL;
+
+// The following are only accessed by the client thread
+static struct mg_connection *ws_connection = NULL;
+static bool ws_connection_open = false;
+static unsigned int ws_connection_url_generation = 0;
+static unsigned int reconnect_backoff_ms = 0;
+static int64_t reconnect_at_ms = 0;
+
+bool parse_model_into_verif_msg_str(GString *destination, const char *model_file_path, 
+                                    unsigned int request_id);
+void process_verif_server_reply(struct mg_ws_message *ws_msg);
 void websocket_verification_callback(struct mg_connection *ws_connection, int ev, void *ev_data, void *fn_data);
 
 
@@ -68,10 +106,12 @@ void websocket_verification_callback(struct mg_connection *ws_connection, int ev
  * 
  * @param destination The GString that the message will be appended to.
  * @param model_file_path The path to the model to request verification for.
+ * @param request_id The id by which the replies of the verification server are correlated.
  * @return true if loading and parsing the model and building the message string succeeded.
  * @return false otherwise.
  */
-bool parse_model_into_verif_msg_str(GString *destination, const char *model_file_path) {
+bool parse_model_into_verif_msg_str(GString *destination, const char *model_file_path, 
+                                    unsigned int request_id) {
 	if (destination == NULL || model_file_path == NULL) {
 		return false;
 	}
@@ -89,279 +129,428 @@ bool parse_model_into_verif_msg_str(GString *destination, const char *model_file
 			gchar *model_content_escaped = g_strescape(buffer, NULL);
 			// Create message in the (json)syntax that the verification server wants
 			g_string_append_printf(destination, "{%s,", msg_type_start_sig);
+			g_string_append_printf(destination, "%s:%u,", msg_request_id_field_key, request_id);
 			g_string_append_printf(destination, "%s:\"%s\"}", msg_type_start_sctx_field_key,
 			                       model_content_escaped);
 			free(model_content_escaped);
-			free(buffer);
 			parse_success = true;
 		}
+		free(buffer);
+		fclose(fp);
 	}
 	return parse_success;
 }
 
 
+// Shall only be called with verifier_mutex acquired
+static void finish_request(ws_verif_request *request, bool success, const char *message) {
+	request->state = VERIF_FINISHED;
+	request->result.success = success;
+	if (message != NULL && request->result.message == NULL) {
+		request->result.message = g_string_new(message);
+		request->result.message_is_json_str = false;
+	}
+	if (request->request_msg != NULL) {
+		g_string_free(request->request_msg, true);
+		request->request_msg = NULL;
+	}
+	pthread_cond_broadcast(&verif_finished);
+}
+
+
 /**
- * @brief Given the model at the file path in ws_data_ptr->file_path, builds
- * a verification request message and sends it via the ws_connection. 
- * If building the message to send fails, the content of ws_data_ptr is updated accordingly.
+ * @brief Finds the request that a reply of the verification server belongs to.
+ * Replies carry the id of their request. Verification servers that do not echo the id 
+ * answer the requests in order, thus a reply without an id belongs to the oldest 
+ * request that has been sent.
+ * Shall only be called with verifier_mutex acquired.
  * 
- * @param ws_connection Connection via which to send the message
- * @param ws_data_ptr (inout) data for this verification attempt to build the request from and
- * update based on success/non-success.
+ * @param reply_str reply of the verification server
+ * @return ws_verif_request* the request, or NULL if no sent request matches
  */
-void send_verif_req_message(struct mg_connection *ws_connection, ws_verif_data* ws_data_ptr) {
-	if (ws_connection == NULL || ws_data_ptr == NULL) {
-		syslog_server(LOG_ERR, 
-		              "Websocket engine uploader: Send verification request message - "
-		              "invalid parameters");
-		return;
-	}
-	
-	// Read sctx model from file, build msg with necessary formatting
-	GString *g_verif_msg_str = g_string_new("");
-	bool parse_success = parse_model_into_verif_msg_str(g_verif_msg_str, ws_data_ptr->file_path->str);
-	
-	// Check if parsing succeeded
-	if (!parse_success) {
-		syslog_server(LOG_ERR, 
-		              "Websocket engine uploader: Send verification request message - "
-		              "unable to parse model file");
-		ws_data_ptr->finished = true;
-		ws_data_ptr->success = false;
-		g_string_free(g_verif_msg_str, true);
-		return;
+static ws_verif_request *find_request_of_reply(const char *reply_str) {
+	const char *id_field = strstr(reply_str, msg_request_id_field_key);
+	bool has_id = false;
+	unsigned int id = 0;
+	if (id_field != NULL) {
+		const char *id_value = id_field + strlen(msg_request_id_field_key);
+		while (*id_value == ':' || *id_value == ' ' || *id_value == '"') {
+			id_value++;
+		}
+		char *id_end = NULL;
+		id = strtoul(id_value, &id_end, 10);
+		has_id = id_end != id_value;
 	}
-	
-	// Try to send verification request
-	if (g_verif_msg_str != NULL && g_verif_msg_str->len > 0) {
-		syslog_server(LOG_INFO, 
-		              "Websocket engine uploader: Send verification request message - "
-		              "sending request to verifier server");
-		ssize_t sent_bytes = mg_ws_send(ws_connection, g_verif_msg_str->str, 
-		                                g_verif_msg_str->len, WEBSOCKET_OP_TEXT);
-		if (sent_bytes <= 0) {
-			syslog_server(LOG_ERR, 
-			              "Send verification request message - sending verification request failed");
-			ws_data_ptr->finished = true;
-			ws_data_ptr->success = false;
+	for (ws_verif_request *request = verif_requests; request != NULL; request = request->next) {
+		if (request->state != VERIF_SENT && request->state != VERIF_STARTED) {
+			continue;
+		}
+		if (!has_id || request->id == id) {
+			return request;
 		}
-	} else {
-		syslog_server(LOG_ERR, 
-		              "Websocket engine uploader: Send verification request message - "
-		              "failed to construct message to send");
-		ws_data_ptr->finished = true;
-		ws_data_ptr->success = false;
 	}
-	g_string_free(g_verif_msg_str, true);
+	return NULL;
 }
 
 
 /**
- * @brief Updates ws_data_ptr contents based on the contents of the result msg (ws_msg).
- * Assumes that ws_msg contains a message from the verification server of 
+ * @brief Updates the request based on the contents of the result msg (reply_str).
+ * Assumes that reply_str contains a message from the verification server of 
  * type ENG_VERIFICATION_REQUEST_RESULT.
+ * Shall only be called with verifier_mutex acquired.
  * 
- * @param ws_msg in-param containing the result message from the verification server
- * @param ws_data_ptr inout-param that will be updated with the message content
+ * @param reply_str in-param containing the result message from the verification server
+ * @param request inout-param that will be updated with the message content
  */
-void process_verification_result_msg(struct mg_ws_message *ws_msg, ws_verif_data *ws_data_ptr) {
-	if (ws_msg == NULL || ws_data_ptr == NULL) {
-		syslog_server(LOG_ERR, 
-		              "Websocket engine uploader: Process verification result message - "
-		              "invalid parameters");
-		return;
-	}
-	
+static void process_verification_result_msg(const GString *reply_str, ws_verif_request *request) {
 	// Check for presence of sequence in msg that indicates verification success
-	char *verif_success = strstr(ws_msg->data.ptr, msg_type_result_status_true_sig);
-	
-	if (verif_success) {
+	if (strstr(reply_str->str, msg_type_result_status_true_sig)) {
 		syslog_server(LOG_INFO, 
 		              "Websocket engine uploader: Process verification result message - "
-		              "engine satisfies all its properties");
-		ws_data_ptr->success = true;
-		ws_data_ptr->finished = true;
-	} else {
+		              "request %u - engine satisfies all its properties", 
+		              request->id);
+		finish_request(request, true, NULL);
+	} else if (!strstr(reply_str->str, msg_type_result_status_false_sig)) {
 		// Verification failed/unsuccessful
-		// Differentiate between status:false and unspecified failure
-		char *status_false_in_reply = strstr(ws_msg->data.ptr, msg_type_result_status_false_sig);
-		if (!status_false_in_reply) {
-			// No 'status' field in answer with either true or false
-			syslog_server(LOG_INFO, 
-			              "Websocket engine uploader: Process verification result message - "
-			              "engine verification result inconclusive");
-			ws_data_ptr->message  = g_string_new("Engine verification done but result is unknown.");
-		} else {
-			// Ordinary failure. Save server's reply (to forward to client later on)
-			syslog_server(LOG_INFO, 
-			              "Websocket engine uploader: Process verification result message - "
-			              "engine does not satisfy all its properties");
-			ws_data_ptr->message  = g_string_new("");
-			g_string_append_printf(ws_data_ptr->message,"%s", ws_msg->data.ptr);
-			ws_data_ptr->message_is_json_str = true;
-		}
-		ws_data_ptr->success = false;
-		ws_data_ptr->finished = true;
+		// No 'status' field in answer with either true or false
+		syslog_server(LOG_INFO, 
+		              "Websocket engine uploader: Process verification result message - "
+		              "request %u - engine verification result inconclusive", 
+		              request->id);
+		finish_request(request, false, "Engine verification done but result is unknown.");
+	} else {
+		// Ordinary failure. Save server's reply (to forward to client later on)
+		syslog_server(LOG_INFO, 
+		              "Websocket engine uploader: Process verification result message - "
+		              "request %u - engine does not satisfy all its properties", 
+		              request->id);
+		request->result.message = g_string_new(reply_str->str);
+		request->result.message_is_json_str = true;
+		finish_request(request, false, NULL);
 	}
 }
 
 
 /**
  * @brief Process a reply message from a verification server. Depending on the contents 
- * of the message (ws_msg), updates ws_verif_data contents.
+ * of the message (ws_msg), updates the request it belongs to.
  * 
  * @param ws_msg The message received from the verifications server
- * @param ws_data_ptr (inout-param) The verification data struct to be updated acc. to server msg.
  */
-void process_verif_server_reply(struct mg_ws_message *ws_msg, ws_verif_data *ws_data_ptr) {
-	// Parses mg_ws_message, which is expected to contain a message from the verification server.
-	// Then adjusts ws_data_ptr struct according to server's message.
-	if (ws_msg == NULL || ws_data_ptr == NULL) {
+void process_verif_server_reply(struct mg_ws_message *ws_msg) {
+	if (ws_msg == NULL) {
 		syslog_server(LOG_ERR, 
 		              "Websocket engine uploader: Process verification server reply - "
 		              "invalid parameters");
 		return;
 	}
+	// The message data is not 0-terminated
+	GString *reply_str = g_string_new_len(ws_msg->data.ptr, ws_msg->data.len);
 	
 	// Check that expected field "__MESSAGE_TYPE__" is contained in message
-	char *msg_type_is_defined = strstr(ws_msg->data.ptr, msg_type_field_key);
-	if (!msg_type_is_defined) {
+	if (!strstr(reply_str->str, msg_type_field_key)) {
 		syslog_server(LOG_ERR, 
 		              "Websocket engine uploader: Process verification server reply - "
 		              "reply lacks __MESSAGE_TYPE__ field");
+		g_string_free(reply_str, true);
 		return;
 	}
 	
-	// Search for occurrence of msg_type_received_sig and msg_type_result_sig respectively
-	char *type_verif_req_received = strstr(ws_msg->data.ptr, msg_type_received_sig);
-	char *type_verif_req_result = strstr(ws_msg->data.ptr, msg_type_result_sig);
-	
-	if (type_verif_req_received) {
+	pthread_mutex_lock(&verifier_mutex);
+	ws_verif_request *request = find_request_of_reply(reply_str->str);
+	if (request == NULL) {
+		syslog_server(LOG_WARNING, 
+		              "Websocket engine uploader: Process verification server reply - "
+		              "reply does not belong to any outstanding request");
+	} else if (strstr(reply_str->str, msg_type_received_sig)) {
 		// verification has started
 		syslog_server(LOG_INFO, 
 		              "Websocket engine uploader: Process verification server reply - "
-		              "verification server begun verification");
-		ws_data_ptr->started = true;
-	} else if (type_verif_req_result) {
+		              "request %u - verification server begun verification", 
+		              request->id);
+		request->state = VERIF_STARTED;
+	} else if (strstr(reply_str->str, msg_type_result_sig)) {
 		syslog_server(LOG_INFO, 
 		              "Websocket engine uploader: Process verification server reply - "
-		              "verification server completed verification");
-		// verification has finished, parse result (updates ws_data_ptr)
-		process_verification_result_msg(ws_msg, ws_data_ptr);
+		              "request %u - verification server completed verification", 
+		              request->id);
+		// verification has finished, parse result (updates request)
+		process_verification_result_msg(reply_str, request);
 	} else {
 		// Unknown message type specified by the server.
 		syslog_server(LOG_WARNING, 
 		              "Websocket engine uploader: Process verification server reply - "
-		              "invalid reply format");
+		              "request %u - invalid reply format", 
+		              request->id);
 		// We are pessimistic and assume that the verification server will not reply again
 		// after this "mistake"
-		ws_data_ptr->success = false;
-		ws_data_ptr->finished = true;
+		finish_request(request, false, NULL);
+	}
+	pthread_mutex_unlock(&verifier_mutex);
+	g_string_free(reply_str, true);
+}
+
+
+// Fails the requests that have been sent, as their replies can no longer be received
+static void fail_sent_requests(const char *message) {
+	pthread_mutex_lock(&verifier_mutex);
+	for (ws_verif_request *request = verif_requests; request != NULL; request = request->next) {
+		if (request->state == VERIF_SENT || request->state == VERIF_STARTED) {
+			finish_request(request, false, message);
+		}
 	}
+	pthread_mutex_unlock(&verifier_mutex);
 }
 
 
 /**
  * @brief Function destined to be used as the callback for when
- * an event occurs on a websocket connection to a verifier server.
- * Depending on the event, updates the ws_verif_data associated with this connection 
- * according to the event that occurred.
+ * an event occurs on the websocket connection to the verifier server.
+ * Depending on the event, updates the state of the connection or the 
+ * requests that have been sent via it.
  * 
- * @param ws_connection websocket connection to the verifier server
+ * @param connection websocket connection to the verifier server
  * @param ev event code specifying the type of event/"something" that has occurred
  * @param ev_data event data
- * @param fn_data ws_verif_data ptr specified for this connection
+ * @param fn_data unused
  */
-void websocket_verification_callback(struct mg_connection *ws_connection, 
+void websocket_verification_callback(struct mg_connection *connection, 
                                      int ev, void *ev_data, void *fn_data) {
-	ws_verif_data *ws_data_ptr = fn_data;
-	if (ws_connection == NULL) {
-		syslog_server(LOG_ERR, 
-		              "Websocket engine uploader: verification callback - connection is NULL");
-		// Error is encountered, the verification can't be completed 
-		ws_data_ptr->success = false;
-		ws_data_ptr->finished = true;
+	if (connection == NULL || connection != ws_connection) {
+		// Events of a connection that has been replaced, e.g., after the URL changed
+		return;
 	} else if (ev == MG_EV_ERROR) {
-		syslog_server(LOG_ERR, 
+		syslog_server(ws_connection_open || reconnect_backoff_ms == 0 ? LOG_ERR : LOG_DEBUG, 
 		              "Websocket engine uploader: verification callback - received error event: %s", 
 		              (char *) ev_data);
-		// Error is encountered, the verification can't be completed 
-		ws_data_ptr->success = false;
-		ws_data_ptr->finished = true;
 	} else if (ev == MG_EV_WS_OPEN) {
-		// The websocket connection is open, send the verification request to the server
-		send_verif_req_message(ws_connection, ws_data_ptr);
+		syslog_server(LOG_INFO, 
+		              "Websocket engine uploader: verification callback - "
+		              "websocket connection to verifier server is open");
+		ws_connection_open = true;
+		reconnect_backoff_ms = 0;
 	} else if (ev == MG_EV_WS_MSG) {
 		// "Normal" message -> Process message from server
-		process_verif_server_reply((struct mg_ws_message *) ev_data, ws_data_ptr);
+		process_verif_server_reply((struct mg_ws_message *) ev_data);
 	} else if (ev == MG_EV_CLOSE) {
-		syslog_server(LOG_INFO, 
+		syslog_server(ws_connection_open ? LOG_INFO : LOG_DEBUG, 
 		              "Websocket engine uploader: verification callback - "
-		              "closing websocket connection to verifier server");
-		ws_data_ptr->finished = true;
+		              "websocket connection to verifier server closed");
+		ws_connection = NULL;
+		ws_connection_open = false;
+		fail_sent_requests("connection to the verification server was lost");
+		// Reconnect with exponential backoff
+		reconnect_backoff_ms = reconnect_backoff_ms == 0 
+		                       ? websocket_reconnect_backoff_min_ms 
+		                       : MIN(2 * reconnect_backoff_ms, websocket_reconnect_backoff_max_ms);
+		reconnect_at_ms = mg_millis() + reconnect_backoff_ms;
 	}
 }
 
 
-verif_result verify_engine_model(const char* f_filepath) {
+// Connects to the verifier url, or reconnects if the url has changed
+static void maintain_connection(struct mg_mgr *event_manager) {
+	pthread_mutex_lock(&verifier_mutex);
+	if (ws_connection != NULL && ws_connection_url_generation != verifier_url_generation) {
+		// Url changed, close the connection to the old verifier
+		ws_connection->is_closing = 1;
+		ws_connection = NULL;
+		ws_connection_open = false;
+		reconnect_backoff_ms = 0;
+		reconnect_at_ms = 0;
+		pthread_mutex_unlock(&verifier_mutex);
+		fail_sent_requests("verification server URL changed during verification");
+		pthread_mutex_lock(&verifier_mutex);
+	}
+	if (ws_connection == NULL && verifier_url != NULL && mg_millis() >= reconnect_at_ms) {
+		ws_connection_url_generation = verifier_url_generation;
+		ws_connection = mg_ws_connect(event_manager, verifier_url, 
+		                              websocket_verification_callback, NULL, NULL);
+		if (ws_connection == NULL) {
+			reconnect_backoff_ms = websocket_reconnect_backoff_max_ms;
+			reconnect_at_ms = mg_millis() + reconnect_backoff_ms;
+			syslog_server(LOG_ERR, 
+			              "Websocket engine uploader: Maintain connection - "
+			              "cannot connect to %s", 
+			              verifier_url);
+		}
+	}
+	pthread_mutex_unlock(&verifier_mutex);
+}
+
+
+// Sends the queued requests, and fails the requests whose deadline has passed
+static void process_requests(void) {
+	const int64_t now_ms = mg_millis();
+	pthread_mutex_lock(&verifier_mutex);
+	for (ws_verif_request *request = verif_requests; request != NULL; request = request->next) {
+		if (request->state == VERIF_QUEUED && ws_connection_open) {
+			syslog_server(LOG_INFO, 
+			              "Websocket engine uploader: Process requests - "
+			              "sending request %u to verifier server", 
+			              request->id);
+			const size_t sent_bytes = mg_ws_send(ws_connection, request->request_msg->str, 
+			                                     request->request_msg->len, WEBSOCKET_OP_TEXT);
+			g_string_free(request->request_msg, true);
+			request->request_msg = NULL;
+			if (sent_bytes == 0) {
+				syslog_server(LOG_ERR, 
+				              "Websocket engine uploader: Process requests - "
+				              "sending verification request %u failed", 
+				              request->id);
+				finish_request(request, false, NULL);
+				continue;
+			}
+			request->state = VERIF_SENT;
+			request->deadline_ms = now_ms + websocket_start_timeout_ms;
+		} else if ((request->state == VERIF_QUEUED || request->state == VERIF_SENT) 
+		           && now_ms > request->deadline_ms) {
+			syslog_server(LOG_WARNING, 
+			              "Websocket engine uploader: Process requests - "
+			              "verification %u did not start within %u ms, abort", 
+			              request->id, websocket_start_timeout_ms);
+			finish_request(request, false, request->state == VERIF_QUEUED 
+			               ? "verification server could not be reached" : NULL);
+		}
+	}
+	pthread_mutex_unlock(&verifier_mutex);
+}
+
+
+static void *verifier_client_run(void *_) {
 	struct mg_mgr event_manager;
-	ws_verif_data ws_verif_data = {false, false, false, false, g_string_new(f_filepath), NULL};
+	mg_mgr_init(&event_manager);
+	pthread_mutex_lock(&verifier_mutex);
+	client_wakeup_pipe = mg_mkpipe(&event_manager, NULL, NULL);
+	pthread_mutex_unlock(&verifier_mutex);
 	
+	while (client_running) {
+		maintain_connection(&event_manager);
+		process_requests();
+		mg_mgr_poll(&event_manager, websocket_single_poll_length_ms);
+	}
+	
+	if (ws_connection != NULL && ws_connection_open) {
+		// '1' is length of payload ("0"), which indicates reason for closing.
+		mg_ws_send(ws_connection, "0", 1, WEBSOCKET_OP_CLOSE);
+		ws_connection->is_draining = 1;
+		mg_mgr_poll(&event_manager, websocket_single_poll_length_ms);
+	}
+	pthread_mutex_lock(&verifier_mutex);
+	client_wakeup_pipe = NULL;
+	ws_connection = NULL;
+	ws_connection_open = false;
+	for (ws_verif_request *request = verif_requests; request != NULL; request = request->next) {
+		if (request->state != VERIF_FINISHED) {
+			finish_request(request, false, "verification client stopped");
+		}
+	}
+	pthread_mutex_unlock(&verifier_mutex);
+	// Free event manager resources, including the connection
+	mg_mgr_free(&event_manager);
+	return NULL;
+}
+
+
+// Shall only be called with verifier_mutex acquired
+static void wakeup_client(void) {
+	if (client_wakeup_pipe != NULL) {
+		mg_mgr_wakeup(client_wakeup_pipe, NULL, 0);
+	}
+}
+
+
+void verifier_client_start(void) {
+	if (client_running) {
+		return;
+	}
+	client_running = true;
+	reconnect_backoff_ms = 0;
+	reconnect_at_ms = 0;
+	if (pthread_create(&client_thread, NULL, verifier_client_run, NULL)) {
+		client_running = false;
+		syslog_server(LOG_ERR, "Websocket engine uploader: Start client - thread creation failed");
+		return;
+	}
+	syslog_server(LOG_INFO, "Websocket engine uploader: Start client - started");
+}
+
+
+void verifier_client_stop(void) {
+	if (!client_running) {
+		return;
+	}
+	pthread_mutex_lock(&verifier_mutex);
+	client_running = false;
+	wakeup_client();
+	pthread_mutex_unlock(&verifier_mutex);
+	pthread_join(client_thread, NULL);
+	syslog_server(LOG_INFO, "Websocket engine uploader: Stop client - stopped");
+}
+
+
+verif_result verify_engine_model(const char* f_filepath) {
+	verif_result result_data = {false, false, NULL};
+	pthread_mutex_lock(&verifier_mutex);
 	if (verifier_url == NULL) {
+		pthread_mutex_unlock(&verifier_mutex);
 		syslog_server(LOG_ERR, 
 		              "Websocket engine uploader: Verify engine model - "
 		              "no verifier URL has been set, abort");
-		verif_result result_data;
-		result_data.success = false;
-		result_data.message_is_json_str = false;
 		result_data.message = g_string_new("No verifier server URL has been set, "
 		                                   "thus no verification was possible");
 		return result_data;
+	} else if (!client_running) {
+		pthread_mutex_unlock(&verifier_mutex);
+		syslog_server(LOG_ERR, 
+		              "Websocket engine uploader: Verify engine model - "
+		              "verifier client is not running, abort");
+		result_data.message = g_string_new("Verifier client is not running, "
+		                                   "thus no verification was possible");
+		return result_data;
 	}
+	const unsigned int request_id = next_request_id++;
+	pthread_mutex_unlock(&verifier_mutex);
 	
-	// Client connection, init event manager
-	struct mg_connection *ws_connection;
-	mg_mgr_init(&event_manager);
+	// Read sctx model from file, build msg with necessary formatting
+	GString *g_verif_msg_str = g_string_new("");
+	if (!parse_model_into_verif_msg_str(g_verif_msg_str, f_filepath, request_id)) {
+		syslog_server(LOG_ERR, 
+		              "Websocket engine uploader: Verify engine model - "
+		              "unable to parse model file %s", 
+		              f_filepath);
+		g_string_free(g_verif_msg_str, true);
+		return result_data;
+	}
 	
-	// Create client; callback will automatically initiate and process verification
-	ws_connection = mg_ws_connect(&event_manager, verifier_url, websocket_verification_callback, 
-	                              &ws_verif_data, NULL);
+	ws_verif_request request = {
+		.id = request_id,
+		.state = VERIF_QUEUED,
+		.request_msg = g_verif_msg_str,
+		.deadline_ms = mg_millis() + websocket_start_timeout_ms,
+		.result = {false, false, NULL},
+		.next = NULL
+	};
 	
-	unsigned int poll_counter = 0;
-	// Wait for Verification to end
-	while (ws_connection && ws_verif_data.finished == false) {
-		// Wait/Poll for reply
-		mg_mgr_poll(&event_manager, websocket_single_poll_length_ms);
-		++poll_counter;
-		
-		// Check if verification has started yet; abort if not started within certain time.
-		if (poll_counter > websocket_max_polls_before_start && !ws_verif_data.started) { 
-			ws_verif_data.finished = true;
-			ws_verif_data.success = false;
-			syslog_server(LOG_WARNING, 
-			              "Websocket engine uploader: Verify engine model - "
-			              "verification did not start within %u ms, abort", 
-			              (poll_counter * websocket_single_poll_length_ms));
-		}
+	pthread_mutex_lock(&verifier_mutex);
+	ws_verif_request **tail = &verif_requests;
+	while (*tail != NULL) {
+		tail = &(*tail)->next;
 	}
-	
-	if (ws_connection && !ws_connection->is_closing) {
-		// Close if not yet closing. Then one poll, otherwise will not close.
-		// '1' is length of payload ("0"), which indicates reason for closing.
-		mg_ws_send(ws_connection, "0", 1, WEBSOCKET_OP_CLOSE);
-		mg_mgr_poll(&event_manager, 1000);
+	*tail = &request;
+	wakeup_client();
+	// The client thread sends the request and finishes it with the reply
+	while (request.state != VERIF_FINISHED) {
+		pthread_cond_wait(&verif_finished, &verifier_mutex);
 	}
-	
-	// Free event manager resources, including ws_connection
-	mg_mgr_free(&event_manager);
-	verif_result result_data;
-	result_data.success = ws_verif_data.success;
-	result_data.message_is_json_str = ws_verif_data.message_is_json_str;
-	result_data.message = ws_verif_data.message;
-	
-	// Free string allocated for filepath of model file
-	g_string_free(ws_verif_data.file_path, true);
-	return result_data;
+	for (ws_verif_request **it = &verif_requests; *it != NULL; it = &(*it)->next) {
+		if (*it == &request) {
+			*it = request.next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&verifier_mutex);
+	return request.result;
 }
 
 
@@ -370,25 +559,35 @@ void set_verifier_url(const char *upd_verifier_url) {
 		syslog_server(LOG_WARNING, "Set verifier URL - proposed URL is NULL, URL not updated");
 		return;
 	}
+	pthread_mutex_lock(&verifier_mutex);
 	if (verifier_url != NULL) {
 		free(verifier_url);
 		verifier_url = NULL;
 	}
 	verifier_url = strdup(upd_verifier_url);
-	syslog_server(LOG_NOTICE, "Set verifier URL - verifier URL set to: %s", verifier_url);
+	verifier_url_generation++;
+	wakeup_client();
+	pthread_mutex_unlock(&verifier_mutex);
+	syslog_server(LOG_NOTICE, "Set verifier URL - verifier URL set to: %s", upd_verifier_url);
 }
 
 
-const char * get_verifier_url() {
-	return verifier_url;
+char *get_verifier_url() {
+	pthread_mutex_lock(&verifier_mutex);
+	char *url = verifier_url != NULL ? strdup(verifier_url) : NULL;
+	pthread_mutex_unlock(&verifier_mutex);
+	return url;
 }
 
 
 void free_verifier_url() {
+	pthread_mutex_lock(&verifier_mutex);
 	if (verifier_url != NULL) {
 		free(verifier_url);
 		verifier_url = NULL;
+		verifier_url_generation++;
 	}
+	pthread_mutex_unlock(&verifier_mutex);
 }
 
 
@@ -402,19 +601,18 @@ void load_cached_verifier_url() {
 		size_t length = 0;
 		ssize_t bytes_read_count = getdelim(&buffer, &length, '\0', file);
 		if (bytes_read_count != -1 && buffer != NULL) {
-			// url read, update verifier_url accordingly
-			free_verifier_url();
-			verifier_url = strdup(buffer);
 			// Ensure no newline at the end, necessary on e.g. Raspberry Pi OS (but not Ubuntu 22.04)
-			int len = strlen(verifier_url);
-			if (len > 0 && verifier_url[len-1] == '\n') {
-				verifier_url[len-1] = '\0';
+			int len = strlen(buffer);
+			if (len > 0 && buffer[len-1] == '\n') {
+				buffer[len-1] = '\0';
 			}
+			// url read, update verifier_url accordingly
+			set_verifier_url(buffer);
 			
-			free(buffer);
 			syslog_server(LOG_INFO, 
 			              "Load cached verifier URL - loaded URL %s from cache", 
-			              verifier_url);
+			              buffer);
+			free(buffer);
 		} else {
 			syslog_server(LOG_NOTICE, "Load cached verifier URL - no content in cache file");
 		}
@@ -427,7 +625,8 @@ void load_cached_verifier_url() {
 
 void cache_verifier_url() {
 	// write current verifier url to cache file unless url is null
-	if (verifier_url == NULL) {
+	char *url = get_verifier_url();
+	if (url == NULL) {
 		syslog_server(LOG_NOTICE, "Cache verifier URL - not cached as URL is NULL");
 		return;
 	}
@@ -436,12 +635,14 @@ void cache_verifier_url() {
 	FILE* file = fopen(cache_file_verifier_url, "w");
 	if (file == NULL) {
 		syslog_server(LOG_ERR, "Cache verifier URL - cache file opening failed");
+		free(url);
 		return;
 	}
 	
 	// Write the content to the file
-	fputs(verifier_url, file);
-	syslog_server(LOG_INFO, "Cache verifier URL - cached URL %s", verifier_url);
+	fputs(url, file);
+	syslog_server(LOG_INFO, "Cache verifier URL - cached URL %s", url);
+	free(url);
 	
 	// Close the file
 	fclose(file);
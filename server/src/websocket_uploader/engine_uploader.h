@@ -37,10 +37,24 @@ typedef struct {
    GString* message;
 } verif_result;
 
-extern char *verifier_url;
+/**
+ * @brief Starts the thread that keeps a websocket connection to the verification server open, 
+ * reconnects with exponential backoff when it is lost, and reconnects when the url changes.
+ * All verification requests are sent via this connection.
+ */
+void verifier_client_start(void);
+
+/**
+ * @brief Closes the connection to the verification server and stops its thread.
+ * Verifications that are still outstanding fail.
+ */
+void verifier_client_stop(void);
 
 /**
- * Verifies sctx engine model located in file at f_filepath.
+ * Verifies sctx engine model located in file at f_filepath. 
+ * Blocks until the verification server replied with the result. 
+ * Can be called concurrently; the requests share the connection of the verifier client 
+ * and are correlated with their replies by id.
  * 
  * @param f_filepath Path to the file containing the .sctx model to be verified
  * @return verif_result Result of the verification
@@ -56,11 +70,11 @@ verif_result verify_engine_model(const char* f_filepath);
 void set_verifier_url(const char *verifier_url);
 
 /**
- * @brief Get the verifier url. The returned pointer shall not be freed or modified by the caller.
+ * @brief Get a copy of the verifier url, which the caller shall free.
  * 
- * @return const char* the currently configured url to the verification server.
+ * @return char* the currently configured url to the verification server, or NULL if none is set.
  */
-const char *get_verifier_url();
+char *get_verifier_url();
 
 /**
  * @brief Free the verifier url.
@@ -0,0 +1,668 @@
+/*
+ *
+ * Copyright (C) 2022 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Eugene Yip <https://github.com/eyip002>
+ *
+ */
+
+// Micro-benchmarks of the interlocking and config data hot paths. Each layout under the 
+// configurations directory is loaded with libbidib driving the simulated railway, and each 
+// hot path is timed until it has run for at least the minimum time. The results can be saved 
+// as a baseline (CSV) and compared against a saved baseline to make regressions visible.
+// The memory footprints of the interlocking table and of the config tables are measured 
+// for each layout, and compared with the estimates that the server reports (monitor/memory).
+// The monitor replies are built as json and encoded as CBOR for each layout, to compare 
+// their sizes and the time that the encoding adds.
+// 
+// Usage: ./server_benchmarks [--configurations <dir>] [--min-time-ms <n>] [--seed <n>]
+//                            [--save <baseline.csv>] [--baseline <baseline.csv>]
+//                            [--tolerance <percent>]
+
+#include <bidib/bidib.h>
+#include <dirent.h>
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../src/bahn_data_util.h"
+#include "../../src/interlocking.h"
+#include "../../src/handler_controller.h"
+#include "../../src/railway_simulation.h"
+#include "../../src/parsers/interlocking_parser.h"
+#include "../../src/parsers/config_data_parser.h"
+#include "../../src/check_route_sectional/check_route_sectional_direct.h"
+#include "../../src/memory_footprint.h"
+#include "../../src/handler_monitor.h"
+#include "../../src/response_encoding.h"
+
+// Percentages of routes that are granted in the randomised route states
+static const unsigned int granted_percentages[] = { 0, 25, 50 };
+// Time given to libbidib to connect to the simulated boards
+static const unsigned int bidib_settle_ms = 500;
+
+static const char *configurations_dir = "../../configurations/";
+static unsigned int min_time_ms = 200;
+static unsigned int seed = 1;
+static double tolerance_percent = 25.0;
+
+
+// --- Allocation counting ---
+
+// Only the allocations of the benchmarking thread are counted, libbidib allocates 
+// concurrently in its own threads
+static __thread bool counting_allocs = false;
+static __thread unsigned long alloc_count = 0;
+// Bytes allocated minus bytes freed while counting. With GLib before 2.76, the structs of 
+// arrays and hash tables come from its slice allocator and are not included.
+static __thread long long alloc_bytes = 0;
+
+#ifdef __GLIBC__
+
+#include <malloc.h>
+
+// Replacements of the glibc allocator, which are also used by glib, libyaml and libbidib
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+// Size of the chunk of an allocation: its usable size and the size field
+static long long chunk_size(void *ptr) {
+	return ptr != NULL ? (long long) (malloc_usable_size(ptr) + sizeof(size_t)) : 0;
+}
+
+void *malloc(size_t size) {
+	void *ptr = __libc_malloc(size);
+	if (counting_allocs) {
+		alloc_count++;
+		alloc_bytes += chunk_size(ptr);
+	}
+	return ptr;
+}
+
+void *calloc(size_t count, size_t size) {
+	void *ptr = __libc_calloc(count, size);
+	if (counting_allocs) {
+		alloc_count++;
+		alloc_bytes += chunk_size(ptr);
+	}
+	return ptr;
+}
+
+void *realloc(void *ptr, size_t size) {
+	const long long old_size = counting_allocs ? chunk_size(ptr) : 0;
+	void *new_ptr = __libc_realloc(ptr, size);
+	if (counting_allocs) {
+		alloc_count += ptr == NULL;
+		if (new_ptr != NULL || size == 0) {
+			alloc_bytes += chunk_size(new_ptr) - old_size;
+		}
+	}
+	return new_ptr;
+}
+
+void free(void *ptr) {
+	if (counting_allocs && ptr != NULL) {
+		alloc_bytes -= chunk_size(ptr);
+	}
+	__libc_free(ptr);
+}
+
+static const bool allocs_counted = true;
+
+#else
+
+static const bool allocs_counted = false;
+
+#endif
+
+
+// --- Timing ---
+
+typedef struct {
+	char layout[64];
+	char name[96];
+	unsigned long iterations;
+	double ns_per_op;
+	double allocs_per_op;
+	// Memory footprints only, otherwise -1: bytes retained on the heap (-1 if allocations 
+	// are not counted), and the estimate of the server (see memory_footprint.h)
+	long long bytes;
+	long long estimated_bytes;
+} t_bench_result;
+
+// One operation of a benchmark; `i` is the iteration, for cycling through the inputs
+typedef void (*t_bench_op)(void *context, unsigned long i);
+
+static GArray *results = NULL;
+
+static int64_t now_ns(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void run_benchmark(const char *layout, const char *name, t_bench_op op, void *context) {
+	// Warm up, then double the iterations until the minimum time is reached
+	op(context, 0);
+	unsigned long iterations = 1;
+	int64_t elapsed_ns = 0;
+	unsigned long allocs = 0;
+	while (true) {
+		alloc_count = 0;
+		counting_allocs = true;
+		const int64_t start_ns = now_ns();
+		for (unsigned long i = 0; i < iterations; i++) {
+			op(context, i);
+		}
+		elapsed_ns = now_ns() - start_ns;
+		counting_allocs = false;
+		allocs = alloc_count;
+		if (elapsed_ns >= (int64_t) min_time_ms * 1000000 || iterations >= (1UL << 30)) {
+			break;
+		}
+		iterations *= 2;
+	}
+	
+	t_bench_result result = {
+		.iterations = iterations,
+		.ns_per_op = (double) elapsed_ns / iterations,
+		.allocs_per_op = allocs_counted ? (double) allocs / iterations : -1.0,
+		.bytes = -1,
+		.estimated_bytes = -1
+	};
+	snprintf(result.layout, sizeof(result.layout), "%s", layout);
+	snprintf(result.name, sizeof(result.name), "%s", name);
+	g_array_append_val(results, result);
+	printf("%-20s %-44s %12.1f ns/op %10.2f allocs/op %10lu ops\n", 
+	       layout, name, result.ns_per_op, result.allocs_per_op, iterations);
+	fflush(stdout);
+}
+
+
+// Records the memory footprint of a subsystem of a layout
+static void record_footprint(const char *layout, const char *subsystem, long long bytes, 
+                             size_t estimated_bytes) {
+	t_bench_result result = {
+		.iterations = 1,
+		.ns_per_op = 0.0,
+		.allocs_per_op = -1.0,
+		.bytes = allocs_counted ? bytes : -1,
+		.estimated_bytes = (long long) estimated_bytes
+	};
+	snprintf(result.layout, sizeof(result.layout), "%s", layout);
+	snprintf(result.name, sizeof(result.name), "memory/%s", subsystem);
+	g_array_append_val(results, result);
+	printf("%-20s %-44s %12lld bytes %12zu estimated (%+.1f%%)\n", 
+	       layout, result.name, result.bytes, estimated_bytes, 
+	       result.bytes > 0 ? 100.0 * ((double) estimated_bytes - bytes) / bytes : 0.0);
+	fflush(stdout);
+}
+
+
+// --- Benchmarked operations ---
+
+typedef struct {
+	const char *config_dir;
+	// Shallow copies of the loaded interlocking table's route ids, sources and destinations
+	GArray *route_ids;
+	GArray *sources;
+	GArray *destinations;
+	// Granted routes and their requested conflicting routes
+	GArray *conflict_granted;
+	GArray *conflict_requested;
+	// Segments of the route paths
+	GArray *segment_ids;
+} t_bench_layout;
+
+static void op_parse_interlocking_table(void *context, unsigned long i) {
+	const t_bench_layout *layout = context;
+	GHashTable *table = parse_interlocking_table(layout->config_dir);
+	if (table != NULL) {
+		g_hash_table_destroy(table);
+	}
+}
+
+static void op_parse_config_data(void *context, unsigned long i) {
+	const t_bench_layout *layout = context;
+	t_config_data config_data = {};
+	parse_config_data(layout->config_dir, &config_data);
+	free_config_data(config_data);
+}
+
+static void op_get_route_ids(void *context, unsigned long i) {
+	const t_bench_layout *layout = context;
+	const unsigned int index = i % layout->route_ids->len;
+	interlocking_table_get_route_ids(g_array_index(layout->sources, char *, index), 
+	                                 g_array_index(layout->destinations, char *, index));
+}
+
+static void op_get_route_has_granted_conflicts(void *context, unsigned long i) {
+	const t_bench_layout *layout = context;
+	get_route_has_granted_conflicts(
+			g_array_index(layout->route_ids, char *, i % layout->route_ids->len));
+}
+
+static void op_get_route_is_clear(void *context, unsigned long i) {
+	const t_bench_layout *layout = context;
+	get_route_is_clear(g_array_index(layout->route_ids, char *, i % layout->route_ids->len));
+}
+
+static void op_is_route_conflict_safe_sectional(void *context, unsigned long i) {
+	const t_bench_layout *layout = context;
+	const unsigned int index = i % layout->conflict_granted->len;
+	is_route_conflict_safe_sectional(g_array_index(layout->conflict_granted, char *, index), 
+	                                 g_array_index(layout->conflict_requested, char *, index));
+}
+
+static void op_get_block_id_of_segment(void *context, unsigned long i) {
+	const t_bench_layout *layout = context;
+	config_get_block_id_of_segment(
+			g_array_index(layout->segment_ids, char *, i % layout->segment_ids->len));
+}
+
+static void op_get_scalar_string_value(void *context, unsigned long i) {
+	const t_bench_layout *layout = context;
+	config_get_scalar_string_value("route", 
+	                               g_array_index(layout->route_ids, char *, 
+	                                             i % layout->route_ids->len), 
+	                               "destination");
+}
+
+
+// --- Reply encodings ---
+
+// Monitor replies whose json build time, and CBOR size and encode time are measured. 
+// The engines and interlockers are left out, as they need the dynamic containers
+static const char *monitor_replies[] = {
+	"segments", "train-states", "reversers", "points", "signals", "granted-routes", 
+	"track-outputs", "trains", "peripherals"
+};
+
+typedef struct {
+	const char *endpoint;
+	GString *json;
+} t_bench_reply;
+
+static void op_build_monitor_reply(void *context, unsigned long i) {
+	const t_bench_reply *reply = context;
+	GString *json = monitor_reply_json(reply->endpoint);
+	if (json != NULL) {
+		g_string_free(json, true);
+	}
+}
+
+static void op_encode_cbor(void *context, unsigned long i) {
+	const t_bench_reply *reply = context;
+	GString *cbor = response_encoding_json_to_cbor(reply->json->str, reply->json->len);
+	if (cbor != NULL) {
+		g_string_free(cbor, true);
+	}
+}
+
+static void benchmark_reply_encodings(const char *name) {
+	char bench_name[96];
+	for (unsigned int i = 0; i < G_N_ELEMENTS(monitor_replies); i++) {
+		t_bench_reply reply = { 
+			.endpoint = monitor_replies[i], 
+			.json = monitor_reply_json(monitor_replies[i]) 
+		};
+		if (reply.json == NULL) {
+			fprintf(stderr, "%s: unable to build the reply %s, skipped\n", name, reply.endpoint);
+			continue;
+		}
+		GString *cbor = response_encoding_json_to_cbor(reply.json->str, reply.json->len);
+		if (cbor == NULL) {
+			fprintf(stderr, "%s: reply %s is not valid json, skipped\n", name, reply.endpoint);
+			g_string_free(reply.json, true);
+			continue;
+		}
+		snprintf(bench_name, sizeof(bench_name), "monitor/%s", reply.endpoint);
+		printf("%-20s %-44s %12zu bytes json %11zu bytes CBOR\n", 
+		       name, bench_name, reply.json->len, cbor->len);
+		g_string_free(cbor, true);
+		
+		snprintf(bench_name, sizeof(bench_name), "monitor_reply_json/%s", reply.endpoint);
+		run_benchmark(name, bench_name, op_build_monitor_reply, &reply);
+		snprintf(bench_name, sizeof(bench_name), "json_to_cbor/%s", reply.endpoint);
+		run_benchmark(name, bench_name, op_encode_cbor, &reply);
+		g_string_free(reply.json, true);
+	}
+}
+
+
+// --- Layouts ---
+
+static void collect_layout_inputs(t_bench_layout *layout) {
+	layout->route_ids = interlocking_table_get_all_route_ids_shallowcpy();
+	layout->sources = g_array_new(FALSE, FALSE, sizeof(char *));
+	layout->destinations = g_array_new(FALSE, FALSE, sizeof(char *));
+	layout->conflict_granted = g_array_new(FALSE, FALSE, sizeof(char *));
+	layout->conflict_requested = g_array_new(FALSE, FALSE, sizeof(char *));
+	layout->segment_ids = g_array_new(FALSE, FALSE, sizeof(char *));
+	
+	GHashTable *segments = g_hash_table_new(g_str_hash, g_str_equal);
+	for (unsigned int i = 0; i < layout->route_ids->len; i++) {
+		const t_interlocking_route *route = 
+				get_route(g_array_index(layout->route_ids, char *, i));
+		g_array_append_val(layout->sources, route->source);
+		g_array_append_val(layout->destinations, route->destination);
+		for (unsigned int j = 0; route->conflicts != NULL && j < route->conflicts->len; j++) {
+			g_array_append_val(layout->conflict_granted, route->id);
+			g_array_append_val(layout->conflict_requested, 
+			                   g_array_index(route->conflicts, char *, j));
+		}
+		for (unsigned int j = 0; j < route->path->len; j++) {
+			char *item = g_array_index(route->path, char *, j);
+			if (is_type_segment(item) && g_hash_table_add(segments, item)) {
+				g_array_append_val(layout->segment_ids, item);
+			}
+		}
+	}
+	g_hash_table_destroy(segments);
+}
+
+static void free_layout_inputs(t_bench_layout *layout) {
+	GArray *arrays[] = { layout->route_ids, layout->sources, layout->destinations, 
+	                     layout->conflict_granted, layout->conflict_requested, 
+	                     layout->segment_ids };
+	for (unsigned int i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++) {
+		g_array_free(arrays[i], true);
+	}
+}
+
+// Grants the given percentage of routes, chosen at random, to a benchmark train
+static void set_granted_routes(const t_bench_layout *layout, unsigned int percentage) {
+	for (unsigned int i = 0; i < layout->route_ids->len; i++) {
+		t_interlocking_route *route = get_route(g_array_index(layout->route_ids, char *, i));
+		free(route->train);
+		route->train = ((unsigned int) rand() % 100 < percentage) ? strdup("bench_train") : NULL;
+	}
+}
+
+static void measure_footprints(const char *name, const char *config_dir, 
+                               long long loaded_bytes) {
+	t_config_data config_data = {};
+	alloc_bytes = 0;
+	counting_allocs = true;
+	parse_config_data(config_dir, &config_data);
+	counting_allocs = false;
+	const long long config_bytes = alloc_bytes;
+	
+	record_footprint(name, "interlocking_table", loaded_bytes - config_bytes, 
+	                 interlocking_table_memory_footprint());
+	record_footprint(name, "config_tables", config_bytes, 
+	                 config_data_memory_footprint(&config_data));
+	free_config_data(config_data);
+}
+
+static void benchmark_layout(const char *name, const char *config_dir) {
+	if (!railway_simulation_start(config_dir)) {
+		fprintf(stderr, "%s: unable to start the simulated railway, skipped\n", name);
+		return;
+	}
+	if (bidib_start_pointer(railway_simulation_read, railway_simulation_write, config_dir, 0)) {
+		fprintf(stderr, "%s: unable to start libbidib, skipped\n", name);
+		railway_simulation_stop();
+		return;
+	}
+	usleep(bidib_settle_ms * 1000);
+	// The bytes retained by loading the configuration, of which the config tables are 
+	// measured separately by parsing them again
+	alloc_bytes = 0;
+	counting_allocs = true;
+	const bool is_loaded = bahn_data_util_initialise_config(config_dir);
+	counting_allocs = false;
+	const long long loaded_bytes = alloc_bytes;
+	if (!is_loaded) {
+		fprintf(stderr, "%s: unable to load the configuration, skipped\n", name);
+		bidib_stop();
+		railway_simulation_stop();
+		return;
+	}
+	measure_footprints(name, config_dir, loaded_bytes);
+	
+	t_bench_layout layout = { .config_dir = config_dir };
+	collect_layout_inputs(&layout);
+	
+	run_benchmark(name, "parse_interlocking_table", op_parse_interlocking_table, &layout);
+	run_benchmark(name, "parse_config_data", op_parse_config_data, &layout);
+	if (layout.route_ids->len > 0) {
+		run_benchmark(name, "interlocking_table_get_route_ids", op_get_route_ids, &layout);
+		run_benchmark(name, "config_get_scalar_string_value", 
+		              op_get_scalar_string_value, &layout);
+		
+		srand(seed);
+		char bench_name[96];
+		for (unsigned int i = 0; i < G_N_ELEMENTS(granted_percentages); i++) {
+			set_granted_routes(&layout, granted_percentages[i]);
+			snprintf(bench_name, sizeof(bench_name), "get_route_has_granted_conflicts/%u%%", 
+			         granted_percentages[i]);
+			run_benchmark(name, bench_name, op_get_route_has_granted_conflicts, &layout);
+			snprintf(bench_name, sizeof(bench_name), "get_route_is_clear/%u%%", 
+			         granted_percentages[i]);
+			run_benchmark(name, bench_name, op_get_route_is_clear, &layout);
+		}
+		set_granted_routes(&layout, 0);
+	}
+	if (layout.conflict_granted->len > 0) {
+		run_benchmark(name, "is_route_conflict_safe_sectional", 
+		              op_is_route_conflict_safe_sectional, &layout);
+	}
+	if (layout.segment_ids->len > 0) {
+		run_benchmark(name, "config_get_block_id_of_segment", 
+		              op_get_block_id_of_segment, &layout);
+	}
+	benchmark_reply_encodings(name);
+	
+	free_layout_inputs(&layout);
+	bahn_data_util_free_config();
+	bidib_stop();
+	railway_simulation_stop();
+	// libbidib closes syslog when it stops
+	openlog("swtbahn", 0, LOG_LOCAL0);
+	setlogmask(LOG_UPTO(LOG_NOTICE));
+}
+
+static int compare_strings(const void *a, const void *b) {
+	return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+static void benchmark_layouts(void) {
+	DIR *dir = opendir(configurations_dir);
+	if (dir == NULL) {
+		fprintf(stderr, "Unable to open the configurations directory %s\n", configurations_dir);
+		return;
+	}
+	GPtrArray *names = g_ptr_array_new_with_free_func(g_free);
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if (entry->d_name[0] == '.') {
+			continue;
+		}
+		// Only layouts that have an interlocking table and extras configuration
+		char *table = g_strdup_printf("%s%s/interlocking_table.yml", 
+		                              configurations_dir, entry->d_name);
+		char *extras = g_strdup_printf("%s%s/extras_config.yml", 
+		                               configurations_dir, entry->d_name);
+		if (access(table, R_OK) == 0 && access(extras, R_OK) == 0) {
+			g_ptr_array_add(names, g_strdup(entry->d_name));
+		}
+		g_free(table);
+		g_free(extras);
+	}
+	closedir(dir);
+	
+	qsort(names->pdata, names->len, sizeof(char *), compare_strings);
+	for (unsigned int i = 0; i < names->len; i++) {
+		const char *name = g_ptr_array_index(names, i);
+		char *config_dir = g_strdup_printf("%s%s/", configurations_dir, name);
+		benchmark_layout(name, config_dir);
+		g_free(config_dir);
+	}
+	g_ptr_array_free(names, true);
+}
+
+
+// --- Baselines ---
+
+static bool save_baseline(const char *path) {
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		fprintf(stderr, "Unable to write the baseline %s\n", path);
+		return false;
+	}
+	fprintf(file, "layout,benchmark,ns_per_op,allocs_per_op,iterations,bytes,estimated_bytes\n");
+	for (unsigned int i = 0; i < results->len; i++) {
+		const t_bench_result *result = &g_array_index(results, t_bench_result, i);
+		fprintf(file, "%s,%s,%.1f,%.2f,%lu,%lld,%lld\n", result->layout, result->name, 
+		        result->ns_per_op, result->allocs_per_op, result->iterations, 
+		        result->bytes, result->estimated_bytes);
+	}
+	fclose(file);
+	printf("Saved the baseline to %s\n", path);
+	return true;
+}
+
+static const t_bench_result *find_result(const char *layout, const char *name) {
+	for (unsigned int i = 0; i < results->len; i++) {
+		const t_bench_result *result = &g_array_index(results, t_bench_result, i);
+		if (strcmp(result->layout, layout) == 0 && strcmp(result->name, name) == 0) {
+			return result;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Compares the results with a saved baseline. A benchmark regresses if its time per 
+ * operation exceeds the baseline by more than the tolerance, or if it allocates more.
+ * A memory footprint regresses if it is larger than in the baseline.
+ * 
+ * @return number of regressions, or -1 if the baseline could not be read
+ */
+static int compare_baseline(const char *path) {
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		fprintf(stderr, "Unable to read the baseline %s\n", path);
+		return -1;
+	}
+	printf("\nComparison with the baseline %s (tolerance %.0f%%)\n", path, tolerance_percent);
+	int regressions = 0;
+	char line[256];
+	while (fgets(line, sizeof(line), file) != NULL) {
+		char layout[64];
+		char name[96];
+		double ns_per_op;
+		double allocs_per_op;
+		unsigned long iterations;
+		long long bytes = -1;
+		long long estimated_bytes = -1;
+		// Baselines saved before the memory footprints were measured have no bytes
+		const int fields = sscanf(line, "%63[^,],%95[^,],%lf,%lf,%lu,%lld,%lld", layout, name, 
+		                          &ns_per_op, &allocs_per_op, &iterations, &bytes, 
+		                          &estimated_bytes);
+		if (fields < 4) {
+			// Header
+			continue;
+		}
+		const t_bench_result *result = find_result(layout, name);
+		if (result == NULL) {
+			continue;
+		}
+		if (result->estimated_bytes >= 0) {
+			// Retained bytes if both were measured, otherwise the estimates
+			const bool is_measured = bytes >= 0 && result->bytes >= 0;
+			const long long baseline_bytes = is_measured ? bytes : estimated_bytes;
+			const long long result_bytes = is_measured ? result->bytes : result->estimated_bytes;
+			const bool larger = baseline_bytes >= 0 && result_bytes > baseline_bytes;
+			printf("%-20s %-44s %+12lld bytes%s\n", layout, name, 
+			       baseline_bytes >= 0 ? result_bytes - baseline_bytes : 0LL, 
+			       larger ? "  REGRESSION" : "");
+			regressions += larger;
+			continue;
+		}
+		const double ratio = ns_per_op > 0.0 ? result->ns_per_op / ns_per_op : 1.0;
+		const bool slower = ratio > 1.0 + tolerance_percent / 100.0;
+		const bool more_allocs = allocs_counted && allocs_per_op >= 0.0 
+		                         && result->allocs_per_op > allocs_per_op + 0.5;
+		printf("%-20s %-44s %6.2fx time %+9.2f allocs/op%s\n", layout, name, ratio, 
+		       allocs_per_op >= 0.0 ? result->allocs_per_op - allocs_per_op : 0.0, 
+		       (slower || more_allocs) ? "  REGRESSION" : "");
+		regressions += slower || more_allocs;
+	}
+	fclose(file);
+	printf("%d regression(s)\n", regressions);
+	return regressions;
+}
+
+
+int main(int argc, char **argv) {
+	const char *save_path = NULL;
+	const char *baseline_path = NULL;
+	for (int i = 1; i < argc; i++) {
+		const bool has_value = i + 1 < argc;
+		if (has_value && strcmp(argv[i], "--configurations") == 0) {
+			configurations_dir = argv[++i];
+		} else if (has_value && strcmp(argv[i], "--min-time-ms") == 0) {
+			min_time_ms = (unsigned int) strtoul(argv[++i], NULL, 10);
+		} else if (has_value && strcmp(argv[i], "--seed") == 0) {
+			seed = (unsigned int) strtoul(argv[++i], NULL, 10);
+		} else if (has_value && strcmp(argv[i], "--save") == 0) {
+			save_path = argv[++i];
+		} else if (has_value && strcmp(argv[i], "--baseline") == 0) {
+			baseline_path = argv[++i];
+		} else if (has_value && strcmp(argv[i], "--tolerance") == 0) {
+			tolerance_percent = strtod(argv[++i], NULL);
+		} else {
+			fprintf(stderr, "Usage: %s [--configurations <dir>] [--min-time-ms <n>] "
+			        "[--seed <n>] [--save <baseline.csv>] [--baseline <baseline.csv>] "
+			        "[--tolerance <percent>]\n", argv[0]);
+			return 2;
+		}
+	}
+	
+	openlog("swtbahn", 0, LOG_LOCAL0);
+	// The hot paths log on the debug level, which would flood the system log
+	setlogmask(LOG_UPTO(LOG_NOTICE));
+	syslog(LOG_INFO, "server_benchmarks: %s", "Benchmarks started");
+	
+	results = g_array_new(FALSE, FALSE, sizeof(t_bench_result));
+	benchmark_layouts();
+	
+	int ret = results->len > 0 ? 0 : 1;
+	if (save_path != NULL && !save_baseline(save_path)) {
+		ret = 1;
+	}
+	if (baseline_path != NULL && compare_baseline(baseline_path) != 0) {
+		ret = 1;
+	}
+	g_array_free(results, true);
+	
+	closelog();
+	return ret;
+}
@@ -25,14 +25,26 @@
  *
  */
 
+#include <pthread.h>
+#include <stdio.h>
 #include <syslog.h>
 #include <stddef.h>
+#include <string.h>
 #include <setjmp.h>
 #include <stdarg.h>
 #include <cmocka.h>
 #include <bidib/bidib.h>
 
 #include "../../src/bahn_data_util.h"
+#include "../../src/interlocking.h"
+#include "../../src/route_speed_profile.h"
+#include "../../src/route_planner.h"
+#include "../../src/json_response_builder.h"
+#include "../../src/response_encoding.h"
+#include "../../src/request_metrics.h"
+#include "../../src/bidib_messages.h"
+#include "../../src/websocket_uploader/engine_uploader.h"
+#include "../../src/websocket_uploader/mongoose.h"
 
 static const char *config_directory = "../../configurations/swtbahn-full/";
 
@@ -98,6 +110,245 @@ static void overlaps(void **state) {
 	assert_string_equal("seg3", overlaps[1]);
 }
 
+static void route_speed_profile(void **state) {
+	t_interlocking_route *route = get_route("0");
+	assert_non_null(route);
+	
+	t_route_speed_profile profile = route_speed_profile_plan(route, "cargo_db");
+	assert_non_null(profile.speeds);
+	assert_int_equal(6, profile.len);
+	
+	// Stop at the destination, creep into it, and brake monotonically before that
+	assert_int_equal(0, profile.speeds[5]);
+	assert_int_equal(SPEED_PROFILE_SPEED_CREEP, profile.speeds[4]);
+	for (int i = 0; i < 4; i++) {
+		assert_true(profile.speeds[i] >= profile.speeds[i + 1]);
+		assert_true(profile.speeds[i] <= 120);
+	}
+	assert_true(profile.speed_max > SPEED_PROFILE_SPEED_CREEP);
+	
+	route_speed_profile_free(&profile);
+	assert_null(profile.speeds);
+}
+
+static bool route_is_not_route_0(const t_interlocking_route *route, void *context) {
+	return strcmp(route->id, "0") != 0;
+}
+
+static bool route_does_not_end_at(const t_interlocking_route *route, void *context) {
+	return strcmp(route->destination, (const char *) context) != 0;
+}
+
+static void route_planner(void **state) {
+	float plan_length = 0.0f;
+	GArray *plan = route_planner_plan("platform4", "platform1", NULL, NULL, &plan_length);
+	assert_non_null(plan);
+	assert_int_equal(2, plan->len);
+	assert_string_equal("0", g_array_index(plan, char *, 0));
+	assert_string_equal("30", g_array_index(plan, char *, 1));
+	assert_true(plan_length > 524.0f && plan_length < 524.5f);
+	g_array_free(plan, true);
+	
+	plan = route_planner_plan("platform4", "signal37", NULL, NULL, NULL);
+	assert_non_null(plan);
+	assert_int_equal(1, plan->len);
+	assert_string_equal("0", g_array_index(plan, char *, 0));
+	g_array_free(plan, true);
+	
+	// Avoiding route 0 (e.g., because it conflicts with a granted route) takes a longer detour
+	plan = route_planner_plan("platform4", "platform1", route_is_not_route_0, NULL, &plan_length);
+	assert_non_null(plan);
+	assert_int_equal(2, plan->len);
+	assert_string_equal("3", g_array_index(plan, char *, 0));
+	assert_string_equal("155", g_array_index(plan, char *, 1));
+	assert_true(plan_length > 544.0f && plan_length < 544.5f);
+	g_array_free(plan, true);
+	
+	// No alternative exists if no route may end at the target
+	assert_null(route_planner_plan("platform4", "signal37", route_does_not_end_at, "signal37", 
+	                               NULL));
+	
+	assert_null(route_planner_plan("platform4", "unknown", NULL, NULL, NULL));
+}
+
+static void json_response_builder(void **state) {
+	GString *json = g_string_new("");
+	append_start_of_obj(json, false);
+	append_field_str_value(json, "id", "a\"b\\c\n\x01", true);
+	append_field_int_value(json, "int", -42, true);
+	append_field_uint_value(json, "uint", 4294967295u, true);
+	append_field_float_value(json, "float", -15.125f, false);
+	append_end_of_obj(json, false);
+	assert_string_equal("{\n\"id\": \"a\\\"b\\\\c\\n\\u0001\",\n\"int\": -42,"
+	                    "\n\"uint\": 4294967295,\n\"float\": -15.125000\n}", json->str);
+	g_string_free(json, true);
+}
+
+static void response_encoding_cbor(void **state) {
+	const char json[] = "{\n\"a\": [1, -2, 300],\n\"b\": \"x\\n\",\n\"c\": true\n}";
+	const unsigned char expected[] = {
+		0xbf, 0x61, 'a', 0x9f, 0x01, 0x21, 0x19, 0x01, 0x2c, 0xff, 
+		0x61, 'b', 0x62, 'x', '\n', 0x61, 'c', 0xf5, 0xff
+	};
+	GString *cbor = response_encoding_json_to_cbor(json, strlen(json));
+	assert_non_null(cbor);
+	assert_int_equal(sizeof(expected), cbor->len);
+	assert_memory_equal(expected, cbor->str, sizeof(expected));
+	g_string_free(cbor, true);
+	
+	assert_null(response_encoding_json_to_cbor("[1,]", 4));
+}
+
+static void request_metrics_mutex(void **state) {
+	static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+	request_metrics_track_mutex(&mutex, "test_mutex");
+	request_metrics_mutex_lock(&mutex);
+	pthread_mutex_unlock(&mutex);
+	request_metrics_mutex_lock(&mutex);
+	pthread_mutex_unlock(&mutex);
+	
+	GString *metrics = request_metrics_prometheus();
+	assert_non_null(strstr(metrics->str, 
+	                       "swtbahn_mutex_acquisitions_total{mutex=\"test_mutex\"} 2\n"));
+	assert_non_null(strstr(metrics->str, 
+	                       "swtbahn_mutex_contended_total{mutex=\"test_mutex\"} 0\n"));
+	g_string_free(metrics, true);
+}
+
+static void bidib_messages_decode_types(void **state) {
+	const uint8_t occupancy[] = { 0x05, 0x00, 0x07, 0xa0, 0x03, 0x01 };
+	t_bidib_message_event event;
+	assert_true(bidib_messages_decode(occupancy, &event));
+	assert_int_equal(BIDIB_MESSAGE_FEEDBACK, event.message_class);
+	assert_int_equal(0x07, event.number);
+	assert_int_equal(0xa0, event.type);
+	assert_int_equal(2, event.data_len);
+	assert_int_equal(0x03, event.data[0]);
+	
+	const uint8_t accessory[] = { 0x05, 0x01, 0x00, 0x02, 0xb8, 0x04 };
+	assert_true(bidib_messages_decode(accessory, &event));
+	assert_int_equal(BIDIB_MESSAGE_ACCESSORY, event.message_class);
+	assert_int_equal(0x01, event.address[0]);
+	assert_int_equal(1, event.data_len);
+	
+	const uint8_t truncated[] = { 0x02, 0x01, 0x00 };
+	assert_false(bidib_messages_decode(truncated, &event));
+}
+
+// Mock verification server that answers the first two requests in reverse order.
+// A model containing "unsafe" does not satisfy its properties.
+typedef struct {
+	struct mg_mgr event_manager;
+	volatile bool running;
+	int connections;
+	int request_count;
+	unsigned int request_ids[2];
+	bool request_unsafe[2];
+} t_mock_verifier;
+
+typedef struct {
+	const char *model_file;
+	verif_result result;
+} t_mock_verification;
+
+static void mock_verifier_reply(struct mg_connection *c, const char *type, unsigned int id, 
+                                const char *status) {
+	char reply[256];
+	snprintf(reply, sizeof(reply), 
+	         "{\"__MESSAGE_TYPE__\":\"%s\",\"__REQUEST_ID__\":%u%s}", type, id, status);
+	mg_ws_send(c, reply, strlen(reply), WEBSOCKET_OP_TEXT);
+}
+
+static void mock_verifier_callback(struct mg_connection *c, int ev, void *ev_data, void *fn_data) {
+	t_mock_verifier *mock = fn_data;
+	if (ev == MG_EV_ACCEPT) {
+		mock->connections++;
+	} else if (ev == MG_EV_HTTP_MSG) {
+		mg_ws_upgrade(c, ev_data, NULL);
+	} else if (ev == MG_EV_WS_MSG && mock->request_count < 2) {
+		struct mg_ws_message *msg = ev_data;
+		GString *request = g_string_new_len(msg->data.ptr, msg->data.len);
+		const char *id = strstr(request->str, "\"__REQUEST_ID__\":");
+		const int i = mock->request_count++;
+		mock->request_ids[i] = 
+				id != NULL ? strtoul(id + strlen("\"__REQUEST_ID__\":"), NULL, 10) : 0;
+		mock->request_unsafe[i] = strstr(request->str, "unsafe") != NULL;
+		g_string_free(request, true);
+		mock_verifier_reply(c, "ENG_VERIFICATION_REQUEST_RECEIVED", mock->request_ids[i], "");
+		if (mock->request_count == 2) {
+			for (int j = 1; j >= 0; j--) {
+				mock_verifier_reply(c, "ENG_VERIFICATION_REQUEST_RESULT", mock->request_ids[j], 
+				                    mock->request_unsafe[j] ? ",\"status\":false" 
+				                                            : ",\"status\":true");
+			}
+		}
+	}
+}
+
+static void *mock_verifier_run(void *data) {
+	t_mock_verifier *mock = data;
+	while (mock->running) {
+		mg_mgr_poll(&mock->event_manager, 20);
+	}
+	return NULL;
+}
+
+static void *mock_verification_run(void *data) {
+	t_mock_verification *verification = data;
+	verification->result = verify_engine_model(verification->model_file);
+	return NULL;
+}
+
+static void verifier_client_mock(void **state) {
+	t_mock_verification verifications[2] = {
+		{ .model_file = "verifier_test_safe.sctx" }, 
+		{ .model_file = "verifier_test_unsafe.sctx" }
+	};
+	const char *models[2] = { "scchart safe {}", "scchart unsafe {}" };
+	for (int i = 0; i < 2; i++) {
+		FILE *file = fopen(verifications[i].model_file, "w");
+		assert_non_null(file);
+		fputs(models[i], file);
+		fclose(file);
+	}
+	
+	t_mock_verifier mock = { .running = true };
+	mg_mgr_init(&mock.event_manager);
+	struct mg_connection *listener = mg_http_listen(&mock.event_manager, "http://127.0.0.1:0", 
+	                                                mock_verifier_callback, &mock);
+	assert_non_null(listener);
+	char url[64];
+	snprintf(url, sizeof(url), "ws://127.0.0.1:%u/verify", mg_ntohs(listener->peer.port));
+	pthread_t mock_thread;
+	assert_int_equal(0, pthread_create(&mock_thread, NULL, mock_verifier_run, &mock));
+	
+	// Both verifications are outstanding at once, and share the connection
+	set_verifier_url(url);
+	verifier_client_start();
+	pthread_t verification_threads[2];
+	for (int i = 0; i < 2; i++) {
+		assert_int_equal(0, pthread_create(&verification_threads[i], NULL, 
+		                                   mock_verification_run, &verifications[i]));
+	}
+	for (int i = 0; i < 2; i++) {
+		pthread_join(verification_threads[i], NULL);
+		remove(verifications[i].model_file);
+	}
+	verifier_client_stop();
+	free_verifier_url();
+	mock.running = false;
+	pthread_join(mock_thread, NULL);
+	mg_mgr_free(&mock.event_manager);
+	
+	assert_int_equal(1, mock.connections);
+	assert_int_equal(2, mock.request_count);
+	assert_int_not_equal(mock.request_ids[0], mock.request_ids[1]);
+	assert_true(verifications[0].result.success);
+	assert_false(verifications[1].result.success);
+	assert_true(verifications[1].result.message_is_json_str);
+	assert_non_null(strstr(verifications[1].result.message->str, "\"status\":false"));
+	g_string_free(verifications[1].result.message, true);
+}
 
 int main(int argc, char **argv) {
 	openlog("swtbahn", 0, LOG_LOCAL0);
@@ -109,7 +360,14 @@ int main(int argc, char **argv) {
 			cmocka_unit_test(type_signal),
 			cmocka_unit_test(type_none),
 			cmocka_unit_test(main_segments),
-			cmocka_unit_test(overlaps)
+			cmocka_unit_test(overlaps),
+			cmocka_unit_test(route_speed_profile),
+			cmocka_unit_test(route_planner),
+			cmocka_unit_test(json_response_builder),
+			cmocka_unit_test(response_encoding_cbor),
+			cmocka_unit_test(request_metrics_mutex),
+			cmocka_unit_test(bidib_messages_decode_types),
+			cmocka_unit_test(verifier_client_mock)
 	};
 	
 	test_setup();
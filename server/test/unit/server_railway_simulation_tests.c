@@ -0,0 +1,165 @@
+/*
+ *
+ * Copyright (C) 2026 University of Bamberg, Software Technologies Research Group
+ * <https://www.uni-bamberg.de/>, <http://www.swt-bamberg.de/>
+ * 
+ * This file is part of the SWTbahn command line interface (swtbahn-cli), which is
+ * a client-server application to interactively control a BiDiB model railway.
+ *
+ * swtbahn-cli is licensed under the GNU GENERAL PUBLIC LICENSE (Version 3), see
+ * the LICENSE file at the project's top-level directory for details or consult
+ * <http://www.gnu.org/licenses/>.
+ *
+ * swtbahn-cli is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or any later version.
+ *
+ * swtbahn-cli is a RESEARCH PROTOTYPE and distributed WITHOUT ANY WARRANTY, without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. See the GNU General Public License for more details.
+ *
+ * The following people contributed to the conception and realization of the
+ * present swtbahn-cli (in alphabetic order by surname):
+ *
+ * - Nicolas Gross <https://github.com/nicolasgross>
+ * - Bernhard Luedtke <https://github.com/bluedtke>
+ *
+ */
+
+#include <syslog.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <cmocka.h>
+
+#include "../../src/railway_simulation.h"
+
+static const char *config_directory = "../../configurations/swtbahn-full/";
+
+#define MAGIC					0xfe
+#define ESCAPE					0xfd
+#define MSG_SYS_GET_MAGIC		0x01
+#define MSG_SYS_MAGIC			0x81
+
+static uint8_t crc8_update(uint8_t crc, uint8_t byte) {
+	crc ^= byte;
+	for (int i = 0; i < 8; i++) {
+		crc = (crc & 0x01) ? (crc >> 1) ^ 0x8c : (crc >> 1);
+	}
+	return crc;
+}
+
+// Sends a message without data to the interface (node 0) like libbidib
+static void write_message(uint8_t type) {
+	const uint8_t message[4] = { 3, 0x00, 0x00, type };
+	uint8_t crc = 0;
+	railway_simulation_write(MAGIC);
+	for (size_t i = 0; i < sizeof(message); i++) {
+		crc = crc8_update(crc, message[i]);
+		railway_simulation_write(message[i]);
+	}
+	railway_simulation_write(crc);
+	railway_simulation_write(MAGIC);
+}
+
+/**
+ * Reads the next packet from the simulated interface, unescaped and without its magic 
+ * bytes; returns its length (including the CRC), or 0 if nothing is waiting.
+ */
+static size_t read_packet(uint8_t packet[], size_t packet_len_max) {
+	size_t len = 0;
+	bool escaped = false;
+	int byte_read = 0;
+	uint8_t byte = railway_simulation_read(&byte_read);
+	if (!byte_read) {
+		return 0;
+	}
+	// Every packet starts with a magic byte
+	assert_int_equal(byte, MAGIC);
+	while (true) {
+		byte = railway_simulation_read(&byte_read);
+		// Packets are only queued whole, so the rest of the packet is waiting
+		assert_true(byte_read);
+		if (byte == MAGIC) {
+			return len;
+		} else if (byte == ESCAPE) {
+			escaped = true;
+		} else {
+			assert_true(len < packet_len_max);
+			packet[len++] = escaped ? byte ^ 0x20 : byte;
+			escaped = false;
+		}
+	}
+}
+
+// Checks that a packet holds a single valid magic reply of the interface
+static void assert_magic_reply(const uint8_t packet[], size_t len) {
+	uint8_t crc = 0;
+	for (size_t i = 0; i < len; i++) {
+		crc = crc8_update(crc, packet[i]);
+	}
+	assert_int_equal(crc, 0);
+	// Length, address 0, message number, type, magic (0xfe, 0xaf) and CRC
+	assert_int_equal(len, 7);
+	assert_int_equal(packet[0], 5);
+	assert_int_equal(packet[1], 0x00);
+	assert_int_equal(packet[3], MSG_SYS_MAGIC);
+	assert_int_equal(packet[4], 0xfe);
+	assert_int_equal(packet[5], 0xaf);
+}
+
+static void simulation_round_trip(void **state) {
+	assert_true(railway_simulation_start(config_directory));
+	
+	write_message(MSG_SYS_GET_MAGIC);
+	uint8_t packet[256];
+	const size_t len = read_packet(packet, sizeof(packet));
+	assert_magic_reply(packet, len);
+	assert_int_equal(read_packet(packet, sizeof(packet)), 0);
+	
+	railway_simulation_stop();
+}
+
+static void simulation_uplink_overflow(void **state) {
+	assert_true(railway_simulation_start(config_directory));
+	
+	// More replies than fit into the uplink while nothing is read
+	const unsigned int request_count = RAILWAY_SIMULATION_UPLINK_LEN / 4;
+	for (unsigned int i = 0; i < request_count; i++) {
+		write_message(MSG_SYS_GET_MAGIC);
+	}
+	unsigned int reply_count = 0;
+	uint8_t packet[256];
+	size_t len;
+	while ((len = read_packet(packet, sizeof(packet))) > 0) {
+		// Only whole replies are waiting, the others have been dropped
+		assert_magic_reply(packet, len);
+		reply_count++;
+	}
+	assert_true(reply_count > 0);
+	assert_true(reply_count < request_count);
+	
+	// Replies are queued again once libbidib has caught up
+	write_message(MSG_SYS_GET_MAGIC);
+	len = read_packet(packet, sizeof(packet));
+	assert_magic_reply(packet, len);
+	
+	railway_simulation_stop();
+}
+
+int main(int argc, char **argv) {
+	openlog("swtbahn", 0, LOG_LOCAL0);
+	syslog(LOG_INFO, "server_railway_simulation_tests: %s", "Railway simulation tests started");
+	
+	const struct CMUnitTest tests[] = {
+			cmocka_unit_test(simulation_round_trip),
+			cmocka_unit_test(simulation_uplink_overflow)
+	};
+	
+	int ret = cmocka_run_group_tests(tests, NULL, NULL);
+	
+	syslog(LOG_INFO, "server_railway_simulation_tests: %s", "Railway simulation tests stopped");
+	closelog();
+	return ret;
+}